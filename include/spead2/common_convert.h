@@ -0,0 +1,73 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Copy functions that convert the data type or byte order of each element.
+ */
+
+#ifndef SPEAD2_COMMON_CONVERT_H
+#define SPEAD2_COMMON_CONVERT_H
+
+#include <cstddef>
+#include <spead2/common_features.h>
+
+namespace spead2
+{
+
+/// Element conversions supported by @ref get_convert_function
+enum convert_function_id : unsigned int
+{
+    CONVERT_BSWAP16,            ///< Reverse the bytes of each 16-bit element
+    CONVERT_BSWAP32,            ///< Reverse the bytes of each 32-bit element
+    CONVERT_BSWAP64,            ///< Reverse the bytes of each 64-bit element
+    CONVERT_INT8_INT16,         ///< Sign-extend 8-bit integers to (native-endian) 16-bit integers
+    CONVERT_INT16_FLOAT32,      ///< Convert native-endian 16-bit integers to single-precision floats
+    CONVERT_INT16BE_FLOAT32     ///< Convert big-endian 16-bit integers to single-precision floats
+};
+
+/**
+ * Function that converts @a n elements from @a src and writes them to
+ * @a dest. The regions must not overlap.
+ */
+typedef void (*convert_function)(void * __restrict__ dest, const void * __restrict__ src, std::size_t n) noexcept;
+
+/**
+ * Get an implementation of a conversion. The fastest implementation
+ * supported by the CPU (and enabled at compile time) is chosen.
+ *
+ * @throw std::invalid_argument if @a id is not a known conversion
+ */
+convert_function get_convert_function(convert_function_id id);
+
+/**
+ * Get the size in bytes of each input element of a conversion.
+ *
+ * @throw std::invalid_argument if @a id is not a known conversion
+ */
+std::size_t get_convert_input_size(convert_function_id id);
+
+/**
+ * Get the size in bytes of each output element of a conversion.
+ *
+ * @throw std::invalid_argument if @a id is not a known conversion
+ */
+std::size_t get_convert_output_size(convert_function_id id);
+
+} // namespace spead2
+
+#endif // SPEAD2_COMMON_CONVERT_H
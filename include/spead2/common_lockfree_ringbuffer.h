@@ -0,0 +1,565 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Lock-free ring buffer.
+ */
+
+#ifndef SPEAD2_COMMON_LOCKFREE_RINGBUFFER_H
+#define SPEAD2_COMMON_LOCKFREE_RINGBUFFER_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/common_storage.h>
+
+namespace spead2
+{
+
+namespace detail
+{
+
+/**
+ * Waiting strategy for @ref lockfree_ringbuffer: spin for a while, then block
+ * on a condition variable. Notification only takes the mutex if some thread
+ * is actually blocked, so that it is cheap when the other side is keeping up.
+ */
+class spin_then_block
+{
+private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<unsigned int> waiters{0};
+
+    static void relax()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+public:
+    /// Wait until @a ready returns true
+    template<typename Pred>
+    void wait(std::size_t spins, Pred &&ready)
+    {
+        for (std::size_t i = 0; i < spins; i++)
+        {
+            if (ready())
+                return;
+            relax();
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        // Pairs with the fence in notify, so that either we see the
+        // new state or the notifier sees us waiting.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cond.wait(lock, ready);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /// Wake up any blocked waiters. Must be called after updating the state.
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cond.notify_all();
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * Ring buffer with the same interface and stop semantics as @ref ringbuffer,
+ * but where pushing and popping do not take any locks or make system calls
+ * unless the ring buffer is full or empty. It can be used as the
+ * @c Ringbuffer template parameter of @ref recv::ring_stream, or as the
+ * data or free ring of @ref recv::chunk_ring_stream.
+ *
+ * It is safe for multiple producers and consumers, but is most efficient
+ * with a single producer and a single consumer. When it is necessary to wait,
+ * the caller first spins (for a number of iterations given to the
+ * constructor) and then blocks. It does not use semaphores, so it cannot be
+ * waited on with a file descriptor, and extra arguments to @ref push and
+ * @ref pop are ignored.
+ *
+ * \internal
+ *
+ * This is a bounded queue in the style of Dmitry Vyukov's MPMC queue. Each
+ * slot has a sequence number that indicates whether it is ready to be
+ * written (equal to twice the enqueue position) or read (twice the enqueue
+ * position plus one). Doubling keeps the two states distinct even when the
+ * capacity is 1. The top bit of @ref enqueue_pos is the stop flag, so that
+ * stopping and pushing are serialised by the same atomic. The remaining bits
+ * at the time of stopping give the position at which consumers should see
+ * @ref ringbuffer_stopped.
+ */
+template<typename T>
+class lockfree_ringbuffer
+{
+private:
+    static constexpr std::size_t stop_bit = std::size_t(1) << (sizeof(std::size_t) * CHAR_BIT - 1);
+
+    struct slot
+    {
+        std::atomic<std::size_t> seq;
+        detail::storage<T> data;
+    };
+
+    enum class status
+    {
+        success,
+        blocked,   ///< Full (for push) or empty (for pop)
+        stopped
+    };
+
+    const std::size_t cap;
+    const std::size_t spins;
+    std::unique_ptr<slot[]> slots;
+    alignas(64) std::atomic<std::size_t> enqueue_pos{0};
+    alignas(64) std::atomic<std::size_t> dequeue_pos{0};
+    alignas(64) std::atomic<std::size_t> producers{0};
+    detail::spin_then_block data_waiter;    ///< Waited on by consumers
+    detail::spin_then_block space_waiter;   ///< Waited on by producers
+
+    status push_internal(T &&value);
+    status pop_internal(std::optional<T> &out);
+    bool can_push() const;
+    bool can_pop() const;
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param cap     Maximum number of items held at once
+     * @param spins   Number of times to poll before blocking
+     */
+    explicit lockfree_ringbuffer(std::size_t cap, std::size_t spins = 1000);
+    ~lockfree_ringbuffer();
+
+    /// Maximum number of items that can be held at once
+    std::size_t capacity() const { return cap; }
+
+    /**
+     * Return the number of items currently in the ringbuffer. This should
+     * only be used for metrics.
+     */
+    std::size_t size() const;
+
+    /// @copydoc ringbuffer::try_push
+    void try_push(T &&value);
+
+    /// @copydoc ringbuffer::try_emplace
+    template<typename... Args>
+    void try_emplace(Args&&... args) { try_push(T(std::forward<Args>(args)...)); }
+
+    /// @copydoc ringbuffer::push
+    template<typename... SemArgs>
+    void push(T &&value, SemArgs&&... sem_args);
+
+    /// @copydoc ringbuffer::emplace
+    template<typename... Args>
+    void emplace(Args&&... args) { push(T(std::forward<Args>(args)...)); }
+
+    /// @copydoc ringbuffer::try_pop
+    T try_pop();
+
+    /// @copydoc ringbuffer::pop
+    template<typename... SemArgs>
+    T pop(SemArgs&&... sem_args);
+
+    /// @copydoc ringbuffer::push_many
+    template<typename ForwardIt, typename... SemArgs>
+    void push_many(ForwardIt first, ForwardIt last, SemArgs&&... sem_args);
+
+    /// @copydoc ringbuffer::try_push_many
+    template<typename ForwardIt>
+    std::size_t try_push_many(ForwardIt first, ForwardIt last);
+
+    /// @copydoc ringbuffer::pop_many
+    template<typename OutputIt, typename... SemArgs>
+    std::size_t pop_many(OutputIt out, std::size_t max_items, SemArgs&&... sem_args);
+
+    /// @copydoc ringbuffer::try_pop_many
+    template<typename OutputIt>
+    std::size_t try_pop_many(OutputIt out, std::size_t max_items);
+
+    /// @copydoc ringbuffer::stop
+    bool stop();
+
+    /// @copydoc ringbuffer_base::add_producer
+    void add_producer();
+
+    /// @copydoc ringbuffer::remove_producer
+    bool remove_producer();
+
+    /// @copydoc ringbuffer::begin
+    detail::ringbuffer_iterator<lockfree_ringbuffer> begin();
+    /// @copydoc ringbuffer::end
+    detail::ringbuffer_sentinel end();
+};
+
+template<typename T>
+lockfree_ringbuffer<T>::lockfree_ringbuffer(std::size_t cap, std::size_t spins)
+    : cap(cap), spins(spins), slots(new slot[cap])
+{
+    assert(cap > 0);
+    for (std::size_t i = 0; i < cap; i++)
+        slots[i].seq.store(2 * i, std::memory_order_relaxed);
+}
+
+template<typename T>
+lockfree_ringbuffer<T>::~lockfree_ringbuffer()
+{
+    // Drain any remaining elements
+    std::size_t tail = enqueue_pos.load(std::memory_order_relaxed) & ~stop_bit;
+    for (std::size_t pos = dequeue_pos.load(std::memory_order_relaxed); pos != tail; pos++)
+    {
+        slot &s = slots[pos % cap];
+        if (s.seq.load(std::memory_order_relaxed) == 2 * pos + 1)
+            s.data.destroy();
+    }
+}
+
+template<typename T>
+std::size_t lockfree_ringbuffer<T>::size() const
+{
+    std::size_t head = dequeue_pos.load(std::memory_order_relaxed);
+    std::size_t tail = enqueue_pos.load(std::memory_order_relaxed) & ~stop_bit;
+    return tail > head ? tail - head : 0;
+}
+
+template<typename T>
+auto lockfree_ringbuffer<T>::push_internal(T &&value) -> status
+{
+    std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        if (pos & stop_bit)
+            return status::stopped;
+        slot &s = slots[pos % cap];
+        std::size_t seq = s.seq.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = std::ptrdiff_t(seq - 2 * pos);
+        if (diff == 0)
+        {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                s.data.construct(std::move(value));
+                s.seq.store(2 * pos + 1, std::memory_order_release);
+                return status::success;
+            }
+            // On failure, pos has been updated
+        }
+        else if (diff < 0)
+        {
+            // The slot still holds an item from the previous lap. Re-check
+            // the stop flag so that a stopped, full ring reports stopped.
+            std::size_t cur = enqueue_pos.load(std::memory_order_relaxed);
+            if (cur == pos)
+                return status::blocked;
+            pos = cur;
+        }
+        else
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+auto lockfree_ringbuffer<T>::pop_internal(std::optional<T> &out) -> status
+{
+    std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        slot &s = slots[pos % cap];
+        std::size_t seq = s.seq.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = std::ptrdiff_t(seq - (2 * pos + 1));
+        if (diff == 0)
+        {
+            if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                out.emplace(std::move(*s.data));
+                s.data.destroy();
+                s.seq.store(2 * (pos + cap), std::memory_order_release);
+                return status::success;
+            }
+        }
+        else if (diff < 0)
+        {
+            std::size_t tail = enqueue_pos.load(std::memory_order_acquire);
+            std::size_t cur = dequeue_pos.load(std::memory_order_relaxed);
+            if (cur != pos)
+                pos = cur;
+            else if ((tail & stop_bit) && (tail & ~stop_bit) == pos)
+                return status::stopped;
+            else
+                return status::blocked;
+        }
+        else
+            pos = dequeue_pos.load(std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+bool lockfree_ringbuffer<T>::can_push() const
+{
+    std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    if (pos & stop_bit)
+        return true;   // push will report the stop
+    const slot &s = slots[pos % cap];
+    return std::ptrdiff_t(s.seq.load(std::memory_order_acquire) - 2 * pos) >= 0;
+}
+
+template<typename T>
+bool lockfree_ringbuffer<T>::can_pop() const
+{
+    std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    const slot &s = slots[pos % cap];
+    if (std::ptrdiff_t(s.seq.load(std::memory_order_acquire) - (2 * pos + 1)) >= 0)
+        return true;
+    return (enqueue_pos.load(std::memory_order_acquire) & stop_bit) != 0;
+}
+
+template<typename T>
+void lockfree_ringbuffer<T>::try_push(T &&value)
+{
+    switch (push_internal(std::move(value)))
+    {
+    case status::success:
+        data_waiter.notify();
+        break;
+    case status::blocked:
+        throw ringbuffer_full();
+    case status::stopped:
+        throw ringbuffer_stopped();
+    }
+}
+
+template<typename T>
+template<typename... SemArgs>
+void lockfree_ringbuffer<T>::push(T &&value, SemArgs&&...)
+{
+    while (true)
+    {
+        switch (push_internal(std::move(value)))
+        {
+        case status::success:
+            data_waiter.notify();
+            return;
+        case status::blocked:
+            space_waiter.wait(spins, [this] { return can_push(); });
+            break;
+        case status::stopped:
+            throw ringbuffer_stopped();
+        }
+    }
+}
+
+template<typename T>
+T lockfree_ringbuffer<T>::try_pop()
+{
+    std::optional<T> out;
+    switch (pop_internal(out))
+    {
+    case status::success:
+        space_waiter.notify();
+        break;
+    case status::blocked:
+        throw ringbuffer_empty();
+    case status::stopped:
+        throw ringbuffer_stopped();
+    }
+    return std::move(*out);
+}
+
+template<typename T>
+template<typename... SemArgs>
+T lockfree_ringbuffer<T>::pop(SemArgs&&...)
+{
+    std::optional<T> out;
+    while (true)
+    {
+        switch (pop_internal(out))
+        {
+        case status::success:
+            space_waiter.notify();
+            return std::move(*out);
+        case status::blocked:
+            data_waiter.wait(spins, [this] { return can_pop(); });
+            break;
+        case status::stopped:
+            throw ringbuffer_stopped();
+        }
+    }
+}
+
+template<typename T>
+template<typename ForwardIt, typename... SemArgs>
+void lockfree_ringbuffer<T>::push_many(ForwardIt first, ForwardIt last, SemArgs&&...)
+{
+    bool pushed = false;
+    while (first != last)
+    {
+        switch (push_internal(std::move(*first)))
+        {
+        case status::success:
+            pushed = true;
+            ++first;
+            break;
+        case status::blocked:
+            // Let consumers at what we've pushed so far before waiting
+            if (pushed)
+                data_waiter.notify();
+            pushed = false;
+            space_waiter.wait(spins, [this] { return can_push(); });
+            break;
+        case status::stopped:
+            if (pushed)
+                data_waiter.notify();
+            throw ringbuffer_stopped();
+        }
+    }
+    if (pushed)
+        data_waiter.notify();
+}
+
+template<typename T>
+template<typename ForwardIt>
+std::size_t lockfree_ringbuffer<T>::try_push_many(ForwardIt first, ForwardIt last)
+{
+    std::size_t n = 0;
+    for (; first != last; ++first)
+    {
+        status result = push_internal(std::move(*first));
+        if (result == status::success)
+            n++;
+        else if (n > 0)
+            break;
+        else if (result == status::blocked)
+            throw ringbuffer_full();
+        else
+            throw ringbuffer_stopped();
+    }
+    if (n > 0)
+        data_waiter.notify();
+    return n;
+}
+
+template<typename T>
+template<typename OutputIt, typename... SemArgs>
+std::size_t lockfree_ringbuffer<T>::pop_many(OutputIt out, std::size_t max_items, SemArgs&&...)
+{
+    if (max_items == 0)
+        return 0;
+    *out = pop();
+    ++out;
+    std::size_t n = 1;
+    std::optional<T> item;
+    while (n < max_items && pop_internal(item) == status::success)
+    {
+        *out = std::move(*item);
+        ++out;
+        item.reset();
+        n++;
+    }
+    if (n > 1)
+        space_waiter.notify();
+    return n;
+}
+
+template<typename T>
+template<typename OutputIt>
+std::size_t lockfree_ringbuffer<T>::try_pop_many(OutputIt out, std::size_t max_items)
+{
+    std::size_t n = 0;
+    std::optional<T> item;
+    while (n < max_items)
+    {
+        status result = pop_internal(item);
+        if (result == status::success)
+        {
+            *out = std::move(*item);
+            ++out;
+            item.reset();
+            n++;
+        }
+        else if (n > 0)
+            break;
+        else if (result == status::blocked)
+            throw ringbuffer_empty();
+        else
+            throw ringbuffer_stopped();
+    }
+    if (n > 0)
+        space_waiter.notify();
+    return n;
+}
+
+template<typename T>
+bool lockfree_ringbuffer<T>::stop()
+{
+    std::size_t old = enqueue_pos.fetch_or(stop_bit, std::memory_order_acq_rel);
+    if (old & stop_bit)
+        return false;
+    data_waiter.notify();
+    space_waiter.notify();
+    return true;
+}
+
+template<typename T>
+void lockfree_ringbuffer<T>::add_producer()
+{
+    producers.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<typename T>
+bool lockfree_ringbuffer<T>::remove_producer()
+{
+    std::size_t old = producers.fetch_sub(1, std::memory_order_acq_rel);
+    assert(old != 0);
+    if (old == 1)
+        return stop();
+    else
+        return false;
+}
+
+template<typename T>
+auto lockfree_ringbuffer<T>::begin() -> detail::ringbuffer_iterator<lockfree_ringbuffer>
+{
+    return detail::ringbuffer_iterator(*this);
+}
+
+template<typename T>
+detail::ringbuffer_sentinel lockfree_ringbuffer<T>::end()
+{
+    return detail::ringbuffer_sentinel();
+}
+
+} // namespace spead2
+
+#endif // SPEAD2_COMMON_LOCKFREE_RINGBUFFER_H
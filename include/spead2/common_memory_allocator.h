@@ -147,6 +147,8 @@ private:
  *   when pre-faulting the hard way.
  * - it is possible to specify additional flags, e.g. MAP_HUGETLB or
  *   MAP_LOCKED.
+ * - the memory can be bound to a NUMA node, regardless of which thread
+ *   allocates it (see @ref thread_pool::get_numa_node).
  *
  * @internal
  *
@@ -158,6 +160,7 @@ class mmap_allocator : public memory_allocator
 public:
     const int flags;         ///< Requested flags given to constructor
     const bool prefer_huge;  ///< Whether to prefer huge pages
+    const int numa_node;     ///< NUMA node to bind memory to, or -1 for no binding
 
     /**
      * Constructor.
@@ -166,8 +169,11 @@ public:
      * @param prefer_huge  If true, allocations will try to use huge pages
      *                     (if supported by the OS), and fall back to normal
      *                     pages if that fails.
+     * @param numa_node    If non-negative, bind the memory to this NUMA node
+     *                     (with @c mbind) before faulting it in. Failure to
+     *                     bind is logged but does not cause an exception.
      */
-    explicit mmap_allocator(int flags = 0, bool prefer_huge = false);
+    explicit mmap_allocator(int flags = 0, bool prefer_huge = false, int numa_node = -1);
 
     virtual pointer allocate(std::size_t size, void *hint) override;
 };
@@ -23,10 +23,13 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <atomic>
 #include <mutex>
 #include <stack>
+#include <vector>
 #include <memory>
 #include <optional>
+#include <future>
 #include <boost/asio.hpp>
 #include <spead2/common_thread_pool.h>
 #include <spead2/common_memory_allocator.h>
@@ -34,7 +37,21 @@
 namespace spead2
 {
 
-namespace detail { class memory_pool_deleter; }
+namespace detail
+{
+
+class memory_pool_deleter;
+class memory_pool_thread_owner;
+
+// Free buffers cached for a single thread. It is only accessed by that thread.
+struct alignas(64) memory_pool_thread_cache
+{
+    /// Unique identifier of the thread that owns the cache (0 if none yet)
+    std::uint64_t owner = 0;
+    std::vector<memory_allocator::pointer> items;
+};
+
+} // namespace detail
 
 /**
  * Memory allocator that pre-allocates memory and recycles it. This wastes
@@ -49,11 +66,22 @@ namespace detail { class memory_pool_deleter; }
  * drop its references, even if there is still memory that has been allocated
  * and not yet freed.
  *
+ * Optionally, each thread can keep a small cache of free buffers in front of
+ * the shared pool (see @ref set_thread_cache_size). Allocations and frees
+ * that hit the cache do not take the lock. Buffers move between a thread's
+ * cache and the shared pool in batches, and are returned to the shared pool
+ * when the thread exits. Buffers in thread caches count towards @a max_free.
+ *
  * This class is thread-safe.
  */
 class memory_pool : public memory_allocator
 {
     friend class detail::memory_pool_deleter;
+    friend class detail::memory_pool_thread_owner;
+
+public:
+    /// Maximum number of concurrent threads that can have thread caches
+    static constexpr std::size_t max_thread_caches = 64;
 
 private:
     std::optional<io_service_ref> io_service;
@@ -64,11 +92,27 @@ private:
     std::stack<pointer> pool;
     bool refilling = false;
     bool warn_on_empty = true;
+    /// Total number of free buffers (in @ref pool and in thread caches)
+    std::atomic<std::size_t> n_free{0};
+    /// Maximum number of buffers in each thread cache (0 to disable)
+    std::atomic<std::size_t> thread_cache_size{0};
+    /// Thread caches, indexed by a per-thread slot number
+    std::unique_ptr<detail::memory_pool_thread_cache[]> thread_caches;
+    /// Pooled allocations satisfied from free memory
+    std::atomic<std::uint64_t> hits{0};
+    /// Pooled allocations that required a new allocation
+    std::atomic<std::uint64_t> misses{0};
 
     // Like shared_from_this but pointer has the right type
     std::shared_ptr<memory_pool> shared_this();
     // Called by memory_pool_deleter to return a pointer to the pool
     void free_impl(std::uint8_t *ptr, memory_allocator::deleter &&base_deleter);
+    // Increment n_free if it is less than max_free, returning true on success
+    bool reserve_free();
+    // Get the cache for the calling thread, or nullptr if it does not have one
+    detail::memory_pool_thread_cache *get_thread_cache();
+    // Move the contents of a thread cache to the shared pool
+    void flush_thread_cache(std::size_t index);
     // Makes ourself the owner
     pointer convert(pointer &&base);
     static void refill(std::size_t upper, std::shared_ptr<memory_allocator> allocator,
@@ -91,6 +135,42 @@ public:
                 std::shared_ptr<memory_allocator> allocator = nullptr);
     bool get_warn_on_empty() const;
     void set_warn_on_empty(bool warn);
+
+    /**
+     * Set the maximum number of free buffers that each thread may cache.
+     * The default is 0, which disables thread caches so that every
+     * allocation and free goes through the shared pool.
+     *
+     * Thread caches reduce lock contention when several threads allocate and
+     * free buffers, at the cost of free buffers possibly being held by one
+     * thread while another finds the shared pool empty. Only the first
+     * @ref max_thread_caches threads to use the pool concurrently get
+     * a cache. This should be set before the pool is used: reducing it does
+     * not immediately flush buffers already held in other threads' caches.
+     */
+    void set_thread_cache_size(std::size_t size);
+    std::size_t get_thread_cache_size() const;
+
+    /**
+     * Add up to @a n buffers to the free pool in the background. Each
+     * buffer is allocated (and hence prefaulted) by a separate task posted
+     * to @a io_service, so the work is spread over its threads. If those
+     * threads have affinity, the memory is first touched on their NUMA node.
+     * Buffers that would exceed @a max_free are discarded.
+     *
+     * This allows a large pool to be constructed with @a initial set to 0
+     * and then populated in parallel.
+     *
+     * @returns A future that becomes ready when all the buffers have been
+     * added. If any allocation fails, it holds the exception.
+     */
+    std::future<void> warm_up(io_service_ref io_service, std::size_t n);
+
+    /// Number of allocations in the pooled range that were satisfied from free memory
+    std::uint64_t get_hits() const;
+    /// Number of allocations in the pooled range that required a new allocation
+    std::uint64_t get_misses() const;
+
     virtual pointer allocate(std::size_t size, void *hint) override;
 
     /**
@@ -0,0 +1,79 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Helpers for warming up memory in parallel on a thread pool.
+ */
+
+#ifndef SPEAD2_COMMON_PREFAULT_H
+#define SPEAD2_COMMON_PREFAULT_H
+
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <spead2/common_thread_pool.h>
+
+namespace spead2
+{
+
+namespace detail
+{
+
+/**
+ * Tracks a fixed number of asynchronous tasks, and makes a future ready
+ * once all of them have completed. If any task fails, the future holds the
+ * first exception.
+ */
+class completion_countdown
+{
+private:
+    std::mutex mutex;
+    std::size_t remaining;
+    std::exception_ptr error;
+    std::promise<void> promise;
+
+public:
+    explicit completion_countdown(std::size_t tasks);
+
+    std::future<void> get_future() { return promise.get_future(); }
+    /// Mark one task as complete, optionally with an error
+    void complete(std::exception_ptr e = nullptr);
+};
+
+} // namespace detail
+
+/**
+ * Fault in the pages of a memory region, using the threads of
+ * @a io_service. The region is split at page boundaries into at most
+ * @a parts pieces of roughly equal size, each of which is touched by one
+ * task. When the thread pool has affinity, the pages are thus first touched
+ * (and hence placed) on the NUMA node of its threads.
+ *
+ * The contents of the memory are preserved, but it must not be modified
+ * concurrently. The memory must remain valid until the returned future is
+ * ready.
+ *
+ * @returns A future that becomes ready when all the memory has been touched
+ */
+std::future<void> prefault_async(
+    io_service_ref io_service, void *ptr, std::size_t size, std::size_t parts);
+
+} // namespace spead2
+
+#endif // SPEAD2_COMMON_PREFAULT_H
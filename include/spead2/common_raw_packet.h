@@ -55,6 +55,13 @@ mac_address multicast_mac(const boost::asio::ip::address &address);
  */
 mac_address interface_mac(const boost::asio::ip::address &address);
 
+/**
+ * Determine the index of an interface, given the interface's IP address.
+ *
+ * @throw std::runtime_error if no interface with this IP address is found.
+ */
+unsigned int interface_index(const boost::asio::ip::address &address);
+
 class packet_buffer
 {
 private:
@@ -34,6 +34,7 @@
 #include <climits>
 #include <iostream>
 #include <new>
+#include <iterator>
 #include <spead2/common_logging.h>
 #include <spead2/common_semaphore.h>
 #include <spead2/common_storage.h>
@@ -199,6 +200,24 @@ protected:
     /// Implementation of popping functions, which doesn't touch semaphores
     T pop_internal();
 
+    /**
+     * Implementation of pushing multiple items, which doesn't touch
+     * semaphores. Exactly @a n items are moved from @a first, which is
+     * advanced past them.
+     */
+    template<typename InputIt>
+    void push_many_internal(InputIt &first, std::size_t n);
+
+    /**
+     * Implementation of popping multiple items, which doesn't touch
+     * semaphores. Up to @a max_items are moved to @a out, stopping early
+     * if the stop position is reached.
+     *
+     * @returns the number of items popped
+     */
+    template<typename OutputIt>
+    std::size_t pop_many_internal(OutputIt &out, std::size_t max_items);
+
     /**
      * Implementation of stopping, without the semaphores.
      *
@@ -314,6 +333,40 @@ T ringbuffer_base<T>::pop_internal()
     return result;
 }
 
+template<typename T>
+template<typename InputIt>
+void ringbuffer_base<T>::push_many_internal(InputIt &first, std::size_t n)
+{
+    std::lock_guard<std::mutex> lock(tail_mutex);
+    if (stopped)
+    {
+        throw ringbuffer_stopped();
+    }
+    for (std::size_t i = 0; i < n; i++, ++first)
+    {
+        storage[tail].construct(std::move(*first));
+        tail = next(tail);
+    }
+}
+
+template<typename T>
+template<typename OutputIt>
+std::size_t ringbuffer_base<T>::pop_many_internal(OutputIt &out, std::size_t max_items)
+{
+    std::lock_guard<std::mutex> lock(head_mutex);
+    std::size_t n = 0;
+    while (n < max_items && head != stop_position)
+    {
+        auto &item = storage[head];
+        *out = std::move(*item);
+        ++out;
+        item.destroy();
+        head = next(head);
+        n++;
+    }
+    return n;
+}
+
 template<typename T>
 bool ringbuffer_base<T>::stop_internal(bool remove_producer)
 {
@@ -377,6 +430,13 @@ void ringbuffer_base<T>::add_producer()
  * observe a stop condition after downing a semaphore will re-up it. This
  * causes the semaphore to be transiently unavailable, which leads to the need
  * for @ref throw_empty_or_stopped and @ref throw_full_or_stopped.
+ *
+ * The batched functions (@ref push_many, @ref pop_many and their
+ * non-blocking variants) down the semaphore once (blocking if needed), then
+ * down it without blocking as many more times as they can use. The items are
+ * then transferred with a single lock acquisition and the other semaphore is
+ * upped once for the whole batch. Any reservations that were not used
+ * because of a stop are returned.
  */
 template<typename T, typename DataSemaphore = semaphore, typename SpaceSemaphore = semaphore>
 class ringbuffer : public ringbuffer_base<T>
@@ -385,6 +445,23 @@ private:
     DataSemaphore data_sem;     ///< Number of filled slots
     SpaceSemaphore space_sem;   ///< Number of available slots
 
+    /**
+     * Down @a sem without blocking until it has been downed @a reserved
+     * times in total or would block.
+     *
+     * @returns the total number of reservations
+     */
+    template<typename Semaphore>
+    static std::size_t reserve_more(Semaphore &sem, std::size_t reserved, std::size_t max_items);
+
+    /// Push @a reserved items from @a first, given that @a reserved slots were reserved
+    template<typename ForwardIt>
+    void push_reserved(ForwardIt &first, std::size_t reserved);
+
+    /// Pop up to @a reserved items to @a out, given that @a reserved items were reserved
+    template<typename OutputIt>
+    std::size_t pop_reserved(OutputIt &out, std::size_t reserved);
+
 public:
     explicit ringbuffer(std::size_t cap);
 
@@ -446,6 +523,56 @@ public:
     template<typename... SemArgs>
     T pop(SemArgs&&... sem_args);
 
+    /**
+     * Append the items in [@a first, @a last) to the queue, blocking as
+     * necessary. Items are moved in batches, taking the lock once for as
+     * many items as there is space for.
+     *
+     * If the queue is stopped part-way through, some items may already
+     * have been pushed (and hence moved from).
+     *
+     * @param first, last  Range of items to move
+     * @param sem_args     Arbitrary arguments to pass to the space semaphore
+     * @throw ringbuffer_stopped if @ref stop is called first
+     */
+    template<typename ForwardIt, typename... SemArgs>
+    void push_many(ForwardIt first, ForwardIt last, SemArgs&&... sem_args);
+
+    /**
+     * Append as many of the items in [@a first, @a last) as there is space
+     * for, without blocking.
+     *
+     * @returns the number of items pushed (which will be the first items of the range)
+     * @throw ringbuffer_full if the range is non-empty and there is no space
+     * @throw ringbuffer_stopped if @ref stop has already been called
+     */
+    template<typename ForwardIt>
+    std::size_t try_push_many(ForwardIt first, ForwardIt last);
+
+    /**
+     * Retrieve up to @a max_items items from the queue, blocking until at
+     * least one is available or until the queue is stopped. Items that are
+     * already available are retrieved with a single lock acquisition.
+     *
+     * @param out        Output iterator to which the items are written
+     * @param max_items  Maximum number of items to retrieve
+     * @param sem_args   Arbitrary arguments to pass to the data semaphore
+     * @returns the number of items retrieved, which is only zero if @a max_items is zero
+     * @throw ringbuffer_stopped if the queue is empty and @ref stop was called
+     */
+    template<typename OutputIt, typename... SemArgs>
+    std::size_t pop_many(OutputIt out, std::size_t max_items, SemArgs&&... sem_args);
+
+    /**
+     * Retrieve up to @a max_items items from the queue, if there are any.
+     *
+     * @returns the number of items retrieved, which is only zero if @a max_items is zero
+     * @throw ringbuffer_stopped if the queue is empty and @ref stop was called
+     * @throw ringbuffer_empty if the queue is empty but still active
+     */
+    template<typename OutputIt>
+    std::size_t try_pop_many(OutputIt out, std::size_t max_items);
+
     /**
      * Indicate that no more items will be produced. This does not immediately
      * stop consumers if there are still items in the queue; instead,
@@ -603,6 +730,106 @@ T ringbuffer<T, DataSemaphore, SpaceSemaphore>::try_pop()
     }
 }
 
+template<typename T, typename DataSemaphore, typename SpaceSemaphore>
+template<typename Semaphore>
+std::size_t ringbuffer<T, DataSemaphore, SpaceSemaphore>::reserve_more(
+    Semaphore &sem, std::size_t reserved, std::size_t max_items)
+{
+    if (reserved < max_items)
+        reserved += sem.try_get_many(max_items - reserved);
+    return reserved;
+}
+
+template<typename T, typename DataSemaphore, typename SpaceSemaphore>
+template<typename ForwardIt>
+void ringbuffer<T, DataSemaphore, SpaceSemaphore>::push_reserved(
+    ForwardIt &first, std::size_t reserved)
+{
+    try
+    {
+        this->push_many_internal(first, reserved);
+        data_sem.put(reserved);
+    }
+    catch (ringbuffer_stopped &e)
+    {
+        // We didn't actually use the slots we reserved with space_sem
+        space_sem.put(reserved);
+        throw;
+    }
+}
+
+template<typename T, typename DataSemaphore, typename SpaceSemaphore>
+template<typename OutputIt>
+std::size_t ringbuffer<T, DataSemaphore, SpaceSemaphore>::pop_reserved(
+    OutputIt &out, std::size_t reserved)
+{
+    std::size_t n = this->pop_many_internal(out, reserved);
+    if (n > 0)
+        space_sem.put(n);
+    // Fewer items than reservations means that we reached the stop
+    // position. Return the excess to wake up the next waiter.
+    if (n < reserved)
+        data_sem.put(reserved - n);
+    if (n == 0)
+        throw ringbuffer_stopped();
+    return n;
+}
+
+template<typename T, typename DataSemaphore, typename SpaceSemaphore>
+template<typename ForwardIt, typename... SemArgs>
+void ringbuffer<T, DataSemaphore, SpaceSemaphore>::push_many(
+    ForwardIt first, ForwardIt last, SemArgs&&... sem_args)
+{
+    std::size_t remaining = std::distance(first, last);
+    while (remaining > 0)
+    {
+        semaphore_get(space_sem, sem_args...);
+        std::size_t reserved = reserve_more(space_sem, 1, remaining);
+        push_reserved(first, reserved);
+        remaining -= reserved;
+    }
+}
+
+template<typename T, typename DataSemaphore, typename SpaceSemaphore>
+template<typename ForwardIt>
+std::size_t ringbuffer<T, DataSemaphore, SpaceSemaphore>::try_push_many(
+    ForwardIt first, ForwardIt last)
+{
+    std::size_t remaining = std::distance(first, last);
+    if (remaining == 0)
+        return 0;
+    if (space_sem.try_get() == -1)
+        this->throw_full_or_stopped();
+    std::size_t reserved = reserve_more(space_sem, 1, remaining);
+    push_reserved(first, reserved);
+    return reserved;
+}
+
+template<typename T, typename DataSemaphore, typename SpaceSemaphore>
+template<typename OutputIt, typename... SemArgs>
+std::size_t ringbuffer<T, DataSemaphore, SpaceSemaphore>::pop_many(
+    OutputIt out, std::size_t max_items, SemArgs&&... sem_args)
+{
+    if (max_items == 0)
+        return 0;
+    semaphore_get(data_sem, std::forward<SemArgs>(sem_args)...);
+    std::size_t reserved = reserve_more(data_sem, 1, max_items);
+    return pop_reserved(out, reserved);
+}
+
+template<typename T, typename DataSemaphore, typename SpaceSemaphore>
+template<typename OutputIt>
+std::size_t ringbuffer<T, DataSemaphore, SpaceSemaphore>::try_pop_many(
+    OutputIt out, std::size_t max_items)
+{
+    if (max_items == 0)
+        return 0;
+    if (data_sem.try_get() == -1)
+        this->throw_empty_or_stopped();
+    std::size_t reserved = reserve_more(data_sem, 1, max_items);
+    return pop_reserved(out, reserved);
+}
+
 template<typename T, typename DataSemaphore, typename SpaceSemaphore>
 bool ringbuffer<T, DataSemaphore, SpaceSemaphore>::stop()
 {
@@ -28,6 +28,7 @@
 # define _GNU_SOURCE
 #endif
 #include <spead2/common_features.h>
+#include <cstddef>
 #include <memory>
 #include <atomic>
 #if SPEAD2_USE_POSIX_SEMAPHORES
@@ -55,6 +56,9 @@ public:
     /// Increment
     void put();
 
+    /// Increment by @a n
+    void put(unsigned int n);
+
     /**
      * Decrement semaphore, blocking if necessary.
      *
@@ -70,6 +74,14 @@ public:
      * @retval 0 on success
      */
     int try_get();
+
+    /**
+     * Decrement semaphore by up to @a n, but do not block.
+     *
+     * @returns the amount by which it was decremented (zero if it was
+     * already zero or a system call was interrupted)
+     */
+    std::size_t try_get_many(std::size_t n);
 };
 
 /**
@@ -97,12 +109,18 @@ public:
     /// @copydoc semaphore_spin::put
     void put();
 
+    /// @copydoc semaphore_spin::put(unsigned int)
+    void put(unsigned int n);
+
     /// @copydoc semaphore_spin::get
     int get();
 
     /// @copydoc semaphore_spin::try_get
     int try_get();
 
+    /// @copydoc semaphore_spin::try_get_many
+    std::size_t try_get_many(std::size_t n);
+
     /// Return a file descriptor that will be readable when get will not block
     int get_fd() const;
 };
@@ -131,12 +149,23 @@ public:
     /// @copydoc semaphore_spin::put
     void put();
 
+    /// @copydoc semaphore_spin::put(unsigned int)
+    void put(unsigned int n);
+
     /// @copydoc semaphore_spin::get
     int get();
 
     /// @copydoc semaphore_spin::try_get
     int try_get();
 
+    /**
+     * @copydoc semaphore_spin::try_get_many
+     *
+     * The eventfd is in semaphore mode, where each read only decrements it
+     * by one, so this makes a system call per unit.
+     */
+    std::size_t try_get_many(std::size_t n);
+
     /// @copydoc semaphore_pipe::get_fd
     int get_fd() const;
 };
@@ -163,11 +192,17 @@ public:
     /// @copydoc semaphore_spin::put
     void put();
 
+    /// @copydoc semaphore_spin::put(unsigned int)
+    void put(unsigned int n);
+
     /// @copydoc semaphore_spin::get
     int get();
 
     /// @copydoc semaphore_spin::try_get
     int try_get();
+
+    /// @copydoc semaphore_spin::try_get_many
+    std::size_t try_get_many(std::size_t n);
 };
 
 #endif // SPEAD2_USE_POSIX_SEMAPHORES
@@ -193,6 +228,7 @@ public:
     using semaphore_fd::put;
     using semaphore_fd::get;
     using semaphore_fd::try_get;
+    using semaphore_fd::try_get_many;
 };
 
 #endif // !SPEAD2_USE_POSIX_SEMAPHORES
@@ -0,0 +1,119 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_COMMON_SLAB_ALLOCATOR_H
+#define SPEAD2_COMMON_SLAB_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <spead2/common_thread_pool.h>
+#include <spead2/common_memory_allocator.h>
+#include <spead2/common_memory_pool.h>
+
+namespace spead2
+{
+
+/**
+ * Memory allocator with a pool for each of a range of power-of-two size
+ * classes. An allocation is rounded up to the smallest class that can hold
+ * it, and served from that class's @ref memory_pool. Allocations larger than
+ * the largest class are satisfied directly by the underlying allocator.
+ *
+ * Each class has the same @a max_free, @a initial and @a low_water
+ * parameters (which are counts of buffers, not bytes), so a wide range of
+ * classes with a large @a initial can reserve a lot of memory.
+ *
+ * The allocator must be managed by a std::shared_ptr. This class is
+ * thread-safe.
+ */
+class slab_allocator : public memory_allocator
+{
+public:
+    /// Statistics for a single size class
+    struct class_stats
+    {
+        std::size_t size;      ///< Size of the buffers in the class
+        std::uint64_t hits;    ///< Allocations served from free memory
+        std::uint64_t misses;  ///< Allocations that required a new buffer
+    };
+
+private:
+    const std::shared_ptr<memory_allocator> base_allocator;
+    /// Base-2 logarithm of the smallest class size
+    unsigned int min_shift;
+    std::vector<std::shared_ptr<memory_pool>> pools;
+
+    slab_allocator(std::optional<io_service_ref> io_service,
+                   std::size_t min_size,
+                   std::size_t max_size,
+                   std::size_t max_free,
+                   std::size_t initial,
+                   std::size_t low_water,
+                   std::shared_ptr<memory_allocator> allocator,
+                   int dummy);  // dummy parameter makes the constructor unambiguous
+
+public:
+    /**
+     * Constructor. @a min_size and @a max_size are rounded up to powers of
+     * two.
+     *
+     * @throw std::invalid_argument if @a min_size is zero or greater than @a max_size,
+     * or if @a initial is greater than @a max_free
+     */
+    slab_allocator(std::size_t min_size, std::size_t max_size,
+                   std::size_t max_free, std::size_t initial,
+                   std::shared_ptr<memory_allocator> allocator = nullptr);
+
+    /**
+     * Constructor with background refilling. When a class has fewer than
+     * @a low_water free buffers, a task is posted to @a io_service to
+     * allocate more until it has @a initial.
+     *
+     * @throw std::invalid_argument if @a min_size is zero or greater than @a max_size,
+     * or if the buffer counts are inconsistent
+     */
+    slab_allocator(io_service_ref io_service,
+                   std::size_t min_size, std::size_t max_size,
+                   std::size_t max_free, std::size_t initial, std::size_t low_water,
+                   std::shared_ptr<memory_allocator> allocator = nullptr);
+
+    virtual pointer allocate(std::size_t size, void *hint) override;
+
+    /// Number of size classes
+    std::size_t get_num_classes() const;
+    /// Size of buffers in the largest class
+    std::size_t get_max_size() const;
+    /// Pool that serves a size class
+    const std::shared_ptr<memory_pool> &get_pool(std::size_t index) const;
+    /// Get statistics for all the size classes, from smallest to largest
+    std::vector<class_stats> get_stats() const;
+
+    /// Set @ref memory_pool::set_warn_on_empty for all size classes
+    void set_warn_on_empty(bool warn);
+    /// Set @ref memory_pool::set_thread_cache_size for all size classes
+    void set_thread_cache_size(std::size_t size);
+};
+
+} // namespace spead2
+
+#endif // SPEAD2_COMMON_SLAB_ALLOCATOR_H
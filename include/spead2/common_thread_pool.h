@@ -48,6 +48,8 @@ private:
      * is connected to an async task.
      */
     std::vector<std::future<void> > workers;
+    /// Cores to which the threads are bound (empty if not bound)
+    std::vector<int> affinity;
 
 public:
     explicit thread_pool(int num_threads = 1);
@@ -69,6 +71,21 @@ public:
      * Set CPU affinity of current thread.
      */
     static void set_affinity(int core);
+
+    /**
+     * Get the NUMA node containing a CPU core, or -1 if it cannot be
+     * determined (including on operating systems other than Linux).
+     */
+    static int get_core_numa_node(int core);
+
+    /**
+     * Get the NUMA node shared by all the cores that the threads are bound
+     * to. This is intended to be passed to a NUMA-aware allocator (such as
+     * @ref mmap_allocator) so that memory is local to the threads that write
+     * it. Returns -1 if the threads are not bound, or are bound to cores on
+     * more than one node, or if the node cannot be determined.
+     */
+    int get_numa_node() const;
 };
 
 /**
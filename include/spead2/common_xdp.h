@@ -0,0 +1,376 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Support code shared by the AF_XDP sender and receiver.
+ */
+
+#ifndef SPEAD2_COMMON_XDP_H
+#define SPEAD2_COMMON_XDP_H
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_XDP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <linux/bpf.h>
+#include <linux/if_xdp.h>
+#include <boost/asio.hpp>
+#include <spead2/common_memory_allocator.h>
+
+namespace spead2
+{
+
+/// Whether an AF_XDP socket uses zero-copy mode
+enum class xdp_mode
+{
+    AUTO,        ///< Use zero-copy if the driver supports it, otherwise copy
+    COPY,        ///< Copy packets between the driver and the UMEM
+    ZERO_COPY    ///< Require zero-copy support from the driver
+};
+
+namespace detail
+{
+
+/// Move-only owner of a file descriptor
+class xdp_fd
+{
+private:
+    int fd = -1;
+
+public:
+    xdp_fd() = default;
+    explicit xdp_fd(int fd) : fd(fd) {}
+    xdp_fd(xdp_fd &&other) noexcept : fd(std::exchange(other.fd, -1)) {}
+    xdp_fd &operator=(xdp_fd &&other) noexcept;
+    ~xdp_fd();
+
+    int get() const { return fd; }
+};
+
+/**
+ * One of the rings that an AF_XDP socket shares with the kernel. The fill
+ * and completion rings hold frame addresses, while the RX and TX rings hold
+ * descriptors. The same class handles both the producer and consumer side;
+ * each ring is only used for one of them.
+ */
+template<typename T>
+class xdp_ring
+{
+private:
+    void *map = nullptr;
+    std::size_t map_size = 0;
+    std::uint32_t *producer = nullptr;
+    std::uint32_t *consumer = nullptr;
+    std::uint32_t *flags = nullptr;
+    T *ring = nullptr;
+    std::uint32_t size = 0;
+    /// Local copies of the producer and consumer indices
+    std::uint32_t local_producer = 0, local_consumer = 0;
+
+public:
+    xdp_ring() = default;
+    /**
+     * Map the ring from the socket @a fd.
+     *
+     * @param fd      AF_XDP socket
+     * @param pgoff   Offset passed to mmap to select the ring
+     * @param offsets Offsets within the ring, from @c XDP_MMAP_OFFSETS
+     * @param size    Number of entries (a power of 2)
+     */
+    xdp_ring(int fd, std::uint64_t pgoff, const xdp_ring_offset &offsets, std::uint32_t size);
+    xdp_ring(xdp_ring &&other) noexcept;
+    xdp_ring &operator=(xdp_ring &&other) noexcept;
+    ~xdp_ring();
+
+    std::uint32_t get_size() const { return size; }
+    /// Access an entry by (free-running) index
+    T &operator[](std::uint32_t index) { return ring[index & (size - 1)]; }
+
+    /// Producer: number of entries that can be written
+    std::uint32_t free_entries() const
+    {
+        return size - (local_producer - __atomic_load_n(consumer, __ATOMIC_ACQUIRE));
+    }
+    /// Producer: index of the next entry to write
+    std::uint32_t producer_index() const { return local_producer; }
+    /// Producer: pass the next @a n entries to the kernel
+    void produce(std::uint32_t n)
+    {
+        local_producer += n;
+        __atomic_store_n(producer, local_producer, __ATOMIC_RELEASE);
+    }
+
+    /// Consumer: number of entries that can be read
+    std::uint32_t available() const
+    {
+        return __atomic_load_n(producer, __ATOMIC_ACQUIRE) - local_consumer;
+    }
+    /// Consumer: index of the next entry to read
+    std::uint32_t consumer_index() const { return local_consumer; }
+    /// Consumer: return the next @a n entries to the kernel
+    void consume(std::uint32_t n)
+    {
+        local_consumer += n;
+        __atomic_store_n(consumer, local_consumer, __ATOMIC_RELEASE);
+    }
+
+    /// Whether the kernel needs a system call to process the ring
+    bool needs_wakeup() const
+    {
+        return __atomic_load_n(flags, __ATOMIC_RELAXED) & XDP_RING_NEED_WAKEUP;
+    }
+};
+
+extern template class xdp_ring<std::uint64_t>;
+extern template class xdp_ring<xdp_desc>;
+
+/**
+ * An AF_XDP socket bound to one queue of an interface, together with its
+ * UMEM. The UMEM is divided into frames of @ref frame_size bytes, and is
+ * only used by this socket.
+ */
+class xdp_socket
+{
+public:
+    /// Size of each UMEM frame
+    static constexpr std::size_t frame_size = 4096;
+    /// Largest Ethernet frame that fits in a UMEM frame
+    static constexpr std::size_t max_frame_data = frame_size - XDP_PACKET_HEADROOM;
+
+private:
+    /* Note: declaration order is important for correct destruction
+     * (the socket must be closed before the UMEM is freed).
+     */
+    memory_allocator::pointer umem;
+    std::uint32_t n_frames;
+    xdp_fd fd;
+
+public:
+    xdp_ring<std::uint64_t> fill;
+    xdp_ring<std::uint64_t> completion;
+    xdp_ring<xdp_desc> rx;
+    xdp_ring<xdp_desc> tx;
+
+    /**
+     * Constructor. Each ring that is enabled has one entry per frame.
+     *
+     * @param ifindex      Interface index
+     * @param queue_id     Queue of the interface to bind to
+     * @param buffer_size  UMEM size, which is rounded down to a power of 2
+     *                     number of frames
+     * @param mode         Whether to use zero-copy mode
+     * @param use_rx       Whether to set up the RX ring
+     * @param use_tx       Whether to set up the TX ring
+     *
+     * @throws std::system_error if the socket cannot be set up
+     */
+    xdp_socket(unsigned int ifindex, std::uint32_t queue_id, std::size_t buffer_size,
+               xdp_mode mode, bool use_rx, bool use_tx);
+
+    int native_handle() const { return fd.get(); }
+    std::uint32_t get_n_frames() const { return n_frames; }
+    /// Pointer to a byte in the UMEM, given its offset
+    std::uint8_t *data(std::uint64_t addr) const { return umem.get() + addr; }
+
+    /// Ask the kernel to process the fill ring, if it needs to be told
+    void wakeup_rx();
+    /// Ask the kernel to process the TX ring, if it needs to be told
+    void wakeup_tx();
+};
+
+/**
+ * An XDP program attached to an interface, which redirects IPv4 UDP packets
+ * addressed to any of a list of endpoints to AF_XDP sockets (chosen by the
+ * receive queue). Other packets, and packets arriving on queues without a
+ * socket, are passed to the kernel network stack. The program is detached
+ * from the interface when this object is destroyed.
+ */
+class xdp_program
+{
+private:
+    xdp_fd map_fd;
+    xdp_fd prog_fd;
+    xdp_fd link_fd;
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param ifindex     Interface index
+     * @param endpoints   Endpoints to match (the address may be unspecified
+     *                    to match any address)
+     * @param max_queues  One more than the largest queue ID that will be used
+     *
+     * @throws std::system_error if the program cannot be loaded or attached
+     */
+    xdp_program(unsigned int ifindex,
+                const std::vector<boost::asio::ip::udp::endpoint> &endpoints,
+                std::uint32_t max_queues);
+
+    /// Redirect packets arriving on queue @a queue_id to @a socket
+    void add_socket(std::uint32_t queue_id, const xdp_socket &socket);
+};
+
+/**
+ * Common configuration for AF_XDP senders and receivers. It uses the
+ * curiously recurring template pattern so that setters return the derived
+ * type.
+ */
+template<typename Derived>
+class udp_xdp_config_base
+{
+private:
+    std::vector<boost::asio::ip::udp::endpoint> endpoints;
+    boost::asio::ip::address interface_address;
+    std::size_t buffer_size = Derived::default_buffer_size;
+    std::uint32_t queue_id = 0;
+    xdp_mode mode = xdp_mode::AUTO;
+    int max_poll = Derived::default_max_poll;
+
+public:
+    /// Get the configured endpoints
+    const std::vector<boost::asio::ip::udp::endpoint> &get_endpoints() const { return endpoints; }
+    /**
+     * Set the endpoints (replacing any previous).
+     *
+     * @throws std::invalid_argument if any element of @a endpoints is invalid.
+     */
+    Derived &set_endpoints(const std::vector<boost::asio::ip::udp::endpoint> &endpoints);
+    /**
+     * Append a single endpoint.
+     *
+     * @throws std::invalid_argument if @a endpoint is invalid.
+     */
+    Derived &add_endpoint(const boost::asio::ip::udp::endpoint &endpoint);
+
+    /// Get the currently set interface address
+    const boost::asio::ip::address get_interface_address() const { return interface_address; }
+    /**
+     * Set the interface address. This selects the interface to use.
+     *
+     * @throws std::invalid_argument if @a interface_address is not an IPv4 address.
+     */
+    Derived &set_interface_address(const boost::asio::ip::address &interface_address);
+
+    /// Get the currently configured UMEM size
+    std::size_t get_buffer_size() const { return buffer_size; }
+    /**
+     * Set the UMEM size. The value 0 is special and resets it to the
+     * default. The size actually used is rounded to a power of 2 number
+     * of frames.
+     */
+    Derived &set_buffer_size(std::size_t buffer_size);
+
+    /// Get the interface queue (see @ref set_queue_id)
+    std::uint32_t get_queue_id() const { return queue_id; }
+    /**
+     * Set the queue of the interface to use. For receiving, packets that
+     * arrive on other queues are not seen, so the NIC must be configured
+     * (for example, with ethtool) to direct the traffic to this queue.
+     */
+    Derived &set_queue_id(std::uint32_t queue_id);
+
+    /// Get the zero-copy mode (see @ref set_mode)
+    xdp_mode get_mode() const { return mode; }
+    /// Set whether to use zero-copy mode
+    Derived &set_mode(xdp_mode mode);
+
+    /// Get maximum number of times to poll in a row (see @ref set_max_poll)
+    int get_max_poll() const { return max_poll; }
+    /**
+     * Set maximum number of times to poll the rings in a row before letting
+     * other code run on the thread or waiting for the socket.
+     *
+     * @throws std::invalid_argument if @a max_poll is zero.
+     */
+    Derived &set_max_poll(int max_poll);
+};
+
+template<typename Derived>
+Derived &udp_xdp_config_base<Derived>::set_endpoints(
+    const std::vector<boost::asio::ip::udp::endpoint> &endpoints)
+{
+    for (const auto &endpoint : endpoints)
+        Derived::validate_endpoint(endpoint);
+    this->endpoints = endpoints;
+    return *static_cast<Derived *>(this);
+}
+
+template<typename Derived>
+Derived &udp_xdp_config_base<Derived>::add_endpoint(
+    const boost::asio::ip::udp::endpoint &endpoint)
+{
+    Derived::validate_endpoint(endpoint);
+    endpoints.push_back(endpoint);
+    return *static_cast<Derived *>(this);
+}
+
+template<typename Derived>
+Derived &udp_xdp_config_base<Derived>::set_interface_address(
+    const boost::asio::ip::address &interface_address)
+{
+    if (!interface_address.is_v4())
+        throw std::invalid_argument("interface address is not an IPv4 address");
+    this->interface_address = interface_address;
+    return *static_cast<Derived *>(this);
+}
+
+template<typename Derived>
+Derived &udp_xdp_config_base<Derived>::set_buffer_size(std::size_t buffer_size)
+{
+    if (buffer_size == 0)
+        this->buffer_size = Derived::default_buffer_size;
+    else
+        this->buffer_size = buffer_size;
+    return *static_cast<Derived *>(this);
+}
+
+template<typename Derived>
+Derived &udp_xdp_config_base<Derived>::set_queue_id(std::uint32_t queue_id)
+{
+    this->queue_id = queue_id;
+    return *static_cast<Derived *>(this);
+}
+
+template<typename Derived>
+Derived &udp_xdp_config_base<Derived>::set_mode(xdp_mode mode)
+{
+    this->mode = mode;
+    return *static_cast<Derived *>(this);
+}
+
+template<typename Derived>
+Derived &udp_xdp_config_base<Derived>::set_max_poll(int max_poll)
+{
+    if (max_poll < 1)
+        throw std::invalid_argument("max_poll must be at least 1");
+    this->max_poll = max_poll;
+    return *static_cast<Derived *>(this);
+}
+
+} // namespace detail
+
+} // namespace spead2
+
+#endif // SPEAD2_USE_XDP
+
+#endif // SPEAD2_COMMON_XDP_H
@@ -1,4 +1,4 @@
-/* Copyright 2021-2023 National Research Foundation (SARAO)
+/* Copyright 2021-2023, 2026 National Research Foundation (SARAO)
  *
  * This program is free software: you can redistribute it and/or modify it under
  * the terms of the GNU Lesser General Public License as published by the Free
@@ -30,10 +30,13 @@
 #include <utility>
 #include <mutex>
 #include <limits>
+#include <optional>
+#include <libdivide.h>
 #include <spead2/common_defines.h>
 #include <spead2/common_memory_allocator.h>
 #include <spead2/common_ringbuffer.h>
 #include <spead2/common_endian.h>
+#include <spead2/common_logging.h>
 #include <spead2/recv_packet.h>
 #include <spead2/recv_stream.h>
 
@@ -113,6 +116,124 @@ struct chunk_place_data
  */
 typedef std::function<void(chunk_place_data *data, std::size_t data_size)> chunk_place_function;
 
+/**
+ * Callback to determine where each of several heaps is placed in the chunk
+ * stream. It is equivalent to calling a @ref chunk_place_function for each
+ * element of @a data, but allows the work to be amortised or vectorised.
+ *
+ * @param data       Pointer to an array of input and output arguments, one per heap.
+ * @param n_data     Number of elements in @a data
+ * @param data_size  <code>sizeof(chunk_place_data)</code> at the time spead2 was compiled,
+ *                   which is also the stride between the elements of @a data
+ *
+ * @see chunk_place_data, chunk_stream_config::set_place_batch
+ */
+typedef std::function<void(chunk_place_data *data, std::size_t n_data, std::size_t data_size)> chunk_place_batch_function;
+
+/**
+ * Built-in placement rule, for use instead of a place callback when the
+ * placement is an affine function of a timestamp item and (optionally) a
+ * channel item. Items are identified by their index in the list passed to
+ * @ref chunk_stream_config::set_items.
+ *
+ * Let @em t be the timestamp divided by the timestamp step, and @em c the
+ * channel divided by the channel step (or 0 if there is no channel item).
+ * Then
+ *
+ * - chunk_id = t / timestamps_per_chunk
+ * - heap_index = (t % timestamps_per_chunk) * channels + c
+ * - heap_offset = heap_index * heap_size
+ *
+ * Heaps are discarded if the timestamp or channel is not a multiple of its
+ * step, or if @em c is not less than the number of channels. The divisions
+ * are performed with libdivide. A chunk stream also discards heaps whose
+ * length exceeds the heap size, since they would overflow their slot.
+ */
+class chunk_place_affine
+{
+private:
+    std::size_t timestamp_item = 0;
+    item_pointer_t timestamp_step = 1;
+    std::size_t timestamps_per_chunk = 1;
+    std::optional<std::size_t> channel_item;
+    item_pointer_t channel_step = 1;
+    std::size_t channels = 1;
+    std::size_t heap_size = 0;
+
+    libdivide::divider<item_pointer_t> timestamp_div{1};
+    libdivide::divider<item_pointer_t> chunk_div{1};
+    libdivide::divider<item_pointer_t> channel_div{1};
+
+    template<bool has_channel>
+    void place_impl(chunk_place_data *data, std::size_t n_data) const;
+
+public:
+    /// Set the index (in the list of items) of the timestamp item
+    chunk_place_affine &set_timestamp_item(std::size_t index);
+    /// Get the index of the timestamp item
+    std::size_t get_timestamp_item() const { return timestamp_item; }
+
+    /**
+     * Set the difference in timestamp between consecutive heaps.
+     *
+     * @throw std::invalid_argument if @a step is zero.
+     */
+    chunk_place_affine &set_timestamp_step(item_pointer_t step);
+    /// Get the difference in timestamp between consecutive heaps
+    item_pointer_t get_timestamp_step() const { return timestamp_step; }
+
+    /**
+     * Set the number of timestamps (each a multiple of the step) per chunk.
+     *
+     * @throw std::invalid_argument if @a timestamps_per_chunk is zero.
+     */
+    chunk_place_affine &set_timestamps_per_chunk(std::size_t timestamps_per_chunk);
+    /// Get the number of timestamps per chunk
+    std::size_t get_timestamps_per_chunk() const { return timestamps_per_chunk; }
+
+    /**
+     * Set the index (in the list of items) of the channel item, or
+     * @c std::nullopt if heaps are distinguished only by timestamp.
+     */
+    chunk_place_affine &set_channel_item(std::optional<std::size_t> index);
+    /// Get the index of the channel item
+    const std::optional<std::size_t> &get_channel_item() const { return channel_item; }
+
+    /**
+     * Set the difference in the channel item between heaps with adjacent
+     * channels.
+     *
+     * @throw std::invalid_argument if @a step is zero.
+     */
+    chunk_place_affine &set_channel_step(item_pointer_t step);
+    /// Get the difference in the channel item between adjacent heaps
+    item_pointer_t get_channel_step() const { return channel_step; }
+
+    /**
+     * Set the number of channel groups (heaps per timestamp).
+     *
+     * @throw std::invalid_argument if @a channels is zero.
+     */
+    chunk_place_affine &set_channels(std::size_t channels);
+    /// Get the number of channel groups
+    std::size_t get_channels() const { return channels; }
+
+    /**
+     * Set the payload size of each heap, which determines @ref
+     * chunk_place_data::heap_offset. It must be set (to a non-zero value)
+     * before the rule is used by a chunk stream.
+     */
+    chunk_place_affine &set_heap_size(std::size_t heap_size);
+    /// Get the payload size of each heap
+    std::size_t get_heap_size() const { return heap_size; }
+
+    /// Number of heaps in a chunk (@c timestamps_per_chunk times @c channels)
+    std::size_t get_heaps_per_chunk() const { return timestamps_per_chunk * channels; }
+
+    /// Place a batch of heaps
+    void operator()(chunk_place_data *data, std::size_t n_data) const;
+};
+
 /**
  * Callback to obtain storage for a new chunk. It does not need to populate
  * @ref chunk::chunk_id.
@@ -141,10 +262,13 @@ private:
     std::size_t max_heap_extra = 0;
 
     chunk_place_function place;
+    chunk_place_batch_function place_batch;
+    std::optional<chunk_place_affine> place_affine;
     chunk_allocate_function allocate;
     chunk_ready_function ready;
 
     std::size_t packet_presence_payload_size = 0;
+    bool direct_placement = false;
 
 public:
     /**
@@ -171,6 +295,43 @@ public:
     /// Get the function used to determine the chunk of each heap and its placement within the chunk.
     const chunk_place_function &get_place() const { return place; }
 
+    /**
+     * Set a function used to determine the placement of many heaps at once,
+     * instead of the function set with @ref set_place (which is ignored if
+     * this is set).
+     *
+     * When a batch of packets is received, the function is called once
+     * for the first packet of every heap that starts in the batch. The
+     * heaps are still checked against the chunk window one at a time as
+     * their packets are processed, so the result is the same as for
+     * @ref set_place. Packets that are not received in batches, as well as
+     * heaps that are restarted part-way through a batch, are placed with
+     * calls where @a n_data is 1.
+     *
+     * The function is called before the packets are added to the stream.
+     * Packets that fail the stream's own header checks (such as the element
+     * alignment required by @ref packet_memcpy_convert) are not passed to
+     * it, but it may still be called for a heap whose first packet is later
+     * rejected, for example because the stream stopped part-way through the
+     * batch or the packet is inconsistent with the heap. The function must
+     * therefore not have side effects (such as updating statistics) that
+     * assume the heap will be received; any such effects belong in the
+     * allocate or ready functions.
+     */
+    chunk_stream_config &set_place_batch(chunk_place_batch_function place_batch);
+    /// Get the function set with @ref set_place_batch.
+    const chunk_place_batch_function &get_place_batch() const { return place_batch; }
+
+    /**
+     * Use a built-in placement rule instead of a place function. If set,
+     * the functions set with @ref set_place and @ref set_place_batch are
+     * ignored. Heaps are placed in batches in the same way as for
+     * @ref set_place_batch, but without calling out to user code.
+     */
+    chunk_stream_config &set_place_affine(std::optional<chunk_place_affine> place_affine);
+    /// Get the rule set with @ref set_place_affine.
+    const std::optional<chunk_place_affine> &get_place_affine() const { return place_affine; }
+
     /// Set the function used to allocate a chunk.
     chunk_stream_config &set_allocate(chunk_allocate_function allocate);
     /// Get the function used to allocate a chunk.
@@ -205,6 +366,24 @@ public:
     chunk_stream_config &set_max_heap_extra(std::size_t max_heap_extra);
     /// Get maximum amount of data a placement function may write to @ref chunk_place_data::extra.
     std::size_t get_max_heap_extra() const { return max_heap_extra; }
+
+    /**
+     * Copy packet payloads straight into the chunks, without assembling
+     * heaps. Each packet's heap is tracked with just a chunk location and a
+     * count of the payload bytes received, rather than a full
+     * @ref spead2::recv::live_heap, which removes most of the per-packet
+     * and per-heap overheads.
+     *
+     * The cost is that duplicate packets are not detected: a heap is
+     * considered complete once the total payload of its packets reaches
+     * the heap length, so a retransmitted packet can cause a heap with a
+     * missing packet to be marked as present. It should thus only be used
+     * on networks that do not duplicate packets, or together with
+     * @ref enable_packet_presence.
+     */
+    chunk_stream_config &set_direct_placement(bool direct_placement);
+    /// Get whether payloads are placed directly into chunks (see @ref set_direct_placement).
+    bool get_direct_placement() const { return direct_placement; }
 };
 
 namespace detail
@@ -366,6 +545,8 @@ class chunk_stream_state_base
 protected:
     struct free_place_data
     {
+        std::size_t n;  ///< Number of elements of @ref chunk_place_data
+
         void operator()(unsigned char *ptr) const;
     };
 
@@ -374,6 +555,11 @@ protected:
     const std::uintptr_t stream_id;
     const std::size_t base_stat_index;         ///< Index of first custom stat
 
+    // Offsets from base_stat_index. Keep these in sync with stats added in adjust_config
+    static constexpr std::size_t too_old_heaps_offset = 0;
+    static constexpr std::size_t rejected_heaps_offset = 1;
+    static constexpr std::size_t misaligned_packets_offset = 2;
+
     /**
      * Circular buffer of chunks under construction.
      *
@@ -387,16 +573,93 @@ protected:
      * just the @ref chunk_place_data, but also the various arrays it points
      * to. They're allocated contiguously to minimise the number of cache lines
      * accessed.
+     *
+     * When a @ref chunk_place_batch_function is used, there is an array of
+     * 1 + @ref stream_base::packet_window elements. The first is used for
+     * heaps placed individually, and the rest for @ref prepare_place.
      */
     std::unique_ptr<unsigned char[], free_place_data> place_data_storage;
     chunk_place_data *place_data;
 
+    /**
+     * First packets of heaps whose placement was computed by
+     * @ref prepare_place, in the same order as <code>place_data + 1</code>.
+     * Entries are set to null once used.
+     */
+    std::vector<const packet_header *> prepared_packets;
+    /// Index of the first unused entry in @ref prepared_packets
+    std::size_t next_prepared = 0;
+
+    /// Heap being received with @ref chunk_stream_config::set_direct_placement
+    struct direct_heap
+    {
+        s_item_pointer_t cnt = -1;         ///< Heap cnt, or -1 if the slot is free
+        s_item_pointer_t heap_length = 0;  ///< Total payload size of the heap
+        s_item_pointer_t received = 0;     ///< Payload bytes received so far
+        /**
+         * Location of the heap in its chunk, with @ref heap_metadata as the
+         * deleter. The deleter is constructed once and updated in place,
+         * so that no memory is allocated per heap.
+         */
+        memory_allocator::pointer allocation;
+    };
+
+    const bool allow_out_of_order;     ///< Copy of @ref stream_config::get_allow_out_of_order
+    const bool stop_on_stop_item;      ///< Copy of @ref stream_config::get_stop_on_stop_item
+    /// Hash table of heaps being received with direct placement (power-of-two size)
+    std::vector<direct_heap> direct_heaps;
+    /// Shift for Fibonacci hashing of heap cnts into @ref direct_heaps
+    int direct_heap_shift = 0;
+    /// Scratch slot for single-packet heaps, which never enter @ref direct_heaps
+    direct_heap direct_single;
+
     void packet_memcpy(const spead2::memory_allocator::pointer &allocation,
                        const packet_header &packet) const;
 
+    /// Set the presence flag for a completed heap
+    void heap_present(const memory_allocator::pointer &allocation) const;
+
+    /// Prepare @a data to be passed to the place function for a heap starting with @a packet
+    void fill_place_data(chunk_place_data *data, const packet_header &packet,
+                         std::uint64_t *batch_stats) const;
+
+    /// Whether heaps are placed in batches (see @ref prepare_place)
+    bool place_batched() const
+    {
+        return chunk_config.get_place_affine() || chunk_config.get_place_batch();
+    }
+
+    /// Invoke the placement rule, batch place function or place function on @a n elements
+    void call_place(chunk_place_data *data, std::size_t n) const;
+
+    /**
+     * Retrieve the placement computed by @ref prepare_place for a heap
+     * starting with @a packet, or return @c nullptr if there isn't one.
+     */
+    chunk_place_data *take_prepared(const packet_header &packet);
+
+    /// Whether a heap with cnt @a heap_cnt is being received with direct placement
+    bool is_direct_heap_live(s_item_pointer_t heap_cnt)
+    {
+        return get_direct_heap(heap_cnt).cnt == heap_cnt;
+    }
+
     /// Implementation of @ref stream::heap_ready
     void do_heap_ready(live_heap &&lh);
 
+    /// Find the slot in @ref direct_heaps for a heap cnt
+    direct_heap &get_direct_heap(s_item_pointer_t heap_cnt)
+    {
+        // Look up Fibonacci hashing for an explanation of the magic number
+        return direct_heaps[(item_pointer_t(heap_cnt) * 11400714819323198485ULL) >> direct_heap_shift];
+    }
+
+    /// Implementation of @ref stream_base::flush_direct
+    std::size_t do_flush_direct();
+
+    /// Whether a packet contains a stream control stop item
+    static bool packet_has_stream_stop(const packet_header &packet);
+
 protected:
     std::uint64_t get_head_chunk() const { return chunks.get_head_chunk(); }
     std::uint64_t get_tail_chunk() const { return chunks.get_tail_chunk(); }
@@ -435,6 +698,15 @@ public:
      * was not allocated by a chunk stream, returns @c nullptr.
      */
     static const heap_metadata *get_heap_metadata(const memory_allocator::pointer &ptr);
+
+protected:
+    /**
+     * Point @a entry at the location of a new heap, given the result of
+     * @ref chunk_stream_state::allocate.
+     */
+    static void reset_direct_heap(
+        direct_heap &entry, const packet_header &packet,
+        std::uint8_t *ptr, const heap_metadata &metadata);
 };
 
 /**
@@ -476,6 +748,28 @@ public:
     std::pair<std::uint8_t *, heap_metadata> allocate(
         std::size_t size, const packet_header &packet);
 
+    /// Implementation of @ref stream_base::add_packet_direct
+    stream_base::direct_packet_result add_packet_direct(const packet_header &packet);
+
+    /**
+     * Implementation of @ref stream_base::prepare_packets. If a batch place
+     * function is in use, it is called for the first packet of each heap
+     * that will be started by @a packets, and the results are held for
+     * @ref allocate to use.
+     *
+     * @param packets           Packets about to be added
+     * @param n_packets         Number of elements in @a packets
+     * @param is_packet_aligned Callable that reports whether a packet passes
+     *                          @ref stream_base::is_packet_aligned (packets
+     *                          that don't are rejected, so are not placed)
+     * @param is_heap_live      Callable that reports whether the stream already
+     *                          has an incomplete heap for a cnt (only used when
+     *                          direct placement is disabled)
+     */
+    template<typename F, typename G>
+    void prepare_place(const packet_header *packets, std::size_t n_packets,
+                       const F &is_packet_aligned, const G &is_heap_live);
+
     /// Send all in-flight chunks to the ready callback (not thread-safe)
     void flush_chunks();
 };
@@ -541,6 +835,9 @@ class chunk_stream : private detail::chunk_stream_state<detail::chunk_manager_si
     friend class detail::chunk_manager_simple;
 
     virtual void heap_ready(live_heap &&) override;
+    virtual direct_packet_result add_packet_direct(const packet_header &packet) override;
+    virtual std::size_t flush_direct() override;
+    virtual void prepare_packets(const packet_header *packets, std::size_t n_packets) override;
 
 public:
     using heap_metadata = detail::chunk_stream_state_base::heap_metadata;
@@ -564,13 +861,16 @@ public:
      *     a non-negative chunk ID that was behind the window.
      *   - <tt>rejected_heaps</tt>: number of heaps for which the placement function returned
      *     a negative chunk ID.
+     *   - <tt>misaligned_packets</tt>: number of packets rejected because they
+     *     split the elements of a widening @ref packet_memcpy_convert.
      *
      * @param io_service       I/O service (also used by the readers).
      * @param config           Basic stream configuration
      * @param chunk_config     Configuration for chunking
      *
      * @throw invalid_argument if any of the function pointers in @a chunk_config
-     * have not been set.
+     * have not been set (only one of the place and batch place functions is
+     * required).
      */
     chunk_stream(
         io_service_ref io_service,
@@ -706,6 +1006,7 @@ stream_config chunk_stream_state<CM>::adjust_config(const stream_config &config)
     // Add custom statistics
     new_config.add_stat("too_old_heaps");
     new_config.add_stat("rejected_heaps");
+    new_config.add_stat("misaligned_packets");
     return new_config;
 }
 
@@ -726,33 +1027,16 @@ chunk_stream_state<CM>::allocate(std::size_t /* size */, const packet_header &pa
     // Used to get a non-null pointer
     static std::uint8_t dummy_uint8;
 
-    // Keep these in sync with stats added in adjust_config
-    static constexpr std::size_t too_old_heaps_offset = 0;
-    static constexpr std::size_t rejected_heaps_offset = 1;
-
-    /* Extract the user's requested items.
-     * TODO: this could possibly be optimised with a hash table (with a
-     * perfect hash function chosen in advance), but for the expected
-     * sizes the overheads will probably outweight the benefits.
-     */
-    const auto &item_ids = get_chunk_config().get_items();
-    std::fill(place_data->items, place_data->items + item_ids.size(), -1);
-    pointer_decoder decoder(packet.heap_address_bits);
-    /* packet.pointers and packet.n_items skips initial "special" item
-     * pointers. To allow them to be matched as well, we start from the
-     * original packet and skip over the 8-byte header.
-     */
-    for (const std::uint8_t *p = packet.packet + 8; p != packet.payload; p += sizeof(item_pointer_t))
+    chunk_place_data *data = take_prepared(packet);
+    if (!data)
     {
-        item_pointer_t pointer = load_be<item_pointer_t>(p);
-        if (decoder.is_immediate(pointer))
-        {
-            item_pointer_t id = decoder.get_id(pointer);
-            for (std::size_t j = 0; j < item_ids.size(); j++)
-                if (item_ids[j] == id)
-                    place_data->items[j] = decoder.get_immediate(pointer);
-        }
+        data = place_data;
+        fill_place_data(data, packet, chunk_manager.get_batch_stats(*this));
+        call_place(data, 1);
     }
+    const auto &place_affine = chunk_config.get_place_affine();
+    if (place_affine && packet.heap_length > s_item_pointer_t(place_affine->get_heap_size()))
+        data->chunk_id = -1;  // The heap would overflow its slot in the chunk
 
     /* TODO: see if the storage can be in the class with the deleter
      * just referencing it. That will avoid the implied memory allocation
@@ -762,23 +1046,14 @@ chunk_stream_state<CM>::allocate(std::size_t /* size */, const packet_header &pa
     auto &[ptr, metadata] = out;
     ptr = &dummy_uint8;  // Use a non-null value to avoid confusion with empty pointers
 
-    place_data->packet = packet.packet;
-    place_data->packet_size = packet.payload + packet.payload_length - packet.packet;
-    place_data->chunk_id = -1;
-    place_data->heap_index = 0;
-    place_data->heap_offset = 0;
-    place_data->batch_stats = chunk_manager.get_batch_stats(*this);
-    place_data->extra_offset = 0;
-    place_data->extra_size = 0;
-    chunk_config.get_place()(place_data, sizeof(*place_data));
-    std::int64_t chunk_id = place_data->chunk_id;
+    std::int64_t chunk_id = data->chunk_id;
     if (chunk_too_old(chunk_id))
     {
         // We don't want this heap.
         metadata.chunk_id = -1;
         metadata.chunk_ptr = nullptr;
         std::size_t stat_offset = (chunk_id >= 0) ? too_old_heaps_offset : rejected_heaps_offset;
-        place_data->batch_stats[base_stat_index + stat_offset]++;
+        data->batch_stats[base_stat_index + stat_offset]++;
         return out;
     }
     else
@@ -793,16 +1068,16 @@ chunk_stream_state<CM>::allocate(std::size_t /* size */, const packet_header &pa
         if (chunk_ptr)
         {
             chunk &c = *chunk_ptr;
-            ptr = c.data.get() + place_data->heap_offset;
+            ptr = c.data.get() + data->heap_offset;
             metadata.chunk_id = chunk_id;
-            metadata.heap_index = place_data->heap_index;
-            metadata.heap_offset = place_data->heap_offset;
+            metadata.heap_index = data->heap_index;
+            metadata.heap_offset = data->heap_offset;
             metadata.chunk_ptr = &c;
-            if (place_data->extra_size > 0)
+            if (data->extra_size > 0)
             {
-                assert(place_data->extra_size <= chunk_config.get_max_heap_extra());
+                assert(data->extra_size <= chunk_config.get_max_heap_extra());
                 assert(c.extra);
-                std::memcpy(c.extra.get() + place_data->extra_offset, place_data->extra, place_data->extra_size);
+                std::memcpy(c.extra.get() + data->extra_offset, data->extra, data->extra_size);
             }
             return out;
         }
@@ -816,6 +1091,108 @@ chunk_stream_state<CM>::allocate(std::size_t /* size */, const packet_header &pa
     }
 }
 
+template<typename CM>
+template<typename F, typename G>
+void chunk_stream_state<CM>::prepare_place(
+    const packet_header *packets, std::size_t n_packets,
+    const F &is_packet_aligned, const G &is_heap_live)
+{
+    prepared_packets.clear();
+    next_prepared = 0;
+    if (!place_batched())
+        return;
+    assert(n_packets <= stream_base::packet_window);
+    std::uint64_t *batch_stats = chunk_manager.get_batch_stats(*this);
+    for (std::size_t i = 0; i < n_packets; i++)
+    {
+        /* Only select packets that are certain to start a heap and be
+         * placed (for which live_heap will allocate memory). Misses are
+         * harmless since allocate will place the heap itself.
+         */
+        const packet_header &packet = packets[i];
+        if (packet.heap_length <= 0)
+            continue;
+        if (!allow_out_of_order && packet.payload_offset != 0)
+            continue;
+        if (!is_packet_aligned(packet))
+            continue;
+        if (packet.payload_length != packet.heap_length)
+        {
+            const s_item_pointer_t cnt = packet.heap_cnt;
+            if (direct_heaps.empty() ? is_heap_live(cnt) : is_direct_heap_live(cnt))
+                continue;
+            // Check whether an earlier packet in the window starts the heap
+            bool seen = false;
+            for (const packet_header *prev : prepared_packets)
+                if (prev->heap_cnt == cnt && prev->payload_length != prev->heap_length)
+                {
+                    seen = true;
+                    break;
+                }
+            if (seen)
+                continue;
+        }
+        fill_place_data(place_data + 1 + prepared_packets.size(), packet, batch_stats);
+        prepared_packets.push_back(&packet);
+    }
+    if (!prepared_packets.empty())
+        call_place(place_data + 1, prepared_packets.size());
+}
+
+template<typename CM>
+stream_base::direct_packet_result chunk_stream_state<CM>::add_packet_direct(const packet_header &packet)
+{
+    stream_base::direct_packet_result result;
+    const bool single = packet.payload_length == packet.heap_length;
+    // Single-packet heaps don't need to be found again, so don't evict anything
+    direct_heap &entry = single ? direct_single : get_direct_heap(packet.heap_cnt);
+    if (single || entry.cnt != packet.heap_cnt)
+    {
+        if (!allow_out_of_order && packet.payload_offset != 0)
+        {
+            log_debug("packet rejected because there is a gap in the heap and "
+                      "allow_out_of_order is false");
+            return result;
+        }
+        if (entry.cnt >= 0)
+            result.heap_evicted = true;
+        std::pair<std::uint8_t *, heap_metadata> placement{nullptr, {-1, 0, 0, nullptr}};
+        // Like live_heap, only call the place function if there is a payload
+        if (packet.heap_length > 0)
+            placement = allocate(packet.heap_length, packet);
+        reset_direct_heap(entry, packet, placement.first, placement.second);
+    }
+    else if (packet.heap_length != entry.heap_length)
+    {
+        log_info("packet rejected because its HEAP_LEN is inconsistent with the heap");
+        return result;
+    }
+    else if (!allow_out_of_order && packet.payload_offset != entry.received)
+    {
+        log_debug("packet rejected because there is a gap in the heap and "
+                  "allow_out_of_order is false");
+        return result;
+    }
+
+    result.added = true;
+    if (packet.payload_length > 0)
+        packet_memcpy(entry.allocation, packet);
+    entry.received += packet.payload_length;
+    if (stop_on_stop_item && packet_has_stream_stop(packet))
+    {
+        // As with heap assembly, a heap with a stop item is never marked present
+        result.end_of_stream = true;
+        entry.cnt = -1;
+    }
+    else if (entry.received >= entry.heap_length)
+    {
+        result.heap_complete = true;
+        heap_present(entry.allocation);
+        entry.cnt = -1;
+    }
+    return result;
+}
+
 template<typename DataRingbuffer, typename FreeRingbuffer>
 chunk_ring_pair<DataRingbuffer, FreeRingbuffer>::chunk_ring_pair(
     std::shared_ptr<DataRingbuffer> data_ring,
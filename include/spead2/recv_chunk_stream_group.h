@@ -1,4 +1,4 @@
-/* Copyright 2023 National Research Foundation (SARAO)
+/* Copyright 2023, 2026 National Research Foundation (SARAO)
  *
  * This program is free software: you can redistribute it and/or modify it under
  * the terms of the GNU Lesser General Public License as published by the Free
@@ -291,6 +291,9 @@ private:
     const std::size_t group_index;  ///< Position of the chunk within the group
 
     virtual void heap_ready(live_heap &&) override;
+    virtual direct_packet_result add_packet_direct(const packet_header &packet) override;
+    virtual std::size_t flush_direct() override;
+    virtual void prepare_packets(const packet_header *packets, std::size_t n_packets) override;
 
     /**
      * Flush all chunks with an ID strictly less than @a chunk_id.
@@ -25,7 +25,7 @@
 #include <cstdint>
 #include <memory>
 #include <vector>
-#include <map>
+#include <utility>
 #include <spead2/common_defines.h>
 #include <spead2/common_flavour.h>
 #include <spead2/common_memory_allocator.h>
@@ -175,7 +175,7 @@ private:
      *
      * @see @ref live_heap::payload_ranges.
      */
-    std::map<s_item_pointer_t, s_item_pointer_t> payload_ranges;
+    std::vector<std::pair<s_item_pointer_t, s_item_pointer_t>> payload_ranges;
 
     /// Heap payload length encoded in packets (-1 for unknown)
     s_item_pointer_t heap_length;
@@ -26,10 +26,10 @@
 #include <cstring>
 #include <vector>
 #include <array>
-#include <set>
 #include <memory>
-#include <map>
+#include <utility>
 #include <functional>
+#include <atomic>
 #include <spead2/common_defines.h>
 #include <spead2/common_memory_allocator.h>
 #include <spead2/recv_packet.h>
@@ -38,7 +38,10 @@
 namespace spead2::unittest::recv::live_heap
 {
     struct add_pointers;
+    struct add_pointers_many;
+    struct reset_reuse;
     struct payload_ranges;
+    struct move_assign;
 }
 
 namespace spead2::recv
@@ -48,6 +51,175 @@ typedef std::function<void(const spead2::memory_allocator::pointer &allocation,
                            const packet_header &packet)> packet_memcpy_function;
 
 class heap;
+class live_heap;
+
+namespace detail
+{
+
+/**
+ * Free list of memory for @ref live_heap metadata. When a heap that holds
+ * metadata out-of-line is handed off with @ref live_heap::take, the memory
+ * goes with it, and it is returned here when the new heap is reset or
+ * destroyed (usually when it is frozen on another thread). The stream then
+ * takes it to replace the memory that was handed off.
+ *
+ * Since it is used by reader threads on every hand-off and by consumer
+ * threads returning heaps, it does not take a lock. It holds a fixed number
+ * of slots, each with an atomic state, and a thread claims a slot by
+ * changing its state with a compare-and-swap. If there is no free slot,
+ * returned storage is simply freed.
+ */
+class live_heap_storage_pool
+{
+public:
+    /// Memory for item pointers and payload ranges
+    struct storage
+    {
+        std::vector<item_pointer_t> pointers;
+        std::vector<std::pair<s_item_pointer_t, s_item_pointer_t>> ranges;
+    };
+
+    /// Maximum number of storage objects held by the pool
+    static constexpr std::size_t capacity = 64;
+
+private:
+    enum slot_state : std::uint8_t
+    {
+        SLOT_EMPTY,
+        SLOT_BUSY,    ///< Being filled or emptied by a thread
+        SLOT_FULL
+    };
+
+    // The states are packed together so that a scan touches few cache lines
+    std::array<std::atomic<std::uint8_t>, capacity> states;
+    std::array<storage, capacity> slots;
+
+public:
+    live_heap_storage_pool();
+
+    /// Take storage from the pool, or empty storage if the pool is empty
+    storage get();
+    /// Return storage to the pool. Its contents are discarded.
+    void put(storage &&s);
+};
+
+} // namespace detail
+
+/**
+ * Set of disjoint, non-adjacent ranges of a heap payload that have been
+ * received, stored in sorted order. Each range is a half-open interval
+ * [first, second).
+ *
+ * Packets are expected to arrive more-or-less in order, so the set will
+ * normally contain only a few ranges. A small number are stored inline,
+ * and only if there are more is memory allocated (which is retained by
+ * @ref clear).
+ */
+class payload_range_set
+{
+public:
+    typedef std::pair<s_item_pointer_t, s_item_pointer_t> value_type;
+    typedef const value_type *const_iterator;
+
+    static constexpr std::size_t max_inline_ranges = 4;
+
+private:
+    /// Number of ranges in the set
+    std::size_t n_ranges = 0;
+    /// Whether the ranges are stored in @ref external_ranges
+    bool external = false;
+    std::array<value_type, max_inline_ranges> inline_ranges;
+    std::vector<value_type> external_ranges;
+
+    value_type *data() { return external ? external_ranges.data() : inline_ranges.data(); }
+    const value_type *data() const { return external ? external_ranges.data() : inline_ranges.data(); }
+
+    /// Insert a new range before position @a pos, returning the new element
+    value_type *insert(std::size_t pos, s_item_pointer_t first, s_item_pointer_t last);
+    /// Remove the element at position @a pos
+    void erase(std::size_t pos);
+
+public:
+    payload_range_set() = default;
+    payload_range_set(const payload_range_set &) = default;
+    payload_range_set &operator=(const payload_range_set &) = default;
+    // The moved-from object is left empty, rather than referencing moved-from storage
+    payload_range_set(payload_range_set &&other) noexcept
+        : n_ranges(other.n_ranges), external(other.external),
+        inline_ranges(other.inline_ranges),
+        external_ranges(std::move(other.external_ranges))
+    {
+        other.clear();
+    }
+
+    payload_range_set &operator=(payload_range_set &&other) noexcept
+    {
+        n_ranges = other.n_ranges;
+        external = other.external;
+        inline_ranges = other.inline_ranges;
+        external_ranges = std::move(other.external_ranges);
+        other.clear();
+        return *this;
+    }
+
+    /**
+     * Add a range. Returns true if the new range was inserted, or false if
+     * it was discarded as a duplicate or because it partially overlaps an
+     * existing range.
+     */
+    bool add(s_item_pointer_t first, s_item_pointer_t last);
+
+    bool empty() const { return n_ranges == 0; }
+    std::size_t size() const { return n_ranges; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + n_ranges; }
+
+    /// Remove all ranges (but keep any allocated memory)
+    void clear();
+
+    /**
+     * Remove all ranges, and exchange the allocated memory with @a storage.
+     * On return, @a storage is empty but has the capacity that was
+     * previously held by this object.
+     */
+    void swap_storage(std::vector<value_type> &storage);
+
+    /// Number of ranges that can be held in allocated (non-inline) memory
+    std::size_t capacity() const { return external_ranges.capacity(); }
+};
+
+namespace detail
+{
+
+/**
+ * Metadata of a @ref live_heap that is held in memory which may have come
+ * from a @ref live_heap_storage_pool. If @ref pool is set, the memory is
+ * returned to it when this object is released, destroyed or move-assigned
+ * over.
+ */
+class live_heap_metadata
+{
+public:
+    /// Item pointers, once there are too many to hold inline in the heap
+    std::vector<item_pointer_t> external_pointers;
+    /// Received parts of the payload (see @ref live_heap::metadata)
+    payload_range_set payload_ranges;
+    /**
+     * Pool to which the memory is returned. It is only set on heaps returned
+     * by @ref live_heap::take.
+     */
+    std::shared_ptr<live_heap_storage_pool> pool;
+
+    live_heap_metadata() = default;
+    live_heap_metadata(live_heap_metadata &&) = default;
+    live_heap_metadata &operator=(live_heap_metadata &&other);
+    ~live_heap_metadata();
+
+    /// Return the memory to @ref pool (if set), leaving this object empty
+    void release();
+};
+
+} // namespace detail
 
 /**
  * A SPEAD heap that is in the process of being received. Once it is fully
@@ -75,7 +247,10 @@ private:
     friend class heap;
     friend class incomplete_heap;
     friend struct ::spead2::unittest::recv::live_heap::add_pointers;
+    friend struct ::spead2::unittest::recv::live_heap::add_pointers_many;
+    friend struct ::spead2::unittest::recv::live_heap::reset_reuse;
     friend struct ::spead2::unittest::recv::live_heap::payload_ranges;
+    friend struct ::spead2::unittest::recv::live_heap::move_assign;
 
     static constexpr int max_inline_pointers = 8;
 
@@ -120,29 +295,44 @@ private:
      * For efficiency, the item pointers can be stored in two different ways.
      * When the number is small, they are held inline to avoid memory
      * allocation, and checks for duplicates use a linear search. Once there
-     * are too many to hold inline, they are stored both in a vector and a set.
-     * The former preserves order, while the latter is used to check for
-     * duplicates.
+     * are too many to hold inline, they are stored in a vector (which
+     * preserves order) in @ref metadata, and an open-addressed hash table of
+     * indices into the vector is used to check for duplicates.
      */
 
     std::array<item_pointer_t, max_inline_pointers> inline_pointers;
-    std::vector<item_pointer_t> external_pointers;
-    std::set<item_pointer_t> seen_pointers;
+    /**
+     * Hash table with linear probing. Each slot holds one plus an index into
+     * the external pointers, or zero if the slot is empty. The size is a
+     * power of two, and is kept at least twice the number of pointers.
+     */
+    std::vector<std::uint32_t> pointer_hash;
+    /// Right shift to map a 64-bit hash to a slot in @ref pointer_hash
+    int pointer_hash_shift = 0;
+
+    /**
+     * Number of memory allocations for metadata (not payload) made since
+     * construction or the last call to @ref reset.
+     */
+    std::size_t allocations = 0;
 
     /**@}*/
 
     /**
-     * Parts of the payload that have been seen. Each key indicates the start
-     * of a contiguous region of received data, and the value indicates the end
-     * of that contiguous region. Since packets are expected to arrive
-     * more-or-less in order (or more-or-less in order for each of a small
-     * number of streams) the map is not expected to grow large.
+     * Out-of-line item pointers, and the parts of the payload that have been
+     * seen, as contiguous regions of received data. Since packets are
+     * expected to arrive more-or-less in order (or more-or-less in order for
+     * each of a small number of streams) the set of payload ranges is not
+     * expected to grow large.
      *
-     * It is only used when the stream is constructed with
+     * The payload ranges are only used when the stream is constructed with
      * allow_out_of_order=true. When it is false, the received range is
      * assumed to be [0, received_length).
+     *
+     * For a heap returned by @ref take, the memory is returned to the pool
+     * when the heap is reset, destroyed or move-assigned over.
      */
-    std::map<s_item_pointer_t, s_item_pointer_t> payload_ranges;
+    detail::live_heap_metadata metadata;
 
     /**
      * Make sure at least @a size bytes are allocated for payload. If
@@ -162,6 +352,15 @@ private:
      */
     void add_pointers(std::size_t n, const std::uint8_t *pointers);
 
+    /**
+     * Find the slot in @ref pointer_hash that holds @a pointer, or the empty
+     * slot where it would be inserted.
+     */
+    std::uint32_t *pointer_hash_find(item_pointer_t pointer);
+
+    /// Rebuild @ref pointer_hash from the external pointers, growing it if necessary
+    void pointer_hash_rebuild();
+
 public:
     /**
      * Constructor. Note that the constructor does not actually add @a
@@ -172,6 +371,12 @@ public:
      */
     explicit live_heap(const packet_header &initial_packet,
                        bug_compat_mask bug_compat);
+    live_heap(live_heap &&) = default;
+    /**
+     * Move assignment. Metadata memory held by this object that came from
+     * a @ref detail::live_heap_storage_pool is returned to the pool first.
+     */
+    live_heap &operator=(live_heap &&) = default;
 
     /**
      * Attempt to add a packet to the heap. The packet must have been
@@ -207,8 +412,33 @@ public:
     item_pointer_t *pointers_begin();
     /// Get last stored item pointer
     item_pointer_t *pointers_end();
-    /// Free all allocated memory
+    /**
+     * Get the number of memory allocations made for metadata (item pointers
+     * and payload ranges, but not the payload itself) since construction or
+     * the last call to @ref reset.
+     */
+    std::size_t get_allocations() const { return allocations; }
+    /**
+     * Move the heap into a new object, for handing it off once it is ready,
+     * and reset this object. If the metadata is held in allocated memory,
+     * that memory goes with the new object, and this object is given
+     * replacement memory from @a pool. The new object returns the memory to
+     * @a pool when it is reset or destroyed, so that a stream that keeps
+     * handing off heaps does not need to allocate more.
+     */
+    live_heap take(const std::shared_ptr<detail::live_heap_storage_pool> &pool);
+    /**
+     * Return to an empty state, freeing the payload. Memory used to hold
+     * metadata is retained, so that it can be reused without allocation
+     * (or for a heap returned by @ref take, returned to the pool).
+     */
     void reset();
+    /**
+     * Reset the heap and prepare it to receive a new heap, as if it had been
+     * constructed with these arguments, but retaining memory allocated for
+     * metadata.
+     */
+    void reset(const packet_header &initial_packet, bug_compat_mask bug_compat);
 };
 
 } // namespace spead2::recv
@@ -77,6 +77,25 @@ s_item_pointer_t get_packet_size(const uint8_t *data, std::size_t length);
  */
 std::size_t decode_packet(packet_header &out, const std::uint8_t *raw, std::size_t max_size);
 
+/**
+ * Split out the header fields for a batch of packets, such as those
+ * returned by a single call to @c recvmmsg. Unlike @ref decode_packet, each
+ * buffer must contain exactly one packet (as is the case for datagrams), and
+ * packets whose size does not match the buffer length are discarded.
+ *
+ * Packets that are successfully decoded are written contiguously to @a out,
+ * in their original order.
+ *
+ * @param[out] out       Packet headers (must have space for @a n_packets entries)
+ * @param[in]  raw       Start of each packet
+ * @param[in]  lengths   Length of each packet
+ * @param      n_packets Number of packets in the batch
+ * @returns The number of packets successfully decoded.
+ */
+std::size_t decode_packets(
+    packet_header *out, const std::uint8_t * const *raw, const std::size_t *lengths,
+    std::size_t n_packets);
+
 } // namespace spead2::recv
 
 #endif // SPEAD2_RECV_PACKET
@@ -0,0 +1,199 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_RECV_PCAP_WRITER_H
+#define SPEAD2_RECV_PCAP_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+
+namespace spead2::recv
+{
+
+/**
+ * Writes received packets to a pcap file. An instance can be attached to
+ * one or more streams with @ref stream_config::set_packet_tap, in which case
+ * every packet seen by a UDP reader (whether or not it turns out to be a
+ * valid SPEAD packet) is recorded along with the time it was received.
+ *
+ * Only the UDP payload is available to the readers, so each packet is
+ * given synthetic Ethernet, IPv4 and UDP headers (with zero addresses and
+ * ports) so that the file can be read by standard tools, and by
+ * @ref udp_pcap_file_reader or @ref udp_pcap_replay_reader. Timestamps have
+ * nanosecond resolution.
+ *
+ * Packets are appended to in-memory buffers, and full buffers are written
+ * to the file by a background thread, so that the receive path never blocks
+ * on I/O. If the disk cannot keep up and all buffers are full, packets are
+ * not recorded and are counted by @ref get_dropped instead. Packets are
+ * only guaranteed to be in the file after @ref flush or @ref close. If
+ * writing to the file fails, the error is logged and all further packets
+ * are dropped.
+ *
+ * Each UDP reader records packets through its own @ref source, which has
+ * its own buffer, so that readers do not contend with each other except
+ * when handing over a full buffer. One extra buffer is allocated for each
+ * source. It is safe to call @ref add_packet from multiple threads at once,
+ * but those calls share a single source.
+ */
+class pcap_writer
+{
+public:
+    class source;
+
+private:
+    struct buffer
+    {
+        std::unique_ptr<std::uint8_t[]> data;
+        std::size_t length = 0;
+    };
+
+    int fd;
+    const std::size_t buffer_size;
+    /// Set by @ref close
+    std::atomic<bool> closed{false};
+    /// Set by the writer thread if writing to the file fails
+    std::atomic<bool> failed{false};
+    std::atomic<std::uint64_t> dropped{0};
+
+    /// Protects @ref sources. Must be taken before any @ref source::mutex.
+    std::mutex sources_mutex;
+    std::vector<source *> sources;
+
+    /**
+     * Protects the members below it. This is only taken to exchange whole
+     * buffers with the writer thread, and must not be held while taking
+     * @ref sources_mutex or a @ref source::mutex.
+     */
+    std::mutex mutex;
+    std::condition_variable full_cond;
+    /// Buffers waiting to be written
+    std::deque<buffer> full_buffers;
+    /// Empty buffers available for filling
+    std::vector<buffer> free_buffers;
+    /// Number of buffers in existence, and the number allowed
+    std::size_t n_buffers, max_buffers;
+    /// Set once all sources have been flushed during @ref close
+    bool stopping = false;
+
+    std::future<void> writer_future;
+    /// Source used by @ref add_packet (created on first use)
+    std::unique_ptr<source> direct_source;
+    std::once_flag direct_source_once;
+
+    void writer_thread();
+    /// Get an empty buffer, or a buffer with null data if none is available
+    buffer get_buffer();
+    /// Return an empty buffer to the free list (or free it)
+    void release_buffer(buffer &&b);
+    /// Pass a buffer to the writer thread
+    void submit_buffer(buffer &&b);
+
+public:
+    /// Default size of each buffer
+    static constexpr std::size_t default_buffer_size = 8 * 1024 * 1024;
+    /// Default number of buffers
+    static constexpr std::size_t default_buffers = 2;
+
+    /**
+     * Constructor.
+     *
+     * @param filename     Output file (truncated if it already exists)
+     * @param buffer_size  Size of each in-memory buffer
+     * @param buffers      Number of buffers (at least 2), in addition to
+     *                     one per @ref source
+     *
+     * @throw std::invalid_argument if @a buffers is less than 2 or
+     * @a buffer_size is too small to hold a maximum-size packet.
+     * @throw std::system_error if the file could not be opened.
+     */
+    explicit pcap_writer(const std::string &filename,
+                         std::size_t buffer_size = default_buffer_size,
+                         std::size_t buffers = default_buffers);
+    /// Destructor. This calls @ref close, but only logs errors.
+    ~pcap_writer();
+
+    /**
+     * Record a packet. If the packet is too large to be represented in an
+     * IPv4 datagram or no buffer space is available, it is dropped.
+     */
+    void add_packet(const std::uint8_t *data, std::size_t length);
+
+    /// Pass any buffered packets (from all sources) to the writer thread.
+    void flush();
+
+    /**
+     * Write all buffered packets, stop the writer thread and close the
+     * file. Further packets are counted as dropped. If the writer thread
+     * encountered an error, it is rethrown here.
+     */
+    void close();
+
+    /**
+     * Number of packets that could not be recorded due to lack of buffer
+     * space or an earlier write error
+     */
+    std::uint64_t get_dropped() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+/**
+ * Handle through which a single producer (typically one reader) records
+ * packets into a @ref pcap_writer. It fills its own buffer, and only
+ * interacts with the writer when that buffer is full. The writer must
+ * outlive the source.
+ */
+class pcap_writer::source
+{
+private:
+    friend class pcap_writer;
+
+    pcap_writer &owner;
+    /**
+     * Protects @ref cur_buffer. Apart from the producer, it is only taken
+     * by @ref pcap_writer::flush and @ref pcap_writer::close, so it is
+     * normally uncontended.
+     */
+    std::mutex mutex;
+    /// Buffer currently being filled (data is null if none was available)
+    buffer cur_buffer;
+
+    /// Hand @ref cur_buffer to the writer thread (with @ref mutex held)
+    void flush_unlocked();
+
+public:
+    explicit source(pcap_writer &owner);
+    /// Destructor. Any buffered packets are passed to the writer thread.
+    ~source();
+
+    /// Record a packet (see @ref pcap_writer::add_packet)
+    void add_packet(const std::uint8_t *data, std::size_t length);
+};
+
+} // namespace spead2::recv
+
+#endif // SPEAD2_RECV_PCAP_WRITER_H
@@ -28,6 +28,7 @@
 #include <spead2/recv_heap.h>
 #include <spead2/recv_stream.h>
 #include <utility>
+#include <cstddef>
 
 namespace spead2::recv
 {
@@ -149,6 +150,34 @@ public:
      */
     live_heap try_pop_live();
 
+    /**
+     * Wait until at least one heap is available, then retrieve up to
+     * @a max_heaps heaps at once; or until the stream is stopped. This
+     * amortises the synchronisation cost over several heaps, which helps
+     * when heaps are small.
+     *
+     * @param out        Output iterator to which the heaps are written
+     * @param max_heaps  Maximum number of heaps to retrieve
+     * @param sem_args   Arbitrary arguments to pass to the data semaphore
+     * @returns the number of heaps retrieved
+     * @throw ringbuffer_stopped if @ref stop has been called and
+     * there are no more heaps.
+     */
+    template<typename OutputIt, typename... SemArgs>
+    std::size_t pop_live_many(OutputIt out, std::size_t max_heaps, SemArgs&&... sem_args);
+
+    /**
+     * Like @ref pop_live_many, but if no heap is available,
+     * throws @ref spead2::ringbuffer_empty.
+     *
+     * @throw ringbuffer_empty if there is no heap available, but the
+     * stream has not been stopped
+     * @throw ringbuffer_stopped if @ref stop has been called and
+     * there are no more heaps.
+     */
+    template<typename OutputIt>
+    std::size_t try_pop_live_many(OutputIt out, std::size_t max_heaps);
+
     virtual void stop_received() override;
 
     virtual void stop() override;
@@ -275,6 +304,21 @@ live_heap ring_stream<Ringbuffer>::try_pop_live()
     return ready_heaps.try_pop();
 }
 
+template<typename Ringbuffer>
+template<typename OutputIt, typename... SemArgs>
+std::size_t ring_stream<Ringbuffer>::pop_live_many(
+    OutputIt out, std::size_t max_heaps, SemArgs&&... sem_args)
+{
+    return ready_heaps.pop_many(std::move(out), max_heaps, std::forward<SemArgs>(sem_args)...);
+}
+
+template<typename Ringbuffer>
+template<typename OutputIt>
+std::size_t ring_stream<Ringbuffer>::try_pop_live_many(OutputIt out, std::size_t max_heaps)
+{
+    return ready_heaps.try_pop_many(std::move(out), max_heaps);
+}
+
 template<typename Ringbuffer>
 void ring_stream<Ringbuffer>::stop_received()
 {
@@ -1,4 +1,4 @@
-/* Copyright 2015, 2017-2021, 2023 National Research Foundation (SARAO)
+/* Copyright 2015, 2017-2021, 2023, 2026 National Research Foundation (SARAO)
  *
  * This program is free software: you can redistribute it and/or modify it under
  * the terms of the GNU Lesser General Public License as published by the Free
@@ -31,12 +31,14 @@
 #include <functional>
 #include <future>
 #include <mutex>
+#include <shared_mutex>
 #include <atomic>
 #include <iterator>
 #include <type_traits>
 #include <boost/asio.hpp>
 #include <boost/iterator/iterator_facade.hpp>
 #include <libdivide.h>
+#include <spead2/common_convert.h>
 #include <spead2/recv_live_heap.h>
 #include <spead2/common_memory_pool.h>
 #include <spead2/common_semaphore.h>
@@ -53,6 +55,7 @@ namespace recv
 
 struct packet_header;
 class stream;
+class pcap_writer;
 
 /// Registration information about a statistic counter.
 class stream_stat_config
@@ -104,7 +107,8 @@ static constexpr std::size_t max_batch = 5;
 static constexpr std::size_t single_packet_heaps = 6;
 static constexpr std::size_t search_dist = 7;
 static constexpr std::size_t worker_blocked = 8;
-static constexpr std::size_t custom = 9;  ///< Index for first user-defined statistic
+static constexpr std::size_t metadata_allocations = 9;
+static constexpr std::size_t custom = 10;  ///< Index for first user-defined statistic
 
 } // namespace stream_stat_indices
 
@@ -328,6 +332,111 @@ public:
     stream_stats &operator+=(const stream_stats &other);
 };
 
+/**
+ * Packet memcpy function (for use with @ref stream_config::set_memcpy) that
+ * scatters the payload of each heap into rows. The heap payload is treated
+ * as a sequence of rows of @a row_size bytes, and row @em i is written to
+ * <code>row_stride * i</code> bytes past the start of the heap's allocation.
+ * Packets need not be aligned to rows.
+ *
+ * Combined with a chunk stream whose place function sets the heap offset to
+ * the position of the heap's first row, this allows data to be corner-turned
+ * (for example, from time-major heaps to a channel-major chunk) as it is
+ * received, rather than in a separate pass over the chunk.
+ *
+ * Since the heap occupies more than its length in the allocation, it can
+ * only be used with chunk streams, and the chunks must be sized to hold the
+ * scattered heaps (see @ref get_allocation_size). Other streams throw
+ * @c std::invalid_argument from their constructors if configured with it.
+ */
+class packet_memcpy_scatter
+{
+private:
+    std::size_t row_size;
+    std::size_t row_stride;
+    memcpy_function_id id;
+
+    template<typename Copy>
+    void copy(std::uint8_t *base, const packet_header &packet, const Copy &copy_row) const;
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param row_size    Number of contiguous bytes in each row of the payload
+     * @param row_stride  Distance in bytes between the starts of consecutive rows in the destination
+     * @param id          Function used to copy each row
+     *
+     * @throw std::invalid_argument if @a row_size is zero or @a row_stride is less than @a row_size
+     * @throw std::invalid_argument if @a id is not a known function
+     */
+    packet_memcpy_scatter(std::size_t row_size, std::size_t row_stride,
+                          memcpy_function_id id = MEMCPY_STD);
+
+    /// Get the number of bytes in each row
+    std::size_t get_row_size() const { return row_size; }
+    /// Get the distance between the starts of consecutive rows in the destination
+    std::size_t get_row_stride() const { return row_stride; }
+    /// Get the function used to copy each row
+    memcpy_function_id get_memcpy() const { return id; }
+    /// Get the number of bytes spanned in the allocation by a heap with @a heap_length bytes of payload
+    std::size_t get_allocation_size(std::size_t heap_length) const;
+
+    void operator()(const memory_allocator::pointer &allocation, const packet_header &packet) const;
+};
+
+/**
+ * Packet memcpy function (for use with @ref stream_config::set_memcpy) that
+ * converts the payload as it is copied, using one of the vectorised kernels
+ * from @ref get_convert_function. The payload is treated as an array of
+ * input elements, and the element at byte offset @em k times the input
+ * element size is written to byte offset @em k times the output element
+ * size of the heap's allocation.
+ *
+ * Conversions that widen the elements write more than the heap length, so
+ * they can only be used with chunk streams, and the chunks must be sized to
+ * hold the converted heaps (see @ref get_allocation_size). Other streams
+ * throw @c std::invalid_argument from their constructors if configured with
+ * a widening conversion, because the item pointers of their heaps would
+ * give offsets into the unconverted payload rather than the one stored.
+ *
+ * Packets need not be aligned to elements for the byte-swapping
+ * conversions. For widening conversions, a partial element cannot be
+ * converted, so the chunk stream rejects packets whose payload offset or
+ * length is not a multiple of the input element size (see
+ * @ref get_packet_alignment), and counts them in its
+ * <tt>misaligned_packets</tt> statistic.
+ */
+class packet_memcpy_convert
+{
+private:
+    convert_function_id id;
+    convert_function convert;
+    std::size_t input_size;
+    std::size_t output_size;
+
+    // Handle a partial element at the start or end of a packet
+    void copy_partial(std::uint8_t *dest, std::size_t offset,
+                      const std::uint8_t *src, std::size_t length) const;
+
+public:
+    /**
+     * Constructor.
+     *
+     * @throw std::invalid_argument if @a id is not a known conversion
+     */
+    explicit packet_memcpy_convert(convert_function_id id);
+
+    /// Get the conversion passed to the constructor
+    convert_function_id get_convert() const { return id; }
+    /// Get the number of bytes spanned in the allocation by a heap with @a heap_length bytes of payload
+    std::size_t get_allocation_size(std::size_t heap_length) const;
+    /// Get the multiple of which packet payload offsets and lengths must be
+    std::size_t get_packet_alignment() const { return input_size == output_size ? 1 : input_size; }
+
+    void operator()(const memory_allocator::pointer &allocation, const packet_header &packet) const;
+};
+
 /**
  * Parameters for a receive stream.
  */
@@ -342,6 +451,8 @@ private:
     std::size_t max_heaps = default_max_heaps;
     /// Number of substreams
     std::size_t substreams = 1;
+    /// Number of independently-locked groups of substreams
+    std::size_t shards = 1;
     /// Protocol bugs to be compatible with
     bug_compat_mask bug_compat = 0;
 
@@ -359,6 +470,8 @@ private:
     std::uintptr_t stream_id = 0;
     /// Whether @ref stream::start needs to be called
     bool explicit_start = false;
+    /// Destination for copies of received packets
+    std::shared_ptr<pcap_writer> packet_tap;
     /** Statistics (includes the built-in ones)
      *
      * This is a shared_ptr so that instances of @ref stream_stats can share
@@ -390,6 +503,25 @@ public:
     /// Get number of substreams.
     std::size_t get_substreams() const { return substreams; }
 
+    /**
+     * Set number of shards. Substreams are divided amongst the shards (the
+     * shard is the substream index modulo the number of shards), and each
+     * shard is protected by its own lock. This allows multiple readers
+     * (running on different threads of a @ref thread_pool) to assemble heaps
+     * concurrently, provided that they receive heaps from different shards.
+     *
+     * The number of substreams must be a multiple of the number of shards
+     * (this is only checked when the stream is constructed). Custom
+     * statistics are not supported when there is more than one shard, and
+     * stream classes whose @ref stream_base::heap_ready is not thread-safe
+     * (such as @ref chunk_stream) do not support it.
+     *
+     * @throw std::invalid_argument if @a shards is zero.
+     */
+    stream_config &set_shards(std::size_t shards);
+    /// Get number of shards.
+    std::size_t get_shards() const { return shards; }
+
     /// Set an allocator to use for allocating heap memory.
     stream_config &set_memory_allocator(std::shared_ptr<memory_allocator> allocator);
     /// Get allocator for allocating heap memory.
@@ -449,6 +581,15 @@ public:
     /// Get the explicit start flag
     bool get_explicit_start() const { return explicit_start; }
 
+    /**
+     * Set a @ref pcap_writer that will record every packet received by
+     * UDP-based readers of the stream. The same writer may be shared by
+     * several streams. Pass a null pointer to disable recording.
+     */
+    stream_config &set_packet_tap(std::shared_ptr<pcap_writer> packet_tap);
+    /// Get the packet tap (may be null)
+    const std::shared_ptr<pcap_writer> &get_packet_tap() const { return packet_tap; }
+
     /**
      * Add a new custom statistic. Returns the index to use with @ref stream_stats.
      *
@@ -518,11 +659,26 @@ class stream_base;
  * each has a separate head pointer that wraps within its own portion of the
  * storage.
  *
+ * When using multiple shards, substream @a i belongs to shard
+ * <code>i % shards</code>. Because the number of substreams is a multiple of
+ * the number of shards, this is also the heap cnt modulo the number of
+ * shards. Each shard has its own section of @ref buckets, so that a hash
+ * chain never contains heaps from more than one shard.
+ *
  * Avoiding deadlocks requires a careful design with several mutexes. It's
  * governed by the requirement that @ref heap_ready may block indefinitely, and
  * this must not block other functions. Thus, several mutexes are involved:
  *   - @ref shared_state::queue_mutex: protects values only used
  *     by @ref add_packet. This may be locked for long periods.
+ *   - @ref shared_state::shard_mutex: only used when there are multiple
+ *     shards. Batches of packets lock it in shared mode (instead of locking
+ *     @ref shared_state::queue_mutex), and then lock the mutex of the shard
+ *     containing each heap, holding at most one shard mutex at a time.
+ *     Anything else that needs access to the queues (flushing, stopping, and
+ *     functions passed to @ref post) locks it in exclusive mode, after
+ *     locking @ref shared_state::queue_mutex. A pending exclusive lock
+ *     holds @ref shared_state::shard_gate, which stops new batches from
+ *     taking the shared lock ahead of it.
  *   - @ref stats_mutex: protects stream statistics, and is mostly locked for
  *     writes (assuming the user is only occasionally checking the stats).
  *
@@ -541,7 +697,13 @@ private:
     struct queue_entry
     {
         queue_entry *next;   // Hash table chain
+        /**
+         * Heap storage. Once constructed, the heap is kept (and recycled with
+         * @ref live_heap::reset) until the stream is destroyed, so that its
+         * metadata memory can be reused.
+         */
         spead2::detail::storage<live_heap> heap;
+        bool constructed;    // Whether @ref heap has been constructed
         /* TODO: pad to a multiple of 16 bytes, so that there is a
          * good chance of next and heap.cnt being in the same cache line.
          */
@@ -556,6 +718,13 @@ private:
         std::size_t head;
     };
 
+    // Per-shard data
+    struct shard
+    {
+        /// Protects the substreams and buckets of the shard (only used with multiple shards)
+        std::mutex mutex;
+    };
+
     /**
      * Circular queue for heaps.
      *
@@ -563,11 +732,14 @@ private:
      * not INVALID_ENTRY.
      */
     const std::unique_ptr<queue_entry[]> queue_storage;
-    /// Number of entries in @ref buckets
+    /// Number of entries in @ref buckets for each shard
     const std::size_t bucket_count;
     /// Right shift to map 64-bit unsigned to a bucket index
     const int bucket_shift;
-    /// Pointer to the first heap in each bucket, or NULL
+    /**
+     * Pointer to the first heap in each bucket, or NULL. Each shard has
+     * @ref bucket_count consecutive entries.
+     */
     const std::unique_ptr<queue_entry *[]> buckets;
     /**
      * Per-substream data. There is one extra entry to indicate the end
@@ -576,10 +748,17 @@ private:
     const std::unique_ptr<substream[]> substreams;
     /// Fast division by number of substreams
     libdivide::divider<item_pointer_t> substream_div;
+    /// Per-shard data
+    const std::unique_ptr<shard[]> shards;
+    /// Fast division by number of shards
+    libdivide::divider<item_pointer_t> shard_div;
 
     /// Stream configuration
     const stream_config config;
 
+    /// Free list of metadata memory for heaps handed off by @ref live_heap::take
+    const std::shared_ptr<detail::live_heap_storage_pool> heap_storage_pool;
+
 private:
     struct shared_state
     {
@@ -595,13 +774,58 @@ private:
          */
         mutable std::mutex queue_mutex;
 
+        /**
+         * Mutex that is held in shared mode while processing a batch of
+         * packets, when the stream has multiple shards. It is not used by
+         * batches when there is only one shard.
+         */
+        mutable std::shared_mutex shard_mutex;
+
+        /**
+         * Set while an @ref exclusive_lock is waiting for
+         * @ref shard_mutex. Batches that see it wait on @ref shard_gate
+         * before taking the shared lock, so that a steady stream of batches
+         * cannot starve the exclusive lock (@c std::shared_mutex may prefer
+         * shared owners).
+         */
+        std::atomic<bool> exclusive_pending{false};
+
+        /// Held by an @ref exclusive_lock while it waits for @ref shard_mutex
+        mutable std::mutex shard_gate;
+
         /**
          * Pointer back to the owning stream. This is set to @c nullptr
          * when the stream is stopped.
          */
         stream_base *self;
 
-        explicit shared_state(stream_base *self) : self(self) {}
+        /// Whether the stream has more than one shard
+        const bool sharded;
+
+        shared_state(stream_base *self, bool sharded) : self(self), sharded(sharded) {}
+    };
+
+    /**
+     * Lock that gives exclusive access to the stream, regardless of the
+     * number of shards. It locks @ref shared_state::queue_mutex and then
+     * @ref shared_state::shard_mutex in exclusive mode, holding
+     * @ref shared_state::shard_gate while waiting for the latter.
+     */
+    class exclusive_lock
+    {
+    private:
+        std::lock_guard<std::mutex> queue_lock;
+        std::unique_lock<std::shared_mutex> shard_lock;
+
+    public:
+        explicit exclusive_lock(shared_state &state)
+            : queue_lock(state.queue_mutex)
+        {
+            state.exclusive_pending = true;
+            std::lock_guard<std::mutex> gate_lock(state.shard_gate);
+            shard_lock = std::unique_lock<std::shared_mutex>(state.shard_mutex);
+            state.exclusive_pending = false;
+        }
     };
 
     /**
@@ -615,12 +839,21 @@ private:
     /// @ref stop_received has been called, either externally or by stream control
     bool stopped = false;
 
+    /// Compute bucket number for a heap cnt, given the shard it belongs to
+    std::size_t get_bucket(item_pointer_t heap_cnt, std::size_t shard_id) const;
+
     /// Compute bucket number for a heap cnt
-    std::size_t get_bucket(item_pointer_t heap_cnt) const;
+    std::size_t get_bucket(item_pointer_t heap_cnt) const
+    {
+        return get_bucket(heap_cnt, get_shard(heap_cnt));
+    }
 
     /// Compute substream from a heap cnt
     std::size_t get_substream(item_pointer_t heap_cnt) const;
 
+    /// Compute shard from a heap cnt
+    std::size_t get_shard(item_pointer_t heap_cnt) const;
+
     /**
      * Unlink an entry from the hash table.
      *
@@ -634,19 +867,112 @@ private:
      * The heap might or might not be complete. The
      * @ref spead2::recv::stream_base::shared_state::queue_mutex will be
      * locked during this call, which will block @ref stop and @ref flush.
+     *
+     * When the stream has multiple shards, it is instead called with only
+     * the mutex for the heap's shard held (unless it is called while flushing
+     * or stopping), and so it may be called concurrently for heaps from
+     * different shards.
      */
     virtual void heap_ready(live_heap &&) {}
 
-    /// Implementation of @ref flush that assumes the caller has locked @ref shared_state::queue_mutex
+    /// Implementation of @ref flush that assumes the caller holds an @ref exclusive_lock
     void flush_unlocked();
 
-    /// Implementation of @ref stop that assumes the caller has locked @ref shared_state::queue_mutex
+    /// Implementation of @ref stop that assumes the caller holds an @ref exclusive_lock
     void stop_unlocked();
 
     /// Implementation of @ref add_packet_state::add_packet
     bool add_packet(add_packet_state &state, const packet_header &packet);
 
+    /// Implementation of @ref add_packet_state::add_packets
+    std::size_t add_packets(add_packet_state &state, const packet_header *packets, std::size_t n_packets);
+
+    /// Whether packets are passed to @ref add_packet_direct instead of being assembled into heaps
+    bool direct_packets = false;
+
+    /// Multiple of which packet payload offsets and lengths must be (see @ref set_packet_alignment)
+    std::size_t packet_alignment = 1;
+    /// Index of the statistic counting packets rejected by @ref packet_alignment
+    std::size_t misaligned_packets_stat = 0;
+
+public:
+    /// Maximum number of packets that @ref add_packets groups by heap
+    static constexpr std::size_t packet_window = 64;
+
+    /// Outcome of @ref add_packet_direct
+    struct direct_packet_result
+    {
+        bool added = false;          ///< The packet was consumed
+        bool heap_complete = false;  ///< The packet completed its heap
+        bool heap_evicted = false;   ///< An incomplete heap was discarded to make room
+        bool end_of_stream = false;  ///< The packet contained a stream stop item
+    };
+
+private:
+    /**
+     * Handle a packet without constructing a @ref live_heap, when enabled
+     * with @ref enable_direct_packets. It is called with the same locks
+     * held as @ref heap_ready, after the packet has been checked for a
+     * heap length. The base implementation rejects every packet.
+     */
+    virtual direct_packet_result add_packet_direct(const packet_header &) { return {}; }
+
+    /**
+     * Discard all incomplete heaps tracked by @ref add_packet_direct, and
+     * return the number discarded. It is called by @ref flush_unlocked.
+     */
+    virtual std::size_t flush_direct() { return 0; }
+
+    /**
+     * Called by @ref add_packets with each window of (up to
+     * @ref packet_window) packets before they are added, so that a subclass
+     * can do work for the whole window at once. It is called with the same
+     * locks held as @ref heap_ready. Any state derived from the packets
+     * must be discarded on the next call, which is made with
+     * @a n_packets = 0 once the batch is complete.
+     */
+    virtual void prepare_packets(const packet_header *, std::size_t) {}
+
 protected:
+    /**
+     * Bypass heap assembly, passing every packet to @ref add_packet_direct.
+     * The subclass becomes responsible for tracking heaps, and
+     * @ref heap_ready is never called. This may only be called from the
+     * constructor, and is incompatible with multiple shards.
+     *
+     * @throw std::invalid_argument if the stream has multiple shards
+     */
+    void enable_direct_packets();
+
+    /**
+     * Reject packets that cannot be copied by @a memcpy because they are not
+     * aligned to its elements (see
+     * @ref packet_memcpy_convert::get_packet_alignment), counting them in
+     * the custom statistic with index @a stat_index. Only subclasses that
+     * accept widening conversions (which replace the memcpy function in the
+     * stream config with a wrapper) need to call this, with the original.
+     * This may only be called from the constructor.
+     */
+    void set_packet_alignment(const packet_memcpy_function &memcpy, std::size_t stat_index);
+
+    /**
+     * Whether @a packet satisfies the alignment set with
+     * @ref set_packet_alignment. Packets that don't are rejected by
+     * @ref add_packet before they reach a heap.
+     */
+    bool is_packet_aligned(const packet_header &packet) const
+    {
+        return packet_alignment == 1
+            || (packet.payload_offset % packet_alignment == 0
+                && packet.payload_length % packet_alignment == 0);
+    }
+
+    /**
+     * Determine whether there is an incomplete heap with cnt @a heap_cnt.
+     * The caller must hold the lock for the heap's shard.
+     */
+    bool is_heap_live(s_item_pointer_t heap_cnt) const;
+
     mutable std::mutex stats_mutex;
     std::vector<std::uint64_t> stats;
 
@@ -669,8 +995,9 @@ protected:
      * is stopped.
      *
      * This is called with @ref spead2::recv::stream_base::shared_state::queue_mutex
-     * locked. Users must not call this function themselves; instead, call @ref
-     * stop.
+     * locked (and, if there are multiple shards, with exclusive access to the
+     * stream). Users must not call this function themselves; instead, call
+     * @ref stop.
      */
     virtual void stop_received();
 
@@ -685,7 +1012,7 @@ protected:
     void post(ExecutionContext &ex, F &&func)
     {
         boost::asio::post(ex, [shared{shared}, func{std::forward<F>(func)}]() {
-            std::lock_guard<std::mutex> lock(shared->queue_mutex);
+            exclusive_lock lock(*shared);
             stream_base *self = shared->self;
             if (self)
                 func(*self);
@@ -695,7 +1022,9 @@ protected:
 public:
     /**
      * State for a batch of calls to @ref add_packet. Constructing this object
-     * locks the stream's @ref shared_state::queue_mutex.
+     * locks the stream's @ref shared_state::queue_mutex (or, if the stream
+     * has multiple shards, takes a shared lock on
+     * @ref shared_state::shard_mutex).
      *
      * After constructing this object, one *must* check whether @ref owner is
      * null (checking @ref is_stopped implicitly does so). If so, do not call
@@ -708,8 +1037,15 @@ public:
     {
         friend class stream_base;
     private:
-        /// Holds a lock on the owner's @ref shared_state::queue_mutex
-        std::lock_guard<std::mutex> lock;
+        /// Holds a lock on the owner's @ref shared_state::queue_mutex (single shard only)
+        std::unique_lock<std::mutex> lock;
+        /// Holds a shared lock on the owner's @ref shared_state::shard_mutex (multiple shards only)
+        std::shared_lock<std::shared_mutex> shared_lock;
+        /// Holds a lock on the mutex of the most recently used shard (multiple shards only)
+        std::unique_lock<std::mutex> shard_lock;
+        /// Index of the shard locked by @ref shard_lock
+        std::size_t shard_id = 0;
+        shared_state &shared;
         stream_base *owner;
 
         // Updates to the statistics
@@ -718,6 +1054,21 @@ public:
         std::uint64_t incomplete_heaps_evicted = 0;
         std::uint64_t single_packet_heaps = 0;
         std::uint64_t search_dist = 0;
+        std::uint64_t metadata_allocations = 0;
+
+        /**
+         * Queue entry that received the previous packet, which is checked
+         * before searching the hash table. It is not necessarily still valid,
+         * and is only used if it still holds a heap with the right cnt. It
+         * is only dereferenced if @ref last_heap_cnt and @ref last_shard_id
+         * match the packet, because another thread may modify the entries
+         * of a shard once its lock is released.
+         */
+        queue_entry *last_entry = nullptr;
+        /// Heap cnt of the packet that was added to @ref last_entry
+        s_item_pointer_t last_heap_cnt = -1;
+        /// Shard containing @ref last_entry
+        std::size_t last_shard_id = 0;
 
         /**
          * Whether the stream is stopped. If a stop was received during the
@@ -726,6 +1077,12 @@ public:
          */
         bool stopped;
 
+        /// Make @a shard_id the (only) locked shard
+        void lock_shard(std::size_t shard_id);
+
+        /// Merge the statistics for the batch into the stream
+        void update_stats();
+
     public:
         explicit add_packet_state(shared_state &owner);
         explicit add_packet_state(stream_base &s) : add_packet_state(*s.shared) {}
@@ -747,6 +1104,27 @@ public:
             assert(!is_stopped());
             return owner->add_packet(*this, packet);
         }
+
+        /**
+         * Add a batch of packets that have been examined by @ref
+         * decode_packet or @ref decode_packets, and return the number that
+         * were consumed.
+         *
+         * Packets belonging to the same heap are grouped together (within
+         * windows of 64 packets), so that each heap's state stays in cache
+         * and the hash table lookup is only done once per heap. Packets of
+         * a heap are still added in the order they were received. If the
+         * stream stops part-way through the batch, the remaining packets
+         * are discarded; because of the grouping, these are not necessarily
+         * exactly the packets that were received after the stop item.
+         *
+         * It is an error to call this after the stream has been stopped.
+         */
+        std::size_t add_packets(const packet_header *packets, std::size_t n_packets)
+        {
+            assert(!is_stopped());
+            return owner->add_packets(*this, packets, n_packets);
+        }
     };
 
     /**
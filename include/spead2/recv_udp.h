@@ -29,7 +29,9 @@
 # include <sys/socket.h>
 # include <sys/types.h>
 #endif
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 #include <boost/asio.hpp>
 #include <spead2/recv_stream.h>
 #include <spead2/recv_udp_base.h>
@@ -37,6 +39,57 @@
 namespace spead2::recv
 {
 
+/**
+ * Polling options for @ref udp_reader. The defaults wait for the socket to
+ * become readable between receive calls.
+ */
+class udp_poll_config
+{
+private:
+    int max_poll = 1;
+    int busy_poll = 0;
+    bool prefer_busy_poll = false;
+
+public:
+    /**
+     * Set the number of times that the reader calls @c recvmmsg in a row
+     * before it goes back to waiting for the socket to become readable. The
+     * default of 1 never polls. Larger values trade CPU time for lower
+     * wake-up latency, and are only worthwhile if the thread pool has
+     * dedicated cores. While packets keep arriving the reader continues
+     * polling, yielding to other work on the thread pool between attempts.
+     *
+     * This has no effect if spead2 was built without @c recvmmsg support.
+     *
+     * @throw std::invalid_argument if @a max_poll is less than 1.
+     */
+    udp_poll_config &set_max_poll(int max_poll);
+    /// Get the number of times to poll the socket in a row
+    int get_max_poll() const { return max_poll; }
+
+    /**
+     * Set the @c SO_BUSY_POLL socket option (in microseconds), so that the
+     * kernel busy-polls the network device when the socket is read and
+     * empty. Zero leaves the system default. Raising it above the system
+     * default needs @c CAP_NET_ADMIN; if the option cannot be set, a warning
+     * is logged.
+     *
+     * @throw std::invalid_argument if @a busy_poll is negative.
+     */
+    udp_poll_config &set_busy_poll(int busy_poll);
+    /// Get the @c SO_BUSY_POLL value
+    int get_busy_poll() const { return busy_poll; }
+
+    /**
+     * Set whether to set @c SO_PREFER_BUSY_POLL, which asks the kernel to
+     * defer interrupt processing in favour of busy polling. It requires
+     * Linux 5.11 or later.
+     */
+    udp_poll_config &set_prefer_busy_poll(bool prefer_busy_poll);
+    /// Get whether @c SO_PREFER_BUSY_POLL is set
+    bool get_prefer_busy_poll() const { return prefer_busy_poll; }
+};
+
 /**
  * Asynchronous stream reader that receives packets over UDP.
  */
@@ -79,9 +132,28 @@ private:
 #endif
     /// UDP socket we are listening on
     boost::asio::ip::udp::socket socket;
+    /// Number of times to call recvmmsg in a row (see @ref udp_poll_config::set_max_poll)
+    const int max_poll;
 
-    /// Start an asynchronous receive
-    void enqueue_receive(handler_context ctx);
+    /// Apply the busy-polling socket options from @a poll_config
+    void set_busy_poll_options(const udp_poll_config &poll_config);
+
+    /**
+     * Start an asynchronous receive. If @a need_poll is true, the socket is
+     * polled again at the next opportunity rather than waiting for it to
+     * become readable.
+     */
+    void enqueue_receive(handler_context ctx, bool need_poll = false);
+
+#if SPEAD2_USE_RECVMMSG
+    /**
+     * Receive and process one batch of packets with a non-blocking call to
+     * recvmmsg.
+     *
+     * @returns the return value of recvmmsg
+     */
+    int receive_batch(stream_base::add_packet_state &state);
+#endif
 
     /// Callback on completion of asynchronous receive
     void packet_handler(
@@ -109,12 +181,14 @@ public:
      * @param buffer_size  Requested socket buffer size. Note that the
      *                     operating system might not allow a buffer size
      *                     as big as the default.
+     * @param poll_config  Polling options
      */
     udp_reader(
         stream &owner,
         const boost::asio::ip::udp::endpoint &endpoint,
         std::size_t max_size = default_max_size,
-        std::size_t buffer_size = default_buffer_size);
+        std::size_t buffer_size = default_buffer_size,
+        const udp_poll_config &poll_config = udp_poll_config());
 
     /**
      * Constructor with explicit interface address (IPv4 only).
@@ -134,6 +208,7 @@ public:
      * @param max_size     Maximum packet size that will be accepted.
      * @param buffer_size  Requested socket buffer size.
      * @param interface_address  Address of the interface which should join the group
+     * @param poll_config  Polling options
      *
      * @throws std::invalid_argument If @a endpoint is not an IPv4 multicast address and
      *                               does not match @a interface_address.
@@ -144,7 +219,8 @@ public:
         const boost::asio::ip::udp::endpoint &endpoint,
         std::size_t max_size,
         std::size_t buffer_size,
-        const boost::asio::ip::address &interface_address);
+        const boost::asio::ip::address &interface_address,
+        const udp_poll_config &poll_config = udp_poll_config());
 
     /**
      * Constructor with explicit multicast interface index (IPv6 only).
@@ -159,6 +235,7 @@ public:
      * @param max_size     Maximum packet size that will be accepted.
      * @param buffer_size  Requested socket buffer size.
      * @param interface_index  Address of the interface which should join the group
+     * @param poll_config  Polling options
      *
      * @see if_nametoindex(3)
      */
@@ -167,7 +244,8 @@ public:
         const boost::asio::ip::udp::endpoint &endpoint,
         std::size_t max_size,
         std::size_t buffer_size,
-        unsigned int interface_index);
+        unsigned int interface_index,
+        const udp_poll_config &poll_config = udp_poll_config());
 
     /**
      * Constructor using an existing socket. This allows socket options (e.g.,
@@ -179,16 +257,58 @@ public:
      * @param socket       Existing socket which will be taken over. It must
      *                     use the same I/O service as @a owner.
      * @param max_size     Maximum packet size that will be accepted.
+     * @param poll_config  Polling options
      */
     udp_reader(
         stream &owner,
         boost::asio::ip::udp::socket &&socket,
-        std::size_t max_size = default_max_size);
+        std::size_t max_size = default_max_size,
+        const udp_poll_config &poll_config = udp_poll_config());
 
     virtual void start() override;
     virtual void stop() override;
 };
 
+/**
+ * Create @a n UDP sockets that are all bound to @a endpoint with
+ * @c SO_REUSEPORT, so that each can be passed to its own @ref udp_reader.
+ * This allows reception to be spread over several threads: typically the
+ * readers either all belong to one stream with @a n shards (see
+ * @ref stream_config::set_shards) and a thread pool with @a n threads, or
+ * each belongs to a different member of a @ref chunk_stream_group.
+ *
+ * When supported by the operating system, a classic BPF program is attached
+ * to the sockets to steer each packet to socket <code>cnt % n</code>, where
+ * @a cnt is the heap counter. Thus all the packets of a heap arrive on the
+ * same socket, and when @a n is the number of shards, each socket feeds a
+ * single shard. The program takes the heap counter from the first item
+ * pointer of the packet (which is where spead2 and most other senders put
+ * it), and only uses the low 32 bits of it. If @a n is not a power of 2,
+ * heaps with counters of 2<sup>32</sup> or more are thus not necessarily
+ * steered to the socket matching their shard, but all the packets of a heap
+ * are still steered to the same socket. Packets that are not SPEAD packets
+ * are distributed by the kernel's default flow hash.
+ *
+ * If steering is not supported, a warning is logged and the kernel's default
+ * flow hash is used, which keeps each sender on a single socket.
+ *
+ * If the port of @a endpoint is zero, the first socket is bound to an
+ * ephemeral port and the others are bound to the same port.
+ *
+ * @param io_service   I/O service for the sockets (must be the same as for
+ *                     the streams that will use them)
+ * @param endpoint     Unicast address (possibly unspecified) and port
+ * @param n            Number of sockets
+ * @param buffer_size  Requested socket buffer size for each socket
+ *
+ * @throws std::invalid_argument if @a n is zero or @a endpoint is a multicast address
+ */
+std::vector<boost::asio::ip::udp::socket> make_udp_reuseport_sockets(
+    boost::asio::io_service &io_service,
+    const boost::asio::ip::udp::endpoint &endpoint,
+    std::size_t n,
+    std::size_t buffer_size = udp_reader::default_buffer_size);
+
 /**
  * Factory overload to allow udp_reader to be dynamically substituted with
  * udp_ibv_reader based on environment variables.
@@ -200,26 +320,30 @@ struct reader_factory<udp_reader>
         stream &owner,
         const boost::asio::ip::udp::endpoint &endpoint,
         std::size_t max_size = udp_reader::default_max_size,
-        std::size_t buffer_size = udp_reader::default_buffer_size);
+        std::size_t buffer_size = udp_reader::default_buffer_size,
+        const udp_poll_config &poll_config = udp_poll_config());
 
     static std::unique_ptr<reader> make_reader(
         stream &owner,
         const boost::asio::ip::udp::endpoint &endpoint,
         std::size_t max_size,
         std::size_t buffer_size,
-        const boost::asio::ip::address &interface_address);
+        const boost::asio::ip::address &interface_address,
+        const udp_poll_config &poll_config = udp_poll_config());
 
     static std::unique_ptr<reader> make_reader(
         stream &owner,
         const boost::asio::ip::udp::endpoint &endpoint,
         std::size_t max_size,
         std::size_t buffer_size,
-        unsigned int interface_index);
+        unsigned int interface_index,
+        const udp_poll_config &poll_config = udp_poll_config());
 
     static std::unique_ptr<reader> make_reader(
         stream &owner,
         boost::asio::ip::udp::socket &&socket,
-        std::size_t max_size = udp_reader::default_max_size);
+        std::size_t max_size = udp_reader::default_max_size,
+        const udp_poll_config &poll_config = udp_poll_config());
 };
 
 } // namespace spead2::recv
@@ -23,17 +23,40 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <vector>
+#include <boost/asio.hpp>
 #include <spead2/recv_stream.h>
+#include <spead2/recv_packet.h>
+#include <spead2/recv_pcap_writer.h>
 
 namespace spead2::recv
 {
 
 /**
- * Base class that has common logic between @ref udp_reader and @ref
- * udp_ibv_reader.
+ * Base class that has common logic between @ref udp_reader, @ref
+ * udp_uring_reader and @ref udp_ibv_reader.
  */
 class udp_reader_base : public reader
 {
+private:
+    /// Copy of the stream's packet tap (see @ref stream_config::set_packet_tap)
+    const std::shared_ptr<pcap_writer> packet_tap;
+    /// This reader's handle to @ref packet_tap (null if there is no tap)
+    const std::unique_ptr<pcap_writer::source> packet_tap_source;
+
+    /// Packets passed to @ref add_to_batch that are yet to be processed
+    std::vector<const std::uint8_t *> batch_data;
+    std::vector<std::size_t> batch_lengths;
+    /// Scratch space for decoding the batch
+    std::vector<packet_header> batch_headers;
+
+    /**
+     * Pass a packet to the packet tap (if any), and check whether the
+     * length is acceptable.
+     */
+    bool check_packet(const std::uint8_t *data, std::size_t length, std::size_t max_size);
+
 protected:
     /**
      * Handle a single received packet.
@@ -49,11 +72,69 @@ protected:
         stream_base::add_packet_state &state,
         const std::uint8_t *data, std::size_t length, std::size_t max_size);
 
+    /**
+     * Queue a single received packet for @ref process_batch. This is more
+     * efficient than @ref process_one_packet when many packets are received
+     * at once, because the packets are all decoded first and then passed to
+     * @ref stream_base::add_packet_state::add_packets.
+     *
+     * The packet data must remain valid until @ref process_batch is called.
+     *
+     * @param data      Pointer to the start of the UDP payload
+     * @param length    Length of the UDP payload
+     * @param max_size  Maximum expected length of the UDP payload
+     */
+    void add_to_batch(const std::uint8_t *data, std::size_t length, std::size_t max_size);
+
+    /**
+     * Handle the packets queued by @ref add_to_batch, and clear the queue.
+     *
+     * @param state     Batch state
+     *
+     * @return whether the packets caused the stream to stop
+     */
+    bool process_batch(stream_base::add_packet_state &state);
+
+    /**
+     * Create a socket for receiving from @a endpoint, subscribing to the
+     * multicast group if it is a multicast address. The socket is not bound.
+     */
+    static boost::asio::ip::udp::socket make_socket(
+        boost::asio::io_service &io_service,
+        const boost::asio::ip::udp::endpoint &endpoint,
+        std::size_t buffer_size);
+
+    /**
+     * Create an IPv4 socket for receiving from @a endpoint, using @a
+     * interface_address for multicast subscriptions. The socket is not bound.
+     *
+     * @throws std::invalid_argument If @a endpoint is not an IPv4 multicast address and
+     *                               does not match @a interface_address.
+     * @throws std::invalid_argument If @a interface_address is not an IPv4 address
+     */
+    static boost::asio::ip::udp::socket make_v4_socket(
+        boost::asio::io_service &io_service,
+        const boost::asio::ip::udp::endpoint &endpoint,
+        std::size_t buffer_size,
+        const boost::asio::ip::address &interface_address);
+
+    /**
+     * Create an IPv6 socket for receiving from multicast group @a endpoint,
+     * subscribed on interface @a interface_index. The socket is not bound.
+     *
+     * @throws std::invalid_argument If @a endpoint is not an IPv6 multicast address.
+     */
+    static boost::asio::ip::udp::socket make_multicast_v6_socket(
+        boost::asio::io_service &io_service,
+        const boost::asio::ip::udp::endpoint &endpoint,
+        std::size_t buffer_size,
+        unsigned int interface_index);
+
 public:
     /// Maximum packet size, if none is explicitly passed to the constructor
     static constexpr std::size_t default_max_size = 9200;
 
-    using reader::reader;
+    explicit udp_reader_base(stream &owner);
 };
 
 } // namespace spead2::recv
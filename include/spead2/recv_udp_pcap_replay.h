@@ -0,0 +1,140 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_RECV_UDP_PCAP_REPLAY_H
+#define SPEAD2_RECV_UDP_PCAP_REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <boost/asio.hpp>
+#include <spead2/common_raw_packet.h>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/recv_udp_base.h>
+#include <spead2/recv_stream.h>
+
+namespace spead2::recv
+{
+
+/**
+ * Reader class that replays UDP packets from a pcap file into a stream.
+ *
+ * Unlike @ref udp_pcap_file_reader, this does not use libpcap. The file is
+ * memory-mapped, and a background thread walks the file to find the
+ * frames (which also has the effect of paging in the file ahead of the
+ * stream). Packets can either be fed to the stream as fast as possible, or
+ * at the times given by the timestamps in the file, scaled by a speed
+ * factor.
+ *
+ * Only the classic pcap format (with microsecond or nanosecond timestamps,
+ * in either byte order) is supported, not pcapng. Frames that are not
+ * unfragmented IPv4 UDP packets are skipped.
+ */
+class udp_pcap_replay_reader : public udp_reader_base
+{
+private:
+    using udp_unpacker = packet_buffer (*)(void *, size_t);
+
+    /// Location of a single frame in the mapping
+    struct frame
+    {
+        const std::uint8_t *data;
+        std::uint32_t caplen;          ///< Number of bytes captured
+        std::uint32_t len;             ///< Number of bytes on the wire
+        std::int64_t timestamp_ns;     ///< Capture time, in nanoseconds
+    };
+    typedef std::vector<frame> frame_batch;
+
+    /// Maximum number of frames in a @ref frame_batch
+    static constexpr std::size_t index_batch_size = 256;
+    /// Maximum number of packets to pass to the stream in one go
+    static constexpr std::size_t max_batch = 64;
+
+    /// Playback speed relative to the original capture, or 0 to ignore timestamps
+    const double speed;
+    /// Start and size of the memory-mapped file
+    std::uint8_t *mapping = nullptr;
+    std::size_t mapping_size = 0;
+    /// Whether fields in the file are byte-swapped relative to the host
+    bool swapped = false;
+    /// Whether timestamps are in nanoseconds (rather than microseconds)
+    bool nanosecond = false;
+    udp_unpacker udp_from_frame;
+
+    /// Batches of frames found by @ref index_thread
+    ringbuffer<frame_batch> batches;
+    std::thread index_thread;
+    /// Batch currently being replayed (only accessed by handlers)
+    frame_batch current;
+    /// Position of the next frame to replay in @ref current
+    std::size_t current_pos = 0;
+
+    /// Timer used to wait for the next packet when pacing by timestamps
+    boost::asio::steady_timer timer;
+    /// Wall-clock time at which the first packet was replayed
+    std::chrono::steady_clock::time_point start_time;
+    /// Timestamp of the first packet, or -1 if none has been replayed yet
+    std::int64_t start_timestamp = -1;
+
+    /// Load a 32-bit field from the file, correcting the byte order
+    std::uint32_t load_u32(const std::uint8_t *ptr) const;
+
+    /// Body of @ref index_thread
+    void index();
+
+    /**
+     * Get the next frame to replay. Returns null if @ref index_thread has
+     * not found it yet, or if the end of the file has been reached (in which
+     * case @a end_of_file is set to true).
+     */
+    const frame *next_frame(bool &end_of_file);
+
+    void run(handler_context ctx, stream_base::add_packet_state &state);
+    void timer_handler(handler_context ctx, stream_base::add_packet_state &state,
+                       const boost::system::error_code &error);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param owner    Owning stream
+     * @param filename Filename of the capture file
+     * @param speed    Playback speed relative to the original capture (for
+     *                 example, 2.0 replays twice as fast as the packets were
+     *                 captured). The default of 0 replays as fast as possible.
+     *
+     * @throw std::system_error if @a filename could not be opened or mapped
+     * @throw std::runtime_error if the file is not a supported pcap file
+     * @throw std::invalid_argument if @a speed is negative
+     */
+    udp_pcap_replay_reader(stream &owner, const std::string &filename, double speed = 0.0);
+    virtual ~udp_pcap_replay_reader() override;
+
+    virtual void start() override;
+    virtual void stop() override;
+    virtual bool lossy() const override;
+};
+
+} // namespace spead2::recv
+
+#endif // SPEAD2_RECV_UDP_PCAP_REPLAY_H
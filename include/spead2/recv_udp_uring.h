@@ -0,0 +1,172 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_RECV_UDP_URING_H
+#define SPEAD2_RECV_UDP_URING_H
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_URING
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <liburing.h>
+#include <boost/asio.hpp>
+#include <spead2/common_memory_allocator.h>
+#include <spead2/recv_stream.h>
+#include <spead2/recv_udp_base.h>
+
+namespace spead2::recv
+{
+
+/**
+ * Asynchronous stream reader that receives packets over UDP using io_uring.
+ *
+ * A single multishot receive request is kept outstanding on the socket, and
+ * the kernel places each datagram into a buffer taken from a ring of
+ * provided buffers. Completions are collected from the completion queue
+ * without a system call per batch. When the completion queue is empty, the
+ * reader waits on an eventfd registered with the ring.
+ *
+ * Generic receive offload is not used, since multishot receive does not
+ * provide the segment size.
+ */
+class udp_uring_reader : public udp_reader_base
+{
+private:
+    /// RAII wrapper for the io_uring instance
+    struct ring_t : public io_uring
+    {
+        explicit ring_t(unsigned int entries);
+        ~ring_t();
+    };
+
+    /* Note: declaration order is important for correct destruction
+     * (the ring must be torn down before the buffers are freed).
+     */
+
+    /// Maximum packet size we will accept
+    std::size_t max_size;
+    /// Size of each buffer (@a max_size + 1, so that overflow can be detected)
+    std::size_t buffer_stride;
+    /// Storage for the provided buffers
+    memory_allocator::pointer buffer;
+    /// Ring of provided buffers, shared with the kernel
+    memory_allocator::pointer buf_ring_storage;
+    io_uring_buf_ring *buf_ring;
+    ring_t ring;
+    /// Buffer IDs from the current batch, to be returned to @ref buf_ring
+    std::vector<unsigned short> used_buffers;
+    /// Eventfd registered with the ring, for waking up
+    boost::asio::posix::stream_descriptor event_fd;
+    /// Endpoint to bind during @ref start()
+    std::optional<boost::asio::ip::udp::endpoint> bind_endpoint;
+    /// UDP socket we are listening on
+    boost::asio::ip::udp::socket socket;
+
+    /// Submit a (new) multishot receive request
+    void submit_receive();
+
+    /**
+     * Start an asynchronous wait for completions (or post a callback
+     * immediately if @a need_poll).
+     */
+    void enqueue_receive(handler_context ctx, bool need_poll);
+
+    /// Callback to collect completions
+    void packet_handler(
+        handler_context ctx,
+        stream_base::add_packet_state &state,
+        const boost::system::error_code &error,
+        bool consume_event);
+
+public:
+    /// Socket receive buffer size, if none is explicitly passed to the constructor
+    static constexpr std::size_t default_buffer_size = 8 * 1024 * 1024;
+    /// Number of provided buffers (which bounds the number of packets in flight)
+    static constexpr unsigned int buffer_count = 1024;
+
+    /**
+     * Constructor.
+     *
+     * If @a endpoint is a multicast address, then this constructor will
+     * subscribe to the multicast group, and also set @c SO_REUSEADDR so that
+     * multiple sockets can be subscribed to the multicast group.
+     *
+     * @param owner        Owning stream
+     * @param endpoint     Address on which to listen
+     * @param max_size     Maximum packet size that will be accepted.
+     * @param buffer_size  Requested socket buffer size.
+     *
+     * @throws std::system_error if the io_uring instance could not be created
+     */
+    udp_uring_reader(
+        stream &owner,
+        const boost::asio::ip::udp::endpoint &endpoint,
+        std::size_t max_size = default_max_size,
+        std::size_t buffer_size = default_buffer_size);
+
+    /**
+     * Constructor with explicit interface address (IPv4 only). See the
+     * equivalent constructor of @ref udp_reader for details.
+     *
+     * @param owner        Owning stream
+     * @param endpoint     Address and port
+     * @param max_size     Maximum packet size that will be accepted.
+     * @param buffer_size  Requested socket buffer size.
+     * @param interface_address  Address of the interface which should join the group
+     *
+     * @throws std::invalid_argument If @a endpoint is not an IPv4 multicast address and
+     *                               does not match @a interface_address.
+     * @throws std::invalid_argument If @a interface_address is not an IPv4 address
+     * @throws std::system_error if the io_uring instance could not be created
+     */
+    udp_uring_reader(
+        stream &owner,
+        const boost::asio::ip::udp::endpoint &endpoint,
+        std::size_t max_size,
+        std::size_t buffer_size,
+        const boost::asio::ip::address &interface_address);
+
+    /**
+     * Constructor using an existing socket. The socket must already be bound
+     * to the desired endpoint.
+     *
+     * @param owner        Owning stream
+     * @param socket       Existing socket which will be taken over. It must
+     *                     use the same I/O service as @a owner.
+     * @param max_size     Maximum packet size that will be accepted.
+     *
+     * @throws std::system_error if the io_uring instance could not be created
+     */
+    udp_uring_reader(
+        stream &owner,
+        boost::asio::ip::udp::socket &&socket,
+        std::size_t max_size = default_max_size);
+
+    virtual void start() override;
+    virtual void stop() override;
+};
+
+} // namespace spead2::recv
+
+#endif // SPEAD2_USE_URING
+#endif // SPEAD2_RECV_UDP_URING_H
@@ -0,0 +1,166 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_RECV_UDP_XDP_H
+#define SPEAD2_RECV_UDP_XDP_H
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_XDP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <boost/asio.hpp>
+#include <spead2/common_raw_packet.h>
+#include <spead2/common_xdp.h>
+#include <spead2/recv_stream.h>
+#include <spead2/recv_udp_base.h>
+
+namespace spead2
+{
+
+// Prevent the compiler instantiating the template in all translation units
+// (we'll explicitly instantiate it in recv_udp_xdp.cpp).
+namespace recv { class udp_xdp_config; }
+extern template class detail::udp_xdp_config_base<recv::udp_xdp_config>;
+
+namespace recv
+{
+
+/**
+ * Configuration for @ref udp_xdp_reader.
+ */
+class udp_xdp_config : public spead2::detail::udp_xdp_config_base<udp_xdp_config>
+{
+public:
+    /// UMEM size, if none is explicitly set
+    static constexpr std::size_t default_buffer_size = 16 * 1024 * 1024;
+    /// Maximum packet size to accept, if none is explicitly set (also the largest supported)
+    static constexpr std::size_t default_max_size =
+        spead2::detail::xdp_socket::max_frame_data
+        - ethernet_frame::min_size - ipv4_packet::min_size - udp_packet::min_size;
+    /// Number of times to poll in a row, if none is explicitly set
+    static constexpr int default_max_poll = 10;
+
+private:
+    std::size_t max_size = default_max_size;
+
+    friend class spead2::detail::udp_xdp_config_base<udp_xdp_config>;
+    static void validate_endpoint(const boost::asio::ip::udp::endpoint &endpoint);
+
+public:
+    /// Get maximum packet size to accept
+    std::size_t get_max_size() const { return max_size; }
+
+    /**
+     * Set maximum packet size to accept.
+     *
+     * @throws std::invalid_argument if @a max_size is zero or larger than
+     *         @ref default_max_size.
+     */
+    udp_xdp_config &set_max_size(std::size_t max_size);
+};
+
+/**
+ * Stream reader that receives UDP packets through an AF_XDP socket. An XDP
+ * program attached to the interface redirects IPv4 UDP packets for the
+ * configured endpoints to the socket, which delivers them into frames of a
+ * memory area shared with the kernel (the UMEM). Other traffic continues to
+ * the kernel network stack.
+ *
+ * Only one queue of the interface is used (see
+ * @ref udp_xdp_config::set_queue_id), and an interface can only be used by
+ * one reader at a time. IPv4 packets with IP header options, fragmentation
+ * or VLAN tags are not supported.
+ */
+class udp_xdp_reader : public udp_reader_base
+{
+private:
+    enum class poll_result
+    {
+        stopped,       ///< stream was stopped
+        partial,       ///< processed a full batch, so there may be more
+        drained,       ///< RX ring fully drained
+    };
+
+    /// Maximum number of packets to take from the RX ring at a time
+    static constexpr std::uint32_t max_batch = 64;
+
+    /**
+     * Socket that is used only to join the multicast group. It is not
+     * bound to a port.
+     */
+    boost::asio::ip::udp::socket join_socket;
+    /// Multicast groups to subscribe to
+    std::vector<boost::asio::ip::address> groups;
+    /// Interface address for multicast subscription
+    boost::asio::ip::address interface_address;
+
+    ///< Maximum supported packet size
+    const std::size_t max_size;
+    ///< Number of times to poll before waiting
+    const int max_poll;
+
+    spead2::detail::xdp_socket socket;
+    spead2::detail::xdp_program program;
+    /// Duplicate of the socket file descriptor, for waiting on
+    boost::asio::posix::stream_descriptor socket_wrapper;
+
+    /// Take a batch of packets from the RX ring and process them.
+    poll_result poll_once(stream_base::add_packet_state &state);
+
+    /**
+     * Retrieve packets from the RX ring and process them. This is called
+     * either when the socket is readable or by a post to the io_service.
+     */
+    void packet_handler(
+        handler_context ctx,
+        stream_base::add_packet_state &state,
+        const boost::system::error_code &error);
+
+    /**
+     * Request a callback when there is data (or as soon as possible if
+     * @a need_poll is true).
+     */
+    void enqueue_receive(handler_context ctx, bool need_poll);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param owner        Owning stream
+     * @param config       Configuration
+     *
+     * @throws std::invalid_argument If no endpoints are set.
+     * @throws std::invalid_argument If no interface address is set.
+     * @throws std::system_error If the socket or the XDP program cannot be set up.
+     */
+    udp_xdp_reader(stream &owner, const udp_xdp_config &config);
+
+    virtual void start() override;
+    virtual void stop() override;
+};
+
+} // namespace recv
+} // namespace spead2
+
+#endif // SPEAD2_USE_XDP
+
+#endif // SPEAD2_RECV_UDP_XDP_H
@@ -0,0 +1,122 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_SEND_UDP_URING_H
+#define SPEAD2_SEND_UDP_URING_H
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <boost/asio.hpp>
+#include <spead2/send_stream.h>
+
+namespace spead2::send
+{
+
+/**
+ * Configuration for @ref udp_uring_stream.
+ */
+class udp_uring_config
+{
+public:
+    /// Default send buffer size
+    static constexpr std::size_t default_buffer_size = 512 * 1024;
+
+private:
+    std::vector<boost::asio::ip::udp::endpoint> endpoints;
+    boost::asio::ip::address interface_address;
+    std::size_t buffer_size = default_buffer_size;
+    std::uint8_t ttl = 1;
+    bool zero_copy = false;
+
+public:
+    /// Get the configured endpoints
+    const std::vector<boost::asio::ip::udp::endpoint> &get_endpoints() const { return endpoints; }
+    /// Set the endpoints (replacing any previous), one per substream
+    udp_uring_config &set_endpoints(const std::vector<boost::asio::ip::udp::endpoint> &endpoints);
+    /// Append a single endpoint
+    udp_uring_config &add_endpoint(const boost::asio::ip::udp::endpoint &endpoint);
+
+    /// Get the currently set interface address
+    const boost::asio::ip::address &get_interface_address() const { return interface_address; }
+    /**
+     * Set the interface address. For unicast destinations the socket is
+     * bound to it; for IPv4 multicast it selects the outgoing interface.
+     */
+    udp_uring_config &set_interface_address(const boost::asio::ip::address &interface_address);
+
+    /// Get the socket send buffer size
+    std::size_t get_buffer_size() const { return buffer_size; }
+    /// Set the socket send buffer size (0 for the OS default)
+    udp_uring_config &set_buffer_size(std::size_t buffer_size);
+
+    /// Get the IP TTL for multicast destinations
+    std::uint8_t get_ttl() const { return ttl; }
+    /// Set the IP TTL for multicast destinations
+    udp_uring_config &set_ttl(std::uint8_t ttl);
+
+    /// Get whether zero-copy sends are used
+    bool get_zero_copy() const { return zero_copy; }
+    /**
+     * Use zero-copy sends (@c IORING_OP_SENDMSG_ZC, which requires Linux
+     * 6.1+). The kernel transmits directly from the heap's memory rather
+     * than copying it into socket buffers. This is only beneficial for
+     * large packets and when the network driver supports it; otherwise
+     * the kernel silently falls back to copying.
+     */
+    udp_uring_config &set_zero_copy(bool zero_copy);
+};
+
+/**
+ * Stream that sends packets over UDP using io_uring.
+ *
+ * Packets are batched (with generic segmentation offload where possible)
+ * in the same way as @ref udp_stream, but instead of being sent with
+ * @c sendmmsg, each batch is submitted to an io_uring instance and the
+ * completions are collected asynchronously.
+ */
+class udp_uring_stream : public stream
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param io_service   I/O service for sending data
+     * @param config       Common stream configuration
+     * @param uring_config Class-specific stream configuration
+     *
+     * @throws std::invalid_argument if @a uring_config does not have any endpoints set.
+     * @throws std::invalid_argument if the endpoints do not all have the same protocol.
+     * @throws std::invalid_argument if an interface address is given for IPv6 multicast.
+     * @throws std::system_error if the io_uring instance could not be created
+     */
+    udp_uring_stream(
+        io_service_ref io_service,
+        const stream_config &config,
+        const udp_uring_config &uring_config);
+};
+
+} // namespace spead2::send
+
+#endif // SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+#endif // SPEAD2_SEND_UDP_URING_H
@@ -0,0 +1,100 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#ifndef SPEAD2_SEND_UDP_XDP_H
+#define SPEAD2_SEND_UDP_XDP_H
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_XDP
+
+#include <cstddef>
+#include <cstdint>
+#include <boost/asio.hpp>
+#include <spead2/send_stream.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/common_xdp.h>
+
+namespace spead2
+{
+
+// Prevent the compiler instantiating the template in all translation units
+// (we'll explicitly instantiate it in send_udp_xdp.cpp).
+namespace send { class udp_xdp_config; }
+extern template class detail::udp_xdp_config_base<send::udp_xdp_config>;
+
+namespace send
+{
+
+/**
+ * Configuration for @ref udp_xdp_stream.
+ */
+class udp_xdp_config : public spead2::detail::udp_xdp_config_base<udp_xdp_config>
+{
+public:
+    /// Default UMEM size
+    static constexpr std::size_t default_buffer_size = 1024 * 1024;
+    /// Default number of times to poll in a row
+    static constexpr int default_max_poll = 10;
+
+private:
+    friend class spead2::detail::udp_xdp_config_base<udp_xdp_config>;
+    static void validate_endpoint(const boost::asio::ip::udp::endpoint &endpoint);
+
+    std::uint8_t ttl = 1;
+
+public:
+    /// Get the IP TTL
+    std::uint8_t get_ttl() const { return ttl; }
+    /// Set the IP TTL
+    udp_xdp_config &set_ttl(std::uint8_t ttl);
+};
+
+/**
+ * Stream that sends IPv4 multicast UDP packets through an AF_XDP socket.
+ * Packets are built in frames of a memory area shared with the kernel (the
+ * UMEM), so item data is always copied once. While packets are in flight,
+ * the stream polls for their completion rather than sleeping.
+ */
+class udp_xdp_stream : public stream
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param io_service   I/O service for sending data
+     * @param config       Common stream configuration
+     * @param xdp_config   Class-specific stream configuration
+     *
+     * @throws std::invalid_argument if @a xdp_config does not have an interface address set.
+     * @throws std::invalid_argument if @a xdp_config does not have any endpoints set.
+     * @throws std::invalid_argument if the maximum packet size does not fit in a UMEM frame.
+     * @throws std::system_error if the socket cannot be set up.
+     */
+    udp_xdp_stream(
+        io_service_ref io_service,
+        const stream_config &config,
+        const udp_xdp_config &xdp_config);
+};
+
+} // namespace send
+} // namespace spead2
+
+#endif // SPEAD2_USE_XDP
+#endif // SPEAD2_SEND_UDP_XDP_H
@@ -0,0 +1,183 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <spead2/common_defines.h>
+#include <spead2/common_endian.h>
+#include <spead2/common_features.h>
+#include <spead2/common_convert.h>
+
+namespace spead2::detail
+{
+
+template<typename E>
+static void convert_bswap_scalar(
+    void * __restrict__ dest, const void * __restrict__ src, std::size_t n) noexcept
+{
+    std::uint8_t * __restrict__ dest_c = (std::uint8_t *) dest;
+    const std::uint8_t * __restrict__ src_c = (const std::uint8_t *) src;
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j < sizeof(E); j++)
+            dest_c[i * sizeof(E) + j] = src_c[i * sizeof(E) + sizeof(E) - 1 - j];
+}
+
+static void convert_int8_int16_scalar(
+    void * __restrict__ dest, const void * __restrict__ src, std::size_t n) noexcept
+{
+    std::uint8_t * __restrict__ dest_c = (std::uint8_t *) dest;
+    const std::int8_t * __restrict__ src_c = (const std::int8_t *) src;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        std::int16_t value = src_c[i];
+        std::memcpy(dest_c + i * sizeof(value), &value, sizeof(value));
+    }
+}
+
+template<bool big_endian>
+static void convert_int16_float32_scalar(
+    void * __restrict__ dest, const void * __restrict__ src, std::size_t n) noexcept
+{
+    std::uint8_t * __restrict__ dest_c = (std::uint8_t *) dest;
+    const std::uint8_t * __restrict__ src_c = (const std::uint8_t *) src;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        std::uint16_t raw;
+        if constexpr (big_endian)
+            raw = load_be<std::uint16_t>(src_c + i * sizeof(raw));
+        else
+            std::memcpy(&raw, src_c + i * sizeof(raw), sizeof(raw));
+        float value = std::int16_t(raw);
+        std::memcpy(dest_c + i * sizeof(value), &value, sizeof(value));
+    }
+}
+
+// Kernels indexed by convert_function_id (not static, so that unit tests can find them)
+extern const convert_function convert_functions_scalar[];
+const convert_function convert_functions_scalar[] =
+{
+    convert_bswap_scalar<std::uint16_t>,
+    convert_bswap_scalar<std::uint32_t>,
+    convert_bswap_scalar<std::uint64_t>,
+    convert_int8_int16_scalar,
+    convert_int16_float32_scalar<false>,
+    convert_int16_float32_scalar<true>
+};
+
+} // namespace spead2::detail
+
+#if SPEAD2_USE_SSE41_CONVERT
+# include <smmintrin.h>
+# define SPEAD2_CONVERT_NAME(name) name ## _sse41
+# define SPEAD2_CONVERT_TARGET "sse4.1"
+# define SPEAD2_CONVERT_TYPE __m128i
+# define SPEAD2_CONVERT_LOAD _mm_loadu_si128
+# define SPEAD2_CONVERT_LOAD_HALF _mm_loadl_epi64
+# define SPEAD2_CONVERT_STORE _mm_storeu_si128
+# define SPEAD2_CONVERT_STORE_PS _mm_storeu_ps
+# define SPEAD2_CONVERT_SHUFFLE _mm_shuffle_epi8
+# define SPEAD2_CONVERT_BSWAP16 _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1)
+# define SPEAD2_CONVERT_BSWAP32 _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3)
+# define SPEAD2_CONVERT_BSWAP64 _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7)
+# define SPEAD2_CONVERT_CVTEPI8_EPI16 _mm_cvtepi8_epi16
+# define SPEAD2_CONVERT_CVTEPI16_EPI32 _mm_cvtepi16_epi32
+# define SPEAD2_CONVERT_CVTEPI32_PS _mm_cvtepi32_ps
+# define SPEAD2_CONVERT_VZEROUPPER 0
+# include "common_convert_impl.h"
+#endif
+
+#if SPEAD2_USE_AVX2_CONVERT
+# include <immintrin.h>
+# define SPEAD2_CONVERT_NAME(name) name ## _avx2
+# define SPEAD2_CONVERT_TARGET "avx2"
+# define SPEAD2_CONVERT_TYPE __m256i
+# define SPEAD2_CONVERT_LOAD _mm256_loadu_si256
+# define SPEAD2_CONVERT_LOAD_HALF _mm_loadu_si128
+# define SPEAD2_CONVERT_STORE _mm256_storeu_si256
+# define SPEAD2_CONVERT_STORE_PS _mm256_storeu_ps
+# define SPEAD2_CONVERT_SHUFFLE _mm256_shuffle_epi8
+# define SPEAD2_CONVERT_BSWAP16 _mm256_set_epi8( \
+    14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1, \
+    14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1)
+# define SPEAD2_CONVERT_BSWAP32 _mm256_set_epi8( \
+    12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3, \
+    12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3)
+# define SPEAD2_CONVERT_BSWAP64 _mm256_set_epi8( \
+    8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7, \
+    8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7)
+# define SPEAD2_CONVERT_CVTEPI8_EPI16 _mm256_cvtepi8_epi16
+# define SPEAD2_CONVERT_CVTEPI16_EPI32 _mm256_cvtepi16_epi32
+# define SPEAD2_CONVERT_CVTEPI32_PS _mm256_cvtepi32_ps
+# define SPEAD2_CONVERT_VZEROUPPER 1
+# include "common_convert_impl.h"
+#endif
+
+namespace spead2
+{
+
+// Number of entries in convert_function_id
+static constexpr std::size_t n_convert_functions = 6;
+
+static const convert_function *resolve_convert_functions()
+{
+#if SPEAD2_USE_AVX2_CONVERT || SPEAD2_USE_SSE41_CONVERT
+    __builtin_cpu_init();
+#endif
+#if SPEAD2_USE_AVX2_CONVERT
+    if (__builtin_cpu_supports("avx2"))
+        return detail::convert_functions_avx2;
+#endif
+#if SPEAD2_USE_SSE41_CONVERT
+    if (__builtin_cpu_supports("sse4.1"))
+        return detail::convert_functions_sse41;
+#endif
+    return detail::convert_functions_scalar;
+}
+
+static void check_convert_function_id(convert_function_id id)
+{
+    if (id >= n_convert_functions)
+        throw std::invalid_argument("Unknown conversion function");
+}
+
+convert_function get_convert_function(convert_function_id id)
+{
+    static const convert_function *functions = resolve_convert_functions();
+    check_convert_function_id(id);
+    return functions[id];
+}
+
+std::size_t get_convert_input_size(convert_function_id id)
+{
+    static const std::size_t sizes[n_convert_functions] = {2, 4, 8, 1, 2, 2};
+    check_convert_function_id(id);
+    return sizes[id];
+}
+
+std::size_t get_convert_output_size(convert_function_id id)
+{
+    static const std::size_t sizes[n_convert_functions] = {2, 4, 8, 2, 4, 4};
+    check_convert_function_id(id);
+    return sizes[id];
+}
+
+} // namespace spead2
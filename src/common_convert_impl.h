@@ -0,0 +1,162 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Vectorised conversion kernels. This header file is included multiple
+ * times, with the including code providing different macros each time (see
+ * common_memcpy_impl.h for the rationale). Each kernel processes whole
+ * vectors and hands the remaining elements to the scalar implementation.
+ *
+ * SPEAD2_CONVERT_TYPE is the full vector type, and SPEAD2_CONVERT_LOAD_HALF
+ * loads half a vector (into an __m128i) as the input to the widening
+ * conversions.
+ */
+
+namespace spead2::detail
+{
+
+template<typename E>
+[[gnu::target(SPEAD2_CONVERT_TARGET)]]
+static void SPEAD2_CONVERT_NAME(convert_bswap)(
+    void * __restrict__ dest, const void * __restrict__ src, std::size_t n,
+    SPEAD2_CONVERT_TYPE mask) noexcept
+{
+    using T = SPEAD2_CONVERT_TYPE;
+    constexpr std::size_t lanes = sizeof(T) / sizeof(E);
+    std::uint8_t * __restrict__ dest_c = (std::uint8_t *) dest;
+    const std::uint8_t * __restrict__ src_c = (const std::uint8_t *) src;
+    std::size_t i = 0;
+    for (; i + lanes <= n; i += lanes)
+    {
+        T v = SPEAD2_CONVERT_LOAD((const T *) (src_c + i * sizeof(E)));
+        SPEAD2_CONVERT_STORE((T *) (dest_c + i * sizeof(E)), SPEAD2_CONVERT_SHUFFLE(v, mask));
+    }
+#if SPEAD2_CONVERT_VZEROUPPER
+    _mm256_zeroupper();
+#endif
+    convert_bswap_scalar<E>(dest_c + i * sizeof(E), src_c + i * sizeof(E), n - i);
+}
+
+[[gnu::target(SPEAD2_CONVERT_TARGET)]]
+static void SPEAD2_CONVERT_NAME(convert_bswap16)(
+    void * __restrict__ dest, const void * __restrict__ src, std::size_t n) noexcept
+{
+    SPEAD2_CONVERT_NAME(convert_bswap)<std::uint16_t>(dest, src, n, SPEAD2_CONVERT_BSWAP16);
+}
+
+[[gnu::target(SPEAD2_CONVERT_TARGET)]]
+static void SPEAD2_CONVERT_NAME(convert_bswap32)(
+    void * __restrict__ dest, const void * __restrict__ src, std::size_t n) noexcept
+{
+    SPEAD2_CONVERT_NAME(convert_bswap)<std::uint32_t>(dest, src, n, SPEAD2_CONVERT_BSWAP32);
+}
+
+[[gnu::target(SPEAD2_CONVERT_TARGET)]]
+static void SPEAD2_CONVERT_NAME(convert_bswap64)(
+    void * __restrict__ dest, const void * __restrict__ src, std::size_t n) noexcept
+{
+    SPEAD2_CONVERT_NAME(convert_bswap)<std::uint64_t>(dest, src, n, SPEAD2_CONVERT_BSWAP64);
+}
+
+[[gnu::target(SPEAD2_CONVERT_TARGET)]]
+static void SPEAD2_CONVERT_NAME(convert_int8_int16)(
+    void * __restrict__ dest, const void * __restrict__ src, std::size_t n) noexcept
+{
+    using T = SPEAD2_CONVERT_TYPE;
+    constexpr std::size_t lanes = sizeof(T) / sizeof(std::int16_t);
+    std::int16_t * __restrict__ dest_c = (std::int16_t *) dest;
+    const std::int8_t * __restrict__ src_c = (const std::int8_t *) src;
+    std::size_t i = 0;
+    for (; i + lanes <= n; i += lanes)
+    {
+        __m128i v = SPEAD2_CONVERT_LOAD_HALF((const __m128i *) (src_c + i));
+        SPEAD2_CONVERT_STORE((T *) (dest_c + i), SPEAD2_CONVERT_CVTEPI8_EPI16(v));
+    }
+#if SPEAD2_CONVERT_VZEROUPPER
+    _mm256_zeroupper();
+#endif
+    convert_int8_int16_scalar(dest_c + i, src_c + i, n - i);
+}
+
+template<bool big_endian>
+[[gnu::target(SPEAD2_CONVERT_TARGET)]]
+static void SPEAD2_CONVERT_NAME(convert_int16_float32)(
+    void * __restrict__ dest, const void * __restrict__ src, std::size_t n) noexcept
+{
+    using T = SPEAD2_CONVERT_TYPE;
+    constexpr std::size_t lanes = sizeof(T) / sizeof(float);
+    float * __restrict__ dest_c = (float *) dest;
+    const std::uint8_t * __restrict__ src_c = (const std::uint8_t *) src;
+    const __m128i mask = _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+    std::size_t i = 0;
+    for (; i + lanes <= n; i += lanes)
+    {
+        __m128i v = SPEAD2_CONVERT_LOAD_HALF((const __m128i *) (src_c + i * sizeof(std::int16_t)));
+        if constexpr (big_endian)
+            v = _mm_shuffle_epi8(v, mask);
+        SPEAD2_CONVERT_STORE_PS(dest_c + i, SPEAD2_CONVERT_CVTEPI32_PS(SPEAD2_CONVERT_CVTEPI16_EPI32(v)));
+    }
+#if SPEAD2_CONVERT_VZEROUPPER
+    _mm256_zeroupper();
+#endif
+    convert_int16_float32_scalar<big_endian>(dest_c + i, src_c + i * sizeof(std::int16_t), n - i);
+}
+
+[[gnu::target(SPEAD2_CONVERT_TARGET)]]
+static void SPEAD2_CONVERT_NAME(convert_int16_float32)(
+    void * __restrict__ dest, const void * __restrict__ src, std::size_t n) noexcept
+{
+    SPEAD2_CONVERT_NAME(convert_int16_float32)<false>(dest, src, n);
+}
+
+[[gnu::target(SPEAD2_CONVERT_TARGET)]]
+static void SPEAD2_CONVERT_NAME(convert_int16be_float32)(
+    void * __restrict__ dest, const void * __restrict__ src, std::size_t n) noexcept
+{
+    SPEAD2_CONVERT_NAME(convert_int16_float32)<true>(dest, src, n);
+}
+
+// Kernels indexed by convert_function_id (not static, so that unit tests can find them)
+extern const convert_function SPEAD2_CONVERT_NAME(convert_functions)[];
+const convert_function SPEAD2_CONVERT_NAME(convert_functions)[] =
+{
+    SPEAD2_CONVERT_NAME(convert_bswap16),
+    SPEAD2_CONVERT_NAME(convert_bswap32),
+    SPEAD2_CONVERT_NAME(convert_bswap64),
+    SPEAD2_CONVERT_NAME(convert_int8_int16),
+    SPEAD2_CONVERT_NAME(convert_int16_float32),
+    SPEAD2_CONVERT_NAME(convert_int16be_float32)
+};
+
+} // namespace spead2::detail
+
+#undef SPEAD2_CONVERT_NAME
+#undef SPEAD2_CONVERT_TARGET
+#undef SPEAD2_CONVERT_TYPE
+#undef SPEAD2_CONVERT_LOAD
+#undef SPEAD2_CONVERT_LOAD_HALF
+#undef SPEAD2_CONVERT_STORE
+#undef SPEAD2_CONVERT_STORE_PS
+#undef SPEAD2_CONVERT_SHUFFLE
+#undef SPEAD2_CONVERT_BSWAP16
+#undef SPEAD2_CONVERT_BSWAP32
+#undef SPEAD2_CONVERT_BSWAP64
+#undef SPEAD2_CONVERT_CVTEPI8_EPI16
+#undef SPEAD2_CONVERT_CVTEPI16_EPI32
+#undef SPEAD2_CONVERT_CVTEPI32_PS
+#undef SPEAD2_CONVERT_VZEROUPPER
@@ -18,8 +18,19 @@
  * @file
  */
 
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <vector>
 #include <spead2/common_memory_pool.h>
+#include <spead2/common_features.h>
+#include <spead2/common_logging.h>
 #include "common_unique.h"
+#if SPEAD2_USE_MBIND
+# include <unistd.h>
+# include <sys/syscall.h>
+# include <linux/mempolicy.h>
+#endif
 
 // Some operating systems only provide MAP_ANON
 #ifndef MAP_ANONYMOUS
@@ -82,18 +93,44 @@ void memory_allocator::free(std::uint8_t *ptr, [[maybe_unused]] void *user)
 
 #include <sys/mman.h>
 
-mmap_allocator::mmap_allocator(int flags, bool prefer_huge)
-    : flags(flags), prefer_huge(prefer_huge)
+mmap_allocator::mmap_allocator(int flags, bool prefer_huge, int numa_node)
+    : flags(flags), prefer_huge(prefer_huge), numa_node(numa_node < 0 ? -1 : numa_node)
 {
+#if !SPEAD2_USE_MBIND
+    if (this->numa_node >= 0)
+        log_warning("Cannot bind memory to NUMA node %1%: mbind not detected", numa_node);
+#endif
 }
 
+#if SPEAD2_USE_MBIND
+// Bind memory to a NUMA node. Returns false on failure.
+static bool bind_numa_node(void *ptr, std::size_t size, int node)
+{
+    constexpr int bits = sizeof(unsigned long) * CHAR_BIT;
+    std::vector<unsigned long> mask(node / bits + 1);
+    mask[node / bits] |= 1UL << (node % bits);
+    // The kernel ignores the last bit of maxnode, hence the +1
+    return syscall(SYS_mbind, ptr, size, MPOL_BIND, mask.data(),
+                   (unsigned long) (mask.size() * bits + 1), 0U) == 0;
+}
+#endif
+
 mmap_allocator::pointer mmap_allocator::allocate(std::size_t size, [[maybe_unused]] void *hint)
 {
-    int use_flags = flags | MAP_ANONYMOUS | MAP_PRIVATE
+    /* With NUMA binding, the memory policy must be set before the pages are
+     * faulted in, so MAP_POPULATE is skipped and the memory is prefaulted
+     * by hand after binding.
+     */
+    [[maybe_unused]] bool populate = true;
+#if SPEAD2_USE_MBIND
+    if (numa_node >= 0)
+        populate = false;
+#endif
+    int use_flags = flags | MAP_ANONYMOUS | MAP_PRIVATE;
 #ifdef MAP_POPULATE
-        | MAP_POPULATE
+    if (populate)
+        use_flags |= MAP_POPULATE;
 #endif
-    ;
 
     std::uint8_t *ptr = (std::uint8_t *) MAP_FAILED;
 #ifdef MAP_HUGETLB
@@ -108,7 +145,14 @@ mmap_allocator::pointer mmap_allocator::allocate(std::size_t size, [[maybe_unuse
 
     if (ptr == MAP_FAILED)
         throw std::bad_alloc();
-#ifndef MAP_POPULATE
+#if SPEAD2_USE_MBIND
+    if (numa_node >= 0 && !bind_numa_node(ptr, size, numa_node))
+        log_warning("Failed to bind memory to NUMA node %1%: %2%", numa_node, std::strerror(errno));
+#endif
+#ifdef MAP_POPULATE
+    if (!populate)
+        prefault(ptr, size);
+#else
     prefault(ptr, size);
 #endif
     return pointer(ptr, [size](std::uint8_t *ptr) { munmap(ptr, size); });
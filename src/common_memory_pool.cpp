@@ -19,11 +19,16 @@
  */
 
 #include <cassert>
+#include <algorithm>
 #include <utility>
 #include <memory>
 #include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
 #include <spead2/common_memory_pool.h>
 #include <spead2/common_logging.h>
+#include <spead2/common_prefault.h>
 
 namespace spead2
 {
@@ -88,6 +93,90 @@ public:
     const memory_allocator::deleter &get_base_deleter() const { return state->base_deleter; }
 };
 
+/**
+ * Per-thread state for thread caches. Each thread that uses a thread cache
+ * is assigned a slot number, which indexes the cache array in every memory
+ * pool. Slot numbers are recycled when threads exit, but the unique ID is
+ * not, so that a pool can tell when a slot has changed hands.
+ */
+class memory_pool_thread_owner
+{
+private:
+    struct registry
+    {
+        std::mutex mutex;
+        std::priority_queue<std::size_t, std::vector<std::size_t>, std::greater<>> free_slots;
+        std::size_t next_slot = 0;
+        std::uint64_t next_id = 1;
+    };
+
+    static registry &get_registry()
+    {
+        static registry r;
+        return r;
+    }
+
+public:
+    std::size_t slot;
+    std::uint64_t id;
+    /// Pools in which this thread has taken ownership of a cache
+    std::vector<std::weak_ptr<memory_pool>> pools;
+
+    memory_pool_thread_owner();
+    ~memory_pool_thread_owner();
+
+    void add_pool(std::weak_ptr<memory_pool> pool);
+};
+
+// Set when the calling thread's owner has been destroyed (or is being destroyed)
+static thread_local bool thread_owner_destroyed = false;
+
+memory_pool_thread_owner::memory_pool_thread_owner()
+{
+    registry &r = get_registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (!r.free_slots.empty())
+    {
+        slot = r.free_slots.top();
+        r.free_slots.pop();
+    }
+    else
+        slot = r.next_slot++;
+    id = r.next_id++;
+}
+
+memory_pool_thread_owner::~memory_pool_thread_owner()
+{
+    // Deleters run while flushing must not try to use this thread's caches
+    thread_owner_destroyed = true;
+    for (const auto &weak : pools)
+    {
+        std::shared_ptr<memory_pool> pool = weak.lock();
+        if (pool)
+            pool->flush_thread_cache(slot);
+    }
+    registry &r = get_registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.free_slots.push(slot);
+}
+
+void memory_pool_thread_owner::add_pool(std::weak_ptr<memory_pool> pool)
+{
+    // Forget pools that no longer exist, so that the list does not grow without bound
+    pools.erase(
+        std::remove_if(pools.begin(), pools.end(), [](const auto &p) { return p.expired(); }),
+        pools.end());
+    pools.push_back(std::move(pool));
+}
+
+static memory_pool_thread_owner *get_thread_owner()
+{
+    if (thread_owner_destroyed)
+        return nullptr;
+    static thread_local memory_pool_thread_owner owner;
+    return &owner;
+}
+
 } // namespace detail
 
 memory_pool::memory_pool(
@@ -98,7 +187,8 @@ memory_pool::memory_pool(
     int)
     : io_service(std::move(io_service)), lower(lower), upper(upper), max_free(max_free),
     initial(initial), low_water(low_water),
-    base_allocator(allocator ? std::move(allocator) : std::make_shared<memory_allocator>())
+    base_allocator(allocator ? std::move(allocator) : std::make_shared<memory_allocator>()),
+    thread_caches(std::make_unique<detail::memory_pool_thread_cache[]>(max_thread_caches))
 {
     assert(lower <= upper);
     assert(initial <= max_free);
@@ -106,6 +196,7 @@ memory_pool::memory_pool(
     assert(low_water == 0 || io_service);
     for (std::size_t i = 0; i < initial; i++)
         pool.emplace(base_allocator->allocate(upper, nullptr));
+    n_free = initial;
 }
 
 std::shared_ptr<memory_pool> memory_pool::shared_this()
@@ -113,20 +204,72 @@ std::shared_ptr<memory_pool> memory_pool::shared_this()
     return std::static_pointer_cast<memory_pool>(shared_from_this());
 }
 
+bool memory_pool::reserve_free()
+{
+    std::size_t cur = n_free.load(std::memory_order_relaxed);
+    while (cur < max_free)
+    {
+        if (n_free.compare_exchange_weak(cur, cur + 1, std::memory_order_relaxed))
+            return true;
+    }
+    return false;
+}
+
+detail::memory_pool_thread_cache *memory_pool::get_thread_cache()
+{
+    detail::memory_pool_thread_owner *owner = detail::get_thread_owner();
+    if (!owner || owner->slot >= max_thread_caches)
+        return nullptr;
+    detail::memory_pool_thread_cache &cache = thread_caches[owner->slot];
+    if (cache.owner != owner->id)
+    {
+        // First use of this slot by the current thread
+        cache.owner = owner->id;
+        owner->add_pool(shared_this());
+    }
+    return &cache;
+}
+
+void memory_pool::flush_thread_cache(std::size_t index)
+{
+    detail::memory_pool_thread_cache &cache = thread_caches[index];
+    std::lock_guard<std::mutex> lock(mutex);
+    for (pointer &item : cache.items)
+        pool.push(std::move(item));
+    cache.items.clear();
+    cache.owner = 0;
+}
+
 void memory_pool::free_impl(std::uint8_t *ptr, memory_allocator::deleter &&base_deleter)
 {
     pointer wrapped(ptr, std::move(base_deleter));
-    std::unique_lock<std::mutex> lock(mutex);
-    if (pool.size() < max_free)
+    if (!reserve_free())
     {
-        log_debug("returning memory to the pool");
-        pool.push(std::move(wrapped));
+        log_debug("dropping memory because the pool is full");
+        return;  // deleter for wrapped will free the memory
+    }
+
+    std::size_t cache_size = thread_cache_size.load(std::memory_order_relaxed);
+    detail::memory_pool_thread_cache *cache = cache_size ? get_thread_cache() : nullptr;
+    if (cache)
+    {
+        if (cache->items.size() >= cache_size)
+        {
+            // Cache is full: move the oldest buffers to the shared pool in a batch
+            std::size_t n = cache->items.size() - cache_size / 2;
+            std::lock_guard<std::mutex> lock(mutex);
+            for (std::size_t i = 0; i < n; i++)
+                pool.push(std::move(cache->items[i]));
+            cache->items.erase(cache->items.begin(), cache->items.begin() + n);
+        }
+        log_debug("returning memory to the thread cache");
+        cache->items.push_back(std::move(wrapped));
     }
     else
     {
-        log_debug("dropping memory because the pool is full");
-        lock.unlock();
-        // deleter for wrapped will free the memory
+        std::lock_guard<std::mutex> lock(mutex);
+        log_debug("returning memory to the pool");
+        pool.push(std::move(wrapped));
     }
 }
 
@@ -156,7 +299,7 @@ void memory_pool::refill(std::size_t upper, std::shared_ptr<memory_allocator> al
             break;  // The memory pool vanished from under us
         }
         std::lock_guard<std::mutex> lock(self->mutex);
-        if (self->pool.size() < self->max_free)
+        if (self->reserve_free())
         {
             log_debug("adding background memory to the pool");
             self->pool.push(std::move(ptr));
@@ -176,6 +319,18 @@ memory_pool::pointer memory_pool::allocate(std::size_t size, void *hint)
     pointer ptr;
     if (size >= lower && size <= upper)
     {
+        std::size_t cache_size = thread_cache_size.load(std::memory_order_relaxed);
+        detail::memory_pool_thread_cache *cache = cache_size ? get_thread_cache() : nullptr;
+        if (cache && !cache->items.empty())
+        {
+            ptr = convert(std::move(cache->items.back()));
+            cache->items.pop_back();
+            n_free.fetch_sub(1, std::memory_order_relaxed);
+            hits.fetch_add(1, std::memory_order_relaxed);
+            log_debug("allocating %d bytes from thread cache", size);
+            return ptr;
+        }
+
         /* Declaration order here is important: if there is an exception,
          * we want to drop the lock before trying to put the pointer back in
          * the pool.
@@ -186,6 +341,18 @@ memory_pool::pointer memory_pool::allocate(std::size_t size, void *hint)
             ptr = std::move(pool.top());
             pool.pop();
             ptr = convert(std::move(ptr));
+            n_free.fetch_sub(1, std::memory_order_relaxed);
+            hits.fetch_add(1, std::memory_order_relaxed);
+            if (cache)
+            {
+                // Move a batch into the thread cache for subsequent allocations
+                std::size_t n = (cache_size + 1) / 2;
+                for (std::size_t i = 0; i < n && !pool.empty(); i++)
+                {
+                    cache->items.push_back(std::move(pool.top()));
+                    pool.pop();
+                }
+            }
             if (pool.size() < low_water && !refilling)
             {
                 refilling = true;
@@ -207,6 +374,7 @@ memory_pool::pointer memory_pool::allocate(std::size_t size, void *hint)
             // warning after it is released.
             bool warn = warn_on_empty;
             lock.unlock();
+            misses.fetch_add(1, std::memory_order_relaxed);
             ptr = convert(base_allocator->allocate(upper, nullptr));
             if (warn)
                 log_warning("memory pool is empty when allocating %d bytes", size);
@@ -233,6 +401,56 @@ bool memory_pool::get_warn_on_empty() const
     return warn_on_empty;
 }
 
+std::future<void> memory_pool::warm_up(io_service_ref io_service, std::size_t n)
+{
+    auto countdown = std::make_shared<detail::completion_countdown>(n);
+    std::future<void> future = countdown->get_future();
+    std::weak_ptr<memory_pool> weak = shared_this();
+    for (std::size_t i = 0; i < n; i++)
+    {
+        io_service->post([countdown, weak, upper = upper, allocator = base_allocator] {
+            try
+            {
+                pointer ptr = allocator->allocate(upper, nullptr);
+                std::shared_ptr<memory_pool> self = weak.lock();
+                if (self)
+                {
+                    // If the pool is full, ptr frees the memory after the lock is released
+                    std::lock_guard<std::mutex> lock(self->mutex);
+                    if (self->reserve_free())
+                        self->pool.push(std::move(ptr));
+                }
+                countdown->complete();
+            }
+            catch (...)
+            {
+                countdown->complete(std::current_exception());
+            }
+        });
+    }
+    return future;
+}
+
+void memory_pool::set_thread_cache_size(std::size_t size)
+{
+    thread_cache_size.store(size, std::memory_order_relaxed);
+}
+
+std::size_t memory_pool::get_thread_cache_size() const
+{
+    return thread_cache_size.load(std::memory_order_relaxed);
+}
+
+std::uint64_t memory_pool::get_hits() const
+{
+    return hits.load(std::memory_order_relaxed);
+}
+
+std::uint64_t memory_pool::get_misses() const
+{
+    return misses.load(std::memory_order_relaxed);
+}
+
 const memory_allocator::deleter &memory_pool::get_base_deleter(const memory_allocator::pointer &ptr)
 {
     const memory_allocator::deleter *out = &ptr.get_deleter();
@@ -0,0 +1,106 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <spead2/common_prefault.h>
+
+namespace spead2
+{
+
+namespace detail
+{
+
+completion_countdown::completion_countdown(std::size_t tasks)
+    : remaining(tasks)
+{
+    if (tasks == 0)
+        promise.set_value();
+}
+
+void completion_countdown::complete(std::exception_ptr e)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (e && !error)
+        error = std::move(e);
+    if (--remaining == 0)
+    {
+        if (error)
+            promise.set_exception(error);
+        else
+            promise.set_value();
+    }
+}
+
+} // namespace detail
+
+// Granularity at which pages are touched (the smallest page size in common use)
+static constexpr std::size_t prefault_stride = 4096;
+
+// Touch one byte per page in [start, end), preserving the contents
+static void prefault_range(std::uint8_t *start, std::uint8_t *end)
+{
+    volatile std::uint8_t *data = start;
+    *data = *data;
+    // Every later page starts at a multiple of the stride
+    std::uintptr_t first = std::uintptr_t(start);
+    std::uintptr_t last = std::uintptr_t(end);
+    for (std::uintptr_t page = (first & ~(prefault_stride - 1)) + prefault_stride;
+         page < last; page += prefault_stride)
+    {
+        data = start + (page - first);
+        *data = *data;
+    }
+}
+
+std::future<void> prefault_async(
+    io_service_ref io_service, void *ptr, std::size_t size, std::size_t parts)
+{
+    if (parts == 0)
+        throw std::invalid_argument("parts must be positive");
+    /* Split at multiples of the stride relative to the page containing ptr,
+     * so that no page is shared between parts even if ptr is not aligned.
+     */
+    std::uint8_t *data = static_cast<std::uint8_t *>(ptr);
+    std::size_t skew = std::uintptr_t(data) & (prefault_stride - 1);
+    std::size_t strides = size ? (skew + size + prefault_stride - 1) / prefault_stride : 0;
+    std::size_t part_strides = (strides + parts - 1) / parts;
+    std::size_t part_size = part_strides * prefault_stride;
+    std::size_t n = part_size ? (strides + part_strides - 1) / part_strides : 0;
+
+    auto countdown = std::make_shared<detail::completion_countdown>(n);
+    std::future<void> future = countdown->get_future();
+    for (std::size_t i = 0; i < n; i++)
+    {
+        std::uint8_t *start = data + (i == 0 ? 0 : i * part_size - skew);
+        std::uint8_t *end = data + std::min(size, (i + 1) * part_size - skew);
+        io_service->post([countdown, start, end] {
+            prefault_range(start, end);
+            countdown->complete();
+        });
+    }
+    return future;
+}
+
+} // namespace spead2
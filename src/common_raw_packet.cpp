@@ -36,6 +36,7 @@
 #include <sys/socket.h>
 #include <net/ethernet.h>
 #include <net/if_arp.h>
+#include <net/if.h>
 #include <ifaddrs.h>
 #include <spead2/common_raw_packet.h>
 #include <spead2/common_endian.h>
@@ -77,15 +78,9 @@ struct freeifaddrs_deleter
 };
 } // anonymous namespace
 
-mac_address interface_mac(const boost::asio::ip::address &address)
+// Find the name of the interface with the given address
+static const char *find_interface_name(ifaddrs *ifap, const boost::asio::ip::address &address)
 {
-    ifaddrs *ifap;
-    if (getifaddrs(&ifap) < 0)
-        throw std::system_error(errno, std::system_category(), "getifaddrs failed");
-    std::unique_ptr<ifaddrs, freeifaddrs_deleter> ifap_owner(ifap);
-
-    // Map address to an interface name
-    char *if_name = nullptr;
     for (ifaddrs *cur = ifap; cur; cur = cur->ifa_next)
     {
         if (cur->ifa_addr && *(sa_family_t *) cur->ifa_addr == AF_INET && address.is_v4())
@@ -93,26 +88,32 @@ mac_address interface_mac(const boost::asio::ip::address &address)
             const sockaddr_in *cur_address = (const sockaddr_in *) cur->ifa_addr;
             const auto expected = address.to_v4().to_bytes();
             if (memcmp(&cur_address->sin_addr, &expected, sizeof(expected)) == 0)
-            {
-                if_name = cur->ifa_name;
-                break;
-            }
+                return cur->ifa_name;
         }
         else if (cur->ifa_addr && *(sa_family_t *) cur->ifa_addr == AF_INET6 && address.is_v6())
         {
             const sockaddr_in6 *cur_address = (const sockaddr_in6 *) cur->ifa_addr;
             const auto expected = address.to_v6().to_bytes();
             if (memcmp(&cur_address->sin6_addr, &expected, sizeof(expected)) == 0)
-            {
-                if_name = cur->ifa_name;
-                break;
-            }
+                return cur->ifa_name;
         }
     }
-    if (!if_name)
-    {
-        throw std::runtime_error("no interface found with the address " + address.to_string());
-    }
+    throw std::runtime_error("no interface found with the address " + address.to_string());
+}
+
+static std::unique_ptr<ifaddrs, freeifaddrs_deleter> get_ifaddrs()
+{
+    ifaddrs *ifap;
+    if (getifaddrs(&ifap) < 0)
+        throw std::system_error(errno, std::system_category(), "getifaddrs failed");
+    return std::unique_ptr<ifaddrs, freeifaddrs_deleter>(ifap);
+}
+
+mac_address interface_mac(const boost::asio::ip::address &address)
+{
+    auto ifap_owner = get_ifaddrs();
+    ifaddrs *ifap = ifap_owner.get();
+    const char *if_name = find_interface_name(ifap, address);
 
     // Now find the MAC address for this interface
     for (ifaddrs *cur = ifap; cur; cur = cur->ifa_next)
@@ -146,6 +147,16 @@ mac_address interface_mac(const boost::asio::ip::address &address)
     throw std::runtime_error("no MAC address found for interface "s + if_name);
 }
 
+unsigned int interface_index(const boost::asio::ip::address &address)
+{
+    auto ifap_owner = get_ifaddrs();
+    const char *if_name = find_interface_name(ifap_owner.get(), address);
+    unsigned int index = if_nametoindex(if_name);
+    if (index == 0)
+        throw std::system_error(errno, std::system_category(), "if_nametoindex failed");
+    return index;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 packet_buffer::packet_buffer() : ptr(nullptr), length(0) {}
@@ -31,6 +31,8 @@
 #include <fcntl.h>
 #include <poll.h>
 #include <atomic>
+#include <algorithm>
+#include <cstddef>
 #include <spead2/common_semaphore.h>
 #include <spead2/common_logging.h>
 #if SPEAD2_USE_EVENTFD
@@ -50,6 +52,11 @@ void semaphore_spin::put()
     value.fetch_add(1, std::memory_order_release);
 }
 
+void semaphore_spin::put(unsigned int n)
+{
+    value.fetch_add(n, std::memory_order_release);
+}
+
 int semaphore_spin::get()
 {
     unsigned int cur = value.load(std::memory_order_acquire);
@@ -75,6 +82,19 @@ int semaphore_spin::try_get()
         return -1;
 }
 
+std::size_t semaphore_spin::try_get_many(std::size_t n)
+{
+    unsigned int cur = value.load(std::memory_order_acquire);
+    while (cur > 0 && n > 0)
+    {
+        unsigned int take = std::min(std::size_t(cur), n);
+        if (value.compare_exchange_weak(
+            cur, cur - take, std::memory_order_acquire))
+            return take;
+    }
+    return 0;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 #if SPEAD2_USE_POSIX_SEMAPHORES
@@ -100,6 +120,13 @@ void semaphore_posix::put()
         throw_errno("sem_post failed");
 }
 
+void semaphore_posix::put(unsigned int n)
+{
+    // POSIX has no way to post more than once per call
+    for (unsigned int i = 0; i < n; i++)
+        put();
+}
+
 int semaphore_posix::try_get()
 {
     int status = sem_trywait(&sem);
@@ -114,6 +141,14 @@ int semaphore_posix::try_get()
         return 0;
 }
 
+std::size_t semaphore_posix::try_get_many(std::size_t n)
+{
+    std::size_t got = 0;
+    while (got < n && try_get() == 0)
+        got++;
+    return got;
+}
+
 int semaphore_posix::get()
 {
     int status = sem_wait(&sem);
@@ -212,6 +247,23 @@ void semaphore_pipe::put()
     } while (status < 0);
 }
 
+void semaphore_pipe::put(unsigned int n)
+{
+    char bytes[256] = {};
+    while (n > 0)
+    {
+        std::size_t len = std::min(std::size_t(n), sizeof(bytes));
+        ssize_t status = write(pipe_fds[1], bytes, len);
+        if (status < 0)
+        {
+            if (errno != EINTR)
+                throw_errno("write failed");
+        }
+        else
+            n -= status;
+    }
+}
+
 int semaphore_pipe::get()
 {
     char byte = 0;
@@ -262,6 +314,29 @@ int semaphore_pipe::try_get()
     }
 }
 
+std::size_t semaphore_pipe::try_get_many(std::size_t n)
+{
+    // Each byte in the pipe is one unit, so a single read can take many
+    char bytes[256];
+    std::size_t got = 0;
+    while (got < n)
+    {
+        std::size_t len = std::min(n - got, sizeof(bytes));
+        ssize_t status = read(pipe_fds[0], bytes, len);
+        if (status < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                break;
+            else
+                throw_errno("read failed");
+        }
+        got += status;
+        if (std::size_t(status) < len)
+            break;   // The pipe is empty
+    }
+    return got;
+}
+
 int semaphore_pipe::get_fd() const
 {
     return pipe_fds[0];
@@ -316,6 +391,22 @@ void semaphore_eventfd::put()
     } while (status == -1);
 }
 
+void semaphore_eventfd::put(unsigned int n)
+{
+    if (n == 0)
+        return;
+    int status;
+    do
+    {
+        status = eventfd_write(fd, n);
+        if (status == -1)
+        {
+            if (errno != EINTR)
+                throw_errno("eventfd_write failed");
+        }
+    } while (status == -1);
+}
+
 int semaphore_eventfd::try_get()
 {
     eventfd_t value;
@@ -331,6 +422,14 @@ int semaphore_eventfd::try_get()
     return 0;
 }
 
+std::size_t semaphore_eventfd::try_get_many(std::size_t n)
+{
+    std::size_t got = 0;
+    while (got < n && try_get() == 0)
+        got++;
+    return got;
+}
+
 int semaphore_eventfd::get()
 {
     while (true)
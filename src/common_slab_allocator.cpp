@@ -0,0 +1,148 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <spead2/common_slab_allocator.h>
+#include <spead2/common_logging.h>
+
+namespace spead2
+{
+
+// Smallest s such that 2^s >= size
+static unsigned int ceil_log2(std::size_t size)
+{
+    unsigned int shift = 0;
+    while ((std::size_t(1) << shift) < size)
+        shift++;
+    return shift;
+}
+
+slab_allocator::slab_allocator(
+    std::size_t min_size, std::size_t max_size,
+    std::size_t max_free, std::size_t initial,
+    std::shared_ptr<memory_allocator> allocator)
+    : slab_allocator(std::nullopt, min_size, max_size, max_free, initial, 0, std::move(allocator), 0)
+{
+}
+
+slab_allocator::slab_allocator(
+    io_service_ref io_service,
+    std::size_t min_size, std::size_t max_size,
+    std::size_t max_free, std::size_t initial, std::size_t low_water,
+    std::shared_ptr<memory_allocator> allocator)
+    : slab_allocator(std::optional<io_service_ref>(std::move(io_service)),
+                     min_size, max_size, max_free, initial, low_water, std::move(allocator), 0)
+{
+}
+
+slab_allocator::slab_allocator(
+    std::optional<io_service_ref> io_service,
+    std::size_t min_size, std::size_t max_size,
+    std::size_t max_free, std::size_t initial, std::size_t low_water,
+    std::shared_ptr<memory_allocator> allocator,
+    int)
+    : base_allocator(allocator ? std::move(allocator) : std::make_shared<memory_allocator>())
+{
+    if (min_size == 0)
+        throw std::invalid_argument("min_size cannot be 0");
+    if (min_size > max_size)
+        throw std::invalid_argument("min_size cannot be greater than max_size");
+    if (max_size > std::size_t(1) << (sizeof(std::size_t) * 8 - 1))
+        throw std::invalid_argument("max_size is too large");
+    if (initial > max_free)
+        throw std::invalid_argument("initial cannot be greater than max_free");
+    if (low_water > initial)
+        throw std::invalid_argument("low_water cannot be greater than initial");
+
+    min_shift = ceil_log2(min_size);
+    unsigned int max_shift = ceil_log2(max_size);
+    std::size_t lower = 0;
+    for (unsigned int shift = min_shift; shift <= max_shift; shift++)
+    {
+        std::size_t upper = std::size_t(1) << shift;
+        if (io_service)
+            pools.push_back(std::make_shared<memory_pool>(
+                *io_service, lower, upper, max_free, initial, low_water, base_allocator));
+        else
+            pools.push_back(std::make_shared<memory_pool>(
+                lower, upper, max_free, initial, base_allocator));
+        lower = upper + 1;
+    }
+}
+
+memory_allocator::pointer slab_allocator::allocate(std::size_t size, void *hint)
+{
+    if (size <= get_max_size())
+    {
+        unsigned int shift = ceil_log2(size);
+        std::size_t index = shift <= min_shift ? 0 : shift - min_shift;
+        return pools[index]->allocate(size, hint);
+    }
+    log_debug("allocating %d bytes without using a size class", size);
+    return base_allocator->allocate(size, hint);
+}
+
+std::size_t slab_allocator::get_num_classes() const
+{
+    return pools.size();
+}
+
+std::size_t slab_allocator::get_max_size() const
+{
+    return std::size_t(1) << (min_shift + pools.size() - 1);
+}
+
+const std::shared_ptr<memory_pool> &slab_allocator::get_pool(std::size_t index) const
+{
+    return pools.at(index);
+}
+
+std::vector<slab_allocator::class_stats> slab_allocator::get_stats() const
+{
+    std::vector<class_stats> out;
+    out.reserve(pools.size());
+    for (std::size_t i = 0; i < pools.size(); i++)
+        out.push_back(class_stats{
+            std::size_t(1) << (min_shift + i),
+            pools[i]->get_hits(),
+            pools[i]->get_misses()
+        });
+    return out;
+}
+
+void slab_allocator::set_warn_on_empty(bool warn)
+{
+    for (const auto &pool : pools)
+        pool->set_warn_on_empty(warn);
+}
+
+void slab_allocator::set_thread_cache_size(std::size_t size)
+{
+    for (const auto &pool : pools)
+        pool->set_thread_cache_size(size);
+}
+
+} // namespace spead2
@@ -22,6 +22,9 @@
 #include <thread>
 #include <stdexcept>
 #include <system_error>
+#include <string>
+#include <cstdlib>
+#include <cstring>
 #include <spead2/common_thread_pool.h>
 #include <spead2/common_logging.h>
 #include <spead2/common_features.h>
@@ -29,6 +32,9 @@
 # include <sched.h>
 # include <pthread.h>
 #endif
+#if defined(__linux__)
+# include <dirent.h>
+#endif
 
 namespace spead2
 {
@@ -71,7 +77,7 @@ thread_pool::thread_pool(int num_threads)
 }
 
 thread_pool::thread_pool(int num_threads, const std::vector<int> &affinity)
-    : work(io_service)
+    : work(io_service), affinity(affinity)
 {
     if (num_threads < 1)
         throw std::invalid_argument("at least one thread is required");
@@ -113,6 +119,51 @@ void thread_pool::set_affinity(int core)
 #endif
 }
 
+int thread_pool::get_core_numa_node(int core)
+{
+#if defined(__linux__)
+    if (core < 0)
+        return -1;
+    // The cpu directory contains a symlink "node<N>" to its NUMA node
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(core);
+    DIR *dir = opendir(path.c_str());
+    if (!dir)
+        return -1;
+    int node = -1;
+    while (struct dirent *entry = readdir(dir))
+    {
+        if (std::strncmp(entry->d_name, "node", 4) == 0)
+        {
+            char *end;
+            long value = std::strtol(entry->d_name + 4, &end, 10);
+            if (end != entry->d_name + 4 && *end == '\0')
+            {
+                node = value;
+                break;
+            }
+        }
+    }
+    closedir(dir);
+    return node;
+#else
+    (void) core;
+    return -1;
+#endif
+}
+
+int thread_pool::get_numa_node() const
+{
+    int node = -1;
+    for (int core : affinity)
+    {
+        int core_node = get_core_numa_node(core);
+        if (core_node < 0 || (node >= 0 && core_node != node))
+            return -1;
+        node = core_node;
+    }
+    return node;
+}
+
 void thread_pool::stop()
 {
     io_service.stop();
@@ -0,0 +1,438 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_XDP
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <boost/asio.hpp>
+#include <spead2/common_endian.h>
+#include <spead2/common_logging.h>
+#include <spead2/common_memory_allocator.h>
+#include <spead2/common_raw_packet.h>
+#include <spead2/common_xdp.h>
+
+namespace spead2::detail
+{
+
+xdp_fd &xdp_fd::operator=(xdp_fd &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (fd != -1)
+            close(fd);
+        fd = std::exchange(other.fd, -1);
+    }
+    return *this;
+}
+
+xdp_fd::~xdp_fd()
+{
+    if (fd != -1)
+        close(fd);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+xdp_ring<T>::xdp_ring(
+    int fd, std::uint64_t pgoff, const xdp_ring_offset &offsets, std::uint32_t size)
+    : size(size)
+{
+    map_size = offsets.desc + size * sizeof(T);
+    map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, pgoff);
+    if (map == MAP_FAILED)
+    {
+        map = nullptr;
+        throw_errno("mmap of AF_XDP ring failed");
+    }
+    std::uint8_t *base = static_cast<std::uint8_t *>(map);
+    producer = reinterpret_cast<std::uint32_t *>(base + offsets.producer);
+    consumer = reinterpret_cast<std::uint32_t *>(base + offsets.consumer);
+    flags = reinterpret_cast<std::uint32_t *>(base + offsets.flags);
+    ring = reinterpret_cast<T *>(base + offsets.desc);
+    local_producer = *producer;
+    local_consumer = *consumer;
+}
+
+template<typename T>
+xdp_ring<T>::xdp_ring(xdp_ring &&other) noexcept
+    : map(std::exchange(other.map, nullptr)),
+    map_size(other.map_size),
+    producer(other.producer),
+    consumer(other.consumer),
+    flags(other.flags),
+    ring(other.ring),
+    size(other.size),
+    local_producer(other.local_producer),
+    local_consumer(other.local_consumer)
+{
+}
+
+template<typename T>
+xdp_ring<T> &xdp_ring<T>::operator=(xdp_ring &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (map)
+            munmap(map, map_size);
+        map = std::exchange(other.map, nullptr);
+        map_size = other.map_size;
+        producer = other.producer;
+        consumer = other.consumer;
+        flags = other.flags;
+        ring = other.ring;
+        size = other.size;
+        local_producer = other.local_producer;
+        local_consumer = other.local_consumer;
+    }
+    return *this;
+}
+
+template<typename T>
+xdp_ring<T>::~xdp_ring()
+{
+    if (map)
+        munmap(map, map_size);
+}
+
+template class xdp_ring<std::uint64_t>;
+template class xdp_ring<xdp_desc>;
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Largest power of 2 that is at most n (which must be positive)
+static std::uint32_t floor_pow2(std::size_t n)
+{
+    std::uint32_t ans = 1;
+    while (ans <= n / 2 && ans < (std::uint32_t(1) << 30))
+        ans *= 2;
+    return ans;
+}
+
+static void set_ring_size(int fd, int option, std::uint32_t size)
+{
+    if (setsockopt(fd, SOL_XDP, option, &size, sizeof(size)) != 0)
+        throw_errno("setsockopt on AF_XDP socket failed");
+}
+
+/* Create and bind the socket. This is a separate function so that it can
+ * be retried in copy mode if zero-copy mode is not supported, starting from
+ * a fresh socket.
+ */
+static xdp_fd open_xdp_socket(
+    const memory_allocator::pointer &umem, std::uint32_t n_frames,
+    unsigned int ifindex, std::uint32_t queue_id, std::uint16_t bind_flags,
+    bool use_rx, bool use_tx,
+    xdp_ring<std::uint64_t> &fill, xdp_ring<std::uint64_t> &completion,
+    xdp_ring<xdp_desc> &rx, xdp_ring<xdp_desc> &tx)
+{
+    xdp_fd fd(socket(AF_XDP, SOCK_RAW, 0));
+    if (fd.get() < 0)
+        throw_errno("socket(AF_XDP) failed");
+
+    xdp_umem_reg reg = {};
+    reg.addr = reinterpret_cast<std::uintptr_t>(umem.get());
+    reg.len = std::uint64_t(n_frames) * xdp_socket::frame_size;
+    reg.chunk_size = xdp_socket::frame_size;
+    reg.headroom = 0;
+    if (setsockopt(fd.get(), SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) != 0)
+        throw_errno("registering AF_XDP UMEM failed");
+    // The kernel requires the fill and completion rings even if unused
+    set_ring_size(fd.get(), XDP_UMEM_FILL_RING, n_frames);
+    set_ring_size(fd.get(), XDP_UMEM_COMPLETION_RING, n_frames);
+    if (use_rx)
+        set_ring_size(fd.get(), XDP_RX_RING, n_frames);
+    if (use_tx)
+        set_ring_size(fd.get(), XDP_TX_RING, n_frames);
+
+    xdp_mmap_offsets offsets;
+    socklen_t offsets_len = sizeof(offsets);
+    if (getsockopt(fd.get(), SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &offsets_len) != 0)
+        throw_errno("getsockopt(XDP_MMAP_OFFSETS) failed");
+    fill = xdp_ring<std::uint64_t>(fd.get(), XDP_UMEM_PGOFF_FILL_RING, offsets.fr, n_frames);
+    completion = xdp_ring<std::uint64_t>(
+        fd.get(), XDP_UMEM_PGOFF_COMPLETION_RING, offsets.cr, n_frames);
+    if (use_rx)
+        rx = xdp_ring<xdp_desc>(fd.get(), XDP_PGOFF_RX_RING, offsets.rx, n_frames);
+    if (use_tx)
+        tx = xdp_ring<xdp_desc>(fd.get(), XDP_PGOFF_TX_RING, offsets.tx, n_frames);
+
+    sockaddr_xdp addr = {};
+    addr.sxdp_family = AF_XDP;
+    addr.sxdp_flags = bind_flags | XDP_USE_NEED_WAKEUP;
+    addr.sxdp_ifindex = ifindex;
+    addr.sxdp_queue_id = queue_id;
+    if (bind(fd.get(), reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0)
+        throw_errno("binding AF_XDP socket failed");
+    return fd;
+}
+
+xdp_socket::xdp_socket(
+    unsigned int ifindex, std::uint32_t queue_id, std::size_t buffer_size,
+    xdp_mode mode, bool use_rx, bool use_tx)
+    : n_frames(floor_pow2(std::max(buffer_size / frame_size, std::size_t(1))))
+{
+    auto allocator = std::make_shared<mmap_allocator>(0, true);
+    umem = allocator->allocate(std::size_t(n_frames) * frame_size, nullptr);
+    switch (mode)
+    {
+    case xdp_mode::COPY:
+        fd = open_xdp_socket(umem, n_frames, ifindex, queue_id, XDP_COPY,
+                             use_rx, use_tx, fill, completion, rx, tx);
+        break;
+    case xdp_mode::ZERO_COPY:
+        fd = open_xdp_socket(umem, n_frames, ifindex, queue_id, XDP_ZEROCOPY,
+                             use_rx, use_tx, fill, completion, rx, tx);
+        break;
+    case xdp_mode::AUTO:
+        try
+        {
+            fd = open_xdp_socket(umem, n_frames, ifindex, queue_id, XDP_ZEROCOPY,
+                                 use_rx, use_tx, fill, completion, rx, tx);
+        }
+        catch (std::system_error &e)
+        {
+            log_debug("AF_XDP zero-copy mode not available (%1%), falling back to copy mode",
+                      e.what());
+            fd = open_xdp_socket(umem, n_frames, ifindex, queue_id, XDP_COPY,
+                                 use_rx, use_tx, fill, completion, rx, tx);
+        }
+        break;
+    }
+}
+
+void xdp_socket::wakeup_rx()
+{
+    if (fill.needs_wakeup())
+        recvfrom(fd.get(), nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+}
+
+void xdp_socket::wakeup_tx()
+{
+    if (tx.needs_wakeup())
+    {
+        if (sendto(fd.get(), nullptr, 0, MSG_DONTWAIT, nullptr, 0) < 0
+            && errno != EAGAIN && errno != EBUSY && errno != ENOBUFS && errno != ENETDOWN)
+            log_errno("sendto on AF_XDP socket failed: %1% (%2%)");
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+static int bpf(int cmd, bpf_attr &attr)
+{
+    return syscall(__NR_bpf, cmd, &attr, sizeof(attr));
+}
+
+namespace
+{
+
+/// Minimal assembler for eBPF programs, with forward jumps to labels
+class bpf_assembler
+{
+private:
+    std::vector<bpf_insn> code;
+    std::vector<std::ptrdiff_t> labels;
+    /// Jump instructions with the label they target
+    std::vector<std::pair<std::size_t, int>> fixups;
+
+public:
+    void emit(std::uint8_t opcode, int dst, int src, std::int16_t off, std::int32_t imm)
+    {
+        bpf_insn insn = {};
+        insn.code = opcode;
+        insn.dst_reg = dst;
+        insn.src_reg = src;
+        insn.off = off;
+        insn.imm = imm;
+        code.push_back(insn);
+    }
+
+    int new_label()
+    {
+        labels.push_back(-1);
+        return labels.size() - 1;
+    }
+
+    void bind(int label) { labels[label] = code.size(); }
+
+    void jump(std::uint8_t opcode, int dst, int src, std::int32_t imm, int label)
+    {
+        fixups.emplace_back(code.size(), label);
+        emit(opcode, dst, src, 0, imm);
+    }
+
+    std::vector<bpf_insn> finish()
+    {
+        for (const auto &[pos, label] : fixups)
+            code[pos].off = labels[label] - std::ptrdiff_t(pos + 1);
+        return std::move(code);
+    }
+};
+
+} // anonymous namespace
+
+/* Generate a program that redirects packets for the endpoints to the
+ * sockets in an XSKMAP, indexed by receive queue. Loads from the packet
+ * use the byte order of the packet, so comparisons use the raw (network
+ * order) values.
+ */
+static std::vector<bpf_insn> make_redirect_program(
+    int map_fd, const std::vector<boost::asio::ip::udp::endpoint> &endpoints)
+{
+    constexpr int r0 = 0, r1 = 1, r2 = 2, r3 = 3, r4 = 4, r5 = 5, r6 = 6;
+    constexpr int header_length =
+        ethernet_frame::min_size + ipv4_packet::min_size + udp_packet::min_size;
+    constexpr int ip_offset = ethernet_frame::min_size;
+    constexpr int udp_offset = ip_offset + ipv4_packet::min_size;
+
+    bpf_assembler a;
+    int pass = a.new_label();
+    int redirect = a.new_label();
+    a.emit(BPF_ALU64 | BPF_MOV | BPF_X, r6, r1, 0, 0);
+    a.emit(BPF_LDX | BPF_MEM | BPF_W, r2, r6, offsetof(xdp_md, data), 0);
+    a.emit(BPF_LDX | BPF_MEM | BPF_W, r3, r6, offsetof(xdp_md, data_end), 0);
+    a.emit(BPF_ALU64 | BPF_MOV | BPF_X, r4, r2, 0, 0);
+    a.emit(BPF_ALU64 | BPF_ADD | BPF_K, r4, 0, 0, header_length);
+    a.jump(BPF_JMP | BPF_JGT | BPF_X, r4, r3, 0, pass);
+    // IPv4 without options or fragmentation, carrying UDP
+    a.emit(BPF_LDX | BPF_MEM | BPF_H, r4, r2, 12, 0);
+    a.jump(BPF_JMP | BPF_JNE | BPF_K, r4, 0, htobe<std::uint16_t>(ipv4_packet::ethertype), pass);
+    a.emit(BPF_LDX | BPF_MEM | BPF_B, r4, r2, ip_offset, 0);
+    a.jump(BPF_JMP | BPF_JNE | BPF_K, r4, 0, 0x45, pass);
+    a.emit(BPF_LDX | BPF_MEM | BPF_B, r4, r2, ip_offset + 9, 0);
+    a.jump(BPF_JMP | BPF_JNE | BPF_K, r4, 0, udp_packet::protocol, pass);
+    a.emit(BPF_LDX | BPF_MEM | BPF_H, r4, r2, ip_offset + 6, 0);
+    a.emit(BPF_ALU64 | BPF_AND | BPF_K, r4, 0, 0,
+           htobe<std::uint16_t>(ipv4_packet::flag_more_fragments | 0x1fff));
+    a.jump(BPF_JMP | BPF_JNE | BPF_K, r4, 0, 0, pass);
+    // r4 = destination address, r5 = destination port
+    a.emit(BPF_LDX | BPF_MEM | BPF_W, r4, r2, ip_offset + 16, 0);
+    a.emit(BPF_LDX | BPF_MEM | BPF_H, r5, r2, udp_offset + 2, 0);
+    for (const auto &endpoint : endpoints)
+    {
+        int next = a.new_label();
+        a.jump(BPF_JMP | BPF_JNE | BPF_K, r5, 0, htobe<std::uint16_t>(endpoint.port()), next);
+        if (!endpoint.address().is_unspecified())
+        {
+            auto bytes = endpoint.address().to_v4().to_bytes();
+            std::int32_t raw;
+            std::memcpy(&raw, bytes.data(), sizeof(raw));
+            a.jump(BPF_JMP32 | BPF_JNE | BPF_K, r4, 0, raw, next);
+        }
+        a.jump(BPF_JMP | BPF_JA, 0, 0, 0, redirect);
+        a.bind(next);
+    }
+    a.jump(BPF_JMP | BPF_JA, 0, 0, 0, pass);
+
+    a.bind(redirect);
+    a.emit(BPF_LDX | BPF_MEM | BPF_W, r2, r6, offsetof(xdp_md, rx_queue_index), 0);
+    a.emit(BPF_LD | BPF_DW | BPF_IMM, r1, BPF_PSEUDO_MAP_FD, 0, map_fd);
+    a.emit(0, 0, 0, 0, 0);   // second half of the 64-bit immediate
+    a.emit(BPF_ALU64 | BPF_MOV | BPF_K, r3, 0, 0, XDP_PASS);   // if there is no socket
+    a.emit(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map);
+    a.emit(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+    a.bind(pass);
+    a.emit(BPF_ALU64 | BPF_MOV | BPF_K, r0, 0, 0, XDP_PASS);
+    a.emit(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+    return a.finish();
+}
+
+xdp_program::xdp_program(
+    unsigned int ifindex,
+    const std::vector<boost::asio::ip::udp::endpoint> &endpoints,
+    std::uint32_t max_queues)
+{
+    bpf_attr attr = {};
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(std::uint32_t);
+    attr.value_size = sizeof(std::uint32_t);
+    attr.max_entries = max_queues;
+    map_fd = xdp_fd(bpf(BPF_MAP_CREATE, attr));
+    if (map_fd.get() < 0)
+        throw_errno("creating XSKMAP failed");
+
+    std::vector<bpf_insn> code = make_redirect_program(map_fd.get(), endpoints);
+    static const char license[] = "LGPL";
+    std::vector<char> log(65536);
+    attr = {};
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.expected_attach_type = BPF_XDP;
+    attr.insns = reinterpret_cast<std::uintptr_t>(code.data());
+    attr.insn_cnt = code.size();
+    attr.license = reinterpret_cast<std::uintptr_t>(license);
+    attr.log_buf = reinterpret_cast<std::uintptr_t>(log.data());
+    attr.log_size = log.size();
+    attr.log_level = 1;
+    prog_fd = xdp_fd(bpf(BPF_PROG_LOAD, attr));
+    if (prog_fd.get() < 0)
+    {
+        int err = errno;
+        log.back() = '\0';
+        log_warning("XDP program was rejected: %1%", log.data());
+        throw_errno("loading XDP program failed", err);
+    }
+
+    attr = {};
+    attr.link_create.prog_fd = prog_fd.get();
+    attr.link_create.target_ifindex = ifindex;
+    attr.link_create.attach_type = BPF_XDP;
+    link_fd = xdp_fd(bpf(BPF_LINK_CREATE, attr));
+    if (link_fd.get() < 0)
+    {
+        if (errno == EBUSY)
+            throw_errno("attaching XDP program failed (does the interface already have one?)");
+        throw_errno("attaching XDP program failed");
+    }
+}
+
+void xdp_program::add_socket(std::uint32_t queue_id, const xdp_socket &socket)
+{
+    std::uint32_t value = socket.native_handle();
+    bpf_attr attr = {};
+    attr.map_fd = map_fd.get();
+    attr.key = reinterpret_cast<std::uintptr_t>(&queue_id);
+    attr.value = reinterpret_cast<std::uintptr_t>(&value);
+    attr.flags = BPF_ANY;
+    if (bpf(BPF_MAP_UPDATE_ELEM, attr) != 0)
+        throw_errno("adding socket to XSKMAP failed");
+}
+
+} // namespace spead2::detail
+
+#endif // SPEAD2_USE_XDP
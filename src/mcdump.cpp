@@ -1,4 +1,4 @@
-/* Copyright 2016-2020, 2023 National Research Foundation (SARAO)
+/* Copyright 2016-2020, 2023, 2026 National Research Foundation (SARAO)
  *
  * This program is free software: you can redistribute it and/or modify it under
  * the terms of the GNU Lesser General Public License as published by the Free
@@ -17,13 +17,15 @@
 /**
  * @file
  *
- * Utility program to dump raw packets, using ibverbs. It works with any UDP
- * data, not just SPEAD.
+ * Utility program to dump raw packets, using ibverbs or AF_PACKET sockets
+ * with TPACKET_V3 rings. It works with any UDP data, not just SPEAD.
  *
  * The design is based on three threads:
- * 1. A network thread that handles the ibverbs interface, removing packets
- *    from the completion queue and passing them (in batches) to the collector
- *    thread. It is also responsible for periodically reporting rates.
+ * 1. A network thread that receives packets (from the ibverbs completion
+ *    queue or the AF_PACKET ring) and passes them (in batches) to the
+ *    collector thread. It is also responsible for periodically reporting
+ *    rates. With AF_PACKET there can be more than one of these, each with
+ *    its own socket in a fanout group.
  * 2. A collector thread that receives batches of packets and copies them
  *    into new page-aligned buffers.
  * 3. A disk thread that writes page-aligned buffers to disk (if requested,
@@ -32,11 +34,15 @@
  * If no filename is given, the latter two threads are disabled.
  */
 
-#include <spead2/common_ibv.h>
+#include <spead2/common_features.h>
+#if SPEAD2_USE_IBV
+# include <spead2/common_ibv.h>
+#endif
 #include <spead2/common_raw_packet.h>
 #include <spead2/common_ringbuffer.h>
 #include <spead2/common_logging.h>
 #include <spead2/common_memory_pool.h>
+#include <spead2/common_thread_pool.h>
 #include <boost/program_options.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/format.hpp>
@@ -59,6 +65,20 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <signal.h>
+#if SPEAD2_USE_TPACKET
+# include <poll.h>
+# include <sys/mman.h>
+# include <sys/socket.h>
+# include <arpa/inet.h>
+# include <netinet/in.h>
+# include <linux/filter.h>
+# include <linux/if_ether.h>
+# include <linux/if_packet.h>
+#endif
+
+#if !SPEAD2_USE_IBV && !SPEAD2_USE_TPACKET
+# error "mcdump requires ibverbs or TPACKET_V3 support"
+#endif
 
 namespace po = boost::program_options;
 using namespace std::literals;
@@ -87,7 +107,8 @@ struct options
     int snaplen = 9230;
     std::size_t net_buffer = 128 * 1024 * 1024;
     std::size_t disk_buffer = 64 * 1024 * 1024;
-    int network_affinity = -1;
+    std::vector<int> network_affinity;
+    int network_threads = 1;
     int collect_affinity = -1;
     std::vector<int> disk_affinity;
     bool quiet = false;
@@ -95,8 +116,29 @@ struct options
 #ifdef O_DIRECT
     bool direct = false;
 #endif
+#if SPEAD2_USE_IBV && SPEAD2_USE_TPACKET
+    bool af_packet = false;
+#endif
 };
 
+// Use AF_PACKET rather than ibverbs for capture
+static bool use_af_packet([[maybe_unused]] const options &opts)
+{
+#if SPEAD2_USE_IBV && SPEAD2_USE_TPACKET
+    return opts.af_packet;
+#else
+    return SPEAD2_USE_TPACKET;
+#endif
+}
+
+// CPU core for the network thread with index idx, or -1 if not bound
+static int network_affinity(const options &opts, std::size_t idx)
+{
+    if (opts.network_affinity.empty())
+        return -1;
+    return opts.network_affinity[idx % opts.network_affinity.size()];
+}
+
 static void usage(std::ostream &o, const po::options_description &desc)
 {
     o << "Usage: mcdump [options] -i <iface-addr> <filename> <group>:<port>...\n";
@@ -130,7 +172,13 @@ static options parse_args(int argc, const char **argv)
         ("snaplen,s", make_opt(opts.snaplen), "Maximum frame size to capture")
         ("net-buffer", make_opt(opts.net_buffer), "Maximum memory for buffering packets from the network")
         ("disk-buffer", make_opt(opts.disk_buffer), "Maximum memory for buffering bytes to disk")
-        ("network-cpu,N", make_opt(opts.network_affinity), "CPU core for network receive")
+        ("network-cpu,N", po::value<std::vector<int>>(&opts.network_affinity)->composing(), "CPU core for network receive (can be used multiple times)")
+#if SPEAD2_USE_TPACKET
+        ("network-threads", make_opt(opts.network_threads), "Number of threads for network receive (AF_PACKET only)")
+#endif
+#if SPEAD2_USE_IBV && SPEAD2_USE_TPACKET
+        ("af-packet", make_opt(opts.af_packet), "Capture with AF_PACKET sockets instead of ibverbs")
+#endif
         ("collect-cpu,C", make_opt(opts.collect_affinity), "CPU core for rearranging data")
         ("disk-cpu,D", po::value<std::vector<int>>(&opts.disk_affinity)->composing(), "CPU core for disk writing (can be used multiple times)")
         ("quiet,q", make_opt(opts.quiet), "Do not report counts and rates while running")
@@ -169,6 +217,10 @@ static options parse_args(int argc, const char **argv)
             throw po::error("too few positional options have been specified on the command line");
         if (!vm.count("interface"))
             throw po::error("interface IP address (-i) is required");
+        if (opts.network_threads < 1)
+            throw po::error("--network-threads must be positive");
+        if (opts.network_threads > 1 && !use_af_packet(opts))
+            throw po::error("--network-threads requires AF_PACKET capture");
         return opts;
     }
     catch (po::error &e)
@@ -201,16 +253,21 @@ struct record_header
 };
 
 /* Data associated with a single packet. When using a multi-packet receive
- * queue, wr and sg are not used.
+ * queue or AF_PACKET, wr and sg are not used.
  */
 struct chunk_entry
 {
+#if SPEAD2_USE_IBV
     ibv_recv_wr wr;
     ibv_sge sg;
+#endif
     record_header record;
 };
 
-/* A contiguous chunk of memory holding packets, before collection. */
+/* A contiguous chunk of memory holding packets, before collection. With
+ * AF_PACKET, the packets are instead referenced in place in a ring block
+ * (and there is no storage).
+ */
 struct chunk
 {
     std::uint32_t n_records;
@@ -219,7 +276,13 @@ struct chunk
     std::unique_ptr<chunk_entry[]> entries;
     std::unique_ptr<iovec[]> iov;
     spead2::memory_pool::pointer storage;
+#if SPEAD2_USE_IBV
     spead2::ibv_mr_t storage_mr;
+#endif
+#if SPEAD2_USE_TPACKET
+    /// Ring block to return to the kernel once the chunk is written (AF_PACKET only)
+    tpacket_block_desc *block = nullptr;
+#endif
 };
 
 static std::atomic<bool> stop{false};
@@ -389,9 +452,6 @@ struct chunking_scheme
     std::size_t chunk_size;    ///< Bytes per chunk
 };
 
-typedef std::function<chunking_scheme(const options &,
-                                      const spead2::rdma_cm_id_t &)> chunking_scheme_generator;
-
 /* Joins multicast groups for its lifetime */
 class joiner
 {
@@ -426,13 +486,8 @@ protected:
     const options opts;
 
     boost::asio::ip::address_v4 interface_address;
-    spead2::rdma_event_channel_t event_channel;
-    spead2::rdma_cm_id_t cm_id;
-    spead2::ibv_pd_t pd;
     const chunking_scheme chunking;
 
-    bool timestamp_support = false;
-
     ringbuffer ring;
     ringbuffer free_ring;
     std::uint64_t errors = 0;
@@ -444,7 +499,6 @@ protected:
     std::uint64_t last_packets = 0;
     std::uint64_t last_bytes = 0;
 
-    void init_timestamp_support();
     chunk make_chunk(spead2::memory_allocator &allocator);
 
     void add_to_free(chunk &&c);
@@ -454,12 +508,14 @@ protected:
 
     virtual void network_thread() = 0;
     virtual void post_chunk(chunk &c) = 0;
+    /// Prepare a newly-allocated chunk, before @ref init_record is called on each record
+    virtual void init_chunk([[maybe_unused]] chunk &c) {}
     virtual void init_record(chunk &c, std::size_t idx) = 0;
 
     void chunk_ready(chunk &&c);
     void report_rates(time_point now);
 
-    capture_base(const options &opts, const chunking_scheme_generator &gen_chunking);
+    capture_base(const options &opts, const chunking_scheme &chunking);
 
 public:
     virtual ~capture_base();
@@ -476,23 +532,11 @@ chunk capture_base::make_chunk(spead2::memory_allocator &allocator)
     c.full = false;
     c.entries.reset(new chunk_entry[max_records]);
     c.iov.reset(new iovec[2 * max_records]);
-    c.storage = allocator.allocate(chunk_size, nullptr);
-    c.storage_mr = spead2::ibv_mr_t(pd, c.storage.get(), chunk_size, IBV_ACCESS_LOCAL_WRITE);
-    std::uintptr_t ptr = (std::uintptr_t) c.storage.get();
+    if (chunk_size > 0)
+        c.storage = allocator.allocate(chunk_size, nullptr);
+    init_chunk(c);
     for (std::uint32_t i = 0; i < max_records; i++)
-    {
-        c.entries[i].wr.wr_id = i;
-        c.entries[i].wr.next = (i + 1 < max_records) ? &c.entries[i + 1].wr : nullptr;
-        c.entries[i].wr.num_sge = 1;
-        c.entries[i].wr.sg_list = &c.entries[i].sg;
-        c.entries[i].sg.addr = ptr;
-        c.entries[i].sg.length = opts.snaplen;
-        c.entries[i].sg.lkey = c.storage_mr->lkey;
-        c.iov[2 * i].iov_base = &c.entries[i].record;
-        c.iov[2 * i].iov_len = sizeof(record_header);
-        c.iov[2 * i + 1].iov_base = (void *) ptr;
-        ptr += opts.snaplen;
-    }
+        init_record(c, i);
     return c;
 }
 
@@ -587,24 +631,13 @@ static boost::asio::ip::address_v4 get_interface_address(const options &opts)
     return interface_address;
 }
 
-static spead2::rdma_cm_id_t create_cm_id(const boost::asio::ip::address_v4 &interface_address,
-                                         const spead2::rdma_event_channel_t &event_channel)
-{
-    spead2::rdma_cm_id_t cm_id(event_channel, nullptr, RDMA_PS_UDP);
-    cm_id.bind_addr(interface_address);
-    return cm_id;
-}
-
-capture_base::capture_base(const options &opts, const chunking_scheme_generator &gen_chunking)
+capture_base::capture_base(const options &opts, const chunking_scheme &chunking)
     : opts(opts),
     interface_address(get_interface_address(opts)),
-    cm_id(create_cm_id(interface_address, event_channel)),
-    pd(cm_id),
-    chunking(gen_chunking(opts, cm_id)),
+    chunking(chunking),
     ring(chunking.n_chunks),
     free_ring(chunking.n_chunks)
 {
-    init_timestamp_support();
 }
 
 capture_base::~capture_base()
@@ -615,14 +648,6 @@ capture_base::~capture_base()
         w->close();
 }
 
-void capture_base::init_timestamp_support()
-{
-    ibv_device_attr_ex device_attr;
-    int ret = ibv_query_device_ex(cm_id->verbs, NULL, &device_attr);
-    timestamp_support =
-        ret == 0 && device_attr.completion_timestamp_mask > 0 && device_attr.hca_core_clock > 0;
-}
-
 static boost::asio::ip::udp::endpoint make_endpoint(const std::string &s)
 {
     // Use rfind rather than find because IPv6 addresses contain :'s
@@ -673,8 +698,9 @@ void capture_base::run()
      */
     std::future<void> alloc_future = std::async(
         std::launch::async, [this, allocator = std::move(allocator)] {
-            if (opts.network_affinity >= 0)
-                spead2::thread_pool::set_affinity(opts.network_affinity);
+            int affinity = network_affinity(opts, 0);
+            if (affinity >= 0)
+                spead2::thread_pool::set_affinity(affinity);
             for (std::size_t i = 0; i < chunking.n_chunks; i++)
                 add_to_free(make_chunk(*allocator));
         }
@@ -692,15 +718,16 @@ void capture_base::run()
     if (has_file)
         collect_future = std::async(std::launch::async, [this] { collect_thread(); });
 
-    if (opts.network_affinity >= 0)
-        spead2::thread_pool::set_affinity(opts.network_affinity);
+    int affinity = network_affinity(opts, 0);
+    if (affinity >= 0)
+        spead2::thread_pool::set_affinity(affinity);
     try
     {
         network_thread();
         ring.stop();
 
         /* Briefly sleep so that we can unsubscribe from the switch before we shut
-         * down the QP. This makes it more likely that we can avoid incrementing
+         * down the QP (or socket). This makes it more likely that we can avoid incrementing
          * the dropped packets counter on the NIC.
          */
         std::this_thread::sleep_for(200ms);
@@ -722,7 +749,71 @@ void capture_base::run()
     }
 }
 
-class capture : public capture_base
+#if SPEAD2_USE_IBV
+
+typedef std::function<chunking_scheme(const options &,
+                                      const spead2::rdma_cm_id_t &)> chunking_scheme_generator;
+
+/* ibverbs objects needed by the ibverbs capture classes. This is a separate
+ * base class so that it is constructed before capture_base, because the
+ * chunking scheme depends on the device limits.
+ */
+class ibv_resources
+{
+protected:
+    spead2::rdma_event_channel_t event_channel;
+    spead2::rdma_cm_id_t cm_id;
+    spead2::ibv_pd_t pd;
+
+    explicit ibv_resources(const options &opts);
+};
+
+static spead2::rdma_cm_id_t create_cm_id(const boost::asio::ip::address_v4 &interface_address,
+                                         const spead2::rdma_event_channel_t &event_channel)
+{
+    spead2::rdma_cm_id_t cm_id(event_channel, nullptr, RDMA_PS_UDP);
+    cm_id.bind_addr(interface_address);
+    return cm_id;
+}
+
+ibv_resources::ibv_resources(const options &opts)
+    : cm_id(create_cm_id(get_interface_address(opts), event_channel)),
+    pd(cm_id)
+{
+}
+
+class ibv_capture_base : protected ibv_resources, public capture_base
+{
+protected:
+    bool timestamp_support = false;
+
+    void init_timestamp_support();
+    virtual void init_chunk(chunk &c) override;
+
+    ibv_capture_base(const options &opts, const chunking_scheme_generator &gen_chunking);
+};
+
+ibv_capture_base::ibv_capture_base(const options &opts, const chunking_scheme_generator &gen_chunking)
+    : ibv_resources(opts),
+    capture_base(opts, gen_chunking(opts, cm_id))
+{
+    init_timestamp_support();
+}
+
+void ibv_capture_base::init_timestamp_support()
+{
+    ibv_device_attr_ex device_attr;
+    int ret = ibv_query_device_ex(cm_id->verbs, NULL, &device_attr);
+    timestamp_support =
+        ret == 0 && device_attr.completion_timestamp_mask > 0 && device_attr.hca_core_clock > 0;
+}
+
+void ibv_capture_base::init_chunk(chunk &c)
+{
+    c.storage_mr = spead2::ibv_mr_t(pd, c.storage.get(), chunking.chunk_size, IBV_ACCESS_LOCAL_WRITE);
+}
+
+class capture : public ibv_capture_base
 {
 private:
     spead2::ibv_cq_ex_t cq;
@@ -739,7 +830,7 @@ public:
 };
 
 capture::capture(const options &opts)
-    : capture_base(opts, sizes)
+    : ibv_capture_base(opts, sizes)
 {
     std::uint32_t n_slots = chunking.n_chunks * chunking.max_records;
     ibv_cq_init_attr_ex cq_attr = {};
@@ -905,7 +996,7 @@ void capture::init_record(chunk &c, std::size_t idx)
 
 #if SPEAD2_USE_MLX5DV
 
-class capture_mprq : public capture_base
+class capture_mprq : public ibv_capture_base
 {
 private:
     spead2::ibv_cq_ex_t cq;
@@ -933,7 +1024,7 @@ static int log2i(std::size_t value)
 }
 
 capture_mprq::capture_mprq(const options &opts)
-    : capture_base(opts, sizes)
+    : ibv_capture_base(opts, sizes)
 {
     const std::size_t max_cqe = chunking.max_records * chunking.n_chunks;
 
@@ -1130,6 +1221,411 @@ void capture_mprq::init_record(chunk &c, std::size_t idx)
 
 #endif // SPEAD2_USE_MLX5DV
 
+#endif // SPEAD2_USE_IBV
+
+#if SPEAD2_USE_TPACKET
+
+/* AF_PACKET socket with a memory-mapped TPACKET_V3 receive ring. The kernel
+ * fills whole blocks of packets and hands them over as a unit.
+ */
+class packet_ring
+{
+private:
+    int fd = -1;
+    std::uint8_t *map = nullptr;
+    std::size_t block_size;
+    std::size_t n_blocks;
+    std::size_t next = 0;         ///< Next block to be handed over by the kernel
+
+public:
+    packet_ring(unsigned int ifindex, int fanout, std::size_t block_size, std::size_t n_blocks,
+                const std::vector<sock_filter> &filter);
+    ~packet_ring();
+    packet_ring(const packet_ring &) = delete;
+    packet_ring &operator=(const packet_ring &) = delete;
+
+    /// Wait up to @a timeout_ms for the next block, returning @c nullptr on timeout
+    tpacket_block_desc *next_block(int timeout_ms);
+    /// Return a block to the kernel once its contents are no longer needed
+    static void release_block(tpacket_block_desc *block);
+    /// Number of packets dropped since the last call
+    std::uint64_t get_drops();
+};
+
+packet_ring::packet_ring(
+    unsigned int ifindex, int fanout, std::size_t block_size, std::size_t n_blocks,
+    const std::vector<sock_filter> &filter)
+    : block_size(block_size), n_blocks(n_blocks)
+{
+    // Use protocol 0 so that nothing is received until the socket is bound
+    fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (fd < 0)
+        spead2::throw_errno("socket failed");
+    try
+    {
+        /* The filter also truncates packets to the snaplen, so it needs to be
+         * attached before packets start to arrive.
+         */
+        sock_fprog prog = {};
+        prog.len = filter.size();
+        prog.filter = const_cast<sock_filter *>(filter.data());
+        if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0)
+            spead2::throw_errno("setsockopt(SO_ATTACH_FILTER) failed");
+        int version = TPACKET_V3;
+        if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+            spead2::throw_errno("setsockopt(PACKET_VERSION) failed");
+#ifdef PACKET_IGNORE_OUTGOING
+        int ignore_outgoing = 1;
+        if (setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING,
+                       &ignore_outgoing, sizeof(ignore_outgoing)) < 0)
+            spead2::log_warning("could not ignore outgoing packets: %1%", strerror(errno));
+#endif
+
+        /* With TPACKET_V3 packets are packed into the blocks, so the frame
+         * size is only used for validation.
+         */
+        constexpr unsigned int frame_size = 2048;
+        tpacket_req3 req = {};
+        req.tp_block_size = block_size;
+        req.tp_block_nr = n_blocks;
+        req.tp_frame_size = frame_size;
+        req.tp_frame_nr = block_size / frame_size * n_blocks;
+        req.tp_retire_blk_tov = 10;   // ms
+        if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+            spead2::throw_errno("setsockopt(PACKET_RX_RING) failed");
+        void *ptr = mmap(nullptr, block_size * n_blocks, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, 0);
+        if (ptr == MAP_FAILED)
+            spead2::throw_errno("mmap failed");
+        map = static_cast<std::uint8_t *>(ptr);
+
+        sockaddr_ll addr = {};
+        addr.sll_family = AF_PACKET;
+        addr.sll_protocol = htons(ETH_P_IP);
+        addr.sll_ifindex = ifindex;
+        if (bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0)
+            spead2::throw_errno("bind failed");
+
+        if (fanout >= 0)
+        {
+            /* Spread flows across the sockets, but let a socket whose ring is
+             * full overflow into the others rather than dropping.
+             */
+            int arg = fanout | ((PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_ROLLOVER) << 16);
+            if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &arg, sizeof(arg)) < 0)
+                spead2::throw_errno("setsockopt(PACKET_FANOUT) failed");
+        }
+    }
+    catch (...)
+    {
+        if (map)
+            munmap(map, block_size * n_blocks);
+        close(fd);
+        throw;
+    }
+}
+
+packet_ring::~packet_ring()
+{
+    munmap(map, block_size * n_blocks);
+    close(fd);
+}
+
+tpacket_block_desc *packet_ring::next_block(int timeout_ms)
+{
+    tpacket_block_desc *block = reinterpret_cast<tpacket_block_desc *>(map + next * block_size);
+    if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+    {
+        pollfd pfd = {};
+        pfd.fd = fd;
+        pfd.events = POLLIN | POLLERR;
+        int ret = poll(&pfd, 1, timeout_ms);
+        if (ret < 0 && errno != EINTR)
+            spead2::throw_errno("poll failed");
+        if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+            return nullptr;
+    }
+    next++;
+    if (next == n_blocks)
+        next = 0;
+    return block;
+}
+
+void packet_ring::release_block(tpacket_block_desc *block)
+{
+    __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+}
+
+std::uint64_t packet_ring::get_drops()
+{
+    tpacket_stats_v3 stats = {};
+    socklen_t len = sizeof(stats);
+    if (getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) < 0)
+        spead2::throw_errno("getsockopt(PACKET_STATISTICS) failed");
+    return stats.tp_drops;
+}
+
+/* Build a classic BPF program that accepts IPv4 UDP packets addressed to one
+ * of the endpoints (truncated to the snaplen) and rejects everything else.
+ * An unspecified address in an endpoint matches any destination address.
+ */
+static std::vector<sock_filter> make_filter(
+    const std::vector<boost::asio::ip::udp::endpoint> &endpoints, std::uint32_t snaplen)
+{
+    // Offsets in the frame, which starts with the Ethernet header
+    constexpr std::uint32_t ethertype_offset = 12;
+    constexpr std::uint32_t ip_offset = 14;
+    constexpr std::uint32_t ip_frag_offset = ip_offset + 6;
+    constexpr std::uint32_t ip_protocol_offset = ip_offset + 9;
+    constexpr std::uint32_t ip_dst_offset = ip_offset + 16;
+    constexpr std::uint32_t udp_dst_offset = ip_offset + 2;   // relative to IP payload
+
+    std::vector<sock_filter> prog = {
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, ethertype_offset),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, ip_protocol_offset),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+        // Only the first fragment has the UDP header
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, ip_frag_offset),
+        BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+        // X = IP header length
+        BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, ip_offset)
+    };
+    for (const auto &endpoint : endpoints)
+    {
+        std::uint32_t addr = endpoint.address().to_v4().to_ulong();
+        if (addr != 0)
+        {
+            prog.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, ip_dst_offset));
+            prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, addr, 0, 3));
+        }
+        prog.push_back(BPF_STMT(BPF_LD | BPF_H | BPF_IND, udp_dst_offset));
+        prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, endpoint.port(), 0, 1));
+        prog.push_back(BPF_STMT(BPF_RET | BPF_K, snaplen));
+    }
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+    if (prog.size() > BPF_MAXINSNS)
+        throw std::runtime_error("Too many endpoints for the packet filter");
+    return prog;
+}
+
+/* Capture using AF_PACKET sockets. Each network thread has its own socket
+ * and ring, and the sockets form a fanout group. Chunks refer to packets in
+ * place in the ring blocks rather than copying them; when a block holds more
+ * packets than fit in a chunk it is split over several chunks, and only the
+ * last of them returns the block to the kernel.
+ */
+class capture_packet : public capture_base
+{
+private:
+    static constexpr std::size_t block_size = 1024 * 1024;
+    static constexpr std::size_t max_records = 1024;
+
+    struct alignas(64) thread_counters
+    {
+        std::atomic<std::uint64_t> packets{0};
+        std::atomic<std::uint64_t> bytes{0};
+    };
+
+    std::vector<std::unique_ptr<packet_ring>> rings;
+    std::unique_ptr<thread_counters[]> counters;
+    std::atomic<std::uint64_t> remaining_count;
+
+    static std::size_t blocks_per_ring(const options &opts);
+    static chunking_scheme sizes(const options &opts);
+
+    std::uint32_t claim(std::uint32_t n);
+    void update_counters();
+    void receive(std::size_t idx);
+
+    virtual void network_thread() override;
+    virtual void post_chunk(chunk &c) override;
+    virtual void init_record(chunk &c, std::size_t idx) override;
+
+public:
+    explicit capture_packet(const options &opts);
+};
+
+std::size_t capture_packet::blocks_per_ring(const options &opts)
+{
+    return std::max(opts.net_buffer / (block_size * opts.network_threads), std::size_t(2));
+}
+
+chunking_scheme capture_packet::sizes(const options &opts)
+{
+    if (opts.snaplen + TPACKET3_HDRLEN > block_size)
+        throw std::invalid_argument("snaplen is too large for AF_PACKET capture");
+    /* There must be enough chunks that a block split over several of them
+     * does not leave the network threads waiting for the collector.
+     */
+    std::size_t n_chunks = 2 * blocks_per_ring(opts) * opts.network_threads;
+    return {max_records, n_chunks, 0};
+}
+
+capture_packet::capture_packet(const options &opts)
+    : capture_base(opts, sizes(opts)),
+    counters(new thread_counters[opts.network_threads]),
+    remaining_count(opts.count)
+{
+    std::vector<boost::asio::ip::udp::endpoint> endpoints;
+    for (const std::string &s : opts.endpoints)
+        endpoints.push_back(make_endpoint(s));
+    std::vector<sock_filter> filter = make_filter(endpoints, opts.snaplen);
+    unsigned int ifindex = spead2::interface_index(interface_address);
+    int fanout = opts.network_threads > 1 ? getpid() & 0xffff : -1;
+    std::size_t n_blocks = blocks_per_ring(opts);
+    for (int i = 0; i < opts.network_threads; i++)
+        rings.push_back(std::make_unique<packet_ring>(ifindex, fanout, block_size, n_blocks, filter));
+}
+
+// Take up to n packets from the count limit
+std::uint32_t capture_packet::claim(std::uint32_t n)
+{
+    if (opts.count == std::numeric_limits<std::uint64_t>::max())
+        return n;
+    std::uint64_t cur = remaining_count.load(std::memory_order_relaxed);
+    std::uint64_t take;
+    do
+    {
+        take = std::min<std::uint64_t>(cur, n);
+    } while (take > 0
+             && !remaining_count.compare_exchange_weak(cur, cur - take, std::memory_order_relaxed));
+    return take;
+}
+
+void capture_packet::update_counters()
+{
+    packets = 0;
+    bytes = 0;
+    for (int i = 0; i < opts.network_threads; i++)
+    {
+        packets += counters[i].packets.load(std::memory_order_relaxed);
+        bytes += counters[i].bytes.load(std::memory_order_relaxed);
+    }
+}
+
+void capture_packet::receive(std::size_t idx)
+{
+    try
+    {
+        packet_ring &r = *rings[idx];
+        thread_counters &counter = counters[idx];
+        std::uint64_t thread_packets = 0;
+        std::uint64_t thread_bytes = 0;
+        while (!stop.load() && remaining_count.load(std::memory_order_relaxed) > 0)
+        {
+            tpacket_block_desc *block = r.next_block(100);
+            if (block)
+            {
+                std::uint32_t n = claim(block->hdr.bh1.num_pkts);
+                const std::uint8_t *ptr = reinterpret_cast<const std::uint8_t *>(block)
+                    + block->hdr.bh1.offset_to_first_pkt;
+                chunk c = free_ring.pop();
+                for (std::uint32_t i = 0; i < n; i++)
+                {
+                    if (c.n_records == max_records)
+                    {
+                        c.full = true;
+                        chunk_ready(std::move(c));
+                        c = free_ring.pop();
+                    }
+                    const tpacket3_hdr *hdr = reinterpret_cast<const tpacket3_hdr *>(ptr);
+                    std::size_t rec = c.n_records;
+                    record_header &record = c.entries[rec].record;
+                    record.ts_sec = hdr->tp_sec;
+                    record.ts_nsec = hdr->tp_nsec;
+                    record.incl_len = hdr->tp_snaplen;
+                    record.orig_len = hdr->tp_len;
+                    c.iov[2 * rec + 1].iov_base = const_cast<std::uint8_t *>(ptr + hdr->tp_mac);
+                    c.iov[2 * rec + 1].iov_len = hdr->tp_snaplen;
+                    c.n_records++;
+                    c.n_bytes += hdr->tp_snaplen + sizeof(record_header);
+                    thread_packets++;
+                    thread_bytes += hdr->tp_len;
+                    ptr += hdr->tp_next_offset;
+                }
+                c.full = true;
+                c.block = block;
+                chunk_ready(std::move(c));
+                counter.packets.store(thread_packets, std::memory_order_relaxed);
+                counter.bytes.store(thread_bytes, std::memory_order_relaxed);
+            }
+            if (idx == 0 && !opts.quiet)
+            {
+                time_point now = std::chrono::high_resolution_clock::now();
+                if (now - last_report >= 1s)
+                {
+                    update_counters();
+                    report_rates(now);
+                }
+            }
+        }
+    }
+    catch (std::exception &e)
+    {
+        stop = true;
+        throw;
+    }
+}
+
+void capture_packet::network_thread()
+{
+    std::vector<boost::asio::ip::udp::endpoint> endpoints;
+    for (const std::string &s : opts.endpoints)
+        endpoints.push_back(make_endpoint(s));
+    joiner join(interface_address, endpoints);
+
+    start_time = std::chrono::high_resolution_clock::now();
+    last_report = start_time;
+    std::vector<std::future<void>> futures;
+    for (std::size_t i = 1; i < rings.size(); i++)
+        futures.push_back(std::async(std::launch::async, [this, i] {
+            int affinity = network_affinity(opts, i);
+            if (affinity >= 0)
+                spead2::thread_pool::set_affinity(affinity);
+            receive(i);
+        }));
+    try
+    {
+        receive(0);
+    }
+    catch (...)
+    {
+        for (auto &future : futures)
+            future.wait();
+        throw;
+    }
+    for (auto &future : futures)
+        future.get();
+    update_counters();
+
+    std::uint64_t drops = 0;
+    for (const auto &r : rings)
+        drops += r->get_drops();
+    if (drops > 0)
+        spead2::log_warning("%1% packets dropped by the kernel", drops);
+}
+
+void capture_packet::post_chunk(chunk &c)
+{
+    if (c.block)
+    {
+        packet_ring::release_block(c.block);
+        c.block = nullptr;
+    }
+}
+
+void capture_packet::init_record(chunk &c, std::size_t idx)
+{
+    c.iov[2 * idx].iov_base = &c.entries[idx].record;
+    c.iov[2 * idx].iov_len = sizeof(record_header);
+}
+
+#endif // SPEAD2_USE_TPACKET
+
 int main(int argc, const char **argv)
 {
     try
@@ -1138,19 +1634,28 @@ int main(int argc, const char **argv)
         options opts = parse_args(argc, argv);
         std::unique_ptr<capture_base> cap;
 
+#if SPEAD2_USE_TPACKET
+        if (use_af_packet(opts))
+            cap.reset(new capture_packet(opts));
+#endif
 #if SPEAD2_USE_MLX5DV
-        try
-        {
-            cap.reset(new capture_mprq(opts));
-        }
-        catch (std::system_error &e)
+        if (!cap)
         {
-            if (e.code() != std::errc::not_supported)
-                throw;
+            try
+            {
+                cap.reset(new capture_mprq(opts));
+            }
+            catch (std::system_error &e)
+            {
+                if (e.code() != std::errc::not_supported)
+                    throw;
+            }
         }
 #endif
+#if SPEAD2_USE_IBV
         if (!cap)
             cap.reset(new capture(opts));
+#endif
         cap->run();
     }
     catch (std::runtime_error &e)
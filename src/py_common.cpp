@@ -27,15 +27,21 @@
 #include <functional>
 #include <spead2/py_common.h>
 #include <spead2/common_ringbuffer.h>
+#include <spead2/common_convert.h>
 #include <spead2/common_defines.h>
 #include <spead2/common_flavour.h>
 #include <spead2/common_logging.h>
 #include <spead2/common_memory_pool.h>
+#include <spead2/common_slab_allocator.h>
+#include <spead2/common_prefault.h>
 #include <spead2/common_thread_pool.h>
 #include <spead2/common_inproc.h>
 #if SPEAD2_USE_IBV
 # include <spead2/common_ibv.h>
 #endif
+#if SPEAD2_USE_XDP
+# include <spead2/common_xdp.h>
+#endif
 #include "common_unique.h"
 
 namespace py = pybind11;
@@ -277,10 +283,23 @@ void register_module(py::module m)
 
     EXPORT_ENUM(MEMCPY_STD);
     EXPORT_ENUM(MEMCPY_NONTEMPORAL);
+
+    EXPORT_ENUM(CONVERT_BSWAP16);
+    EXPORT_ENUM(CONVERT_BSWAP32);
+    EXPORT_ENUM(CONVERT_BSWAP64);
+    EXPORT_ENUM(CONVERT_INT8_INT16);
+    EXPORT_ENUM(CONVERT_INT16_FLOAT32);
+    EXPORT_ENUM(CONVERT_INT16BE_FLOAT32);
 #undef EXPORT_ENUM
 
     m.def("log_info", [](const std::string &msg) { log_info("%s", msg); },
           "Log a message at INFO level (for testing only)");
+    m.def("prefault", [](std::shared_ptr<thread_pool> tpool, py::buffer buffer, std::size_t parts)
+    {
+        py::buffer_info info = request_buffer_info(buffer, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE);
+        py::gil_scoped_release gil;
+        prefault_async(std::move(tpool), info.ptr, info.size * info.itemsize, parts).get();
+    }, "thread_pool"_a, "buffer"_a, "parts"_a);
 
     py::class_<flavour>(m, "Flavour")
         .def(py::init<int, int, int, bug_compat_mask>(),
@@ -299,7 +318,8 @@ void register_module(py::module m)
 
     py::class_<mmap_allocator, memory_allocator, std::shared_ptr<mmap_allocator>>(
         m, "MmapAllocator")
-        .def(py::init<int, bool>(), "flags"_a=0, "prefer_huge"_a=false);
+        .def(py::init<int, bool, int>(), "flags"_a=0, "prefer_huge"_a=false, "numa_node"_a=-1)
+        .def_readonly("numa_node", &mmap_allocator::numa_node);
 
     py::class_<memory_pool, memory_allocator, std::shared_ptr<memory_pool>>(
         m, "MemoryPool")
@@ -308,12 +328,40 @@ void register_module(py::module m)
         .def(py::init<std::shared_ptr<thread_pool>, std::size_t, std::size_t, std::size_t, std::size_t, std::size_t, std::shared_ptr<memory_allocator>>(),
              "thread_pool"_a, "lower"_a, "upper"_a, "max_free"_a, "initial"_a, "low_water"_a, py::arg_v("allocator", nullptr, "None"))
         .def_property("warn_on_empty",
-                      &memory_pool::get_warn_on_empty, &memory_pool::set_warn_on_empty);
+                      &memory_pool::get_warn_on_empty, &memory_pool::set_warn_on_empty)
+        .def_property("thread_cache_size",
+                      &memory_pool::get_thread_cache_size, &memory_pool::set_thread_cache_size)
+        .def("warm_up", [](memory_pool &self, std::shared_ptr<thread_pool> tpool, std::size_t n)
+        {
+            py::gil_scoped_release gil;
+            self.warm_up(std::move(tpool), n).get();
+        }, "thread_pool"_a, "n"_a)
+        .def_property_readonly("hits", &memory_pool::get_hits)
+        .def_property_readonly("misses", &memory_pool::get_misses);
+
+    py::class_<slab_allocator, memory_allocator, std::shared_ptr<slab_allocator>> slab_allocator_cls(
+        m, "SlabAllocator");
+    py::class_<slab_allocator::class_stats>(slab_allocator_cls, "ClassStats")
+        .def_readonly("size", &slab_allocator::class_stats::size)
+        .def_readonly("hits", &slab_allocator::class_stats::hits)
+        .def_readonly("misses", &slab_allocator::class_stats::misses);
+    slab_allocator_cls
+        .def(py::init<std::size_t, std::size_t, std::size_t, std::size_t, std::shared_ptr<memory_allocator>>(),
+             "min_size"_a, "max_size"_a, "max_free"_a, "initial"_a, py::arg_v("allocator", nullptr, "None"))
+        .def(py::init<std::shared_ptr<thread_pool>, std::size_t, std::size_t, std::size_t, std::size_t, std::size_t, std::shared_ptr<memory_allocator>>(),
+             "thread_pool"_a, "min_size"_a, "max_size"_a, "max_free"_a, "initial"_a, "low_water"_a, py::arg_v("allocator", nullptr, "None"))
+        .def_property_readonly("num_classes", &slab_allocator::get_num_classes)
+        .def_property_readonly("max_size", &slab_allocator::get_max_size)
+        .def_property_readonly("stats", &slab_allocator::get_stats)
+        .def("set_warn_on_empty", &slab_allocator::set_warn_on_empty, "warn"_a)
+        .def("set_thread_cache_size", &slab_allocator::set_thread_cache_size, "size"_a);
 
     py::class_<thread_pool_wrapper, std::shared_ptr<thread_pool_wrapper>>(m, "ThreadPool")
         .def(py::init<int>(), "threads"_a = 1)
         .def(py::init<int, const std::vector<int> &>(), "threads"_a, "affinity"_a)
         .def_static("set_affinity", &thread_pool_wrapper::set_affinity)
+        .def_static("get_core_numa_node", &thread_pool_wrapper::get_core_numa_node, "core"_a)
+        .def_property_readonly("numa_node", &thread_pool_wrapper::get_numa_node)
         .def("stop", &thread_pool_wrapper::stop);
 
     py::class_<inproc_queue, std::shared_ptr<inproc_queue>>(m, "InprocQueue")
@@ -378,6 +426,12 @@ void register_module(py::module m)
         .def("reset", [](ibv_context_t &self) { self.reset(); })
     ;
 #endif
+#if SPEAD2_USE_XDP
+    py::enum_<xdp_mode>(m, "XdpMode")
+        .value("AUTO", xdp_mode::AUTO)
+        .value("COPY", xdp_mode::COPY)
+        .value("ZERO_COPY", xdp_mode::ZERO_COPY);
+#endif
 }
 
 void register_logging()
@@ -26,11 +26,16 @@
 #include <type_traits>
 #include <cstdint>
 #include <cctype>
+#include <iterator>
+#include <vector>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <spead2/recv_udp.h>
 #include <spead2/recv_udp_ibv.h>
 #include <spead2/recv_udp_pcap.h>
+#include <spead2/recv_udp_pcap_replay.h>
+#include <spead2/recv_udp_uring.h>
+#include <spead2/recv_udp_xdp.h>
 #include <spead2/recv_tcp.h>
 #include <spead2/recv_mem.h>
 #include <spead2/recv_inproc.h>
@@ -40,6 +45,7 @@
 #include <spead2/recv_chunk_stream_group.h>
 #include <spead2/recv_live_heap.h>
 #include <spead2/recv_heap.h>
+#include <spead2/recv_pcap_writer.h>
 #include <spead2/common_ringbuffer.h>
 #include <spead2/py_common.h>
 
@@ -118,6 +124,16 @@ public:
 };
 #endif // SPEAD2_USE_IBV
 
+#if SPEAD2_USE_XDP
+// As for udp_ibv_config_wrapper
+class udp_xdp_config_wrapper : public udp_xdp_config
+{
+public:
+    std::vector<std::pair<std::string, std::uint16_t>> py_endpoints;
+    std::string py_interface_address;
+};
+#endif // SPEAD2_USE_XDP
+
 static boost::asio::ip::address make_address(stream &s, const std::string &hostname)
 {
     return make_address_no_release(s.get_io_service(), hostname,
@@ -143,21 +159,23 @@ static void add_udp_reader(
     std::uint16_t port,
     std::size_t max_size,
     std::size_t buffer_size,
-    const std::string &bind_hostname)
+    const std::string &bind_hostname,
+    const udp_poll_config &poll_config)
 {
     py::gil_scoped_release gil;
     auto endpoint = make_endpoint<boost::asio::ip::udp>(s, bind_hostname, port);
-    s.emplace_reader<udp_reader>(endpoint, max_size, buffer_size);
+    s.emplace_reader<udp_reader>(endpoint, max_size, buffer_size, poll_config);
 }
 
 static void add_udp_reader_socket(
     stream &s,
     const socket_wrapper<boost::asio::ip::udp::socket> &socket,
-    std::size_t max_size = udp_reader::default_max_size)
+    std::size_t max_size,
+    const udp_poll_config &poll_config)
 {
     auto asio_socket = socket.copy(s.get_io_service());
     py::gil_scoped_release gil;
-    s.emplace_reader<udp_reader>(std::move(asio_socket), max_size);
+    s.emplace_reader<udp_reader>(std::move(asio_socket), max_size, poll_config);
 }
 
 static void add_udp_reader_bind_v4(
@@ -166,11 +184,13 @@ static void add_udp_reader_bind_v4(
     std::uint16_t port,
     std::size_t max_size,
     std::size_t buffer_size,
-    const std::string &interface_address)
+    const std::string &interface_address,
+    const udp_poll_config &poll_config)
 {
     py::gil_scoped_release gil;
     auto endpoint = make_endpoint<boost::asio::ip::udp>(s, address, port);
-    s.emplace_reader<udp_reader>(endpoint, max_size, buffer_size, make_address(s, interface_address));
+    s.emplace_reader<udp_reader>(endpoint, max_size, buffer_size, make_address(s, interface_address),
+                                 poll_config);
 }
 
 static void add_udp_reader_bind_v6(
@@ -179,11 +199,12 @@ static void add_udp_reader_bind_v6(
     std::uint16_t port,
     std::size_t max_size,
     std::size_t buffer_size,
-    unsigned int interface_index)
+    unsigned int interface_index,
+    const udp_poll_config &poll_config)
 {
     py::gil_scoped_release gil;
     auto endpoint = make_endpoint<boost::asio::ip::udp>(s, address, port);
-    s.emplace_reader<udp_reader>(endpoint, max_size, buffer_size, interface_index);
+    s.emplace_reader<udp_reader>(endpoint, max_size, buffer_size, interface_index, poll_config);
 }
 
 static void add_tcp_reader(
@@ -208,6 +229,47 @@ static void add_tcp_reader_socket(
     s.emplace_reader<tcp_reader>(std::move(asio_socket), max_size);
 }
 
+static py::list make_udp_reuseport_sockets_py(
+    std::size_t n,
+    std::uint16_t port,
+    const std::string &bind_hostname,
+    std::size_t buffer_size)
+{
+    using namespace pybind11::literals;
+
+    boost::asio::io_service io_service;
+    std::vector<boost::asio::ip::udp::socket> sockets;
+    {
+        py::gil_scoped_release gil;
+        auto address = make_address_no_release(
+            io_service, bind_hostname, boost::asio::ip::udp::resolver::query::passive);
+        sockets = make_udp_reuseport_sockets(
+            io_service, boost::asio::ip::udp::endpoint(address, port), n, buffer_size);
+    }
+    // Hand duplicates of the file descriptors to Python socket objects
+    py::object socket_cls = py::module::import("socket").attr("socket");
+    py::list out;
+    for (auto &socket : sockets)
+    {
+        int fd = ::dup(socket.native_handle());
+        if (fd == -1)
+        {
+            PyErr_SetFromErrno(PyExc_OSError);
+            throw py::error_already_set();
+        }
+        try
+        {
+            out.append(socket_cls("fileno"_a = fd));
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+    }
+    return out;
+}
+
 #if SPEAD2_USE_IBV
 static void add_udp_ibv_reader(stream &s, const udp_ibv_config_wrapper &config_wrapper)
 {
@@ -221,6 +283,46 @@ static void add_udp_ibv_reader(stream &s, const udp_ibv_config_wrapper &config_w
 }
 #endif  // SPEAD2_USE_IBV
 
+#if SPEAD2_USE_XDP
+static void add_udp_xdp_reader(stream &s, const udp_xdp_config_wrapper &config_wrapper)
+{
+    py::gil_scoped_release gil;
+    udp_xdp_config config = config_wrapper;
+    for (const auto &[host, port] : config_wrapper.py_endpoints)
+        config.add_endpoint(make_endpoint<boost::asio::ip::udp>(s, host, port));
+    config.set_interface_address(
+        make_address(s, config_wrapper.py_interface_address));
+    s.emplace_reader<udp_xdp_reader>(config);
+}
+#endif  // SPEAD2_USE_XDP
+
+#if SPEAD2_USE_URING
+static void add_udp_uring_reader(
+    stream &s,
+    std::uint16_t port,
+    std::size_t max_size,
+    std::size_t buffer_size,
+    const std::string &bind_hostname)
+{
+    py::gil_scoped_release gil;
+    auto endpoint = make_endpoint<boost::asio::ip::udp>(s, bind_hostname, port);
+    s.emplace_reader<udp_uring_reader>(endpoint, max_size, buffer_size);
+}
+
+static void add_udp_uring_reader_bind_v4(
+    stream &s,
+    const std::string &address,
+    std::uint16_t port,
+    std::size_t max_size,
+    std::size_t buffer_size,
+    const std::string &interface_address)
+{
+    py::gil_scoped_release gil;
+    auto endpoint = make_endpoint<boost::asio::ip::udp>(s, address, port);
+    s.emplace_reader<udp_uring_reader>(endpoint, max_size, buffer_size, make_address(s, interface_address));
+}
+#endif  // SPEAD2_USE_URING
+
 #if SPEAD2_USE_PCAP
 static void add_udp_pcap_file_reader(stream &s, const std::string &filename, const std::string &filter)
 {
@@ -229,6 +331,12 @@ static void add_udp_pcap_file_reader(stream &s, const std::string &filename, con
 }
 #endif
 
+static void add_udp_pcap_replay_reader(stream &s, const std::string &filename, double speed)
+{
+    py::gil_scoped_release gil;
+    s.emplace_reader<udp_pcap_replay_reader>(filename, speed);
+}
+
 static void add_inproc_reader(stream &s, std::shared_ptr<inproc_queue> queue)
 {
     py::gil_scoped_release gil;
@@ -284,6 +392,14 @@ private:
                             py::return_value_policy::move);
     }
 
+    py::list to_list(std::vector<live_heap> &&heaps)
+    {
+        py::list out(heaps.size());
+        for (std::size_t i = 0; i < heaps.size(); i++)
+            out[i] = to_object(std::move(heaps[i]));
+        return out;
+    }
+
 public:
     ring_stream_wrapper(
         io_service_ref io_service,
@@ -316,6 +432,20 @@ public:
         return to_object(try_pop_live());
     }
 
+    py::list get_many(std::size_t max_heaps)
+    {
+        std::vector<live_heap> heaps;
+        pop_live_many(std::back_inserter(heaps), max_heaps, gil_release_tag());
+        return to_list(std::move(heaps));
+    }
+
+    py::list get_many_nowait(std::size_t max_heaps)
+    {
+        std::vector<live_heap> heaps;
+        try_pop_live_many(std::back_inserter(heaps), max_heaps);
+        return to_list(std::move(heaps));
+    }
+
     int get_fd() const
     {
         return get_ringbuffer().get_data_sem().get_fd();
@@ -591,8 +721,36 @@ py::module register_module(py::module &parent)
     STREAM_STATS_PROPERTY(max_batch);
     STREAM_STATS_PROPERTY(single_packet_heaps);
     STREAM_STATS_PROPERTY(search_dist);
+    STREAM_STATS_PROPERTY(metadata_allocations);
 #undef STREAM_STATS_PROPERTY
 
+    py::class_<pcap_writer, std::shared_ptr<pcap_writer>>(m, "PcapWriter")
+        .def(py::init<const std::string &, std::size_t, std::size_t>(),
+             "filename"_a,
+             "buffer_size"_a = pcap_writer::default_buffer_size,
+             "buffers"_a = pcap_writer::default_buffers)
+        .def("flush", &pcap_writer::flush)
+        .def("close", &pcap_writer::close, py::call_guard<py::gil_scoped_release>())
+        .def_property_readonly("dropped", &pcap_writer::get_dropped)
+        .def_readonly_static("DEFAULT_BUFFER_SIZE", &pcap_writer::default_buffer_size)
+        .def_readonly_static("DEFAULT_BUFFERS", &pcap_writer::default_buffers);
+
+    py::class_<packet_memcpy_scatter>(m, "MemcpyScatter")
+        .def(py::init([](std::size_t row_size, std::size_t row_stride, int id) {
+                 return packet_memcpy_scatter(row_size, row_stride, memcpy_function_id(id));
+             }),
+             "row_size"_a, "row_stride"_a, "memcpy"_a = int(MEMCPY_STD))
+        .def_property_readonly("row_size", &packet_memcpy_scatter::get_row_size)
+        .def_property_readonly("row_stride", &packet_memcpy_scatter::get_row_stride)
+        .def_property_readonly(
+            "memcpy", [](const packet_memcpy_scatter &self) { return int(self.get_memcpy()); });
+
+    py::class_<packet_memcpy_convert>(m, "MemcpyConvert")
+        .def(py::init([](int id) { return packet_memcpy_convert(convert_function_id(id)); }),
+             "convert"_a)
+        .def_property_readonly(
+            "convert", [](const packet_memcpy_convert &self) { return int(self.get_convert()); });
+
     py::class_<stream_config>(m, "StreamConfig")
         .def(py::init(&data_class_constructor<stream_config>))
         .def_property("max_heaps",
@@ -601,22 +759,38 @@ py::module register_module(py::module &parent)
         .def_property("substreams",
                       &stream_config::get_substreams,
                       &stream_config::set_substreams)
+        .def_property("shards",
+                      &stream_config::get_shards,
+                      &stream_config::set_shards)
         .def_property("bug_compat",
                       &stream_config::get_bug_compat,
                       &stream_config::set_bug_compat)
         .def_property("memcpy",
-             [](const stream_config &self) {
+             [](const stream_config &self) -> py::object {
+                 auto scatter = self.get_memcpy().target<packet_memcpy_scatter>();
+                 if (scatter)
+                     return py::cast(*scatter);
+                 auto convert = self.get_memcpy().target<packet_memcpy_convert>();
+                 if (convert)
+                     return py::cast(*convert);
                  stream_config cmp;
                  memcpy_function_id ids[] = {MEMCPY_STD, MEMCPY_NONTEMPORAL};
                  for (memcpy_function_id id : ids)
                  {
                      cmp.set_memcpy(id);
                      if (equal_functions(self.get_memcpy(), cmp.get_memcpy()))
-                         return int(id);
+                         return py::int_(int(id));
                  }
                  throw std::invalid_argument("memcpy function is not one of the standard ones");
              },
-             [](stream_config &self, int id) { self.set_memcpy(memcpy_function_id(id)); })
+             [](stream_config &self, py::object obj) {
+                 if (py::isinstance<packet_memcpy_scatter>(obj))
+                     self.set_memcpy(packet_memcpy_function(obj.cast<packet_memcpy_scatter>()));
+                 else if (py::isinstance<packet_memcpy_convert>(obj))
+                     self.set_memcpy(packet_memcpy_function(obj.cast<packet_memcpy_convert>()));
+                 else
+                     self.set_memcpy(memcpy_function_id(obj.cast<int>()));
+             })
         .def_property("memory_allocator",
                       &stream_config::get_memory_allocator,
                       SPEAD2_PTMF_VOID(stream_config, set_memory_allocator))
@@ -635,6 +809,9 @@ py::module register_module(py::module &parent)
         .def_property("explicit_start",
                       &stream_config::get_explicit_start,
                       &stream_config::set_explicit_start)
+        .def_property("packet_tap",
+                      &stream_config::get_packet_tap,
+                      SPEAD2_PTMF_VOID(stream_config, set_packet_tap))
         .def("add_stat", &stream_config::add_stat,
              "name"_a,
              "mode"_a = stream_stat_config::mode::COUNTER)
@@ -655,6 +832,17 @@ py::module register_module(py::module &parent)
                       &ring_stream_config_wrapper::get_incomplete_keep_payload_ranges,
                       SPEAD2_PTMF_VOID(ring_stream_config_wrapper, set_incomplete_keep_payload_ranges))
         .def_readonly_static("DEFAULT_HEAPS", &ring_stream_config_wrapper::default_heaps);
+    py::class_<udp_poll_config>(m, "UdpPollConfig")
+        .def(py::init(&data_class_constructor<udp_poll_config>))
+        .def_property("max_poll",
+                      &udp_poll_config::get_max_poll,
+                      SPEAD2_PTMF_VOID(udp_poll_config, set_max_poll))
+        .def_property("busy_poll",
+                      &udp_poll_config::get_busy_poll,
+                      SPEAD2_PTMF_VOID(udp_poll_config, set_busy_poll))
+        .def_property("prefer_busy_poll",
+                      &udp_poll_config::get_prefer_busy_poll,
+                      SPEAD2_PTMF_VOID(udp_poll_config, set_prefer_busy_poll));
 #if SPEAD2_USE_IBV
     py::class_<udp_ibv_config_wrapper>(m, "UdpIbvConfig")
         .def(py::init(&data_class_constructor<udp_ibv_config_wrapper>))
@@ -676,6 +864,30 @@ py::module register_module(py::module &parent)
         .def_readonly_static("DEFAULT_MAX_SIZE", &udp_ibv_config_wrapper::default_max_size)
         .def_readonly_static("DEFAULT_MAX_POLL", &udp_ibv_config_wrapper::default_max_poll);
 #endif // SPEAD2_USE_IBV
+#if SPEAD2_USE_XDP
+    py::class_<udp_xdp_config_wrapper>(m, "UdpXdpConfig")
+        .def(py::init(&data_class_constructor<udp_xdp_config_wrapper>))
+        .def_readwrite("endpoints", &udp_xdp_config_wrapper::py_endpoints)
+        .def_readwrite("interface_address", &udp_xdp_config_wrapper::py_interface_address)
+        .def_property("buffer_size",
+                      &udp_xdp_config_wrapper::get_buffer_size,
+                      SPEAD2_PTMF_VOID(udp_xdp_config_wrapper, set_buffer_size))
+        .def_property("max_size",
+                      &udp_xdp_config_wrapper::get_max_size,
+                      SPEAD2_PTMF_VOID(udp_xdp_config_wrapper, set_max_size))
+        .def_property("queue_id",
+                      &udp_xdp_config_wrapper::get_queue_id,
+                      SPEAD2_PTMF_VOID(udp_xdp_config_wrapper, set_queue_id))
+        .def_property("mode",
+                      &udp_xdp_config_wrapper::get_mode,
+                      SPEAD2_PTMF_VOID(udp_xdp_config_wrapper, set_mode))
+        .def_property("max_poll",
+                      &udp_xdp_config_wrapper::get_max_poll,
+                      SPEAD2_PTMF_VOID(udp_xdp_config_wrapper, set_max_poll))
+        .def_readonly_static("DEFAULT_BUFFER_SIZE", &udp_xdp_config_wrapper::default_buffer_size)
+        .def_readonly_static("DEFAULT_MAX_SIZE", &udp_xdp_config_wrapper::default_max_size)
+        .def_readonly_static("DEFAULT_MAX_POLL", &udp_xdp_config_wrapper::default_max_poll);
+#endif // SPEAD2_USE_XDP
     py::class_<stream>(m, "_Stream")
         // SPEAD2_PTMF doesn't work for get_stats because it's defined in stream_base, which is a protected ancestor
         .def_property_readonly("stats", [](const stream &self) { return self.get_stats(); })
@@ -686,22 +898,26 @@ py::module register_module(py::module &parent)
               "port"_a,
               "max_size"_a = udp_reader::default_max_size,
               "buffer_size"_a = udp_reader::default_buffer_size,
-              "bind_hostname"_a = std::string())
+              "bind_hostname"_a = std::string(),
+              "poll_config"_a = udp_poll_config())
         .def("add_udp_reader", add_udp_reader_socket,
               "socket"_a,
-              "max_size"_a = udp_reader::default_max_size)
+              "max_size"_a = udp_reader::default_max_size,
+              "poll_config"_a = udp_poll_config())
         .def("add_udp_reader", add_udp_reader_bind_v4,
               "multicast_group"_a,
               "port"_a,
               "max_size"_a = udp_reader::default_max_size,
               "buffer_size"_a = udp_reader::default_buffer_size,
-              "interface_address"_a = "0.0.0.0")
+              "interface_address"_a = "0.0.0.0",
+              "poll_config"_a = udp_poll_config())
         .def("add_udp_reader", add_udp_reader_bind_v6,
               "multicast_group"_a,
               "port"_a,
               "max_size"_a = udp_reader::default_max_size,
               "buffer_size"_a = udp_reader::default_buffer_size,
-              "interface_index"_a = (unsigned int) 0)
+              "interface_index"_a = (unsigned int) 0,
+              "poll_config"_a = udp_poll_config())
         .def("add_tcp_reader", add_tcp_reader,
              "port"_a,
              "max_size"_a = tcp_reader::default_max_size,
@@ -714,10 +930,29 @@ py::module register_module(py::module &parent)
         .def("add_udp_ibv_reader", add_udp_ibv_reader,
              "config"_a)
 #endif
+#if SPEAD2_USE_XDP
+        .def("add_udp_xdp_reader", add_udp_xdp_reader,
+             "config"_a)
+#endif
+#if SPEAD2_USE_URING
+        .def("add_udp_uring_reader", add_udp_uring_reader,
+             "port"_a,
+             "max_size"_a = udp_uring_reader::default_max_size,
+             "buffer_size"_a = udp_uring_reader::default_buffer_size,
+             "bind_hostname"_a = std::string())
+        .def("add_udp_uring_reader", add_udp_uring_reader_bind_v4,
+             "multicast_group"_a,
+             "port"_a,
+             "max_size"_a = udp_uring_reader::default_max_size,
+             "buffer_size"_a = udp_uring_reader::default_buffer_size,
+             "interface_address"_a = "0.0.0.0")
+#endif
 #if SPEAD2_USE_PCAP
         .def("add_udp_pcap_file_reader", add_udp_pcap_file_reader,
              "filename"_a, "filter"_a = "")
 #endif
+        .def("add_udp_pcap_replay_reader", add_udp_pcap_replay_reader,
+             "filename"_a, "speed"_a = 0.0)
         .def("add_inproc_reader", add_inproc_reader,
              "queue"_a)
         .def("start", &stream::start)
@@ -737,6 +972,8 @@ py::module register_module(py::module &parent)
         .def("__next__", &ring_stream_wrapper::next)
         .def("get", &ring_stream_wrapper::get)
         .def("get_nowait", &ring_stream_wrapper::get_nowait)
+        .def("get_many", &ring_stream_wrapper::get_many, "max_heaps"_a)
+        .def("get_many_nowait", &ring_stream_wrapper::get_many_nowait, "max_heaps"_a)
         .def_property_readonly("fd", &ring_stream_wrapper::get_fd)
         .def_property_readonly("ringbuffer", &ring_stream_wrapper::get_ringbuffer)
         .def_property_readonly("ring_config", &ring_stream_wrapper::get_ring_config);
@@ -744,6 +981,30 @@ py::module register_module(py::module &parent)
     py::class_<Ringbuffer>(stream_class, "Ringbuffer")
         .def("size", &Ringbuffer::size)
         .def("capacity", &Ringbuffer::capacity);
+    py::class_<chunk_place_affine>(m, "ChunkPlaceAffine")
+        .def(py::init(&data_class_constructor<chunk_place_affine>))
+        .def_property("timestamp_item",
+                      &chunk_place_affine::get_timestamp_item,
+                      &chunk_place_affine::set_timestamp_item)
+        .def_property("timestamp_step",
+                      &chunk_place_affine::get_timestamp_step,
+                      &chunk_place_affine::set_timestamp_step)
+        .def_property("timestamps_per_chunk",
+                      &chunk_place_affine::get_timestamps_per_chunk,
+                      &chunk_place_affine::set_timestamps_per_chunk)
+        .def_property("channel_item",
+                      &chunk_place_affine::get_channel_item,
+                      &chunk_place_affine::set_channel_item)
+        .def_property("channel_step",
+                      &chunk_place_affine::get_channel_step,
+                      &chunk_place_affine::set_channel_step)
+        .def_property("channels",
+                      &chunk_place_affine::get_channels,
+                      &chunk_place_affine::set_channels)
+        .def_property("heap_size",
+                      &chunk_place_affine::get_heap_size,
+                      &chunk_place_affine::set_heap_size)
+        .def_property_readonly("heaps_per_chunk", &chunk_place_affine::get_heaps_per_chunk);
     py::class_<chunk_stream_config>(m, "ChunkStreamConfig")
         .def(py::init(&data_class_constructor<chunk_stream_config>))
         .def_property("items",
@@ -764,6 +1025,18 @@ py::module register_module(py::module &parent)
                     "void (void *, size_t, void *)"
                 ));
             })
+        .def_property(
+            "place_batch",
+            [](const chunk_stream_config &config) {
+                return callback_to_python(config.get_place_batch());
+            },
+            [](chunk_stream_config &config, py::object obj) {
+                config.set_place_batch(callback_from_python<chunk_place_batch_function>(
+                    obj,
+                    "void (void *, size_t, size_t)",
+                    "void (void *, size_t, size_t, void *)"
+                ));
+            })
         .def(
             "enable_packet_presence", &chunk_stream_config::enable_packet_presence,
             "payload_size"_a)
@@ -773,6 +1046,12 @@ py::module register_module(py::module &parent)
         .def_property("max_heap_extra",
                       &chunk_stream_config::get_max_heap_extra,
                       &chunk_stream_config::set_max_heap_extra)
+        .def_property("place_affine",
+                      &chunk_stream_config::get_place_affine,
+                      &chunk_stream_config::set_place_affine)
+        .def_property("direct_placement",
+                      &chunk_stream_config::get_direct_placement,
+                      &chunk_stream_config::set_direct_placement)
         .def_readonly_static("DEFAULT_MAX_CHUNKS", &chunk_stream_config::default_max_chunks);
     py::class_<chunk>(m, "Chunk")
         .def(py::init(&data_class_constructor<chunk>))
@@ -967,6 +1246,10 @@ py::module register_module(py::module &parent)
         )
         .def("stop", &chunk_stream_ring_group_wrapper::stop);
 
+    m.def("make_udp_reuseport_sockets", &make_udp_reuseport_sockets_py,
+          "n"_a, "port"_a, "bind_hostname"_a = std::string(),
+          "buffer_size"_a = udp_reader::default_buffer_size);
+
     return m;
 }
 
@@ -31,6 +31,8 @@
 #include <spead2/send_stream.h>
 #include <spead2/send_udp.h>
 #include <spead2/send_udp_ibv.h>
+#include <spead2/send_udp_uring.h>
+#include <spead2/send_udp_xdp.h>
 #include <spead2/send_tcp.h>
 #include <spead2/send_streambuf.h>
 #include <spead2/send_inproc.h>
@@ -532,6 +534,32 @@ public:
 };
 #endif
 
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+
+/* As for udp_ibv_config_wrapper, the Python-centric endpoint list and
+ * interface address are converted when the stream is constructed.
+ */
+class udp_uring_config_wrapper : public udp_uring_config
+{
+public:
+    std::vector<std::pair<std::string, std::uint16_t>> py_endpoints;
+    std::string py_interface_address;
+};
+
+#endif
+
+#if SPEAD2_USE_XDP
+
+// As for udp_uring_config_wrapper
+class udp_xdp_config_wrapper : public udp_xdp_config
+{
+public:
+    std::vector<std::pair<std::string, std::uint16_t>> py_endpoints;
+    std::string py_interface_address;
+};
+
+#endif
+
 class bytes_stream : private std::stringbuf, public stream_wrapper<streambuf_stream>
 {
 public:
@@ -621,6 +649,60 @@ static py::class_<T, stream> udp_ibv_stream_register(py::module &m, const char *
 }
 #endif
 
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+template<typename T>
+static py::class_<T, stream> udp_uring_stream_register(py::module &m, const char *name)
+{
+    using namespace pybind11::literals;
+
+    return py::class_<T, stream>(m, name)
+        .def(py::init([](std::shared_ptr<thread_pool_wrapper> thread_pool,
+                         const stream_config &config,
+                         const udp_uring_config_wrapper &uring_config_wrapper)
+            {
+                udp_uring_config uring_config = uring_config_wrapper;
+                uring_config.set_endpoints(
+                    make_endpoints<boost::asio::ip::udp>(
+                        thread_pool->get_io_service(),
+                        uring_config_wrapper.py_endpoints));
+                uring_config.set_interface_address(
+                    make_address(thread_pool->get_io_service(),
+                                 uring_config_wrapper.py_interface_address));
+                return new T(std::move(thread_pool), config, uring_config);
+            }),
+            "thread_pool"_a.none(false),
+            "config"_a = stream_config(),
+            "udp_uring_config"_a);
+}
+#endif
+
+#if SPEAD2_USE_XDP
+template<typename T>
+static py::class_<T, stream> udp_xdp_stream_register(py::module &m, const char *name)
+{
+    using namespace pybind11::literals;
+
+    return py::class_<T, stream>(m, name)
+        .def(py::init([](std::shared_ptr<thread_pool_wrapper> thread_pool,
+                         const stream_config &config,
+                         const udp_xdp_config_wrapper &xdp_config_wrapper)
+            {
+                udp_xdp_config xdp_config = xdp_config_wrapper;
+                xdp_config.set_endpoints(
+                    make_endpoints<boost::asio::ip::udp>(
+                        thread_pool->get_io_service(),
+                        xdp_config_wrapper.py_endpoints));
+                xdp_config.set_interface_address(
+                    make_address(thread_pool->get_io_service(),
+                                 xdp_config_wrapper.py_interface_address));
+                return new T(std::move(thread_pool), config, xdp_config);
+            }),
+            "thread_pool"_a.none(false),
+            "config"_a = stream_config(),
+            "udp_xdp_config"_a);
+}
+#endif
+
 template<typename Base>
 class tcp_stream_wrapper : public Base
 {
@@ -935,6 +1017,65 @@ py::module register_module(py::module &parent)
     }
 #endif
 
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+    py::class_<udp_uring_config_wrapper>(m, "UdpUringConfig")
+        .def(py::init(&data_class_constructor<udp_uring_config_wrapper>))
+        .def_readwrite("endpoints", &udp_uring_config_wrapper::py_endpoints)
+        .def_readwrite("interface_address", &udp_uring_config_wrapper::py_interface_address)
+        .def_property("buffer_size",
+                      &udp_uring_config_wrapper::get_buffer_size,
+                      SPEAD2_PTMF_VOID(udp_uring_config_wrapper, set_buffer_size))
+        .def_property("ttl",
+                      &udp_uring_config_wrapper::get_ttl,
+                      SPEAD2_PTMF_VOID(udp_uring_config_wrapper, set_ttl))
+        .def_property("zero_copy",
+                      &udp_uring_config_wrapper::get_zero_copy,
+                      SPEAD2_PTMF_VOID(udp_uring_config_wrapper, set_zero_copy))
+        .def_readonly_static("DEFAULT_BUFFER_SIZE", &udp_uring_config_wrapper::default_buffer_size);
+
+    {
+        auto stream_class = udp_uring_stream_register<stream_wrapper<udp_uring_stream>>(m, "UdpUringStream");
+        sync_stream_register(stream_class);
+    }
+    {
+        auto stream_class = udp_uring_stream_register<asyncio_stream_wrapper<udp_uring_stream>>(m, "UdpUringStreamAsyncio");
+        async_stream_register(stream_class);
+    }
+#endif
+
+#if SPEAD2_USE_XDP
+    py::class_<udp_xdp_config_wrapper>(m, "UdpXdpConfig")
+        .def(py::init(&data_class_constructor<udp_xdp_config_wrapper>))
+        .def_readwrite("endpoints", &udp_xdp_config_wrapper::py_endpoints)
+        .def_readwrite("interface_address", &udp_xdp_config_wrapper::py_interface_address)
+        .def_property("buffer_size",
+                      &udp_xdp_config_wrapper::get_buffer_size,
+                      SPEAD2_PTMF_VOID(udp_xdp_config_wrapper, set_buffer_size))
+        .def_property("ttl",
+                      &udp_xdp_config_wrapper::get_ttl,
+                      SPEAD2_PTMF_VOID(udp_xdp_config_wrapper, set_ttl))
+        .def_property("queue_id",
+                      &udp_xdp_config_wrapper::get_queue_id,
+                      SPEAD2_PTMF_VOID(udp_xdp_config_wrapper, set_queue_id))
+        .def_property("mode",
+                      &udp_xdp_config_wrapper::get_mode,
+                      SPEAD2_PTMF_VOID(udp_xdp_config_wrapper, set_mode))
+        .def_property("max_poll",
+                      &udp_xdp_config_wrapper::get_max_poll,
+                      SPEAD2_PTMF_VOID(udp_xdp_config_wrapper, set_max_poll))
+        .def_readonly_static("DEFAULT_BUFFER_SIZE", &udp_xdp_config_wrapper::default_buffer_size)
+        .def_readonly_static("DEFAULT_MAX_POLL", &udp_xdp_config_wrapper::default_max_poll);
+
+    {
+        auto stream_class = udp_xdp_stream_register<stream_wrapper<udp_xdp_stream>>(m, "UdpXdpStream");
+        sync_stream_register(stream_class);
+    }
+    {
+        auto stream_class = udp_xdp_stream_register<asyncio_stream_wrapper<udp_xdp_stream>>(m, "UdpXdpStreamAsyncio");
+        async_stream_register(stream_class);
+    }
+#endif
+
     {
         auto stream_class = tcp_stream_register<tcp_stream_register_sync>(m, "TcpStream");
         sync_stream_register(stream_class);
@@ -1,4 +1,4 @@
-/* Copyright 2021-2023 National Research Foundation (SARAO)
+/* Copyright 2021-2023, 2026 National Research Foundation (SARAO)
  *
  * This program is free software: you can redistribute it and/or modify it under
  * the terms of the GNU Lesser General Public License as published by the Free
@@ -27,8 +27,10 @@
 #include <algorithm>
 #include <utility>
 #include <new>
+#include <optional>
 #include <spead2/common_defines.h>
 #include <spead2/common_memory_allocator.h>
+#include <spead2/common_endian.h>
 #include <spead2/recv_packet.h>
 #include <spead2/recv_live_heap.h>
 #include <spead2/recv_heap.h>
@@ -59,6 +61,18 @@ chunk_stream_config &chunk_stream_config::set_place(chunk_place_function place)
     return *this;
 }
 
+chunk_stream_config &chunk_stream_config::set_place_batch(chunk_place_batch_function place_batch)
+{
+    this->place_batch = std::move(place_batch);
+    return *this;
+}
+
+chunk_stream_config &chunk_stream_config::set_place_affine(std::optional<chunk_place_affine> place_affine)
+{
+    this->place_affine = std::move(place_affine);
+    return *this;
+}
+
 chunk_stream_config &chunk_stream_config::set_allocate(chunk_allocate_function allocate)
 {
     this->allocate = std::move(allocate);
@@ -91,6 +105,105 @@ chunk_stream_config &chunk_stream_config::set_max_heap_extra(std::size_t max_hea
     return *this;
 }
 
+chunk_stream_config &chunk_stream_config::set_direct_placement(bool direct_placement)
+{
+    this->direct_placement = direct_placement;
+    return *this;
+}
+
+
+chunk_place_affine &chunk_place_affine::set_timestamp_item(std::size_t index)
+{
+    timestamp_item = index;
+    return *this;
+}
+
+chunk_place_affine &chunk_place_affine::set_timestamp_step(item_pointer_t step)
+{
+    if (step == 0)
+        throw std::invalid_argument("step must not be zero");
+    timestamp_step = step;
+    timestamp_div = libdivide::divider<item_pointer_t>(step);
+    return *this;
+}
+
+chunk_place_affine &chunk_place_affine::set_timestamps_per_chunk(std::size_t timestamps_per_chunk)
+{
+    if (timestamps_per_chunk == 0)
+        throw std::invalid_argument("timestamps_per_chunk must not be zero");
+    this->timestamps_per_chunk = timestamps_per_chunk;
+    chunk_div = libdivide::divider<item_pointer_t>(timestamps_per_chunk);
+    return *this;
+}
+
+chunk_place_affine &chunk_place_affine::set_channel_item(std::optional<std::size_t> index)
+{
+    channel_item = index;
+    return *this;
+}
+
+chunk_place_affine &chunk_place_affine::set_channel_step(item_pointer_t step)
+{
+    if (step == 0)
+        throw std::invalid_argument("step must not be zero");
+    channel_step = step;
+    channel_div = libdivide::divider<item_pointer_t>(step);
+    return *this;
+}
+
+chunk_place_affine &chunk_place_affine::set_channels(std::size_t channels)
+{
+    if (channels == 0)
+        throw std::invalid_argument("channels must not be zero");
+    this->channels = channels;
+    return *this;
+}
+
+chunk_place_affine &chunk_place_affine::set_heap_size(std::size_t heap_size)
+{
+    this->heap_size = heap_size;
+    return *this;
+}
+
+template<bool has_channel>
+void chunk_place_affine::place_impl(chunk_place_data *data, std::size_t n_data) const
+{
+    const std::size_t channel_index = has_channel ? *channel_item : 0;
+    for (std::size_t i = 0; i < n_data; i++)
+    {
+        const s_item_pointer_t *items = data[i].items;
+        // Missing items are reported as -1
+        if (items[timestamp_item] < 0 || (has_channel && items[channel_index] < 0))
+            continue;
+        // libdivide doesn't provide operator %, so remainders are computed by hand
+        item_pointer_t timestamp = items[timestamp_item];
+        item_pointer_t t = timestamp / timestamp_div;
+        if (t * timestamp_step != timestamp)
+            continue;
+        item_pointer_t chunk_id = t / chunk_div;
+        std::size_t heap_index = t - chunk_id * timestamps_per_chunk;
+        if constexpr (has_channel)
+        {
+            item_pointer_t channel = items[channel_index];
+            item_pointer_t c = channel / channel_div;
+            if (c * channel_step != channel || c >= channels)
+                continue;
+            heap_index = heap_index * channels + c;
+        }
+        data[i].chunk_id = chunk_id;
+        data[i].heap_index = heap_index;
+        data[i].heap_offset = heap_index * heap_size;
+    }
+}
+
+void chunk_place_affine::operator()(chunk_place_data *data, std::size_t n_data) const
+{
+    if (channel_item)
+        place_impl<true>(data, n_data);
+    else
+        place_impl<false>(data, n_data);
+}
+
 
 namespace detail
 {
@@ -109,25 +222,60 @@ chunk_stream_state_base::chunk_stream_state_base(
     chunk_config(chunk_config),
     stream_id(config.get_stream_id()),
     base_stat_index(config.next_stat_index()),
-    chunks(chunk_config.get_max_chunks())
+    chunks(chunk_config.get_max_chunks()),
+    allow_out_of_order(config.get_allow_out_of_order()),
+    stop_on_stop_item(config.get_stop_on_stop_item())
 {
-    if (!this->chunk_config.get_place())
+    const auto &place_affine = this->chunk_config.get_place_affine();
+    if (place_affine)
+    {
+        std::size_t n_items = this->chunk_config.get_items().size();
+        if (place_affine->get_timestamp_item() >= n_items)
+            throw std::invalid_argument("place_affine timestamp_item is out of range");
+        if (place_affine->get_channel_item() && *place_affine->get_channel_item() >= n_items)
+            throw std::invalid_argument("place_affine channel_item is out of range");
+        if (place_affine->get_heap_size() == 0)
+            throw std::invalid_argument("place_affine heap_size must not be zero");
+    }
+    else if (!this->chunk_config.get_place() && !this->chunk_config.get_place_batch())
         throw std::invalid_argument("chunk_config.place is not set");
 
+    if (chunk_config.get_direct_placement())
+    {
+        /* Use twice as many slots as the number of live heaps permitted
+         * by the stream config, to keep collisions (which evict the older
+         * heap) rare.
+         */
+        const std::size_t max_live = config.get_max_heaps() * config.get_substreams();
+        std::size_t size = 2;
+        direct_heap_shift = 63;
+        while (size < 2 * max_live)
+        {
+            size *= 2;
+            direct_heap_shift--;
+        }
+        direct_heaps.resize(size);
+        for (direct_heap &entry : direct_heaps)
+            entry.allocation = memory_allocator::pointer(nullptr, heap_metadata{-1, 0, 0, nullptr});
+        direct_single.allocation = memory_allocator::pointer(nullptr, heap_metadata{-1, 0, 0, nullptr});
+    }
+
     /* Compute the memory required for place_data_storage. The layout is
-     * - chunk_place_data
-     * - item pointers (with s_item_pointer_t alignment)
-     * - extra (with max_align_t alignment)
+     * - chunk_place_data[n_place]
+     * - item pointers (with s_item_pointer_t alignment), n_items per element
+     * - extra (with max_align_t alignment), max_heap_extra (rounded up) per element
      */
+    const std::size_t n_place = place_batched() ? 1 + stream_base::packet_window : 1;
     constexpr std::size_t max_align = alignof(std::max_align_t);
     const std::size_t n_items = chunk_config.get_items().size();
-    std::size_t space = sizeof(chunk_place_data);
+    const std::size_t extra_stride = round_up(chunk_config.get_max_heap_extra(), max_align);
+    std::size_t space = n_place * sizeof(chunk_place_data);
     space = round_up(space, alignof(s_item_pointer_t));
     std::size_t item_offset = space;
-    space += n_items * sizeof(s_item_pointer_t);
+    space += n_place * n_items * sizeof(s_item_pointer_t);
     space = round_up(space, max_align);
     std::size_t extra_offset = space;
-    space += chunk_config.get_max_heap_extra();
+    space += n_place * extra_stride;
     /* operator new is required to return a pointer suitably aligned for an
      * object of the requested size. Round up to a multiple of max_align so
      * that the library cannot infer a smaller alignment.
@@ -148,24 +296,35 @@ chunk_stream_state_base::chunk_stream_state_base(
      * it is necessary to use std::launder so it wouldn't be any simpler.
      */
     unsigned char *ptr = reinterpret_cast<unsigned char *>(operator new(space));
-    place_data = new(ptr) chunk_place_data();
-    if (n_items > 0)
-        place_data->items = new(ptr + item_offset) s_item_pointer_t[n_items];
-    else
-        place_data->items = nullptr;
-    if (chunk_config.get_max_heap_extra() > 0)
-        place_data->extra = new(ptr + extra_offset) std::uint8_t[chunk_config.get_max_heap_extra()];
-    else
-        place_data->extra = nullptr;
-    place_data_storage.reset(ptr);
+    for (std::size_t i = 0; i < n_place; i++)
+    {
+        chunk_place_data *data = new(ptr + i * sizeof(chunk_place_data)) chunk_place_data();
+        if (n_items > 0)
+            data->items = new(ptr + item_offset + i * n_items * sizeof(s_item_pointer_t))
+                s_item_pointer_t[n_items];
+        else
+            data->items = nullptr;
+        if (chunk_config.get_max_heap_extra() > 0)
+            data->extra = new(ptr + extra_offset + i * extra_stride)
+                std::uint8_t[chunk_config.get_max_heap_extra()];
+        else
+            data->extra = nullptr;
+        if (i == 0)
+            place_data = data;
+    }
+    place_data_storage = std::unique_ptr<unsigned char[], free_place_data>(ptr, free_place_data{n_place});
+    prepared_packets.reserve(n_place - 1);
 }
 
 void chunk_stream_state_base::free_place_data::operator()(unsigned char *ptr) const
 {
     // It's not totally clear whether std::launder is required here, but
     // better to be safe.
-    auto *place_data = std::launder(reinterpret_cast<chunk_place_data *>(ptr));
-    place_data->~chunk_place_data();
+    for (std::size_t i = 0; i < n; i++)
+    {
+        auto *place_data = std::launder(reinterpret_cast<chunk_place_data *>(ptr) + i);
+        place_data->~chunk_place_data();
+    }
     operator delete(ptr);
 }
 
@@ -191,22 +350,140 @@ void chunk_stream_state_base::packet_memcpy(
     }
 }
 
+void chunk_stream_state_base::fill_place_data(
+    chunk_place_data *data, const packet_header &packet, std::uint64_t *batch_stats) const
+{
+    /* Extract the user's requested items.
+     * TODO: this could possibly be optimised with a hash table (with a
+     * perfect hash function chosen in advance), but for the expected
+     * sizes the overheads will probably outweight the benefits.
+     */
+    const auto &item_ids = get_chunk_config().get_items();
+    std::fill(data->items, data->items + item_ids.size(), -1);
+    pointer_decoder decoder(packet.heap_address_bits);
+    /* packet.pointers and packet.n_items skips initial "special" item
+     * pointers. To allow them to be matched as well, we start from the
+     * original packet and skip over the 8-byte header.
+     */
+    for (const std::uint8_t *p = packet.packet + 8; p != packet.payload; p += sizeof(item_pointer_t))
+    {
+        item_pointer_t pointer = load_be<item_pointer_t>(p);
+        if (decoder.is_immediate(pointer))
+        {
+            item_pointer_t id = decoder.get_id(pointer);
+            for (std::size_t j = 0; j < item_ids.size(); j++)
+                if (item_ids[j] == id)
+                    data->items[j] = decoder.get_immediate(pointer);
+        }
+    }
+
+    data->packet = packet.packet;
+    data->packet_size = packet.payload + packet.payload_length - packet.packet;
+    data->chunk_id = -1;
+    data->heap_index = 0;
+    data->heap_offset = 0;
+    data->batch_stats = batch_stats;
+    data->extra_offset = 0;
+    data->extra_size = 0;
+}
+
+void chunk_stream_state_base::call_place(chunk_place_data *data, std::size_t n) const
+{
+    const auto &place_affine = chunk_config.get_place_affine();
+    const auto &place_batch = chunk_config.get_place_batch();
+    if (place_affine)
+        (*place_affine)(data, n);
+    else if (place_batch)
+        place_batch(data, n, sizeof(chunk_place_data));
+    else
+    {
+        const auto &place = chunk_config.get_place();
+        for (std::size_t i = 0; i < n; i++)
+            place(data + i, sizeof(chunk_place_data));
+    }
+}
+
+chunk_place_data *chunk_stream_state_base::take_prepared(const packet_header &packet)
+{
+    const std::size_t n_prepared = prepared_packets.size();
+    /* Heaps are usually started in the order they were prepared, so this
+     * normally succeeds on the first iteration.
+     */
+    for (std::size_t i = next_prepared; i < n_prepared; i++)
+    {
+        if (prepared_packets[i] == &packet)
+        {
+            prepared_packets[i] = nullptr;
+            while (next_prepared < n_prepared && !prepared_packets[next_prepared])
+                next_prepared++;
+            return place_data + 1 + i;
+        }
+    }
+    return nullptr;
+}
+
+void chunk_stream_state_base::heap_present(const memory_allocator::pointer &allocation) const
+{
+    auto metadata = get_heap_metadata(allocation);
+    // We need to check the chunk_id because the chunk might have been aged
+    // out while the heap was incomplete.
+    if (metadata && metadata->chunk_ptr
+        && !chunk_too_old(metadata->chunk_id)
+        && !get_chunk_config().get_packet_presence_payload_size())
+    {
+        assert(metadata->heap_index < metadata->chunk_ptr->present_size);
+        metadata->chunk_ptr->present[metadata->heap_index] = true;
+    }
+}
+
 void chunk_stream_state_base::do_heap_ready(live_heap &&lh)
 {
     if (lh.is_complete())
     {
         heap h(std::move(lh));
-        auto metadata = get_heap_metadata(h.get_payload());
-        // We need to check the chunk_id because the chunk might have been aged
-        // out while the heap was incomplete.
-        if (metadata && metadata->chunk_ptr
-            && !chunk_too_old(metadata->chunk_id)
-            && !get_chunk_config().get_packet_presence_payload_size())
+        heap_present(h.get_payload());
+    }
+}
+
+void chunk_stream_state_base::reset_direct_heap(
+    direct_heap &entry, const packet_header &packet,
+    std::uint8_t *ptr, const heap_metadata &metadata)
+{
+    // Update the existing deleter in place rather than constructing a new one
+    *entry.allocation.get_deleter().target<heap_metadata>() = metadata;
+    entry.allocation.release();  // Not owned, so nothing to free
+    entry.allocation.reset(ptr);
+    entry.cnt = packet.heap_cnt;
+    entry.heap_length = packet.heap_length;
+    entry.received = 0;
+}
+
+std::size_t chunk_stream_state_base::do_flush_direct()
+{
+    std::size_t n_flushed = 0;
+    for (direct_heap &entry : direct_heaps)
+    {
+        if (entry.cnt >= 0)
         {
-            assert(metadata->heap_index < metadata->chunk_ptr->present_size);
-            metadata->chunk_ptr->present[metadata->heap_index] = true;
+            n_flushed++;
+            entry.cnt = -1;
         }
     }
+    return n_flushed;
+}
+
+bool chunk_stream_state_base::packet_has_stream_stop(const packet_header &packet)
+{
+    pointer_decoder decoder(packet.heap_address_bits);
+    for (int i = 0; i < packet.n_items; i++)
+    {
+        item_pointer_t pointer = load_be<item_pointer_t>(packet.pointers + i * sizeof(item_pointer_t));
+        if (decoder.is_immediate(pointer)
+            && decoder.get_id(pointer) == STREAM_CTRL_ID
+            && decoder.get_immediate(pointer) == CTRL_STREAM_STOP)
+            return true;
+    }
+    return false;
 }
 
 const chunk_stream_state_base::heap_metadata *chunk_stream_state_base::get_heap_metadata(
@@ -253,6 +530,10 @@ chunk_stream::chunk_stream(
     : chunk_stream_state(config, chunk_config, detail::chunk_manager_simple(chunk_config)),
     stream(std::move(io_service), adjust_config(config))
 {
+    // The stream only sees the wrapper installed by adjust_config
+    set_packet_alignment(orig_memcpy, base_stat_index + misaligned_packets_offset);
+    if (chunk_config.get_direct_placement())
+        enable_direct_packets();
 }
 
 void chunk_stream::heap_ready(live_heap &&lh)
@@ -260,6 +541,24 @@ void chunk_stream::heap_ready(live_heap &&lh)
     do_heap_ready(std::move(lh));
 }
 
+stream_base::direct_packet_result chunk_stream::add_packet_direct(const packet_header &packet)
+{
+    return chunk_stream_state::add_packet_direct(packet);
+}
+
+std::size_t chunk_stream::flush_direct()
+{
+    return do_flush_direct();
+}
+
+void chunk_stream::prepare_packets(const packet_header *packets, std::size_t n_packets)
+{
+    prepare_place(
+        packets, n_packets,
+        [this](const packet_header &packet) { return is_packet_aligned(packet); },
+        [this](s_item_pointer_t cnt) { return is_heap_live(cnt); });
+}
+
 void chunk_stream::stop_received()
 {
     stream::stop_received();
@@ -1,4 +1,4 @@
-/* Copyright 2023 National Research Foundation (SARAO)
+/* Copyright 2023, 2026 National Research Foundation (SARAO)
  *
  * This program is free software: you can redistribute it and/or modify it under
  * the terms of the GNU Lesser General Public License as published by the Free
@@ -241,6 +241,10 @@ chunk_stream_group_member::chunk_stream_group_member(
 {
     if (chunk_config.get_max_chunks() > group.config.get_max_chunks())
         throw std::invalid_argument("stream max_chunks must not be larger than group max_chunks");
+    // The stream only sees the wrapper installed by adjust_config
+    set_packet_alignment(orig_memcpy, base_stat_index + misaligned_packets_offset);
+    if (chunk_config.get_direct_placement())
+        enable_direct_packets();
 }
 
 void chunk_stream_group_member::heap_ready(live_heap &&lh)
@@ -248,6 +252,24 @@ void chunk_stream_group_member::heap_ready(live_heap &&lh)
     do_heap_ready(std::move(lh));
 }
 
+stream_base::direct_packet_result chunk_stream_group_member::add_packet_direct(const packet_header &packet)
+{
+    return chunk_stream_state::add_packet_direct(packet);
+}
+
+std::size_t chunk_stream_group_member::flush_direct()
+{
+    return do_flush_direct();
+}
+
+void chunk_stream_group_member::prepare_packets(const packet_header *packets, std::size_t n_packets)
+{
+    prepare_place(
+        packets, n_packets,
+        [this](const packet_header &packet) { return is_packet_aligned(packet); },
+        [this](s_item_pointer_t cnt) { return is_heap_live(cnt); });
+}
+
 void chunk_stream_group_member::async_flush_until(std::uint64_t chunk_id)
 {
     post([chunk_id](stream_base &s) {
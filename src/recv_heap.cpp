@@ -325,11 +325,11 @@ incomplete_heap::incomplete_heap(live_heap &&h, bool keep_payload, bool keep_pay
     load(std::move(h), false, keep_payload);
     if (keep_payload_ranges)
     {
-        payload_ranges = std::move(h.payload_ranges);
+        payload_ranges.assign(h.metadata.payload_ranges.begin(), h.metadata.payload_ranges.end());
         if (payload_ranges.empty() && received_length > 0)
         {
             // In-order mode doesn't use payload_ranges, so we have to synthesize it
-            payload_ranges.emplace(0, received_length);
+            payload_ranges.emplace_back(0, received_length);
         }
     }
     // Reset h so that it still satisfies its invariants
@@ -339,8 +339,7 @@ incomplete_heap::incomplete_heap(live_heap &&h, bool keep_payload, bool keep_pay
 std::vector<std::pair<s_item_pointer_t, s_item_pointer_t>>
 incomplete_heap::get_payload_ranges() const
 {
-    return std::vector<std::pair<s_item_pointer_t, s_item_pointer_t>>(
-        payload_ranges.begin(), payload_ranges.end());
+    return payload_ranges;
 }
 
 } // namespace spead2::recv
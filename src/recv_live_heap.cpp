@@ -32,47 +32,143 @@
 namespace spead2::recv
 {
 
-live_heap::live_heap(const packet_header &initial_packet,
-                     bug_compat_mask bug_compat)
-    : cnt(initial_packet.heap_cnt),
-    decoder(initial_packet.heap_address_bits),
-    bug_compat(bug_compat)
+namespace detail
 {
-    assert(cnt >= 0);
+
+live_heap_storage_pool::live_heap_storage_pool()
+{
+    for (auto &state : states)
+        state.store(SLOT_EMPTY, std::memory_order_relaxed);
 }
 
-void live_heap::payload_reserve(std::size_t size, bool exact, const packet_header &packet,
-                                memory_allocator &allocator)
+live_heap_storage_pool::storage live_heap_storage_pool::get()
 {
-    if (size > payload_reserved)
+    for (std::size_t i = 0; i < capacity; i++)
     {
-        if (!exact && size < payload_reserved * 2)
+        std::uint8_t expected = SLOT_FULL;
+        if (states[i].load(std::memory_order_relaxed) == SLOT_FULL
+            && states[i].compare_exchange_strong(expected, SLOT_BUSY,
+                                                 std::memory_order_acquire,
+                                                 std::memory_order_relaxed))
         {
-            size = payload_reserved * 2;
+            storage out = std::move(slots[i]);
+            states[i].store(SLOT_EMPTY, std::memory_order_release);
+            return out;
         }
-        memory_allocator::pointer new_payload;
-        new_payload = allocator.allocate(size, (void *) &packet);
-        if (payload && new_payload)
-            std::memcpy(new_payload.get(), payload.get(), payload_reserved);
-        payload = std::move(new_payload);
-        payload_reserved = size;
     }
+    return storage();
 }
 
-bool live_heap::add_payload_range(s_item_pointer_t first, s_item_pointer_t last)
+void live_heap_storage_pool::put(storage &&s)
+{
+    s.pointers.clear();
+    s.ranges.clear();
+    for (std::size_t i = 0; i < capacity; i++)
+    {
+        std::uint8_t expected = SLOT_EMPTY;
+        if (states[i].load(std::memory_order_relaxed) == SLOT_EMPTY
+            && states[i].compare_exchange_strong(expected, SLOT_BUSY,
+                                                 std::memory_order_acquire,
+                                                 std::memory_order_relaxed))
+        {
+            slots[i] = std::move(s);
+            states[i].store(SLOT_FULL, std::memory_order_release);
+            return;
+        }
+    }
+    // The pool is full, so let the memory be freed
+}
+
+live_heap_metadata &live_heap_metadata::operator=(live_heap_metadata &&other)
 {
-    decltype(payload_ranges)::iterator prev, next, ptr;
-    next = payload_ranges.upper_bound(first);
-    if (next != payload_ranges.end() && next->first < last)
+    if (this != &other)
+    {
+        release();
+        external_pointers = std::move(other.external_pointers);
+        payload_ranges = std::move(other.payload_ranges);
+        pool = std::move(other.pool);
+    }
+    return *this;
+}
+
+live_heap_metadata::~live_heap_metadata()
+{
+    release();
+}
+
+void live_heap_metadata::release()
+{
+    if (pool)
+    {
+        live_heap_storage_pool::storage storage;
+        storage.pointers = std::move(external_pointers);
+        external_pointers.clear();
+        payload_ranges.swap_storage(storage.ranges);
+        pool->put(std::move(storage));
+        pool.reset();
+    }
+}
+
+} // namespace detail
+
+payload_range_set::value_type *payload_range_set::insert(
+    std::size_t pos, s_item_pointer_t first, s_item_pointer_t last)
+{
+    assert(pos <= n_ranges);
+    if (!external && n_ranges == max_inline_ranges)
+    {
+        // Spill to external storage
+        external_ranges.assign(inline_ranges.begin(), inline_ranges.end());
+        external = true;
+    }
+    if (external)
+        external_ranges.emplace(external_ranges.begin() + pos, first, last);
+    else
+    {
+        std::move_backward(inline_ranges.begin() + pos, inline_ranges.begin() + n_ranges,
+                           inline_ranges.begin() + n_ranges + 1);
+        inline_ranges[pos] = value_type(first, last);
+    }
+    n_ranges++;
+    return data() + pos;
+}
+
+void payload_range_set::erase(std::size_t pos)
+{
+    assert(pos < n_ranges);
+    if (external)
+        external_ranges.erase(external_ranges.begin() + pos);
+    else
+        std::move(inline_ranges.begin() + pos + 1, inline_ranges.begin() + n_ranges,
+                  inline_ranges.begin() + pos);
+    n_ranges--;
+}
+
+bool payload_range_set::add(s_item_pointer_t first, s_item_pointer_t last)
+{
+    value_type *ranges = data();
+    value_type *prev, *ptr;
+    /* Find the first range that starts after first. In the common case of
+     * in-order arrival that's the end, so check for that before searching.
+     */
+    value_type *next = ranges + n_ranges;
+    if (n_ranges > 0 && next[-1].first > first)
+    {
+        next = std::upper_bound(
+            ranges, next, first,
+            [](s_item_pointer_t value, const value_type &range) { return value < range.first; });
+    }
+    if (next != ranges + n_ranges && next->first < last)
     {
         log_warning("packet rejected because it partially overlaps existing payload");
         return false;
     }
-    else if (next == payload_ranges.begin()
-        || (prev = std::prev(next))->second < first)
+    else if (next == ranges || (prev = next - 1)->second < first)
     {
         // The prior range, if any, does not intersect this one
-        ptr = payload_ranges.emplace_hint(next, first, last);
+        ptr = insert(next - ranges, first, last);
+        ranges = data();   // insert may have reallocated
+        next = ptr + 1;
     }
     else if (prev->second == first)
     {
@@ -90,14 +186,64 @@ bool live_heap::add_payload_range(s_item_pointer_t first, s_item_pointer_t last)
         return false;
     }
 
-    if (next != payload_ranges.end() && next->first == last)
+    if (next != ranges + n_ranges && next->first == last)
     {
         ptr->second = next->second;
-        payload_ranges.erase(next);
+        erase(next - ranges);
     }
     return true;
 }
 
+void payload_range_set::clear()
+{
+    n_ranges = 0;
+    external = false;
+    external_ranges.clear();
+}
+
+void payload_range_set::swap_storage(std::vector<value_type> &storage)
+{
+    clear();
+    external_ranges.swap(storage);
+    external_ranges.clear();
+}
+
+live_heap::live_heap(const packet_header &initial_packet,
+                     bug_compat_mask bug_compat)
+    : cnt(initial_packet.heap_cnt),
+    decoder(initial_packet.heap_address_bits),
+    bug_compat(bug_compat)
+{
+    assert(cnt >= 0);
+}
+
+void live_heap::payload_reserve(std::size_t size, bool exact, const packet_header &packet,
+                                memory_allocator &allocator)
+{
+    if (size > payload_reserved)
+    {
+        if (!exact && size < payload_reserved * 2)
+        {
+            size = payload_reserved * 2;
+        }
+        memory_allocator::pointer new_payload;
+        new_payload = allocator.allocate(size, (void *) &packet);
+        if (payload && new_payload)
+            std::memcpy(new_payload.get(), payload.get(), payload_reserved);
+        payload = std::move(new_payload);
+        payload_reserved = size;
+    }
+}
+
+bool live_heap::add_payload_range(s_item_pointer_t first, s_item_pointer_t last)
+{
+    std::size_t old_capacity = metadata.payload_ranges.capacity();
+    bool added = metadata.payload_ranges.add(first, last);
+    if (metadata.payload_ranges.capacity() != old_capacity)
+        allocations++;
+    return added;
+}
+
 void live_heap::add_pointers(std::size_t n, const std::uint8_t *pointers)
 {
     for (std::size_t i = 0; i < n; i++)
@@ -112,21 +258,28 @@ void live_heap::add_pointers(std::size_t n, const std::uint8_t *pointers)
              * pointer may determine the length of the previous direct-addressed item.
              */
             bool seen;
+            std::uint32_t *slot = nullptr;
             if (n_inline_pointers >= 0)
                 seen = std::count(inline_pointers.begin(), inline_pointers.begin() + n_inline_pointers,
                                   pointer);
             else
-                seen = seen_pointers.count(pointer);
+            {
+                // A heap returned by take() has no hash table
+                if (pointer_hash.empty())
+                    pointer_hash_rebuild();
+                slot = pointer_hash_find(pointer);
+                seen = *slot != 0;
+            }
             if (!seen)
             {
                 if (n_inline_pointers == max_inline_pointers)
                 {
-                    external_pointers.reserve(n_inline_pointers + (n - i));
-                    external_pointers.insert(external_pointers.end(),
-                                             inline_pointers.begin(),
-                                             inline_pointers.begin() + n_inline_pointers);
-                    seen_pointers.insert(inline_pointers.begin(),
-                                         inline_pointers.begin() + n_inline_pointers);
+                    if (metadata.external_pointers.capacity() < n_inline_pointers + (n - i))
+                        allocations++;
+                    metadata.external_pointers.reserve(n_inline_pointers + (n - i));
+                    metadata.external_pointers.insert(metadata.external_pointers.end(),
+                                                      inline_pointers.begin(),
+                                                      inline_pointers.begin() + n_inline_pointers);
                     n_inline_pointers = -1;
                 }
 
@@ -136,8 +289,14 @@ void live_heap::add_pointers(std::size_t n, const std::uint8_t *pointers)
                 }
                 else
                 {
-                    external_pointers.push_back(pointer);
-                    seen_pointers.insert(pointer);
+                    if (metadata.external_pointers.size() == metadata.external_pointers.capacity())
+                        allocations++;
+                    metadata.external_pointers.push_back(pointer);
+                    // slot is null if we've just switched to external storage
+                    if (!slot || 2 * metadata.external_pointers.size() > pointer_hash.size())
+                        pointer_hash_rebuild();
+                    else
+                        *slot = metadata.external_pointers.size();
                 }
 
                 if (item_id == STREAM_CTRL_ID && decoder.is_immediate(pointer)
@@ -148,6 +307,36 @@ void live_heap::add_pointers(std::size_t n, const std::uint8_t *pointers)
     }
 }
 
+std::uint32_t *live_heap::pointer_hash_find(item_pointer_t pointer)
+{
+    const std::size_t mask = pointer_hash.size() - 1;
+    // Look up Fibonacci hashing for an explanation of the magic number
+    std::size_t pos = (pointer * 11400714819323198485ULL) >> pointer_hash_shift;
+    /* Pointers in the table are unique, so this stops at either the matching
+     * pointer or an empty slot.
+     */
+    while (pointer_hash[pos] != 0 && metadata.external_pointers[pointer_hash[pos] - 1] != pointer)
+        pos = (pos + 1) & mask;
+    return &pointer_hash[pos];
+}
+
+void live_heap::pointer_hash_rebuild()
+{
+    std::size_t slots = 32;
+    int shift = 64 - 5;
+    while (slots < 2 * metadata.external_pointers.size())
+    {
+        slots *= 2;
+        shift--;
+    }
+    if (pointer_hash.capacity() < slots)
+        allocations++;
+    pointer_hash.assign(slots, 0);
+    pointer_hash_shift = shift;
+    for (std::size_t i = 0; i < metadata.external_pointers.size(); i++)
+        *pointer_hash_find(metadata.external_pointers[i]) = i + 1;
+}
+
 bool live_heap::add_packet(const packet_header &packet,
                            const packet_memcpy_function &packet_memcpy,
                            memory_allocator &allocator,
@@ -266,7 +455,7 @@ item_pointer_t *live_heap::pointers_begin()
     if (n_inline_pointers >= 0)
         return inline_pointers.data();
     else
-        return external_pointers.data();
+        return metadata.external_pointers.data();
 }
 
 item_pointer_t *live_heap::pointers_end()
@@ -274,7 +463,28 @@ item_pointer_t *live_heap::pointers_end()
     if (n_inline_pointers >= 0)
         return inline_pointers.data() + n_inline_pointers;
     else
-        return external_pointers.data() + external_pointers.size();
+        return metadata.external_pointers.data() + metadata.external_pointers.size();
+}
+
+live_heap live_heap::take(const std::shared_ptr<detail::live_heap_storage_pool> &pool)
+{
+    live_heap out(std::move(*this));
+    /* The hash table is only needed to add more pointers, and is rebuilt on
+     * demand, so it stays here. Other metadata storage goes with the new
+     * heap, and is replaced from the pool.
+     */
+    pointer_hash = std::move(out.pointer_hash);
+    out.pointer_hash.clear();
+    if (out.metadata.external_pointers.capacity() > 0
+        || out.metadata.payload_ranges.capacity() > 0)
+    {
+        detail::live_heap_storage_pool::storage storage = pool->get();
+        metadata.external_pointers = std::move(storage.pointers);
+        metadata.payload_ranges.swap_storage(storage.ranges);
+        out.metadata.pool = pool;
+    }
+    reset();
+    return out;
 }
 
 void live_heap::reset()
@@ -286,10 +496,20 @@ void live_heap::reset()
     payload.reset();
     payload_reserved = 0;
     n_inline_pointers = 0;
-    external_pointers.clear();
-    external_pointers.shrink_to_fit();
-    seen_pointers.clear();
-    payload_ranges.clear();
+    metadata.release();
+    metadata.external_pointers.clear();
+    pointer_hash.clear();
+    metadata.payload_ranges.clear();
+    allocations = 0;
+}
+
+void live_heap::reset(const packet_header &initial_packet, bug_compat_mask bug_compat)
+{
+    reset();
+    cnt = initial_packet.heap_cnt;
+    decoder = pointer_decoder(initial_packet.heap_address_bits);
+    this->bug_compat = bug_compat;
+    assert(cnt >= 0);
 }
 
 } // namespace spead2::recv
@@ -20,15 +20,139 @@
 
 #include <cassert>
 #include <cstring>
+#include <algorithm>
 #include <spead2/recv_packet.h>
 #include <spead2/recv_utils.h>
 #include <spead2/common_defines.h>
+#include <spead2/common_features.h>
 #include <spead2/common_logging.h>
 #include <spead2/common_endian.h>
 
 namespace spead2::recv
 {
 
+/**
+ * If @a pointer is one of the special items that is extracted into a
+ * @ref packet_header, store it in @a out and return true.
+ */
+static inline bool decode_special(
+    packet_header &out, const pointer_decoder &decoder, item_pointer_t pointer)
+{
+    if (!decoder.is_immediate(pointer))
+        return false;
+    switch (decoder.get_id(pointer))
+    {
+    case HEAP_CNT_ID:
+        out.heap_cnt = decoder.get_immediate(pointer);
+        return true;
+    case HEAP_LENGTH_ID:
+        out.heap_length = decoder.get_immediate(pointer);
+        return true;
+    case PAYLOAD_OFFSET_ID:
+        out.payload_offset = decoder.get_immediate(pointer);
+        return true;
+    case PAYLOAD_LENGTH_ID:
+        out.payload_length = decoder.get_immediate(pointer);
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Find the special items amongst the @a out.n_items item pointers starting
+ * at @a pointers, and store them in @a out. Returns the index of the first
+ * item pointer that is not special (or @a out.n_items if there is none).
+ */
+int decode_specials_scalar(packet_header &out, const std::uint8_t *pointers) noexcept
+{
+    pointer_decoder decoder(out.heap_address_bits);
+    int first_regular = out.n_items;
+    for (int i = 0; i < out.n_items; i++)
+    {
+        item_pointer_t pointer = load_be<item_pointer_t>(pointers + i * sizeof(item_pointer_t));
+        if (!decode_special(out, decoder, pointer))
+            first_regular = std::min(first_regular, i);
+    }
+    return first_regular;
+}
+
+} // namespace spead2::recv
+
+#if SPEAD2_USE_SSE41_DECODE
+# include <smmintrin.h>
+# define SPEAD2_DECODE_NAME decode_specials_sse41
+# define SPEAD2_DECODE_TARGET "sse4.1"
+# define SPEAD2_DECODE_TYPE __m128i
+# define SPEAD2_DECODE_BSWAP _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7)
+# define SPEAD2_DECODE_LOAD _mm_loadu_si128
+# define SPEAD2_DECODE_SHUFFLE _mm_shuffle_epi8
+# define SPEAD2_DECODE_SRL _mm_srl_epi64
+# define SPEAD2_DECODE_SUB _mm_sub_epi64
+# define SPEAD2_DECODE_ANDNOT _mm_andnot_si128
+# define SPEAD2_DECODE_CMPEQ _mm_cmpeq_epi64
+# define SPEAD2_DECODE_SET1 _mm_set1_epi64x
+# define SPEAD2_DECODE_SETZERO _mm_setzero_si128
+# define SPEAD2_DECODE_MOVEMASK(x) _mm_movemask_pd(_mm_castsi128_pd(x))
+# define SPEAD2_DECODE_VZEROUPPER 0
+# include "recv_packet_impl.h"
+#endif
+
+#if SPEAD2_USE_AVX2_DECODE
+# include <immintrin.h>
+# define SPEAD2_DECODE_NAME decode_specials_avx2
+# define SPEAD2_DECODE_TARGET "avx2"
+# define SPEAD2_DECODE_TYPE __m256i
+# define SPEAD2_DECODE_BSWAP _mm256_set_epi8( \
+    8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7, \
+    8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7)
+# define SPEAD2_DECODE_LOAD _mm256_loadu_si256
+# define SPEAD2_DECODE_SHUFFLE _mm256_shuffle_epi8
+# define SPEAD2_DECODE_SRL _mm256_srl_epi64
+# define SPEAD2_DECODE_SUB _mm256_sub_epi64
+# define SPEAD2_DECODE_ANDNOT _mm256_andnot_si256
+# define SPEAD2_DECODE_CMPEQ _mm256_cmpeq_epi64
+# define SPEAD2_DECODE_SET1 _mm256_set1_epi64x
+# define SPEAD2_DECODE_SETZERO _mm256_setzero_si256
+# define SPEAD2_DECODE_MOVEMASK(x) _mm256_movemask_pd(_mm256_castsi256_pd(x))
+# define SPEAD2_DECODE_VZEROUPPER 1
+# include "recv_packet_impl.h"
+#endif
+
+namespace spead2::recv
+{
+
+int (*resolve_decode_specials())(packet_header &, const std::uint8_t *) noexcept
+{
+#if SPEAD2_USE_AVX2_DECODE || SPEAD2_USE_SSE41_DECODE
+    __builtin_cpu_init();
+#endif
+#if SPEAD2_USE_AVX2_DECODE
+    if (__builtin_cpu_supports("avx2"))
+        return decode_specials_avx2;
+#endif
+#if SPEAD2_USE_SSE41_DECODE
+    if (__builtin_cpu_supports("sse4.1"))
+        return decode_specials_sse41;
+#endif
+    return decode_specials_scalar;
+}
+
+#if SPEAD2_USE_FMV
+
+[[gnu::ifunc("_ZN6spead24recv23resolve_decode_specialsEv")]]
+int decode_specials(packet_header &out, const std::uint8_t *pointers) noexcept;
+
+#else
+
+int decode_specials(packet_header &out, const std::uint8_t *pointers) noexcept
+{
+    static int (*decode_specials_ptr)(packet_header &, const std::uint8_t *) noexcept = resolve_decode_specials();
+    return decode_specials_ptr(out, pointers);
+}
+
+#endif
+
 /**
  * Retrieve bits [first, first+cnt) from a field.
  *
@@ -115,39 +239,7 @@ std::size_t decode_packet(packet_header &out, const uint8_t *data, std::size_t m
     out.payload_offset = -1;
     out.payload_length = -1;
     // Look for special items
-    pointer_decoder decoder(out.heap_address_bits);
-    int first_regular = out.n_items;
-    for (int i = 0; i < out.n_items; i++)
-    {
-        item_pointer_t pointer = load_be<item_pointer_t>(data + 8 + i * sizeof(item_pointer_t));
-        bool special;
-        if (decoder.is_immediate(pointer))
-        {
-            special = true;
-            switch (decoder.get_id(pointer))
-            {
-            case HEAP_CNT_ID:
-                out.heap_cnt = decoder.get_immediate(pointer);
-                break;
-            case HEAP_LENGTH_ID:
-                out.heap_length = decoder.get_immediate(pointer);
-                break;
-            case PAYLOAD_OFFSET_ID:
-                out.payload_offset = decoder.get_immediate(pointer);
-                break;
-            case PAYLOAD_LENGTH_ID:
-                out.payload_length = decoder.get_immediate(pointer);
-                break;
-            default:
-                special = false;
-                break;
-            }
-        }
-        else
-            special = false;
-        if (!special)
-            first_regular = std::min(first_regular, i);
-    }
+    int first_regular = decode_specials(out, data + 8);
     if (out.heap_cnt == -1 || out.payload_offset == -1 || out.payload_length == -1)
     {
         log_info("packet rejected because it does not have required items");
@@ -175,4 +267,23 @@ std::size_t decode_packet(packet_header &out, const uint8_t *data, std::size_t m
     return size;
 }
 
+std::size_t decode_packets(
+    packet_header *out, const std::uint8_t * const *raw, const std::size_t *lengths,
+    std::size_t n_packets)
+{
+    std::size_t n_out = 0;
+    for (std::size_t i = 0; i < n_packets; i++)
+    {
+        std::size_t size = decode_packet(out[n_out], raw[i], lengths[i]);
+        if (size == lengths[i])
+            n_out++;
+        else if (size != 0)
+        {
+            log_info("discarding packet due to size mismatch (%1% != %2%)",
+                     size, lengths[i]);
+        }
+    }
+    return n_out;
+}
+
 } // namespace spead2::recv
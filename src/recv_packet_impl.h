@@ -0,0 +1,99 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Vectorised search for special items in a packet. This header file is
+ * included multiple times, with the including code providing different
+ * macros each time (see common_memcpy_impl.h for the rationale).
+ *
+ * The item pointers are byte-swapped and shifted right by the number of
+ * heap address bits, which leaves just the immediate flag and the item ID.
+ * The special items are exactly those for which this is one of the four
+ * values (immediate | HEAP_CNT_ID) to (immediate | PAYLOAD_LENGTH_ID), which
+ * is checked with a subtraction and a mask. The (rare) special items are
+ * then decoded by @ref decode_special.
+ */
+
+namespace spead2::recv
+{
+
+[[gnu::target(SPEAD2_DECODE_TARGET)]]
+int SPEAD2_DECODE_NAME(packet_header &out, const std::uint8_t *pointers) noexcept
+{
+    using T = SPEAD2_DECODE_TYPE;
+    constexpr int lanes = sizeof(T) / sizeof(item_pointer_t);
+    constexpr unsigned int all_lanes = (1U << lanes) - 1;
+    static_assert(HEAP_CNT_ID == 1 && PAYLOAD_LENGTH_ID == 4, "special item IDs must be contiguous");
+
+    const int n_items = out.n_items;
+    const int item_id_bits = 8 * sizeof(item_pointer_t) - out.heap_address_bits;
+    const item_pointer_t base = (item_pointer_t(1) << (item_id_bits - 1)) | HEAP_CNT_ID;
+    const pointer_decoder decoder(out.heap_address_bits);
+    const T bswap = SPEAD2_DECODE_BSWAP;
+    const __m128i shift = _mm_cvtsi32_si128(out.heap_address_bits);
+    const T base_v = SPEAD2_DECODE_SET1(base);
+    const T three = SPEAD2_DECODE_SET1(3);
+    const T zero = SPEAD2_DECODE_SETZERO();
+
+    int first_regular = n_items;
+    int i = 0;
+    for (; i + lanes <= n_items; i += lanes)
+    {
+        T p = SPEAD2_DECODE_LOAD((const T *) (pointers + i * sizeof(item_pointer_t)));
+        p = SPEAD2_DECODE_SHUFFLE(p, bswap);
+        T offset = SPEAD2_DECODE_SUB(SPEAD2_DECODE_SRL(p, shift), base_v);
+        T special = SPEAD2_DECODE_CMPEQ(SPEAD2_DECODE_ANDNOT(three, offset), zero);
+        unsigned int mask = SPEAD2_DECODE_MOVEMASK(special);
+        if (mask != all_lanes && first_regular == n_items)
+            first_regular = i + __builtin_ctz(~mask);
+        while (mask)
+        {
+            int lane = __builtin_ctz(mask);
+            mask &= mask - 1;
+            decode_special(out, decoder, load_be<item_pointer_t>(
+                pointers + (i + lane) * sizeof(item_pointer_t)));
+        }
+    }
+#if SPEAD2_DECODE_VZEROUPPER
+    _mm256_zeroupper();
+#endif
+    for (; i < n_items; i++)
+    {
+        item_pointer_t pointer = load_be<item_pointer_t>(pointers + i * sizeof(item_pointer_t));
+        if (!decode_special(out, decoder, pointer))
+            first_regular = std::min(first_regular, i);
+    }
+    return first_regular;
+}
+
+} // namespace spead2::recv
+
+#undef SPEAD2_DECODE_NAME
+#undef SPEAD2_DECODE_TARGET
+#undef SPEAD2_DECODE_TYPE
+#undef SPEAD2_DECODE_BSWAP
+#undef SPEAD2_DECODE_LOAD
+#undef SPEAD2_DECODE_SHUFFLE
+#undef SPEAD2_DECODE_SRL
+#undef SPEAD2_DECODE_SUB
+#undef SPEAD2_DECODE_ANDNOT
+#undef SPEAD2_DECODE_CMPEQ
+#undef SPEAD2_DECODE_SET1
+#undef SPEAD2_DECODE_SETZERO
+#undef SPEAD2_DECODE_MOVEMASK
+#undef SPEAD2_DECODE_VZEROUPPER
@@ -0,0 +1,358 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <cstddef>
+#include <algorithm>
+#include <exception>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <chrono>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <spead2/common_logging.h>
+#include <spead2/common_raw_packet.h>
+#include <spead2/recv_pcap_writer.h>
+
+namespace spead2::recv
+{
+
+namespace
+{
+
+// See https://wiki.wireshark.org/Development/LibpcapFileFormat
+struct pcap_file_header
+{
+    std::uint32_t magic_number;
+    std::uint16_t version_major;
+    std::uint16_t version_minor;
+    std::int32_t thiszone;
+    std::uint32_t sigfigs;
+    std::uint32_t snaplen;
+    std::uint32_t network;
+};
+
+struct pcap_record_header
+{
+    std::uint32_t ts_sec;
+    std::uint32_t ts_nsec;
+    std::uint32_t incl_len;
+    std::uint32_t orig_len;
+};
+
+static constexpr std::size_t frame_header_size =
+    ethernet_frame::min_size + ipv4_packet::min_size + udp_packet::min_size;
+// Largest frame whose IPv4 total length fits in 16 bits
+static constexpr std::size_t max_frame_size = ethernet_frame::min_size + 65535;
+static constexpr std::size_t max_record_size = sizeof(pcap_record_header) + max_frame_size;
+
+static void write_all(int fd, const std::uint8_t *data, std::size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t ret = ::write(fd, data, length);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw_errno("write failed");
+        }
+        data += ret;
+        length -= ret;
+    }
+}
+
+// Write a record for a packet at @a ptr, which must have enough space
+static void write_record(
+    std::uint8_t *ptr, const std::uint8_t *data, std::size_t length, std::int64_t ns)
+{
+    std::size_t frame_size = frame_header_size + length;
+    pcap_record_header record;
+    record.ts_sec = ns / 1000000000;
+    record.ts_nsec = ns % 1000000000;
+    record.incl_len = frame_size;
+    record.orig_len = frame_size;
+    std::memcpy(ptr, &record, sizeof(record));
+    ptr += sizeof(record);
+
+    std::memset(ptr, 0, frame_header_size);
+    ethernet_frame eth(ptr, frame_size);
+    eth.ethertype(ipv4_packet::ethertype);
+    ipv4_packet ipv4 = eth.payload_ipv4();
+    ipv4.version_ihl(0x45);
+    ipv4.total_length(ipv4.size());
+    ipv4.flags_frag_off(ipv4_packet::flag_do_not_fragment);
+    ipv4.ttl(1);
+    ipv4.protocol(udp_packet::protocol);
+    ipv4.update_checksum();
+    udp_packet udp = ipv4.payload_udp();
+    udp.length(udp.size());
+    std::memcpy(ptr + frame_header_size, data, length);
+}
+
+} // anonymous namespace
+
+pcap_writer::pcap_writer(const std::string &filename, std::size_t buffer_size, std::size_t buffers)
+    : buffer_size(buffer_size), n_buffers(buffers), max_buffers(buffers)
+{
+    if (buffers < 2)
+        throw std::invalid_argument("at least 2 buffers are required");
+    if (buffer_size < max_record_size)
+        throw std::invalid_argument("buffer_size is too small");
+    fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0)
+        throw_errno("open failed");
+
+    pcap_file_header header;
+    header.magic_number = 0xa1b23c4d;   // nanosecond resolution
+    header.version_major = 2;
+    header.version_minor = 4;
+    header.thiszone = 0;
+    header.sigfigs = 0;
+    header.snaplen = max_frame_size;
+    header.network = 1;   // DLT_EN10MB
+    try
+    {
+        write_all(fd, reinterpret_cast<const std::uint8_t *>(&header), sizeof(header));
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+
+    for (std::size_t i = 0; i < buffers; i++)
+    {
+        buffer b;
+        b.data = std::make_unique<std::uint8_t[]>(buffer_size);
+        free_buffers.push_back(std::move(b));
+    }
+    writer_future = std::async(std::launch::async, [this] { writer_thread(); });
+}
+
+pcap_writer::~pcap_writer()
+{
+    try
+    {
+        close();
+    }
+    catch (std::exception &e)
+    {
+        log_warning("error closing pcap file: %1%", e.what());
+    }
+}
+
+void pcap_writer::writer_thread()
+{
+    std::exception_ptr error;
+    while (true)
+    {
+        buffer b;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            full_cond.wait(lock, [this] { return stopping || !full_buffers.empty(); });
+            if (full_buffers.empty())
+                break;
+            b = std::move(full_buffers.front());
+            full_buffers.pop_front();
+        }
+        /* After an error, keep recycling buffers (without writing them) so
+         * that sources are not left holding full buffers.
+         */
+        if (!error)
+        {
+            try
+            {
+                write_all(fd, b.data.get(), b.length);
+            }
+            catch (std::exception &e)
+            {
+                error = std::current_exception();
+                failed.store(true, std::memory_order_relaxed);
+                log_warning("error writing pcap file, further packets will be dropped: %1%", e.what());
+            }
+        }
+        release_buffer(std::move(b));
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+pcap_writer::buffer pcap_writer::get_buffer()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_buffers.empty())
+        return buffer();
+    buffer b = std::move(free_buffers.back());
+    free_buffers.pop_back();
+    return b;
+}
+
+void pcap_writer::release_buffer(buffer &&b)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (n_buffers > max_buffers)
+    {
+        // A source has gone away, so we have a spare. The caller frees it.
+        n_buffers--;
+        return;
+    }
+    b.length = 0;
+    free_buffers.push_back(std::move(b));
+}
+
+void pcap_writer::submit_buffer(buffer &&b)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!stopping)
+        {
+            full_buffers.push_back(std::move(b));
+            full_cond.notify_one();
+            return;
+        }
+    }
+    release_buffer(std::move(b));
+}
+
+void pcap_writer::add_packet(const std::uint8_t *data, std::size_t length)
+{
+    std::call_once(direct_source_once, [this] { direct_source = std::make_unique<source>(*this); });
+    direct_source->add_packet(data, length);
+}
+
+void pcap_writer::flush()
+{
+    std::lock_guard<std::mutex> sources_lock(sources_mutex);
+    for (source *s : sources)
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->flush_unlocked();
+    }
+}
+
+void pcap_writer::close()
+{
+    if (closed.exchange(true))
+        return;
+    /* Sources check closed while holding their mutex, so once we've taken
+     * each mutex here no further packets will be added.
+     */
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    // Let the writer thread drain the queue and exit
+    full_cond.notify_all();
+    try
+    {
+        writer_future.get();
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+    if (::close(fd) != 0)
+        throw_errno("close failed");
+}
+
+pcap_writer::source::source(pcap_writer &owner)
+    : owner(owner)
+{
+    buffer b;
+    b.data = std::make_unique<std::uint8_t[]>(owner.buffer_size);
+    std::lock_guard<std::mutex> sources_lock(owner.sources_mutex);
+    owner.sources.push_back(this);
+    std::lock_guard<std::mutex> lock(owner.mutex);
+    owner.free_buffers.push_back(std::move(b));
+    owner.n_buffers++;
+    owner.max_buffers++;
+}
+
+pcap_writer::source::~source()
+{
+    buffer spare;   // freed after releasing the locks
+    std::lock_guard<std::mutex> sources_lock(owner.sources_mutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        flush_unlocked();
+    }
+    owner.sources.erase(std::find(owner.sources.begin(), owner.sources.end(), this));
+    std::lock_guard<std::mutex> lock(owner.mutex);
+    owner.max_buffers--;
+    // If our buffer is in use, it is freed by release_buffer instead
+    if (!owner.free_buffers.empty())
+    {
+        spare = std::move(owner.free_buffers.back());
+        owner.free_buffers.pop_back();
+        owner.n_buffers--;
+    }
+}
+
+void pcap_writer::source::flush_unlocked()
+{
+    if (cur_buffer.data)
+    {
+        if (cur_buffer.length > 0)
+            owner.submit_buffer(std::move(cur_buffer));
+        else
+            owner.release_buffer(std::move(cur_buffer));
+        cur_buffer = buffer();
+    }
+}
+
+void pcap_writer::source::add_packet(const std::uint8_t *data, std::size_t length)
+{
+    std::size_t frame_size = frame_header_size + length;
+    if (frame_size > max_frame_size || owner.failed.load(std::memory_order_relaxed))
+    {
+        owner.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (owner.closed.load(std::memory_order_relaxed))
+    {
+        owner.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    std::size_t record_size = sizeof(pcap_record_header) + frame_size;
+    if (cur_buffer.data && owner.buffer_size - cur_buffer.length < record_size)
+        flush_unlocked();
+    if (!cur_buffer.data)
+    {
+        cur_buffer = owner.get_buffer();
+        if (!cur_buffer.data)
+        {
+            owner.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    write_record(cur_buffer.data.get() + cur_buffer.length, data, length, ns);
+    cur_buffer.length += record_size;
+}
+
+} // namespace spead2::recv
@@ -1,4 +1,4 @@
-/* Copyright 2015, 2017-2021, 2023 National Research Foundation (SARAO)
+/* Copyright 2015, 2017-2021, 2023, 2026 National Research Foundation (SARAO)
  *
  * This program is free software: you can redistribute it and/or modify it under
  * the terms of the GNU Lesser General Public License as published by the Free
@@ -19,11 +19,16 @@
  */
 
 #include <cstddef>
+#include <cstdint>
+#include <array>
 #include <utility>
 #include <algorithm>
 #include <cassert>
 #include <atomic>
 #include <new>
+#include <cstring>
+#include <stdexcept>
+#include <memory>
 #include <spead2/recv_stream.h>
 #include <spead2/recv_live_heap.h>
 #include <spead2/common_memcpy.h>
@@ -112,6 +117,7 @@ static std::shared_ptr<const std::vector<stream_stat_config>> make_default_stats
     // For backwards compatibility, worker_blocked is always stats->emplace_backed, although
     // it is not part of the base stream statistics
     stats->emplace_back("worker_blocked", stream_stat_config::mode::COUNTER);
+    stats->emplace_back("metadata_allocations", stream_stat_config::mode::COUNTER);
     assert(stats->size() == stream_stat_indices::custom);
     return stats;
 }
@@ -251,6 +257,120 @@ static void packet_memcpy_nontemporal(const spead2::memory_allocator::pointer &a
     spead2::memcpy_nontemporal(allocation.get() + packet.payload_offset, packet.payload, packet.payload_length);
 }
 
+packet_memcpy_scatter::packet_memcpy_scatter(
+    std::size_t row_size, std::size_t row_stride, memcpy_function_id id)
+    : row_size(row_size), row_stride(row_stride), id(id)
+{
+    if (row_size == 0)
+        throw std::invalid_argument("row_size cannot be 0");
+    if (row_stride < row_size)
+        throw std::invalid_argument("row_stride cannot be less than row_size");
+    if (id != MEMCPY_STD && id != MEMCPY_NONTEMPORAL)
+        throw std::invalid_argument("Unknown memcpy function");
+}
+
+template<typename Copy>
+void packet_memcpy_scatter::copy(
+    std::uint8_t *base, const packet_header &packet, const Copy &copy_row) const
+{
+    const std::uint8_t *src = packet.payload;
+    std::size_t remaining = packet.payload_length;
+    std::size_t row = packet.payload_offset / row_size;
+    std::size_t col = packet.payload_offset - row * row_size;
+    std::uint8_t *dst = base + row * row_stride + col;
+    // The first row may be partial if the packet isn't aligned to rows
+    std::size_t n = std::min(remaining, row_size - col);
+    while (remaining > 0)
+    {
+        copy_row(dst, src, n);
+        src += n;
+        remaining -= n;
+        dst += row_stride - col;
+        col = 0;
+        n = std::min(remaining, row_size);
+    }
+}
+
+void packet_memcpy_scatter::operator()(
+    const memory_allocator::pointer &allocation, const packet_header &packet) const
+{
+    std::uint8_t *base = allocation.get();
+    if (id == MEMCPY_NONTEMPORAL)
+    {
+        copy(base, packet, [](std::uint8_t *dst, const std::uint8_t *src, std::size_t n)
+        {
+            spead2::memcpy_nontemporal(dst, src, n);
+        });
+    }
+    else
+    {
+        copy(base, packet, [](std::uint8_t *dst, const std::uint8_t *src, std::size_t n)
+        {
+            std::memcpy(dst, src, n);
+        });
+    }
+}
+
+std::size_t packet_memcpy_scatter::get_allocation_size(std::size_t heap_length) const
+{
+    if (heap_length == 0)
+        return 0;
+    std::size_t last_row = (heap_length - 1) / row_size;
+    return last_row * row_stride + (heap_length - last_row * row_size);
+}
+
+packet_memcpy_convert::packet_memcpy_convert(convert_function_id id)
+    : id(id),
+    convert(get_convert_function(id)),
+    input_size(get_convert_input_size(id)),
+    output_size(get_convert_output_size(id))
+{
+}
+
+std::size_t packet_memcpy_convert::get_allocation_size(std::size_t heap_length) const
+{
+    return (heap_length + input_size - 1) / input_size * output_size;
+}
+
+void packet_memcpy_convert::copy_partial(
+    std::uint8_t *dest, std::size_t offset, const std::uint8_t *src, std::size_t length) const
+{
+    /* Only byte swaps can be applied one byte at a time. Streams reject
+     * packets that would need this for other conversions.
+     */
+    if (input_size != output_size)
+        return;
+    for (std::size_t i = 0; i < length; i++)
+    {
+        std::size_t pos = offset + i;
+        std::size_t lane = pos & (input_size - 1);
+        dest[pos - lane + input_size - 1 - lane] = src[i];
+    }
+}
+
+void packet_memcpy_convert::operator()(
+    const memory_allocator::pointer &allocation, const packet_header &packet) const
+{
+    std::uint8_t *dest = allocation.get();
+    const std::uint8_t *src = packet.payload;
+    std::size_t offset = packet.payload_offset;
+    std::size_t length = packet.payload_length;
+    // Element sizes are all powers of two
+    std::size_t head = std::min(length, (input_size - (offset & (input_size - 1))) & (input_size - 1));
+    if (head > 0)
+    {
+        copy_partial(dest, offset, src, head);
+        src += head;
+        offset += head;
+        length -= head;
+    }
+    std::size_t n = length / input_size;
+    convert(dest + offset / input_size * output_size, src, n);
+    std::size_t tail = length - n * input_size;
+    if (tail > 0)
+        copy_partial(dest, offset + n * input_size, src + n * input_size, tail);
+}
+
 stream_config::stream_config()
     : memcpy(packet_memcpy_std),
     allocator(std::make_shared<memory_allocator>()),
@@ -274,6 +394,14 @@ stream_config &stream_config::set_substreams(std::size_t substreams)
     return *this;
 }
 
+stream_config &stream_config::set_shards(std::size_t shards)
+{
+    if (shards == 0)
+        throw std::invalid_argument("shards cannot be 0");
+    this->shards = shards;
+    return *this;
+}
+
 stream_config &stream_config::set_bug_compat(bug_compat_mask bug_compat)
 {
     if (bug_compat & ~BUG_COMPAT_PYSPEAD_0_5_2)
@@ -357,6 +485,12 @@ stream_config &stream_config::set_explicit_start(bool explicit_start)
     return *this;
 }
 
+stream_config &stream_config::set_packet_tap(std::shared_ptr<pcap_writer> packet_tap)
+{
+    this->packet_tap = std::move(packet_tap);
+    return *this;
+}
+
 std::size_t stream_config::add_stat(std::string name, stream_stat_config::mode mode)
 {
     if (spead2::recv::get_stat_index_nothrow(*stats, name) != stats->size())
@@ -377,19 +511,39 @@ std::size_t stream_config::get_stat_index(const std::string &name) const
 
 stream_base::stream_base(const stream_config &config)
     : queue_storage(new queue_entry[config.get_max_heaps() * config.get_substreams()]),
-    bucket_count(compute_bucket_count(config.get_max_heaps() * config.get_substreams())),
+    bucket_count(compute_bucket_count(
+        config.get_max_heaps() * config.get_substreams() / config.get_shards())),
     bucket_shift(compute_bucket_shift(bucket_count)),
-    buckets(new queue_entry *[bucket_count]),
+    buckets(new queue_entry *[bucket_count * config.get_shards()]),
     substreams(new substream[config.get_substreams() + 1]),
     substream_div(config.get_substreams()),
+    shards(new shard[config.get_shards()]),
+    shard_div(config.get_shards()),
     config(config),
-    shared(std::make_shared<shared_state>(this)),
+    heap_storage_pool(std::make_shared<detail::live_heap_storage_pool>()),
+    shared(std::make_shared<shared_state>(this, config.get_shards() > 1)),
     stats(config.get_stats().size()),
     batch_stats(config.get_stats().size())
 {
+    if (config.get_substreams() % config.get_shards() != 0)
+        throw std::invalid_argument("substreams must be a multiple of shards");
+    /* Chunk streams wrap the memcpy function, so seeing one of these here
+     * means that this is some other stream, whose heaps would have item
+     * pointers that don't match the scattered or converted layout.
+     */
+    if (config.get_memcpy().target<packet_memcpy_scatter>())
+        throw std::invalid_argument("packet_memcpy_scatter is only supported by chunk streams");
+    if (auto convert = config.get_memcpy().target<packet_memcpy_convert>();
+        convert && convert->get_packet_alignment() != 1)
+        throw std::invalid_argument("widening packet_memcpy_convert is only supported by chunk streams");
+    if (config.get_shards() > 1 && config.get_stats().size() > stream_stat_indices::custom)
+        throw std::invalid_argument("custom statistics are not supported with multiple shards");
     for (std::size_t i = 0; i < config.get_max_heaps() * config.get_substreams(); i++)
+    {
         queue_storage[i].next = INVALID_ENTRY;
-    for (std::size_t i = 0; i < bucket_count; i++)
+        queue_storage[i].constructed = false;
+    }
+    for (std::size_t i = 0; i < bucket_count * config.get_shards(); i++)
         buckets[i] = NULL;
     for (std::size_t i = 0; i <= config.get_substreams(); i++)
     {
@@ -404,17 +558,40 @@ stream_base::~stream_base()
     {
         queue_entry *entry = &queue_storage[i];
         if (entry->next != INVALID_ENTRY)
-        {
             unlink_entry(entry);
+        if (entry->constructed)
             entry->heap.destroy();
-        }
     }
 }
 
-std::size_t stream_base::get_bucket(item_pointer_t heap_cnt) const
+void stream_base::enable_direct_packets()
+{
+    if (config.get_shards() > 1)
+        throw std::invalid_argument("direct packet handling is not supported with multiple shards");
+    direct_packets = true;
+}
+
+void stream_base::set_packet_alignment(const packet_memcpy_function &memcpy, std::size_t stat_index)
+{
+    if (auto convert = memcpy.target<packet_memcpy_convert>())
+        packet_alignment = convert->get_packet_alignment();
+    else
+        packet_alignment = 1;
+    misaligned_packets_stat = stat_index;
+}
+
+bool stream_base::is_heap_live(s_item_pointer_t heap_cnt) const
+{
+    for (const queue_entry *entry = buckets[get_bucket(heap_cnt)]; entry; entry = entry->next)
+        if (entry->heap->get_cnt() == heap_cnt)
+            return true;
+    return false;
+}
+
+std::size_t stream_base::get_bucket(item_pointer_t heap_cnt, std::size_t shard_id) const
 {
     // Look up Fibonacci hashing for an explanation of the magic number
-    return (heap_cnt * 11400714819323198485ULL) >> bucket_shift;
+    return shard_id * bucket_count + ((heap_cnt * 11400714819323198485ULL) >> bucket_shift);
 }
 
 std::size_t stream_base::get_substream(item_pointer_t heap_cnt) const
@@ -423,6 +600,16 @@ std::size_t stream_base::get_substream(item_pointer_t heap_cnt) const
     return heap_cnt - (heap_cnt / substream_div * config.get_substreams());
 }
 
+std::size_t stream_base::get_shard(item_pointer_t heap_cnt) const
+{
+    if (config.get_shards() == 1)
+        return 0;   // Avoid the division in the common case
+    /* Because substreams is a multiple of shards, this is equivalent to
+     * get_substream(heap_cnt) % shards.
+     */
+    return heap_cnt - (heap_cnt / shard_div * config.get_shards());
+}
+
 void stream_base::unlink_entry(queue_entry *entry)
 {
     assert(entry->next != INVALID_ENTRY);
@@ -438,12 +625,26 @@ void stream_base::unlink_entry(queue_entry *entry)
 }
 
 stream_base::add_packet_state::add_packet_state(shared_state &owner)
-    : lock(owner.queue_mutex), owner(owner.self)
+    : shared(owner)
 {
+    if (owner.sharded)
+    {
+        // Let a waiting exclusive_lock go first (see shared_state::exclusive_pending)
+        if (owner.exclusive_pending)
+        {
+            std::lock_guard<std::mutex> gate_lock(owner.shard_gate);
+        }
+        shared_lock = std::shared_lock<std::shared_mutex>(owner.shard_mutex);
+    }
+    else
+        lock = std::unique_lock<std::mutex>(owner.queue_mutex);
+    this->owner = owner.self;
     if (this->owner)
     {
         stopped = this->owner->stopped;
-        std::fill(this->owner->batch_stats.begin(), this->owner->batch_stats.end(), 0);
+        // With multiple shards there are no custom stats, so batch_stats is unused
+        if (!owner.sharded)
+            std::fill(this->owner->batch_stats.begin(), this->owner->batch_stats.end(), 0);
     }
     else
     {
@@ -453,10 +654,48 @@ stream_base::add_packet_state::add_packet_state(shared_state &owner)
 
 stream_base::add_packet_state::~add_packet_state()
 {
-    if (owner && stopped)
-        owner->stop_received();
-    if (!owner || (!packets && is_stopped()))
-        return;   // Stream was stopped before we could do anything - don't count as a batch
+    if (shared.sharded)
+    {
+        if (shard_lock)
+            shard_lock.unlock();
+        if (owner && (packets || !is_stopped()))
+            update_stats();
+        /* Stopping the stream requires exclusive access, which can only be
+         * obtained once the shared lock is released. In the meantime another
+         * thread may have stopped the stream, so check again.
+         */
+        bool stop_stream = owner && stopped;
+        shared_lock.unlock();
+        if (stop_stream)
+        {
+            exclusive_lock lock(shared);
+            if (shared.self)
+                shared.self->stop_unlocked();
+        }
+    }
+    else
+    {
+        if (owner && stopped)
+            owner->stop_received();
+        if (!owner || (!packets && is_stopped()))
+            return;   // Stream was stopped before we could do anything - don't count as a batch
+        update_stats();
+    }
+}
+
+void stream_base::add_packet_state::lock_shard(std::size_t shard_id)
+{
+    if (!shard_lock || this->shard_id != shard_id)
+    {
+        if (shard_lock)
+            shard_lock.unlock();
+        shard_lock = std::unique_lock<std::mutex>(owner->shards[shard_id].mutex);
+        this->shard_id = shard_id;
+    }
+}
+
+void stream_base::add_packet_state::update_stats()
+{
     std::lock_guard<std::mutex> stats_lock(owner->stats_mutex);
     // The built-in stats are updated directly; batch_stats is not used
     owner->stats[stream_stat_indices::packets] += packets;
@@ -465,6 +704,7 @@ stream_base::add_packet_state::~add_packet_state()
     owner->stats[stream_stat_indices::incomplete_heaps_evicted] += incomplete_heaps_evicted;
     owner->stats[stream_stat_indices::single_packet_heaps] += single_packet_heaps;
     owner->stats[stream_stat_indices::search_dist] += search_dist;
+    owner->stats[stream_stat_indices::metadata_allocations] += metadata_allocations;
     auto &owner_max_batch = owner->stats[stream_stat_indices::max_batch];
     owner_max_batch = std::max(owner_max_batch, packets);
     // Update custom statistics
@@ -483,18 +723,48 @@ bool stream_base::add_packet(add_packet_state &state, const packet_header &packe
         log_info("packet rejected because it has no HEAP_LEN");
         return false;
     }
+    if (!is_packet_aligned(packet))
+    {
+        log_info("packet rejected because its payload is not aligned to the memcpy elements");
+        batch_stats[misaligned_packets_stat]++;
+        return false;
+    }
+
+    if (direct_packets)
+    {
+        if (packet.heap_length >= 0 && packet.payload_length == packet.heap_length)
+            state.single_packet_heaps++;
+        direct_packet_result result = add_packet_direct(packet);
+        state.complete_heaps += result.heap_complete;
+        state.incomplete_heaps_evicted += result.heap_evicted;
+        if (result.end_of_stream)
+            state.stop();
+        return result.added;
+    }
 
     // Look for matching heap.
     queue_entry *entry = NULL;
     s_item_pointer_t heap_cnt = packet.heap_cnt;
-    std::size_t bucket_id = get_bucket(heap_cnt);
-    assert(bucket_id < bucket_count);
+    std::size_t shard_id = get_shard(heap_cnt);
+    if (state.shared.sharded)
+        state.lock_shard(shard_id);
+    std::size_t bucket_id = get_bucket(heap_cnt, shard_id);
+    assert(bucket_id < bucket_count * config.get_shards());
     if (packet.heap_length >= 0 && packet.payload_length == packet.heap_length)
     {
         // Packet is a complete heap, so it shouldn't match any partial heap.
         entry = NULL;
         state.single_packet_heaps++;
     }
+    else if (state.last_entry
+             && state.last_heap_cnt == heap_cnt
+             && state.last_shard_id == shard_id
+             && state.last_entry->next != INVALID_ENTRY
+             && state.last_entry->heap->get_cnt() == heap_cnt)
+    {
+        // Same heap as a recent packet, so no need to search
+        entry = state.last_entry;
+    }
     else
     {
         int search_dist = 1;
@@ -531,19 +801,30 @@ bool stream_base::add_packet(add_packet_state &state, const packet_header &packe
         {
             state.incomplete_heaps_evicted++;
             unlink_entry(entry);
-            heap_ready(std::move(*entry->heap));
-            entry->heap.destroy();
+            heap_ready(entry->heap->take(heap_storage_pool));
         }
         entry->next = buckets[bucket_id];
         buckets[bucket_id] = entry;
-        entry->heap.construct(packet, config.get_bug_compat());
+        if (entry->constructed)
+            entry->heap->reset(packet, config.get_bug_compat());
+        else
+        {
+            entry->heap.construct(packet, config.get_bug_compat());
+            entry->constructed = true;
+        }
     }
 
+    state.last_entry = entry;
+    state.last_heap_cnt = heap_cnt;
+    state.last_shard_id = shard_id;
     live_heap *h = entry->heap.get();
     bool result = false;
     bool end_of_stream = false;
-    if (h->add_packet(packet, config.get_memcpy(), *config.get_memory_allocator(),
-                      config.get_allow_out_of_order()))
+    std::size_t old_allocations = h->get_allocations();
+    bool added = h->add_packet(packet, config.get_memcpy(), *config.get_memory_allocator(),
+                               config.get_allow_out_of_order());
+    state.metadata_allocations += h->get_allocations() - old_allocations;
+    if (added)
     {
         result = true;
         end_of_stream = config.get_stop_on_stop_item() && h->is_end_of_stream();
@@ -553,9 +834,10 @@ bool stream_base::add_packet(add_packet_state &state, const packet_header &packe
             if (!end_of_stream)
             {
                 state.complete_heaps++;
-                heap_ready(std::move(*h));
+                heap_ready(h->take(heap_storage_pool));
             }
-            entry->heap.destroy();
+            else
+                h->reset();   // Release the payload, but keep the heap for reuse
         }
     }
 
@@ -564,6 +846,76 @@ bool stream_base::add_packet(add_packet_state &state, const packet_header &packe
     return result;
 }
 
+std::size_t stream_base::add_packets(
+    add_packet_state &state, const packet_header *packets, std::size_t n_packets)
+{
+    /* Packets are processed in windows of this size, so that a bitmask can
+     * record which packets in the window have already been added.
+     */
+    constexpr std::size_t window = packet_window;
+    static_assert(window <= 64, "window must fit in the bitmask");
+    /* Packets from the same heap are chained together (in order) in a
+     * single pass, using a hash table keyed by heap cnt that holds the last
+     * packet seen for each heap. It has twice as many slots as the window
+     * so that probe sequences stay short, and can never fill up.
+     */
+    constexpr int table_bits = 7;
+    constexpr std::size_t table_size = std::size_t(1) << table_bits;
+    static_assert(table_size >= 2 * window, "hash table is too small");
+    std::array<std::uint8_t, table_size> table;
+    std::array<std::uint8_t, window> next;   // next packet in the same heap, or window if none
+    std::size_t consumed = 0;
+    for (std::size_t start = 0; start < n_packets && !state.is_stopped(); start += window)
+    {
+        std::size_t end = std::min(start + window, n_packets);
+        const packet_header *base = packets + start;
+        prepare_packets(base, end - start);
+
+        std::uint64_t table_used[table_size / 64] = {};
+        for (std::size_t i = 0; i < end - start; i++)
+        {
+            next[i] = window;
+            const packet_header &packet = base[i];
+            if (packet.heap_length >= 0 && packet.payload_length == packet.heap_length)
+                continue;   // Single-packet heap, so there can't be other packets for it
+            // Fibonacci hashing
+            std::size_t h = (std::uint64_t(packet.heap_cnt) * 0x9E3779B97F4A7C15ULL) >> (64 - table_bits);
+            while (true)
+            {
+                std::uint64_t mask = std::uint64_t(1) << (h % 64);
+                if (!(table_used[h / 64] & mask))
+                {
+                    table_used[h / 64] |= mask;
+                    table[h] = i;
+                    break;
+                }
+                else if (base[table[h]].heap_cnt == packet.heap_cnt)
+                {
+                    next[table[h]] = i;
+                    table[h] = i;
+                    break;
+                }
+                h = (h + 1) % table_size;
+            }
+        }
+
+        std::uint64_t done = 0;
+        for (std::size_t i = 0; i < end - start && !state.is_stopped(); i++)
+        {
+            if (done & (std::uint64_t(1) << i))
+                continue;
+            // Add this packet and the remaining packets from the same heap
+            for (std::size_t j = i; j != window && !state.is_stopped(); j = next[j])
+            {
+                done |= std::uint64_t(1) << j;
+                consumed += add_packet(state, base[j]);
+            }
+        }
+    }
+    prepare_packets(nullptr, 0);
+    return consumed;
+}
+
 void stream_base::flush_unlocked()
 {
     const std::size_t num_substreams = get_config().get_substreams();
@@ -581,11 +933,12 @@ void stream_base::flush_unlocked()
             {
                 n_flushed++;
                 unlink_entry(entry);
-                heap_ready(std::move(*entry->heap));
-                entry->heap.destroy();
+                heap_ready(entry->heap->take(heap_storage_pool));
             }
         }
     }
+    if (direct_packets)
+        n_flushed += flush_direct();
     std::lock_guard<std::mutex> stats_lock(stats_mutex);
     stats[stream_stat_indices::heaps] += n_flushed;
     stats[stream_stat_indices::incomplete_heaps_flushed] += n_flushed;
@@ -593,7 +946,7 @@ void stream_base::flush_unlocked()
 
 void stream_base::flush()
 {
-    std::lock_guard<std::mutex> lock(shared->queue_mutex);
+    exclusive_lock lock(*shared);
     flush_unlocked();
 }
 
@@ -605,7 +958,7 @@ void stream_base::stop_unlocked()
 
 void stream_base::stop()
 {
-    std::lock_guard<std::mutex> lock(shared->queue_mutex);
+    exclusive_lock lock(*shared);
     stop_unlocked();
 }
 
@@ -28,12 +28,20 @@
 # include <unistd.h>
 # include <netinet/udp.h>
 #endif
+#if SPEAD2_USE_REUSEPORT_CBPF
+# include <linux/filter.h>
+#endif
+#include <sys/socket.h>
 #include <system_error>
+#include <cerrno>
 #include <cstdint>
 #include <cstring>
 #include <cstdlib>
 #include <mutex>
 #include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 #include <boost/asio.hpp>
 #include <boost/lexical_cast.hpp>
 #include <spead2/recv_stream.h>
@@ -46,19 +54,44 @@
 namespace spead2::recv
 {
 
+udp_poll_config &udp_poll_config::set_max_poll(int max_poll)
+{
+    if (max_poll < 1)
+        throw std::invalid_argument("max_poll must be at least 1");
+    this->max_poll = max_poll;
+    return *this;
+}
+
+udp_poll_config &udp_poll_config::set_busy_poll(int busy_poll)
+{
+    if (busy_poll < 0)
+        throw std::invalid_argument("busy_poll cannot be negative");
+    this->busy_poll = busy_poll;
+    return *this;
+}
+
+udp_poll_config &udp_poll_config::set_prefer_busy_poll(bool prefer_busy_poll)
+{
+    this->prefer_busy_poll = prefer_busy_poll;
+    return *this;
+}
+
 udp_reader::udp_reader(
     stream &owner,
     boost::asio::ip::udp::socket &&socket,
-    std::size_t max_size)
+    std::size_t max_size,
+    const udp_poll_config &poll_config)
     : udp_reader_base(owner), max_size(max_size),
 #if SPEAD2_USE_RECVMMSG
     buffers(mmsg_count), msgvec(mmsg_count), use_gro(false),
 #else
     buffer(new std::uint8_t[max_size + 1]),
 #endif
-    socket(std::move(socket))
+    socket(std::move(socket)),
+    max_poll(poll_config.get_max_poll())
 {
     assert(socket_uses_io_service(this->socket, get_io_service()));
+    set_busy_poll_options(poll_config);
 #if SPEAD2_USE_RECVMMSG
     // Allocate one extra byte so that overflow can be detected.
     size_t buffer_size = max_size + 1;
@@ -88,79 +121,49 @@ udp_reader::udp_reader(
 #endif
 }
 
-void udp_reader::start()
-{
-    if (bind_endpoint)
-        socket.bind(*bind_endpoint);
-    enqueue_receive(make_handler_context());
-}
-
-static boost::asio::ip::udp::socket make_v4_socket(
-    boost::asio::io_service &io_service,
-    const boost::asio::ip::udp::endpoint &endpoint,
-    std::size_t buffer_size,
-    const boost::asio::ip::address &interface_address)
+void udp_reader::set_busy_poll_options(const udp_poll_config &poll_config)
 {
-    if (!interface_address.is_v4())
-        throw std::invalid_argument("interface address is not an IPv4 address");
-    auto ep = endpoint;
-    if (ep.address().is_unspecified())
-        ep.address(interface_address);
-    if (!ep.address().is_v4())
-        throw std::invalid_argument("endpoint is not an IPv4 address");
-    if (!ep.address().is_multicast() && ep.address() != interface_address)
-        throw std::invalid_argument("endpoint is not multicast and does not match interface address");
-    boost::asio::ip::udp::socket socket(io_service, ep.protocol());
-    if (ep.address().is_multicast())
+    int busy_poll = poll_config.get_busy_poll();
+    if (busy_poll > 0)
     {
-        socket.set_option(boost::asio::socket_base::reuse_address(true));
-        socket.set_option(boost::asio::ip::multicast::join_group(
-            ep.address().to_v4(), interface_address.to_v4()));
+#ifdef SO_BUSY_POLL
+        if (setsockopt(socket.native_handle(), SOL_SOCKET, SO_BUSY_POLL,
+                       &busy_poll, sizeof(busy_poll)) == -1)
+            log_warning("failed to set SO_BUSY_POLL: %1%", std::strerror(errno));
+#else
+        log_warning("SO_BUSY_POLL is not supported on this platform");
+#endif
+    }
+    if (poll_config.get_prefer_busy_poll())
+    {
+#ifdef SO_PREFER_BUSY_POLL
+        int enable = 1;
+        if (setsockopt(socket.native_handle(), SOL_SOCKET, SO_PREFER_BUSY_POLL,
+                       &enable, sizeof(enable)) == -1)
+            log_warning("failed to set SO_PREFER_BUSY_POLL: %1%", std::strerror(errno));
+#else
+        log_warning("SO_PREFER_BUSY_POLL is not supported on this platform");
+#endif
     }
-    set_socket_recv_buffer_size(socket, buffer_size);
-    return socket;
-}
-
-static boost::asio::ip::udp::socket make_multicast_v6_socket(
-    boost::asio::io_service &io_service,
-    const boost::asio::ip::udp::endpoint &endpoint,
-    std::size_t buffer_size,
-    unsigned int interface_index)
-{
-    if (!endpoint.address().is_v6() || !endpoint.address().is_multicast())
-        throw std::invalid_argument("endpoint is not an IPv6 multicast address");
-    boost::asio::ip::udp::socket socket(io_service, endpoint.protocol());
-    socket.set_option(boost::asio::socket_base::reuse_address(true));
-    socket.set_option(boost::asio::ip::multicast::join_group(
-        endpoint.address().to_v6(), interface_index));
-    set_socket_recv_buffer_size(socket, buffer_size);
-    return socket;
 }
 
-static boost::asio::ip::udp::socket make_socket(
-    boost::asio::io_service &io_service,
-    const boost::asio::ip::udp::endpoint &endpoint,
-    std::size_t buffer_size)
+void udp_reader::start()
 {
-    boost::asio::ip::udp::socket socket(io_service, endpoint.protocol());
-    if (endpoint.address().is_multicast())
-    {
-        socket.set_option(boost::asio::socket_base::reuse_address(true));
-        socket.set_option(boost::asio::ip::multicast::join_group(endpoint.address()));
-    }
-    set_socket_recv_buffer_size(socket, buffer_size);
-    return socket;
+    if (bind_endpoint)
+        socket.bind(*bind_endpoint);
+    enqueue_receive(make_handler_context());
 }
 
 udp_reader::udp_reader(
     stream &owner,
     const boost::asio::ip::udp::endpoint &endpoint,
     std::size_t max_size,
-    std::size_t buffer_size)
+    std::size_t buffer_size,
+    const udp_poll_config &poll_config)
     : udp_reader(
         owner,
         make_socket(owner.get_io_service(), endpoint, buffer_size),
-        max_size)
+        max_size, poll_config)
 {
     bind_endpoint = endpoint;
 }
@@ -170,12 +173,13 @@ udp_reader::udp_reader(
     const boost::asio::ip::udp::endpoint &endpoint,
     std::size_t max_size,
     std::size_t buffer_size,
-    const boost::asio::ip::address &interface_address)
+    const boost::asio::ip::address &interface_address,
+    const udp_poll_config &poll_config)
     : udp_reader(
         owner,
         make_v4_socket(owner.get_io_service(),
                        endpoint, buffer_size, interface_address),
-        max_size)
+        max_size, poll_config)
 {
     auto ep = endpoint;
     // Match the logic in make_v4_socket
@@ -189,12 +193,13 @@ udp_reader::udp_reader(
     const boost::asio::ip::udp::endpoint &endpoint,
     std::size_t max_size,
     std::size_t buffer_size,
-    unsigned int interface_index)
+    unsigned int interface_index,
+    const udp_poll_config &poll_config)
     : udp_reader(
         owner,
         make_multicast_v6_socket(owner.get_io_service(),
                                  endpoint, buffer_size, interface_index),
-        max_size)
+        max_size, poll_config)
 {
     bind_endpoint = endpoint;
 }
@@ -205,85 +210,111 @@ void udp_reader::packet_handler(
     const boost::system::error_code &error,
     [[maybe_unused]] std::size_t bytes_transferred)
 {
+    bool need_poll = false;
     if (!error)
     {
 #if SPEAD2_USE_RECVMMSG
+        /* With busy polling, call recvmmsg up to max_poll times. If the
+         * last call still found packets there may be more waiting, so poll
+         * again after giving other handlers on the io_service a turn.
+         */
+        int received = 0;
+        for (int attempt = 0; attempt < max_poll && !state.is_stopped(); attempt++)
+            received = receive_batch(state);
+        need_poll = max_poll > 1 && received > 0;
+#else
+        process_one_packet(state, buffer.get(), bytes_transferred, max_size);
+#endif
+    }
+    else if (error != boost::asio::error::operation_aborted)
+        log_warning("Error in UDP receiver: %1%", error.message());
+
+    if (!state.is_stopped())
+    {
+        enqueue_receive(std::move(ctx), need_poll);
+    }
+}
+
+#if SPEAD2_USE_RECVMMSG
+int udp_reader::receive_batch(stream_base::add_packet_state &state)
+{
 #if SPEAD2_USE_GRO
-        if (use_gro)
+    if (use_gro)
+    {
+        for (std::size_t i = 0; i < msgvec.size(); i++)
         {
-            for (std::size_t i = 0; i < msgvec.size(); i++)
-            {
-                msgvec[i].msg_hdr.msg_control = &buffers[i].control;
-                msgvec[i].msg_hdr.msg_controllen = sizeof(buffers[i].control);
-            }
+            msgvec[i].msg_hdr.msg_control = &buffers[i].control;
+            msgvec[i].msg_hdr.msg_controllen = sizeof(buffers[i].control);
         }
+    }
 #endif
-        int received = recvmmsg(socket.native_handle(), msgvec.data(), msgvec.size(),
-                                MSG_DONTWAIT, nullptr);
-        log_debug("recvmmsg returned %1%", received);
-        if (received == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
-        {
-            std::error_code code(errno, std::system_category());
-            log_warning("recvmmsg failed: %1% (%2%)", code.value(), code.message());
-        }
-        bool stopped = false;
-        for (int i = 0; i < received && !stopped; i++)
-        {
+    int received = recvmmsg(socket.native_handle(), msgvec.data(), msgvec.size(),
+                            MSG_DONTWAIT, nullptr);
+    log_debug("recvmmsg returned %1%", received);
+    if (received == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        std::error_code code(errno, std::system_category());
+        log_warning("recvmmsg failed: %1% (%2%)", code.value(), code.message());
+    }
+    for (int i = 0; i < received; i++)
+    {
 #if SPEAD2_USE_GRO
-            if (use_gro)
+        if (use_gro)
+        {
+            int seg_size = -1;
+            for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msgvec[i].msg_hdr);
+                 cmsg != nullptr;
+                 cmsg = CMSG_NXTHDR(&msgvec[i].msg_hdr, cmsg))
             {
-                int seg_size = -1;
-                for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msgvec[i].msg_hdr);
-                     cmsg != nullptr;
-                     cmsg = CMSG_NXTHDR(&msgvec[i].msg_hdr, cmsg))
+                if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
                 {
-                    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
-                    {
-                        std::memcpy(&seg_size, CMSG_DATA(cmsg), sizeof(seg_size));
-                        break;
-                    }
+                    std::memcpy(&seg_size, CMSG_DATA(cmsg), sizeof(seg_size));
+                    break;
                 }
-                if (seg_size > 0)
+            }
+            if (seg_size > 0)
+            {
+                for (unsigned int offset = 0;
+                     offset < msgvec[i].msg_len;
+                     offset += seg_size)
                 {
-                    for (unsigned int offset = 0;
-                         offset < msgvec[i].msg_len && !stopped;
-                         offset += seg_size)
-                    {
-                        unsigned int msg_len = std::min((unsigned int) seg_size,
-                                                        msgvec[i].msg_len - offset);
-                        stopped = process_one_packet(state,
-                                                     buffers[i].data.get() + offset,
-                                                     msg_len,
-                                                     max_size);
-                    }
-                    continue;  // Skip the non-GRO code below
+                    unsigned int msg_len = std::min((unsigned int) seg_size,
+                                                    msgvec[i].msg_len - offset);
+                    add_to_batch(buffers[i].data.get() + offset, msg_len, max_size);
                 }
+                continue;  // Skip the non-GRO code below
             }
-#endif // SPEAD2_USE_GRO
-            stopped = process_one_packet(state,
-                                         buffers[i].data.get(), msgvec[i].msg_len, max_size);
         }
-#else
-        process_one_packet(state, buffer.get(), bytes_transferred, max_size);
-#endif
-    }
-    else if (error != boost::asio::error::operation_aborted)
-        log_warning("Error in UDP receiver: %1%", error.message());
-
-    if (!state.is_stopped())
-    {
-        enqueue_receive(std::move(ctx));
+#endif // SPEAD2_USE_GRO
+        add_to_batch(buffers[i].data.get(), msgvec[i].msg_len, max_size);
     }
+    process_batch(state);
+    return received;
 }
+#endif // SPEAD2_USE_RECVMMSG
 
-void udp_reader::enqueue_receive(handler_context ctx)
+void udp_reader::enqueue_receive(handler_context ctx, [[maybe_unused]] bool need_poll)
 {
     using namespace std::placeholders;
 #if SPEAD2_USE_RECVMMSG
-    socket.async_wait(
-        socket.wait_read,
-        bind_handler(std::move(ctx), std::bind(&udp_reader::packet_handler, this, _1, _2, _3, 0))
-    );
+    if (need_poll)
+    {
+        boost::asio::post(
+            get_io_service(),
+            bind_handler(
+                std::move(ctx),
+                std::bind(&udp_reader::packet_handler, this, _1, _2,
+                          boost::system::error_code(), 0)
+            )
+        );
+    }
+    else
+    {
+        socket.async_wait(
+            socket.wait_read,
+            bind_handler(std::move(ctx), std::bind(&udp_reader::packet_handler, this, _1, _2, _3, 0))
+        );
+    }
 #else
     socket.async_receive_from(
         boost::asio::buffer(buffer.get(), max_size + 1),
@@ -303,6 +334,86 @@ void udp_reader::stop()
     socket.close();
 }
 
+#if SPEAD2_USE_REUSEPORT_CBPF
+/* Attach a program to the SO_REUSEPORT group of @a socket that returns the
+ * index of the socket that should receive each packet. The packet data
+ * seen by the program starts at the UDP payload.
+ */
+static void attach_reuseport_steering(boost::asio::ip::udp::socket &socket, std::size_t n)
+{
+    static constexpr std::uint32_t spead_magic_version = 0x5304;
+    // Offset of the low 32 bits of the value of the first item pointer
+    static constexpr std::uint32_t first_item_low = 12;
+    sock_filter code[] =
+    {
+        // Let the kernel pick a socket for anything that isn't SPEAD
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, spead_magic_version, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+        // X = mask for the heap address bits (all ones for 32 bits or more)
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 3),
+        BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 4, 7, 0),
+        BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 3),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_IMM, 1),
+        BPF_STMT(BPF_ALU | BPF_LSH | BPF_X, 0),
+        BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, 1),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_JUMP(BPF_JMP | BPF_JA, 1, 0, 0),
+        BPF_STMT(BPF_LDX | BPF_IMM, 0xffffffff),
+        // Return (heap cnt & X) % n
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, first_item_low),
+        BPF_STMT(BPF_ALU | BPF_AND | BPF_X, 0),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, std::uint32_t(n)),
+        BPF_STMT(BPF_RET | BPF_A, 0)
+    };
+    sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if (setsockopt(socket.native_handle(), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                   &prog, sizeof(prog)) != 0)
+        log_errno("failed to attach SO_REUSEPORT steering program: %1% (%2%)");
+}
+#endif
+
+std::vector<boost::asio::ip::udp::socket> make_udp_reuseport_sockets(
+    boost::asio::io_service &io_service,
+    const boost::asio::ip::udp::endpoint &endpoint,
+    std::size_t n,
+    std::size_t buffer_size)
+{
+    if (n == 0)
+        throw std::invalid_argument("n must be positive");
+    if (endpoint.address().is_multicast())
+        throw std::invalid_argument("endpoint must not be a multicast address");
+#if !SPEAD2_USE_REUSEPORT_CBPF
+    log_warning("SO_REUSEPORT steering is not supported; sockets will be selected by flow hash");
+#endif
+    std::vector<boost::asio::ip::udp::socket> sockets;
+    sockets.reserve(n);
+    auto ep = endpoint;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        boost::asio::ip::udp::socket socket(io_service, ep.protocol());
+        int enable = 1;
+        if (setsockopt(socket.native_handle(), SOL_SOCKET, SO_REUSEPORT,
+                       &enable, sizeof(enable)) != 0)
+            throw_errno("setsockopt(SO_REUSEPORT) failed");
+        set_socket_recv_buffer_size(socket, buffer_size);
+        socket.bind(ep);
+        if (i == 0)
+        {
+            // Sockets are numbered in the order they join the group
+#if SPEAD2_USE_REUSEPORT_CBPF
+            attach_reuseport_steering(socket, n);
+#endif
+            ep = socket.local_endpoint();
+        }
+        sockets.push_back(std::move(socket));
+    }
+    return sockets;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 static bool ibv_override;
@@ -351,7 +462,8 @@ std::unique_ptr<reader> reader_factory<udp_reader>::make_reader(
     stream &owner,
     const boost::asio::ip::udp::endpoint &endpoint,
     std::size_t max_size,
-    std::size_t buffer_size)
+    std::size_t buffer_size,
+    const udp_poll_config &poll_config)
 {
     if (endpoint.address().is_v4())
     {
@@ -372,7 +484,7 @@ std::unique_ptr<reader> reader_factory<udp_reader>::make_reader(
         }
 #endif
     }
-    return std::make_unique<udp_reader>(owner, endpoint, max_size, buffer_size);
+    return std::make_unique<udp_reader>(owner, endpoint, max_size, buffer_size, poll_config);
 }
 
 std::unique_ptr<reader> reader_factory<udp_reader>::make_reader(
@@ -380,7 +492,8 @@ std::unique_ptr<reader> reader_factory<udp_reader>::make_reader(
     const boost::asio::ip::udp::endpoint &endpoint,
     std::size_t max_size,
     std::size_t buffer_size,
-    const boost::asio::ip::address &interface_address)
+    const boost::asio::ip::address &interface_address,
+    const udp_poll_config &poll_config)
 {
     if (endpoint.address().is_v4())
     {
@@ -401,7 +514,8 @@ std::unique_ptr<reader> reader_factory<udp_reader>::make_reader(
         }
 #endif
     }
-    return std::make_unique<udp_reader>(owner, endpoint, max_size, buffer_size, interface_address);
+    return std::make_unique<udp_reader>(owner, endpoint, max_size, buffer_size, interface_address,
+                                        poll_config);
 }
 
 std::unique_ptr<reader> reader_factory<udp_reader>::make_reader(
@@ -409,17 +523,20 @@ std::unique_ptr<reader> reader_factory<udp_reader>::make_reader(
     const boost::asio::ip::udp::endpoint &endpoint,
     std::size_t max_size,
     std::size_t buffer_size,
-    unsigned int interface_index)
+    unsigned int interface_index,
+    const udp_poll_config &poll_config)
 {
-    return std::make_unique<udp_reader>(owner, endpoint, max_size, buffer_size, interface_index);
+    return std::make_unique<udp_reader>(owner, endpoint, max_size, buffer_size, interface_index,
+                                        poll_config);
 }
 
 std::unique_ptr<reader> reader_factory<udp_reader>::make_reader(
     stream &owner,
     boost::asio::ip::udp::socket &&socket,
-    std::size_t max_size)
+    std::size_t max_size,
+    const udp_poll_config &poll_config)
 {
-    return std::make_unique<udp_reader>(owner, std::move(socket), max_size);
+    return std::make_unique<udp_reader>(owner, std::move(socket), max_size, poll_config);
 }
 
 } // namespace spead2::recv
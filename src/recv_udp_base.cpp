@@ -20,22 +20,102 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <stdexcept>
+#include <boost/asio.hpp>
 #include <spead2/recv_packet.h>
 #include <spead2/recv_stream.h>
 #include <spead2/recv_udp_base.h>
+#include <spead2/recv_pcap_writer.h>
 #include <spead2/common_logging.h>
+#include <spead2/common_socket.h>
 
 namespace spead2::recv
 {
 
+udp_reader_base::udp_reader_base(stream &owner)
+    : reader(owner), packet_tap(owner.get_config().get_packet_tap()),
+    packet_tap_source(packet_tap ? std::make_unique<pcap_writer::source>(*packet_tap) : nullptr)
+{
+}
+
+boost::asio::ip::udp::socket udp_reader_base::make_v4_socket(
+    boost::asio::io_service &io_service,
+    const boost::asio::ip::udp::endpoint &endpoint,
+    std::size_t buffer_size,
+    const boost::asio::ip::address &interface_address)
+{
+    if (!interface_address.is_v4())
+        throw std::invalid_argument("interface address is not an IPv4 address");
+    auto ep = endpoint;
+    if (ep.address().is_unspecified())
+        ep.address(interface_address);
+    if (!ep.address().is_v4())
+        throw std::invalid_argument("endpoint is not an IPv4 address");
+    if (!ep.address().is_multicast() && ep.address() != interface_address)
+        throw std::invalid_argument("endpoint is not multicast and does not match interface address");
+    boost::asio::ip::udp::socket socket(io_service, ep.protocol());
+    if (ep.address().is_multicast())
+    {
+        socket.set_option(boost::asio::socket_base::reuse_address(true));
+        socket.set_option(boost::asio::ip::multicast::join_group(
+            ep.address().to_v4(), interface_address.to_v4()));
+    }
+    set_socket_recv_buffer_size(socket, buffer_size);
+    return socket;
+}
+
+boost::asio::ip::udp::socket udp_reader_base::make_multicast_v6_socket(
+    boost::asio::io_service &io_service,
+    const boost::asio::ip::udp::endpoint &endpoint,
+    std::size_t buffer_size,
+    unsigned int interface_index)
+{
+    if (!endpoint.address().is_v6() || !endpoint.address().is_multicast())
+        throw std::invalid_argument("endpoint is not an IPv6 multicast address");
+    boost::asio::ip::udp::socket socket(io_service, endpoint.protocol());
+    socket.set_option(boost::asio::socket_base::reuse_address(true));
+    socket.set_option(boost::asio::ip::multicast::join_group(
+        endpoint.address().to_v6(), interface_index));
+    set_socket_recv_buffer_size(socket, buffer_size);
+    return socket;
+}
+
+boost::asio::ip::udp::socket udp_reader_base::make_socket(
+    boost::asio::io_service &io_service,
+    const boost::asio::ip::udp::endpoint &endpoint,
+    std::size_t buffer_size)
+{
+    boost::asio::ip::udp::socket socket(io_service, endpoint.protocol());
+    if (endpoint.address().is_multicast())
+    {
+        socket.set_option(boost::asio::socket_base::reuse_address(true));
+        socket.set_option(boost::asio::ip::multicast::join_group(endpoint.address()));
+    }
+    set_socket_recv_buffer_size(socket, buffer_size);
+    return socket;
+}
+
+bool udp_reader_base::check_packet(
+    const std::uint8_t *data, std::size_t length, std::size_t max_size)
+{
+    if (packet_tap_source)
+        packet_tap_source->add_packet(data, length);
+    if (length > max_size)
+    {
+        // If it's bigger, the packet might have been truncated
+        log_info("dropped packet due to truncation");
+        return false;
+    }
+    return length > 0;
+}
+
 bool udp_reader_base::process_one_packet(
     stream_base::add_packet_state &state,
     const std::uint8_t *data, std::size_t length, std::size_t max_size)
 {
     bool stopped = false;
-    if (length <= max_size && length > 0)
+    if (check_packet(data, length, max_size))
     {
-        // If it's bigger, the packet might have been truncated
         packet_header packet;
         std::size_t size = decode_packet(packet, data, length);
         if (size == length)
@@ -53,8 +133,37 @@ bool udp_reader_base::process_one_packet(
                      size, length);
         }
     }
-    else if (length > max_size)
-        log_info("dropped packet due to truncation");
+    return stopped;
+}
+
+void udp_reader_base::add_to_batch(
+    const std::uint8_t *data, std::size_t length, std::size_t max_size)
+{
+    if (check_packet(data, length, max_size))
+    {
+        batch_data.push_back(data);
+        batch_lengths.push_back(length);
+    }
+}
+
+bool udp_reader_base::process_batch(stream_base::add_packet_state &state)
+{
+    bool stopped = false;
+    std::size_t n = batch_data.size();
+    if (n > 0)
+    {
+        if (batch_headers.size() < n)
+            batch_headers.resize(n);
+        n = decode_packets(batch_headers.data(), batch_data.data(), batch_lengths.data(), n);
+        state.add_packets(batch_headers.data(), n);
+        if (state.is_stopped())
+        {
+            log_debug("UDP reader: end of stream detected");
+            stopped = true;
+        }
+        batch_data.clear();
+        batch_lengths.clear();
+    }
     return stopped;
 }
 
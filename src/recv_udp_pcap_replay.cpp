@@ -0,0 +1,306 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <chrono>
+#include <stdexcept>
+#include <functional>
+#include <utility>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <spead2/common_logging.h>
+#include <spead2/common_raw_packet.h>
+#include <spead2/recv_stream.h>
+#include <spead2/recv_udp_base.h>
+#include <spead2/recv_udp_pcap_replay.h>
+
+namespace spead2::recv
+{
+
+// Sizes and magic numbers from the pcap file format
+static constexpr std::size_t pcap_file_header_size = 24;
+static constexpr std::size_t pcap_record_header_size = 16;
+static constexpr std::uint32_t pcap_magic_us = 0xa1b2c3d4;
+static constexpr std::uint32_t pcap_magic_ns = 0xa1b23c4d;
+static constexpr std::uint32_t linktype_ethernet = 1;
+static constexpr std::uint32_t linktype_linux_sll = 113;
+
+std::uint32_t udp_pcap_replay_reader::load_u32(const std::uint8_t *ptr) const
+{
+    std::uint32_t value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return swapped ? __builtin_bswap32(value) : value;
+}
+
+void udp_pcap_replay_reader::index()
+{
+    const std::uint8_t *ptr = mapping + pcap_file_header_size;
+    const std::uint8_t *end = mapping + mapping_size;
+    frame_batch batch;
+    batch.reserve(index_batch_size);
+    try
+    {
+        while (ptr != end)
+        {
+            if (std::size_t(end - ptr) < pcap_record_header_size)
+            {
+                log_warning("pcap file is truncated");
+                break;
+            }
+            std::uint32_t ts_sec = load_u32(ptr);
+            std::uint32_t ts_frac = load_u32(ptr + 4);
+            std::uint32_t caplen = load_u32(ptr + 8);
+            std::uint32_t len = load_u32(ptr + 12);
+            ptr += pcap_record_header_size;
+            if (std::size_t(end - ptr) < caplen)
+            {
+                log_warning("pcap file is truncated");
+                break;
+            }
+            std::int64_t timestamp_ns = std::int64_t(ts_sec) * 1000000000
+                + std::int64_t(ts_frac) * (nanosecond ? 1 : 1000);
+            batch.push_back(frame{ptr, caplen, len, timestamp_ns});
+            ptr += caplen;
+            if (batch.size() == index_batch_size)
+            {
+                batches.push(std::move(batch));
+                batch = frame_batch();
+                batch.reserve(index_batch_size);
+            }
+        }
+        if (!batch.empty())
+            batches.push(std::move(batch));
+        batches.stop();
+    }
+    catch (ringbuffer_stopped &)
+    {
+        // The reader was stopped before the whole file was indexed
+    }
+}
+
+auto udp_pcap_replay_reader::next_frame(bool &end_of_file) -> const frame *
+{
+    end_of_file = false;
+    if (current_pos == current.size())
+    {
+        try
+        {
+            // Don't block here, since the stream's lock is held
+            current = batches.try_pop();
+            current_pos = 0;
+        }
+        catch (ringbuffer_empty &)
+        {
+            return nullptr;
+        }
+        catch (ringbuffer_stopped &)
+        {
+            end_of_file = true;
+            return nullptr;
+        }
+    }
+    return &current[current_pos];
+}
+
+void udp_pcap_replay_reader::run(handler_context ctx, stream_base::add_packet_state &state)
+{
+    using namespace std::placeholders;
+    for (std::size_t pass = 0; pass < max_batch; pass++)
+    {
+        if (state.is_stopped())
+            break;
+        bool end_of_file;
+        const frame *f = next_frame(end_of_file);
+        if (!f)
+        {
+            process_batch(state);
+            if (end_of_file)
+                state.stop();
+            /* Otherwise the index thread has fallen behind (which should be
+             * rare, since it only has to read the record headers). Release
+             * the stream and try again once other handlers have run.
+             */
+            break;
+        }
+        if (speed > 0)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (start_timestamp < 0)
+            {
+                start_timestamp = f->timestamp_ns;
+                start_time = now;
+            }
+            std::chrono::duration<double, std::nano> offset((f->timestamp_ns - start_timestamp) / speed);
+            auto target = start_time
+                + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset);
+            if (target > now)
+            {
+                // Not yet time to send it. Release the stream and wait.
+                process_batch(state);
+                if (state.is_stopped())
+                    return;
+                timer.expires_at(target);
+                timer.async_wait(bind_handler(
+                    std::move(ctx),
+                    std::bind(&udp_pcap_replay_reader::timer_handler, this, _1, _2, _3)));
+                return;
+            }
+        }
+        current_pos++;
+
+        if (f->caplen < f->len)
+        {
+            log_warning("Packet was truncated (%d < %d)", f->caplen, f->len);
+        }
+        else
+        {
+            try
+            {
+                void *bytes = const_cast<std::uint8_t *>(f->data);
+                packet_buffer payload = udp_from_frame(bytes, f->caplen);
+                add_to_batch(payload.data(), payload.size(), payload.size());
+            }
+            catch (packet_type_error &e)
+            {
+                // Unlike udp_pcap_file_reader there is no filter, so non-UDP
+                // traffic is expected.
+                log_debug(e.what());
+            }
+            catch (std::length_error &e)
+            {
+                log_warning(e.what());
+            }
+        }
+    }
+    process_batch(state);
+    // Run ourselves again
+    if (!state.is_stopped())
+    {
+        boost::asio::post(get_io_service(), bind_handler(std::move(ctx), std::bind(&udp_pcap_replay_reader::run, this, _1, _2)));
+    }
+}
+
+void udp_pcap_replay_reader::timer_handler(
+    handler_context ctx, stream_base::add_packet_state &state,
+    const boost::system::error_code &error)
+{
+    if (!error)
+        run(std::move(ctx), state);
+    else if (error != boost::asio::error::operation_aborted)
+        log_warning("Error in pcap replay timer: %1%", error.message());
+}
+
+udp_pcap_replay_reader::udp_pcap_replay_reader(
+    stream &owner, const std::string &filename, double speed)
+    : udp_reader_base(owner),
+    speed(speed),
+    batches(4),
+    timer(owner.get_io_service())
+{
+    if (!(speed >= 0.0))
+        throw std::invalid_argument("speed must be non-negative");
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw_errno("open failed");
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        int err = errno;
+        close(fd);
+        throw_errno("fstat failed", err);
+    }
+    if (std::size_t(st.st_size) < pcap_file_header_size)
+    {
+        close(fd);
+        throw std::runtime_error("file is too short to be a pcap file");
+    }
+    mapping_size = st.st_size;
+    void *ptr = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    close(fd);   // the mapping remains valid
+    if (ptr == MAP_FAILED)
+        throw_errno("mmap failed", err);
+    mapping = static_cast<std::uint8_t *>(ptr);
+    madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+
+    try
+    {
+        std::uint32_t magic;
+        std::memcpy(&magic, mapping, sizeof(magic));
+        if (magic == pcap_magic_us || magic == pcap_magic_ns)
+            swapped = false;
+        else if (magic == __builtin_bswap32(pcap_magic_us) || magic == __builtin_bswap32(pcap_magic_ns))
+        {
+            swapped = true;
+            magic = __builtin_bswap32(magic);
+        }
+        else
+            throw std::runtime_error("not a pcap file (pcapng is not supported)");
+        nanosecond = (magic == pcap_magic_ns);
+        // The upper bits of the link type field are used for other information
+        std::uint32_t linktype = load_u32(mapping + 20) & 0xffff;
+        if (linktype == linktype_ethernet)
+            udp_from_frame = udp_from_ethernet;
+        else if (linktype == linktype_linux_sll)
+            udp_from_frame = udp_from_linux_sll;
+        else
+            throw packet_type_error("pcap linktype is neither ethernet nor linux sll");
+    }
+    catch (...)
+    {
+        munmap(mapping, mapping_size);
+        throw;
+    }
+    index_thread = std::thread([this] { index(); });
+}
+
+void udp_pcap_replay_reader::start()
+{
+    using namespace std::placeholders;
+    boost::asio::post(get_io_service(), bind_handler(std::bind(&udp_pcap_replay_reader::run, this, _1, _2)));
+}
+
+void udp_pcap_replay_reader::stop()
+{
+    batches.stop();
+    timer.cancel();
+}
+
+udp_pcap_replay_reader::~udp_pcap_replay_reader()
+{
+    batches.stop();
+    if (index_thread.joinable())
+        index_thread.join();
+    munmap(mapping, mapping_size);
+}
+
+bool udp_pcap_replay_reader::lossy() const
+{
+    return false;
+}
+
+} // namespace spead2::recv
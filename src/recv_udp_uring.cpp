@@ -0,0 +1,267 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_URING
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <system_error>
+#include <utility>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <liburing.h>
+#include <boost/asio.hpp>
+#include <spead2/common_logging.h>
+#include <spead2/common_memory_allocator.h>
+#include <spead2/common_socket.h>
+#include <spead2/recv_stream.h>
+#include <spead2/recv_udp_base.h>
+#include <spead2/recv_udp_uring.h>
+
+namespace spead2::recv
+{
+
+/// Buffer group ID for the provided buffers (there is only one per ring)
+static constexpr int buffer_group = 0;
+
+udp_uring_reader::ring_t::ring_t(unsigned int entries)
+{
+    io_uring_params params{};
+    /* The submission queue only ever holds the multishot receive request,
+     * but every packet produces a completion.
+     */
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries;
+    int ret = io_uring_queue_init_params(4, this, &params);
+    if (ret < 0)
+        throw_errno("io_uring_queue_init_params failed", -ret);
+}
+
+udp_uring_reader::ring_t::~ring_t()
+{
+    io_uring_queue_exit(this);
+}
+
+udp_uring_reader::udp_uring_reader(
+    stream &owner,
+    boost::asio::ip::udp::socket &&socket,
+    std::size_t max_size)
+    : udp_reader_base(owner), max_size(max_size),
+    buffer_stride(max_size + 1),
+    ring(2 * buffer_count),
+    event_fd(owner.get_io_service()),
+    socket(std::move(socket))
+{
+    assert(socket_uses_io_service(this->socket, get_io_service()));
+
+    buffer = mmap_allocator(0, true).allocate(buffer_count * buffer_stride, nullptr);
+    buf_ring_storage = mmap_allocator().allocate(buffer_count * sizeof(io_uring_buf), nullptr);
+    buf_ring = reinterpret_cast<io_uring_buf_ring *>(buf_ring_storage.get());
+    io_uring_buf_ring_init(buf_ring);
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<std::uintptr_t>(buf_ring);
+    reg.ring_entries = buffer_count;
+    reg.bgid = buffer_group;
+    int ret = io_uring_register_buf_ring(&ring, &reg, 0);
+    if (ret < 0)
+        throw_errno("io_uring_register_buf_ring failed", -ret);
+    const int mask = io_uring_buf_ring_mask(buffer_count);
+    for (unsigned int i = 0; i < buffer_count; i++)
+        io_uring_buf_ring_add(buf_ring, buffer.get() + i * buffer_stride, buffer_stride, i, mask, i);
+    io_uring_buf_ring_advance(buf_ring, buffer_count);
+    used_buffers.reserve(buffer_count);
+
+    int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (efd < 0)
+        throw_errno("eventfd failed");
+    event_fd.assign(efd);
+    ret = io_uring_register_eventfd(&ring, efd);
+    if (ret < 0)
+        throw_errno("io_uring_register_eventfd failed", -ret);
+}
+
+udp_uring_reader::udp_uring_reader(
+    stream &owner,
+    const boost::asio::ip::udp::endpoint &endpoint,
+    std::size_t max_size,
+    std::size_t buffer_size)
+    : udp_uring_reader(
+        owner,
+        make_socket(owner.get_io_service(), endpoint, buffer_size),
+        max_size)
+{
+    bind_endpoint = endpoint;
+}
+
+udp_uring_reader::udp_uring_reader(
+    stream &owner,
+    const boost::asio::ip::udp::endpoint &endpoint,
+    std::size_t max_size,
+    std::size_t buffer_size,
+    const boost::asio::ip::address &interface_address)
+    : udp_uring_reader(
+        owner,
+        make_v4_socket(owner.get_io_service(),
+                       endpoint, buffer_size, interface_address),
+        max_size)
+{
+    auto ep = endpoint;
+    // Match the logic in make_v4_socket
+    if (ep.address().is_unspecified())
+        ep.address(interface_address);
+    bind_endpoint = ep;
+}
+
+void udp_uring_reader::start()
+{
+    if (bind_endpoint)
+        socket.bind(*bind_endpoint);
+    submit_receive();
+    enqueue_receive(make_handler_context(), false);
+}
+
+void udp_uring_reader::submit_receive()
+{
+    io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+    // This is the only request we submit, so there is always space
+    assert(sqe);
+    io_uring_prep_recv_multishot(sqe, socket.native_handle(), nullptr, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffer_group;
+    int ret = io_uring_submit(&ring);
+    if (ret < 0)
+    {
+        std::error_code code(-ret, std::system_category());
+        log_warning("io_uring_submit failed: %1% (%2%)", code.value(), code.message());
+    }
+}
+
+void udp_uring_reader::packet_handler(
+    handler_context ctx,
+    stream_base::add_packet_state &state,
+    const boost::system::error_code &error,
+    bool consume_event)
+{
+    bool need_poll = false;
+    if (!error)
+    {
+        if (consume_event)
+        {
+            /* Reset the eventfd before looking at the completion queue, so
+             * that any completions that arrive after this point will wake
+             * us up again. The eventfd is non-blocking, so a failure
+             * (if another wakeup already consumed it) is harmless.
+             */
+            std::uint64_t counter;
+            [[maybe_unused]] ssize_t result = read(event_fd.native_handle(), &counter, sizeof(counter));
+        }
+
+        bool rearm = false;
+        unsigned int head;
+        unsigned int seen = 0;
+        io_uring_cqe *cqe;
+        io_uring_for_each_cqe(&ring, head, cqe)
+        {
+            seen++;
+            if (cqe->flags & IORING_CQE_F_BUFFER)
+            {
+                unsigned short bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                if (cqe->res >= 0)
+                    add_to_batch(buffer.get() + bid * buffer_stride, cqe->res, max_size);
+                used_buffers.push_back(bid);
+            }
+            else if (cqe->res < 0 && cqe->res != -ENOBUFS && cqe->res != -ECANCELED)
+            {
+                std::error_code code(-cqe->res, std::system_category());
+                log_warning("io_uring receive failed: %1% (%2%)", code.value(), code.message());
+            }
+            /* The kernel terminates the multishot request if it runs out
+             * of buffers (or on error), and we need to submit a new one.
+             */
+            if (!(cqe->flags & IORING_CQE_F_MORE))
+                rearm = true;
+        }
+        io_uring_cq_advance(&ring, seen);
+        process_batch(state);
+
+        // Return the buffers to the kernel, now that the packets are processed
+        const int mask = io_uring_buf_ring_mask(buffer_count);
+        for (std::size_t i = 0; i < used_buffers.size(); i++)
+        {
+            unsigned short bid = used_buffers[i];
+            io_uring_buf_ring_add(buf_ring, buffer.get() + bid * buffer_stride, buffer_stride,
+                                  bid, mask, i);
+        }
+        io_uring_buf_ring_advance(buf_ring, used_buffers.size());
+        used_buffers.clear();
+
+        if (rearm && !state.is_stopped())
+            submit_receive();
+        /* If more completions arrived while we were busy, go straight back
+         * to them rather than through the eventfd.
+         */
+        need_poll = io_uring_cq_ready(&ring) > 0;
+    }
+    else if (error != boost::asio::error::operation_aborted)
+        log_warning("Error in UDP receiver: %1%", error.message());
+
+    if (!state.is_stopped())
+    {
+        enqueue_receive(std::move(ctx), need_poll);
+    }
+}
+
+void udp_uring_reader::enqueue_receive(handler_context ctx, bool need_poll)
+{
+    using namespace std::placeholders;
+    if (!need_poll)
+    {
+        event_fd.async_wait(
+            event_fd.wait_read,
+            bind_handler(
+                std::move(ctx),
+                std::bind(&udp_uring_reader::packet_handler, this, _1, _2, _3, true)));
+    }
+    else
+    {
+        boost::asio::post(
+            get_io_service(),
+            bind_handler(
+                std::move(ctx),
+                std::bind(&udp_uring_reader::packet_handler, this, _1, _2,
+                          boost::system::error_code(), false)));
+    }
+}
+
+void udp_uring_reader::stop()
+{
+    /* This cancels any pending wait. The multishot receive is cancelled
+     * when the ring is destroyed.
+     */
+    event_fd.close();
+    socket.close();
+}
+
+} // namespace spead2::recv
+
+#endif // SPEAD2_USE_URING
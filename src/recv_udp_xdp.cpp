@@ -0,0 +1,217 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_XDP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <unistd.h>
+#include <boost/asio.hpp>
+#include <spead2/common_logging.h>
+#include <spead2/common_raw_packet.h>
+#include <spead2/common_xdp.h>
+#include <spead2/recv_stream.h>
+#include <spead2/recv_udp_xdp.h>
+
+namespace spead2
+{
+namespace recv
+{
+
+void udp_xdp_config::validate_endpoint(const boost::asio::ip::udp::endpoint &endpoint)
+{
+    if (!endpoint.address().is_unspecified() && !endpoint.address().is_v4())
+        throw std::invalid_argument("endpoint is not an IPv4 address");
+}
+
+udp_xdp_config &udp_xdp_config::set_max_size(std::size_t max_size)
+{
+    if (max_size < 1)
+        throw std::invalid_argument("max_size must be positive");
+    if (max_size > default_max_size)
+        throw std::invalid_argument("max_size is too large for an AF_XDP frame");
+    this->max_size = max_size;
+    return *this;
+}
+
+// Check the configuration and return the interface index
+static unsigned int get_ifindex(const udp_xdp_config &config)
+{
+    if (config.get_endpoints().empty())
+        throw std::invalid_argument("endpoints is empty");
+    if (config.get_interface_address().is_unspecified())
+        throw std::invalid_argument("interface address has not been specified");
+    return interface_index(config.get_interface_address());
+}
+
+udp_xdp_reader::udp_xdp_reader(stream &owner, const udp_xdp_config &config)
+    : udp_reader_base(owner),
+    join_socket(owner.get_io_service(), boost::asio::ip::udp::v4()),
+    interface_address(config.get_interface_address()),
+    max_size(config.get_max_size()),
+    max_poll(config.get_max_poll()),
+    socket(get_ifindex(config), config.get_queue_id(), config.get_buffer_size(),
+           config.get_mode(), true, false),
+    program(interface_index(config.get_interface_address()),
+            config.get_endpoints(), config.get_queue_id() + 1),
+    socket_wrapper(owner.get_io_service())
+{
+    for (const auto &endpoint : config.get_endpoints())
+        if (endpoint.address().is_multicast())
+            groups.push_back(endpoint.address());
+
+    // Give all the frames to the kernel to receive into
+    std::uint32_t n_frames = socket.get_n_frames();
+    std::uint32_t first = socket.fill.producer_index();
+    for (std::uint32_t i = 0; i < n_frames; i++)
+        socket.fill[first + i] = std::uint64_t(i) * spead2::detail::xdp_socket::frame_size;
+    socket.fill.produce(n_frames);
+
+    int fd = dup(socket.native_handle());
+    if (fd < 0)
+        throw_errno("dup failed");
+    socket_wrapper.assign(fd);
+    program.add_socket(config.get_queue_id(), socket);
+}
+
+udp_xdp_reader::poll_result udp_xdp_reader::poll_once(stream_base::add_packet_state &state)
+{
+    std::uint32_t n = std::min(socket.rx.available(), max_batch);
+    if (n == 0)
+        return poll_result::drained;
+    std::uint32_t first = socket.rx.consumer_index();
+    for (std::uint32_t i = 0; i < n; i++)
+    {
+        const xdp_desc &desc = socket.rx[first + i];
+        try
+        {
+            packet_buffer payload = udp_from_ethernet(socket.data(desc.addr), desc.len);
+            add_to_batch(payload.data(), payload.size(), max_size);
+        }
+        catch (packet_type_error &e)
+        {
+            log_warning(e.what());
+        }
+        catch (std::length_error &e)
+        {
+            log_warning(e.what());
+        }
+    }
+    bool stopped = process_batch(state);
+
+    // Hand the frames back to the kernel. The fill ring has room for every
+    // frame, so there is always space.
+    std::uint32_t fill_first = socket.fill.producer_index();
+    for (std::uint32_t i = 0; i < n; i++)
+        socket.fill[fill_first + i] =
+            socket.rx[first + i].addr & ~std::uint64_t(spead2::detail::xdp_socket::frame_size - 1);
+    socket.rx.consume(n);
+    socket.fill.produce(n);
+    socket.wakeup_rx();
+
+    if (stopped)
+        return poll_result::stopped;
+    else if (n == max_batch)
+        return poll_result::partial;
+    else
+        return poll_result::drained;
+}
+
+void udp_xdp_reader::packet_handler(
+    handler_context ctx,
+    stream_base::add_packet_state &state,
+    const boost::system::error_code &error)
+{
+    bool need_poll = false;
+    if (!error)
+    {
+        for (int i = 0; i < max_poll; i++)
+        {
+            poll_result result = poll_once(state);
+            if (result == poll_result::stopped)
+                break;
+            /* Waiting on the socket is level-triggered, so only keep
+             * polling if the RX ring was not drained.
+             */
+            need_poll = (result == poll_result::partial);
+        }
+    }
+    else if (error != boost::asio::error::operation_aborted)
+        log_warning("Error in AF_XDP receiver: %1%", error.message());
+
+    if (!state.is_stopped())
+    {
+        enqueue_receive(std::move(ctx), need_poll);
+    }
+}
+
+void udp_xdp_reader::enqueue_receive(handler_context ctx, bool need_poll)
+{
+    using namespace std::placeholders;
+    if (!need_poll)
+    {
+        socket_wrapper.async_wait(
+            socket_wrapper.wait_read,
+            bind_handler(
+                std::move(ctx),
+                std::bind(&udp_xdp_reader::packet_handler, this, _1, _2, _3)));
+    }
+    else
+    {
+        boost::asio::post(
+            get_io_service(),
+            bind_handler(
+                std::move(ctx),
+                std::bind(&udp_xdp_reader::packet_handler, this, _1, _2,
+                          boost::system::error_code())
+            )
+        );
+    }
+}
+
+void udp_xdp_reader::start()
+{
+    enqueue_receive(make_handler_context(), true);
+    join_socket.set_option(boost::asio::socket_base::reuse_address(true));
+    for (const auto &address : groups)
+    {
+        join_socket.set_option(boost::asio::ip::multicast::join_group(
+            address.to_v4(), interface_address.to_v4()));
+    }
+}
+
+void udp_xdp_reader::stop()
+{
+    socket_wrapper.close();
+}
+
+} // namespace recv
+
+template class detail::udp_xdp_config_base<recv::udp_xdp_config>;
+
+} // namespace spead2
+
+#endif // SPEAD2_USE_XDP
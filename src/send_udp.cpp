@@ -1,4 +1,4 @@
-/* Copyright 2015, 2019-2020, 2023 National Research Foundation (SARAO)
+/* Copyright 2015, 2019-2020, 2023, 2026 National Research Foundation (SARAO)
  *
  * This program is free software: you can redistribute it and/or modify it under
  * the terms of the GNU Lesser General Public License as published by the Free
@@ -15,6 +15,7 @@
  */
 
 #include <cstddef>
+#include <cassert>
 #include <cstring>
 #include <utility>
 #include <algorithm>
@@ -23,12 +24,21 @@
 #include <spead2/send_writer.h>
 #include <spead2/common_defines.h>
 #include <spead2/common_socket.h>
+#include <spead2/common_logging.h>
 #if SPEAD2_USE_SENDMMSG
 # include <sys/types.h>
 # include <sys/socket.h>
 # include <netinet/in.h>
 # include <netinet/udp.h>
 #endif
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+# include <cerrno>
+# include <system_error>
+# include <unistd.h>
+# include <sys/eventfd.h>
+# include <liburing.h>
+# include <spead2/send_udp_uring.h>
+#endif
 
 namespace spead2::send
 {
@@ -38,7 +48,7 @@ namespace
 
 class udp_writer : public writer
 {
-private:
+protected:
     boost::asio::ip::udp::socket socket;
     std::vector<boost::asio::ip::udp::endpoint> endpoints;
 
@@ -88,7 +98,33 @@ private:
      * filled in.
      */
     int prepare_msgvec(int first_packet, int last_packet, int first_msg, int first_iov, int gso_size);
-    void send_packets(int first_packet, int last_packet, int first_msg, int last_msg);
+
+    /**
+     * Handle failure to send a message with GSO enabled. If GSO might be
+     * the cause, it is disabled on the socket, @ref msgvec is rebuilt from
+     * @a first_msg onwards (updating @a last_msg) and the return value is
+     * true to indicate that the send should be retried.
+     */
+    bool retry_without_gso(int first_packet, int last_packet, int first_msg, int &last_msg);
+    /**
+     * Update the items for @a sent messages that were successfully
+     * transmitted, starting at @a first_msg. The packet and message indices
+     * are advanced past them and @a groups is incremented by the number of
+     * completed groups.
+     */
+    void messages_sent(int &first_packet, int last_packet, int &first_msg, int sent, int &groups);
+    /**
+     * Set the error on the items for message @a first_msg, and advance past
+     * it (see @ref messages_sent).
+     */
+    void message_failed(int &first_packet, int last_packet, int &first_msg,
+                        const boost::system::error_code &result, int &groups);
+    /**
+     * Transmit messages [first_msg, last_msg) from @ref msgvec, which
+     * contain packets [first_packet, last_packet). Once done, it must call
+     * @ref groups_completed and @ref post_wakeup.
+     */
+    virtual void send_packets(int first_packet, int last_packet, int first_msg, int last_msg);
 #else
     std::unique_ptr<std::uint8_t[]> scratch;
 #endif
@@ -121,74 +157,93 @@ void udp_writer::set_gso_size(int size, boost::system::error_code &result)
 }
 #endif
 
-void udp_writer::send_packets(int first_packet, int last_packet, int first_msg, int last_msg)
+bool udp_writer::retry_without_gso(
+    [[maybe_unused]] int first_packet, [[maybe_unused]] int last_packet,
+    [[maybe_unused]] int first_msg, [[maybe_unused]] int &last_msg)
 {
 #if SPEAD2_USE_GSO
-restart:
-#endif
-    // Try sending
-    int sent = sendmmsg(socket.native_handle(), msgvec + first_msg, last_msg - first_msg, MSG_DONTWAIT);
-    int groups = 0;
-    boost::system::error_code result;
-    if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    /* Not all device drivers support GSO. If we were trying with GSO, try again
+     * without.
+     */
+    if (current_gso_size == gso_probe)
     {
-        /* Not all device drivers support GSO. If we were trying with GSO, try again
-         * without.
+        /* We tried sending with GSO and it failed, but resending without GSO
+         * also failed, so the fault is probably not lack of GSO support. Allow
+         * GSO to be used again.
          */
-        result.assign(errno, boost::asio::error::get_system_category());
-#if SPEAD2_USE_GSO
-        if (current_gso_size == gso_probe)
-        {
-            /* We tried sending with GSO and it failed, but resending without GSO
-             * also failed, so the fault is probably not lack of GSO support. Allow
-             * GSO to be used again.
-             */
-            current_gso_size = gso_inactive;
-        }
-        else if (current_gso_size > 0)
+        current_gso_size = gso_inactive;
+    }
+    else if (current_gso_size > 0)
+    {
+        boost::system::error_code result;
+        set_gso_size(0, result);
+        if (!result)
         {
-            set_gso_size(0, result);
-            if (!result)
-            {
-                /* Re-compute msgvec without GSO */
-                current_gso_size = gso_probe;
-                last_msg = prepare_msgvec(first_packet, last_packet, first_msg,
-                                          msgvec[first_msg].msg_hdr.msg_iov - msg_iov.data(),
-                                          0);
-                goto restart;
-            }
+            /* Re-compute msgvec without GSO */
+            current_gso_size = gso_probe;
+            last_msg = prepare_msgvec(first_packet, last_packet, first_msg,
+                                      msgvec[first_msg].msg_hdr.msg_iov - msg_iov.data(),
+                                      0);
+            return true;
         }
+    }
 #endif
+    return false;
+}
+
+void udp_writer::messages_sent(int &first_packet, int last_packet, int &first_msg, int sent, int &groups)
+{
+    if (current_gso_size == gso_probe)
+    {
+        log_debug("disabling GSO because sending with it failed and without succeeded");
+        // Sending with GSO failed and without GSO succeeded. The network
+        // device probably does not support it, so don't try again.
+        current_gso_size = gso_disabled;
+    }
+    for (int i = 0; i < sent; i++)
+    {
         do
         {
             auto *item = packets[first_packet].packet.item;
-            if (!item->result)
-                item->result = result;
+            item->bytes_sent += packets[first_packet].packet.size;
             groups += packets[first_packet].packet.last;
             first_packet++;
         } while (first_packet < last_packet && packets[first_packet].merged);
-        first_msg++;
+    }
+    first_msg += sent;
+}
+
+void udp_writer::message_failed(
+    int &first_packet, int last_packet, int &first_msg,
+    const boost::system::error_code &result, int &groups)
+{
+    do
+    {
+        auto *item = packets[first_packet].packet.item;
+        if (!item->result)
+            item->result = result;
+        groups += packets[first_packet].packet.last;
+        first_packet++;
+    } while (first_packet < last_packet && packets[first_packet].merged);
+    first_msg++;
+}
+
+void udp_writer::send_packets(int first_packet, int last_packet, int first_msg, int last_msg)
+{
+restart:
+    // Try sending
+    int sent = sendmmsg(socket.native_handle(), msgvec + first_msg, last_msg - first_msg, MSG_DONTWAIT);
+    int groups = 0;
+    if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        boost::system::error_code result(errno, boost::asio::error::get_system_category());
+        if (retry_without_gso(first_packet, last_packet, first_msg, last_msg))
+            goto restart;
+        message_failed(first_packet, last_packet, first_msg, result, groups);
     }
     else if (sent > 0)
     {
-        if (current_gso_size == gso_probe)
-        {
-            log_debug("disabling GSO because sending with it failed and without succeeded");
-            // Sending with GSO failed and without GSO succeeded. The network
-            // device probably does not support it, so don't try again.
-            current_gso_size = gso_disabled;
-        }
-        for (int i = 0; i < sent; i++)
-        {
-            do
-            {
-                auto *item = packets[first_packet].packet.item;
-                item->bytes_sent += packets[first_packet].packet.size;
-                groups += packets[first_packet].packet.last;
-                first_packet++;
-            } while (first_packet < last_packet && packets[first_packet].merged);
-        }
-        first_msg += sent;
+        messages_sent(first_packet, last_packet, first_msg, sent, groups);
     }
 
     if (groups > 0)
@@ -408,6 +463,238 @@ udp_writer::udp_writer(
 #endif
 }
 
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+
+/**
+ * Variant of @ref udp_writer that submits the messages built by
+ * @ref udp_writer::prepare_msgvec to an io_uring instance, instead of
+ * passing them to @c sendmmsg.
+ *
+ * The requests in a batch are linked, so that (as with @c sendmmsg) a
+ * failure cancels the rest of the batch, which is then resubmitted. A batch
+ * is only retired once all its completions have been reaped, including the
+ * notifications for zero-copy sends, since until then the kernel may still
+ * be reading from the heap's memory.
+ */
+class udp_uring_writer final : public udp_writer
+{
+private:
+    /// RAII wrapper for the io_uring instance
+    struct ring_t : public io_uring
+    {
+        explicit ring_t(unsigned int entries);
+        ~ring_t();
+    };
+
+    ring_t ring;
+    /// Eventfd registered with the ring, for waking up
+    boost::asio::posix::stream_descriptor event_fd;
+    bool zero_copy;
+
+    // Arguments to the send_packets call that is in flight
+    int batch_first_packet = 0;
+    int batch_last_packet = 0;
+    int batch_first_msg = 0;
+    int batch_last_msg = 0;
+    /// Number of completions not yet reaped for the batch in flight
+    int pending = 0;
+    /// Result from each request (byte count or negated error code)
+    int msg_result[max_batch];
+
+    /// Submit the queued requests, retrying later on failure
+    void submit();
+    /// Collect completions
+    void completion_handler(const boost::system::error_code &error);
+    /// Update the items once all completions for a batch are reaped
+    void batch_done();
+
+    virtual void send_packets(int first_packet, int last_packet, int first_msg, int last_msg) override;
+
+public:
+    udp_uring_writer(
+        io_service_ref io_service,
+        boost::asio::ip::udp::socket &&socket,
+        const std::vector<boost::asio::ip::udp::endpoint> &endpoints,
+        const stream_config &config,
+        std::size_t buffer_size,
+        bool zero_copy);
+};
+
+udp_uring_writer::ring_t::ring_t(unsigned int entries)
+{
+    io_uring_params params{};
+    /* Zero-copy sends produce two completions per request. SUBMIT_ALL
+     * ensures that a bad request does not leave the rest of the batch
+     * stranded in the submission queue.
+     */
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+    params.cq_entries = 2 * entries;
+    int ret = io_uring_queue_init_params(entries, this, &params);
+    if (ret < 0)
+        throw_errno("io_uring_queue_init_params failed", -ret);
+}
+
+udp_uring_writer::ring_t::~ring_t()
+{
+    io_uring_queue_exit(this);
+}
+
+udp_uring_writer::udp_uring_writer(
+    io_service_ref io_service,
+    boost::asio::ip::udp::socket &&socket,
+    const std::vector<boost::asio::ip::udp::endpoint> &endpoints,
+    const stream_config &config,
+    std::size_t buffer_size,
+    bool zero_copy)
+    : udp_writer(std::move(io_service), std::move(socket), endpoints, config, buffer_size),
+    ring(max_batch),
+    event_fd(get_io_service()),
+    zero_copy(zero_copy)
+{
+    // io_uring waits for socket buffer space itself
+    this->socket.non_blocking(false);
+    int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (efd < 0)
+        throw_errno("eventfd failed");
+    event_fd.assign(efd);
+    int ret = io_uring_register_eventfd(&ring, efd);
+    if (ret < 0)
+        throw_errno("io_uring_register_eventfd failed", -ret);
+}
+
+void udp_uring_writer::send_packets(int first_packet, int last_packet, int first_msg, int last_msg)
+{
+    const int fd = socket.native_handle();
+    for (int i = first_msg; i < last_msg; i++)
+    {
+        io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+        // The submission queue has room for max_batch requests
+        assert(sqe);
+        if (zero_copy)
+            io_uring_prep_sendmsg_zc(sqe, fd, &msgvec[i].msg_hdr, 0);
+        else
+            io_uring_prep_sendmsg(sqe, fd, &msgvec[i].msg_hdr, 0);
+        io_uring_sqe_set_data64(sqe, i);
+        if (i + 1 < last_msg)
+            sqe->flags |= IOSQE_IO_LINK;
+        msg_result[i] = -ECANCELED;
+    }
+    batch_first_packet = first_packet;
+    batch_last_packet = last_packet;
+    batch_first_msg = first_msg;
+    batch_last_msg = last_msg;
+    pending = last_msg - first_msg;
+    submit();
+}
+
+void udp_uring_writer::submit()
+{
+    int ret = io_uring_submit(&ring);
+    if (ret < 0)
+    {
+        // The requests are still in the submission queue, so try again later
+        std::error_code code(-ret, std::system_category());
+        log_warning("io_uring_submit failed: %1% (%2%)", code.value(), code.message());
+        boost::asio::post(get_io_service(), [this]() { submit(); });
+        return;
+    }
+    event_fd.async_wait(
+        event_fd.wait_read,
+        [this](const boost::system::error_code &error) { completion_handler(error); });
+}
+
+void udp_uring_writer::completion_handler(const boost::system::error_code &error)
+{
+    if (error == boost::asio::error::operation_aborted)
+        return;
+    else if (error)
+        log_warning("Error waiting for io_uring completions: %1%", error.message());
+
+    /* Reset the eventfd before looking at the completion queue, so that any
+     * completions that arrive after this point will wake us up again.
+     */
+    std::uint64_t counter;
+    [[maybe_unused]] ssize_t result = read(event_fd.native_handle(), &counter, sizeof(counter));
+
+    unsigned int head;
+    unsigned int seen = 0;
+    io_uring_cqe *cqe;
+    io_uring_for_each_cqe(&ring, head, cqe)
+    {
+        seen++;
+        pending--;
+        // Notifications just indicate that the kernel is done with the memory
+        if (cqe->flags & IORING_CQE_F_NOTIF)
+            continue;
+        msg_result[io_uring_cqe_get_data64(cqe)] = cqe->res;
+        if (cqe->flags & IORING_CQE_F_MORE)
+            pending++;  // a notification will follow
+    }
+    io_uring_cq_advance(&ring, seen);
+
+    if (pending > 0)
+    {
+        event_fd.async_wait(
+            event_fd.wait_read,
+            [this](const boost::system::error_code &error) { completion_handler(error); });
+    }
+    else
+        batch_done();
+}
+
+void udp_uring_writer::batch_done()
+{
+    int first_packet = batch_first_packet;
+    int last_packet = batch_last_packet;
+    int first_msg = batch_first_msg;
+    int last_msg = batch_last_msg;
+    int groups = 0;
+    bool wait_write = false;
+
+    int sent = 0;
+    while (first_msg + sent < last_msg && msg_result[first_msg + sent] >= 0)
+        sent++;
+    if (sent > 0)
+        messages_sent(first_packet, last_packet, first_msg, sent, groups);
+    if (first_msg < last_msg)
+    {
+        // The requests after the failed one were cancelled, and are resubmitted
+        int err = -msg_result[first_msg];
+        if (err == EAGAIN || err == EWOULDBLOCK)
+            wait_write = true;
+        else
+        {
+            boost::system::error_code result(err, boost::asio::error::get_system_category());
+            if (!retry_without_gso(first_packet, last_packet, first_msg, last_msg))
+                message_failed(first_packet, last_packet, first_msg, result, groups);
+        }
+    }
+
+    if (groups > 0)
+        groups_completed(groups);
+    if (first_msg < last_msg)
+    {
+        if (wait_write)
+        {
+            socket.async_wait(
+                socket.wait_write,
+                [this, first_packet, last_packet, first_msg, last_msg](
+                    const boost::system::error_code &
+                ) {
+                    send_packets(first_packet, last_packet, first_msg, last_msg);
+                });
+        }
+        else
+            send_packets(first_packet, last_packet, first_msg, last_msg);
+    }
+    else
+    {
+        post_wakeup();
+    }
+}
+
+#endif // SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+
 } // anonymous namespace
 
 static boost::asio::ip::udp::socket make_socket(
@@ -547,4 +834,75 @@ udp_stream::udp_stream(
 {
 }
 
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+
+udp_uring_config &udp_uring_config::set_endpoints(const std::vector<boost::asio::ip::udp::endpoint> &endpoints)
+{
+    this->endpoints = endpoints;
+    return *this;
+}
+
+udp_uring_config &udp_uring_config::add_endpoint(const boost::asio::ip::udp::endpoint &endpoint)
+{
+    endpoints.push_back(endpoint);
+    return *this;
+}
+
+udp_uring_config &udp_uring_config::set_interface_address(const boost::asio::ip::address &interface_address)
+{
+    this->interface_address = interface_address;
+    return *this;
+}
+
+udp_uring_config &udp_uring_config::set_buffer_size(std::size_t buffer_size)
+{
+    this->buffer_size = buffer_size;
+    return *this;
+}
+
+udp_uring_config &udp_uring_config::set_ttl(std::uint8_t ttl)
+{
+    this->ttl = ttl;
+    return *this;
+}
+
+udp_uring_config &udp_uring_config::set_zero_copy(bool zero_copy)
+{
+    this->zero_copy = zero_copy;
+    return *this;
+}
+
+static boost::asio::ip::udp::socket make_uring_socket(
+    boost::asio::io_service &io_service,
+    const udp_uring_config &uring_config)
+{
+    const auto &endpoints = uring_config.get_endpoints();
+    const auto &interface_address = uring_config.get_interface_address();
+    auto protocol = get_protocol(endpoints);
+    if (!endpoints[0].address().is_multicast())
+        return make_socket(io_service, protocol, interface_address);
+    else if (endpoints[0].address().is_v4())
+        return make_multicast_v4_socket(io_service, endpoints, uring_config.get_ttl(), interface_address);
+    else if (interface_address.is_unspecified())
+        return make_multicast_socket(io_service, endpoints, uring_config.get_ttl());
+    else
+        throw std::invalid_argument("interface address is not supported for IPv6 multicast");
+}
+
+udp_uring_stream::udp_uring_stream(
+    io_service_ref io_service,
+    const stream_config &config,
+    const udp_uring_config &uring_config)
+    : stream(std::make_unique<udp_uring_writer>(
+        io_service,
+        make_uring_socket(*io_service, uring_config),
+        uring_config.get_endpoints(),
+        config,
+        uring_config.get_buffer_size(),
+        uring_config.get_zero_copy()))
+{
+}
+
+#endif // SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+
 } // namespace spead2::send
@@ -0,0 +1,320 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_XDP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+#include <spead2/common_raw_packet.h>
+#include <spead2/common_xdp.h>
+#include <spead2/send_udp_xdp.h>
+#include <spead2/send_stream.h>
+#include <spead2/send_writer.h>
+
+namespace spead2
+{
+namespace send
+{
+
+namespace
+{
+
+static constexpr std::size_t header_length =
+    ethernet_frame::min_size + ipv4_packet::min_size + udp_packet::min_size;
+static constexpr std::size_t frame_size = spead2::detail::xdp_socket::frame_size;
+
+/**
+ * Writer using an AF_XDP socket. Only IPv4 multicast is supported. Each
+ * UMEM frame is used as a slot holding one packet, and slots are used and
+ * completed in order.
+ */
+class udp_xdp_writer : public writer
+{
+private:
+    struct slot : public boost::noncopyable
+    {
+        ethernet_frame frame;
+        std::uint8_t *payload;         ///< points to UDP payload within frame
+        std::size_t payload_size;
+        detail::queue_item *item = nullptr;
+        bool last;   ///< Last packet in the heap
+    };
+
+    boost::asio::ip::udp::socket socket; // used only to assign a source UDP port
+    const std::vector<boost::asio::ip::udp::endpoint> endpoints;
+    std::vector<mac_address> mac_addresses; ///< MAC addresses corresponding to endpoints
+    spead2::detail::xdp_socket xsk;
+    const std::size_t n_slots;
+    const std::size_t target_batch;
+    std::unique_ptr<slot[]> slots;
+    std::size_t head = 0, tail = 0;
+    std::size_t available;
+    const int max_poll;
+
+    /**
+     * Clear out the completion ring and return slots to the queue.
+     * It will stop after freeing up @ref target_batch slots or
+     * find no completions @ref max_poll times.
+     *
+     * Returns @c true if there are possibly more completions still to come.
+     */
+    bool reap();
+
+    virtual void wakeup() override final;
+
+public:
+    udp_xdp_writer(
+        io_service_ref io_service,
+        const stream_config &config,
+        const udp_xdp_config &xdp_config);
+
+    virtual std::size_t get_num_substreams() const override final { return endpoints.size(); }
+};
+
+bool udp_xdp_writer::reap()
+{
+    int retries = max_poll;
+    int groups = 0;
+    std::size_t min_available = std::min(n_slots, available + target_batch);
+    while (available < min_available)
+    {
+        // In copy mode the kernel only transmits a limited number of
+        // packets per system call, so it needs to be kicked repeatedly.
+        xsk.wakeup_tx();
+        std::uint32_t done = xsk.completion.available();
+        if (done == 0)
+        {
+            retries--;
+            if (retries <= 0)
+                break;
+            else
+                continue;
+        }
+
+        for (std::uint32_t i = 0; i < done; i++)
+        {
+            const slot *s = &slots[head];
+            assert(xsk.completion[xsk.completion.consumer_index() + i] == head * frame_size);
+            s->item->bytes_sent += s->payload_size;
+            groups += s->last;
+            if (++head == n_slots)
+                head = 0;
+        }
+        xsk.completion.consume(done);
+        available += done;
+    }
+    if (groups > 0)
+        groups_completed(groups);
+    return available < n_slots && retries > 0;
+}
+
+void udp_xdp_writer::wakeup()
+{
+    bool more_completions = reap();
+    if (available < target_batch)
+    {
+        // There is no completion notification, so poll for space
+        post_wakeup();
+        return;
+    }
+
+    std::size_t i;
+    packet_result result;
+    std::uint32_t first = xsk.tx.producer_index();
+    for (i = 0; i < target_batch; i++)
+    {
+        slot *s = &slots[tail];
+        transmit_packet data;
+        result = get_packet(data, s->payload);
+        if (result != packet_result::SUCCESS)
+            break;
+
+        std::size_t payload_size = data.size;
+        ipv4_packet ipv4 = s->frame.payload_ipv4();
+        ipv4.total_length(payload_size + udp_packet::min_size + ipv4.header_length());
+        udp_packet udp = ipv4.payload_udp();
+        udp.length(payload_size + udp_packet::min_size);
+        if (get_num_substreams() > 1)
+        {
+            const std::size_t substream_index = data.substream_index;
+            const auto &endpoint = endpoints[substream_index];
+            s->frame.destination_mac(mac_addresses[substream_index]);
+            ipv4.destination_address(endpoint.address().to_v4());
+            udp.destination_port(endpoint.port());
+        }
+        ipv4.update_checksum();
+        // The packet_generator writes the SPEAD header and item pointers
+        // directly into the payload. Everything else has to be copied
+        // into the UMEM.
+        assert(boost::asio::buffer_cast<const std::uint8_t *>(data.buffers[0]) == s->payload);
+        std::uint8_t *copy_target = s->payload + boost::asio::buffer_size(data.buffers[0]);
+        for (std::size_t j = 1; j < data.buffers.size(); j++)
+        {
+            const auto &buffer = data.buffers[j];
+            std::size_t length = boost::asio::buffer_size(buffer);
+            std::memcpy(copy_target, boost::asio::buffer_cast<const std::uint8_t *>(buffer), length);
+            copy_target += length;
+        }
+
+        xdp_desc &desc = xsk.tx[first + i];
+        desc.addr = tail * frame_size;
+        desc.len = copy_target - s->frame.data();
+        desc.options = 0;
+        s->payload_size = payload_size;
+        s->item = data.item;
+        s->last = data.last;
+
+        if (++tail == n_slots)
+            tail = 0;
+        available--;
+    }
+
+    if (i > 0)
+    {
+        xsk.tx.produce(i);
+        xsk.wakeup_tx();
+    }
+
+    if (i > 0 || more_completions)
+    {
+        /* There may be more completions immediately available (either existing
+         * ones, or for the packets we've just posted).
+         */
+        post_wakeup();
+    }
+    else if (result == packet_result::SLEEP)
+        sleep();
+    else if (available < n_slots)
+    {
+        // Keep polling until the remaining packets have completed
+        post_wakeup();
+    }
+    else
+    {
+        assert(result == packet_result::EMPTY);
+        request_wakeup();
+    }
+}
+
+static std::size_t calc_target_batch(const stream_config &config, std::size_t n_slots)
+{
+    std::size_t packet_size = config.get_max_packet_size() + header_length;
+    return std::clamp(n_slots / 4, std::size_t(1), 262144 / packet_size);
+}
+
+// Check the configuration and return the interface index
+static unsigned int get_ifindex(const stream_config &config, const udp_xdp_config &xdp_config)
+{
+    if (xdp_config.get_endpoints().empty())
+        throw std::invalid_argument("endpoints is empty");
+    if (xdp_config.get_interface_address().is_unspecified())
+        throw std::invalid_argument("interface address has not been specified");
+    if (config.get_max_packet_size() + header_length > frame_size)
+        throw std::invalid_argument("max_packet_size is too large for an AF_XDP frame");
+    return interface_index(xdp_config.get_interface_address());
+}
+
+udp_xdp_writer::udp_xdp_writer(
+    io_service_ref io_service,
+    const stream_config &config,
+    const udp_xdp_config &xdp_config)
+    : writer(std::move(io_service), config),
+    socket(get_io_service(), boost::asio::ip::udp::v4()),
+    endpoints(xdp_config.get_endpoints()),
+    xsk(get_ifindex(config, xdp_config), xdp_config.get_queue_id(),
+        xdp_config.get_buffer_size(), xdp_config.get_mode(), false, true),
+    n_slots(xsk.get_n_frames()),
+    target_batch(calc_target_batch(config, n_slots)),
+    slots(new slot[n_slots]),
+    available(n_slots),
+    max_poll(xdp_config.get_max_poll())
+{
+    mac_addresses.reserve(endpoints.size());
+    for (const auto &endpoint : endpoints)
+        mac_addresses.push_back(multicast_mac(endpoint.address()));
+    const boost::asio::ip::address &interface_address = xdp_config.get_interface_address();
+    socket.bind(boost::asio::ip::udp::endpoint(interface_address, 0));
+
+    // We fill in the destination details for the first endpoint. If there are
+    // multiple endpoints, they'll get updated for each packet.
+    mac_address source_mac = interface_mac(interface_address);
+    for (std::size_t i = 0; i < n_slots; i++)
+    {
+        slots[i].frame = ethernet_frame(xsk.data(i * frame_size), frame_size);
+        slots[i].frame.destination_mac(mac_addresses[0]);
+        slots[i].frame.source_mac(source_mac);
+        slots[i].frame.ethertype(ipv4_packet::ethertype);
+        ipv4_packet ipv4 = slots[i].frame.payload_ipv4();
+        ipv4.version_ihl(0x45);  // IPv4, 20 byte header
+        // total_length will change later to the actual packet size
+        ipv4.total_length(config.get_max_packet_size() + ipv4_packet::min_size + udp_packet::min_size);
+        ipv4.flags_frag_off(ipv4_packet::flag_do_not_fragment);
+        ipv4.ttl(xdp_config.get_ttl());
+        ipv4.protocol(udp_packet::protocol);
+        ipv4.source_address(interface_address.to_v4());
+        ipv4.destination_address(endpoints[0].address().to_v4());
+        udp_packet udp = ipv4.payload_udp();
+        udp.source_port(socket.local_endpoint().port());
+        udp.destination_port(endpoints[0].port());
+        udp.length(config.get_max_packet_size() + udp_packet::min_size);
+        udp.checksum(0);
+        slots[i].payload = boost::asio::buffer_cast<std::uint8_t *>(udp.payload());
+    }
+}
+
+} // anonymous namespace
+
+void udp_xdp_config::validate_endpoint(const boost::asio::ip::udp::endpoint &endpoint)
+{
+    if (!endpoint.address().is_v4() || !endpoint.address().is_multicast())
+        throw std::invalid_argument("endpoint is not an IPv4 multicast address");
+}
+
+udp_xdp_config &udp_xdp_config::set_ttl(std::uint8_t ttl)
+{
+    this->ttl = ttl;
+    return *this;
+}
+
+udp_xdp_stream::udp_xdp_stream(
+    io_service_ref io_service,
+    const stream_config &config,
+    const udp_xdp_config &xdp_config)
+    : stream(std::make_unique<udp_xdp_writer>(std::move(io_service), config, xdp_config))
+{
+}
+
+} // namespace send
+
+template class detail::udp_xdp_config_base<send::udp_xdp_config>;
+
+} // namespace spead2
+
+#endif // SPEAD2_USE_XDP
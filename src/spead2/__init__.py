@@ -60,6 +60,10 @@ try:
     from spead2._spead2 import IbvContext  # noqa: F401
 except ImportError:
     pass
+try:
+    from spead2._spead2 import XdpMode  # noqa: F401
+except ImportError:
+    pass
 from spead2._version import __version__  # noqa: F401
 
 _logger = logging.getLogger(__name__)
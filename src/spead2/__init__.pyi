@@ -13,6 +13,7 @@
 # You should have received a copy of the GNU Lesser General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+import enum
 from collections.abc import KeysView, Sequence, ValuesView
 from typing import Any, overload
 
@@ -55,6 +56,12 @@ CTRL_DESCRIPTOR_UPDATE: int
 
 MEMCPY_STD: int
 MEMCPY_NONTEMPORAL: int
+CONVERT_BSWAP16: int
+CONVERT_BSWAP32: int
+CONVERT_BSWAP64: int
+CONVERT_INT8_INT16: int
+CONVERT_INT16_FLOAT32: int
+CONVERT_INT16BE_FLOAT32: int
 
 class Stopped(RuntimeError): ...
 class Empty(RuntimeError): ...
@@ -84,15 +91,27 @@ class ThreadPool:
     def __init__(self, threads: int, affinity: list[int]) -> None: ...
     @staticmethod
     def set_affinity(core: int) -> None: ...
+    @staticmethod
+    def get_core_numa_node(core: int) -> int: ...
+    @property
+    def numa_node(self) -> int: ...
 
 class MemoryAllocator:
     def __init__(self) -> None: ...
 
 class MmapAllocator(MemoryAllocator):
-    def __init__(self, flags: int = ..., prefer_huge: bool = ...) -> None: ...
+    def __init__(self, flags: int = ..., prefer_huge: bool = ..., numa_node: int = ...) -> None: ...
+    @property
+    def numa_node(self) -> int: ...
 
 class MemoryPool(MemoryAllocator):
     warn_on_empty: bool
+    thread_cache_size: int
+    @property
+    def hits(self) -> int: ...
+    @property
+    def misses(self) -> int: ...
+    def warm_up(self, thread_pool: ThreadPool, n: int) -> None: ...
 
     @overload
     def __init__(
@@ -115,6 +134,44 @@ class MemoryPool(MemoryAllocator):
         allocator: MemoryAllocator | None = None,
     ) -> None: ...
 
+class SlabAllocator(MemoryAllocator):
+    class ClassStats:
+        @property
+        def size(self) -> int: ...
+        @property
+        def hits(self) -> int: ...
+        @property
+        def misses(self) -> int: ...
+
+    @overload
+    def __init__(
+        self,
+        min_size: int,
+        max_size: int,
+        max_free: int,
+        initial: int,
+        allocator: MemoryAllocator | None = None,
+    ) -> None: ...
+    @overload
+    def __init__(
+        self,
+        thread_pool: ThreadPool,
+        min_size: int,
+        max_size: int,
+        max_free: int,
+        initial: int,
+        low_water: int,
+        allocator: MemoryAllocator | None = None,
+    ) -> None: ...
+    @property
+    def num_classes(self) -> int: ...
+    @property
+    def max_size(self) -> int: ...
+    @property
+    def stats(self) -> list[SlabAllocator.ClassStats]: ...
+    def set_warn_on_empty(self, warn: bool) -> None: ...
+    def set_thread_cache_size(self, size: int) -> None: ...
+
 class InprocQueue:
     def __init__(self) -> None: ...
     def add_packet(self, packet) -> None: ...
@@ -136,7 +193,13 @@ class IbvContext:
     def __init__(self, interface_address: str) -> None: ...
     def reset(self) -> None: ...
 
+class XdpMode(enum.Enum):
+    AUTO = ...
+    COPY = ...
+    ZERO_COPY = ...
+
 def parse_range_list(ranges: str) -> list[int]: ...
+def prefault(thread_pool: ThreadPool, buffer: Any, parts: int) -> None: ...
 
 class Descriptor:
     id: int
@@ -81,6 +81,11 @@ try:
 except ImportError:
     pass
 
+try:
+    from spead2._spead2.recv import UdpXdpConfig  # noqa: F401
+except ImportError:
+    pass
+
 
 # Ideally we'd inherit from _Sequence, but that gives errors about
 # mismatched metaclasses. So instead we copy the mixin methods.
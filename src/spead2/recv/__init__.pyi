@@ -74,6 +74,7 @@ class StreamStats:
     max_batch: int
     single_packet_heaps: int
     search_dist: int
+    metadata_allocations: int
     @property
     def config(self) -> list[StreamStatConfig]: ...
     @overload
@@ -94,18 +95,43 @@ class StreamStats:
     def __add__(self, other: StreamStats) -> StreamStats: ...
     def __iadd__(self, other: StreamStats) -> Self: ...
 
+class PcapWriter:
+    DEFAULT_BUFFER_SIZE: ClassVar[int]
+    DEFAULT_BUFFERS: ClassVar[int]
+    def __init__(self, filename: str, buffer_size: int = ..., buffers: int = ...) -> None: ...
+    def flush(self) -> None: ...
+    def close(self) -> None: ...
+    @property
+    def dropped(self) -> int: ...
+
+class MemcpyScatter:
+    def __init__(self, row_size: int, row_stride: int, memcpy: int = ...) -> None: ...
+    @property
+    def row_size(self) -> int: ...
+    @property
+    def row_stride(self) -> int: ...
+    @property
+    def memcpy(self) -> int: ...
+
+class MemcpyConvert:
+    def __init__(self, convert: int) -> None: ...
+    @property
+    def convert(self) -> int: ...
+
 class StreamConfig:
     DEFAULT_MAX_HEAPS: ClassVar[int] = ...
     max_heaps: int
     substreams: int
+    shards: int
     bug_compat: int
-    memcpy: int
+    memcpy: int | MemcpyScatter | MemcpyConvert
     memory_allocator: spead2.MemoryAllocator
     stop_on_stop_item: bool
     allow_unsized_heaps: bool
     allow_out_of_order: bool
     stream_id: int
     explicit_start: bool
+    packet_tap: PcapWriter | None
     @property
     def stats(self) -> list[StreamStatConfig]: ...
     def __init__(
@@ -113,14 +139,16 @@ class StreamConfig:
         *,
         max_heaps: int = ...,
         substreams: int = ...,
+        shards: int = ...,
         bug_compat: int = ...,
-        memcpy: int = ...,
+        memcpy: int | MemcpyScatter | MemcpyConvert = ...,
         memory_allocator: spead2.MemoryAllocator = ...,
         stop_on_stop_item: bool = ...,
         allow_unsized_heaps: bool = ...,
         allow_out_of_order: bool = ...,
         stream_id: int = ...,
         explicit_start: bool = ...,
+        packet_tap: PcapWriter | None = ...,
     ) -> None: ...
     def add_stat(self, name: str, mode: StreamStatConfig.Mode = ...) -> int: ...
     def get_stat_index(self, name: str) -> int: ...
@@ -139,6 +167,14 @@ class RingStreamConfig:
         incomplete_keep_payload_ranges: bool = ...,
     ) -> None: ...
 
+class UdpPollConfig:
+    max_poll: int
+    busy_poll: int
+    prefer_busy_poll: bool
+    def __init__(
+        self, *, max_poll: int = ..., busy_poll: int = ..., prefer_busy_poll: bool = ...
+    ) -> None: ...
+
 class UdpIbvConfig:
     DEFAULT_BUFFER_SIZE: ClassVar[int]
     DEFAULT_MAX_SIZE: ClassVar[int]
@@ -162,6 +198,31 @@ class UdpIbvConfig:
         max_poll: int = ...,
     ) -> None: ...
 
+class UdpXdpConfig:
+    DEFAULT_BUFFER_SIZE: ClassVar[int]
+    DEFAULT_MAX_SIZE: ClassVar[int]
+    DEFAULT_MAX_POLL: ClassVar[int]
+
+    endpoints: _EndpointList
+    interface_address: str
+    buffer_size: int
+    max_size: int
+    queue_id: int
+    mode: spead2.XdpMode
+    max_poll: int
+
+    def __init__(
+        self,
+        *,
+        endpoints: _EndpointList = ...,
+        interface_address: str = ...,
+        buffer_size: int = ...,
+        max_size: int = ...,
+        queue_id: int = ...,
+        mode: spead2.XdpMode = ...,
+        max_poll: int = ...,
+    ) -> None: ...
+
 class Ringbuffer:
     def size(self) -> int: ...
     def capacity(self) -> int: ...
@@ -175,10 +236,17 @@ class _Stream:
     def add_buffer_reader(self, buffer: Any) -> None: ...
     @overload
     def add_udp_reader(
-        self, port: int, max_size: int = ..., buffer_size: int = ..., bind_hostname: str = ...
+        self,
+        port: int,
+        max_size: int = ...,
+        buffer_size: int = ...,
+        bind_hostname: str = ...,
+        poll_config: UdpPollConfig = ...,
     ) -> None: ...
     @overload
-    def add_udp_reader(self, socket: socket.socket, max_size: int = ...) -> None: ...
+    def add_udp_reader(
+        self, socket: socket.socket, max_size: int = ..., poll_config: UdpPollConfig = ...
+    ) -> None: ...
     @overload
     def add_udp_reader(
         self,
@@ -187,6 +255,7 @@ class _Stream:
         max_size: int = ...,
         buffer_size: int = ...,
         interface_address: str = ...,
+        poll_config: UdpPollConfig = ...,
     ) -> None: ...
     @overload
     def add_udp_reader(
@@ -196,6 +265,7 @@ class _Stream:
         max_size: int = ...,
         buffer_size: int = ...,
         interface_index: int = ...,
+        poll_config: UdpPollConfig = ...,
     ) -> None: ...
     @overload
     def add_tcp_reader(
@@ -204,7 +274,22 @@ class _Stream:
     @overload
     def add_tcp_reader(self, acceptor: socket.socket, max_size: int = ...) -> None: ...
     def add_udp_ibv_reader(self, config: UdpIbvConfig) -> None: ...
+    def add_udp_xdp_reader(self, config: UdpXdpConfig) -> None: ...
+    @overload
+    def add_udp_uring_reader(
+        self, port: int, max_size: int = ..., buffer_size: int = ..., bind_hostname: str = ...
+    ) -> None: ...
+    @overload
+    def add_udp_uring_reader(
+        self,
+        multicast_group: str,
+        port: int,
+        max_size: int = ...,
+        buffer_size: int = ...,
+        interface_address: str = ...,
+    ) -> None: ...
     def add_udp_pcap_file_reader(self, filename: str, filter: str = ...) -> None: ...
+    def add_udp_pcap_replay_reader(self, filename: str, speed: float = ...) -> None: ...
     def add_inproc_reader(self, queue: spead2.InprocQueue) -> None: ...
     def start(self) -> None: ...
     def stop(self) -> None: ...
@@ -224,6 +309,7 @@ class _RingStream(_Stream):
     ) -> None: ...
     def __iter__(self) -> Iterator[Heap]: ...
     def get_nowait(self) -> Heap: ...
+    def get_many_nowait(self, max_heaps: int) -> list[Heap | IncompleteHeap]: ...
     @property
     def fd(self) -> int: ...
     @property
@@ -233,6 +319,29 @@ class _RingStream(_Stream):
 
 class Stream(_RingStream):
     def get(self) -> Heap: ...
+    def get_many(self, max_heaps: int) -> list[Heap | IncompleteHeap]: ...
+
+class ChunkPlaceAffine:
+    timestamp_item: int
+    timestamp_step: int
+    timestamps_per_chunk: int
+    channel_item: int | None
+    channel_step: int
+    channels: int
+    heap_size: int
+    @property
+    def heaps_per_chunk(self) -> int: ...
+    def __init__(
+        self,
+        *,
+        timestamp_item: int = ...,
+        timestamp_step: int = ...,
+        timestamps_per_chunk: int = ...,
+        channel_item: int | None = ...,
+        channel_step: int = ...,
+        channels: int = ...,
+        heap_size: int = ...,
+    ) -> None: ...
 
 class ChunkStreamConfig:
     DEFAULT_MAX_CHUNKS: ClassVar[int]
@@ -240,7 +349,10 @@ class ChunkStreamConfig:
     items: list[int]
     max_chunks: int
     place: tuple | None
+    place_batch: tuple | None
+    place_affine: ChunkPlaceAffine | None
     max_heap_extra: int
+    direct_placement: bool
     def enable_packet_presence(self, payload_size: int) -> None: ...
     def disable_packet_presence(self) -> None: ...
     @property
@@ -251,7 +363,10 @@ class ChunkStreamConfig:
         items: list[int] = ...,
         max_chunks: int = ...,
         place: tuple | None = ...,
+        place_batch: tuple | None = ...,
+        place_affine: ChunkPlaceAffine | None = ...,
         max_heap_extra: int = ...,
+        direct_placement: bool = ...,
     ) -> None: ...
 
 class Chunk:
@@ -347,3 +462,7 @@ class ChunkStreamRingGroup(ChunkRingPair, collections.abc.Sequence[ChunkStreamGr
     def __len__(self) -> int: ...
 
 class ChunkStreamGroupMember(_Stream): ...
+
+def make_udp_reuseport_sockets(
+    n: int, port: int, bind_hostname: str = ..., buffer_size: int = ...
+) -> list[socket.socket]: ...
@@ -130,6 +130,12 @@ class Stream(spead2.recv.Stream):
         """Coroutine that waits for a heap to become available and returns it."""
         return await self._queue.wait(self.get_nowait)
 
+    async def get_many(self, max_heaps):
+        """Coroutine that waits for at least one heap to become available
+        and returns a list of up to `max_heaps` heaps.
+        """
+        return await self._queue.wait(lambda: self.get_many_nowait(max_heaps))
+
     def __aiter__(self):
         return self
 
@@ -20,6 +20,9 @@ import spead2.recv
 
 class Stream(spead2.recv._RingStream):
     async def get(self) -> spead2.recv.Heap: ...
+    async def get_many(
+        self, max_heaps: int
+    ) -> list[spead2.recv.Heap | spead2.recv.IncompleteHeap]: ...
     def __aiter__(self) -> AsyncIterator[spead2.recv.Heap]: ...
 
 class ChunkRingbuffer(spead2.recv._ChunkRingbuffer):
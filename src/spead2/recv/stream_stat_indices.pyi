@@ -22,3 +22,4 @@ MAX_BATCH: int
 SINGLE_PACKET_HEAPS: int
 SEARCH_DIST: int
 WORKER_BLOCKED: int
+METADATA_ALLOCATIONS: int
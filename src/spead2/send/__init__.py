@@ -38,6 +38,16 @@ try:
 except ImportError:
     pass
 
+try:
+    from spead2._spead2.send import UdpUringConfig, UdpUringStream  # noqa: F401
+except ImportError:
+    pass
+
+try:
+    from spead2._spead2.send import UdpXdpConfig, UdpXdpStream  # noqa: F401
+except ImportError:
+    pass
+
 
 class _ItemInfo:
     def __init__(self, item):
@@ -223,6 +223,66 @@ class _UdpIbvStream:
 
 class UdpIbvStream(_UdpIbvStream, SyncStream): ...
 
+class UdpUringConfig:
+    DEFAULT_BUFFER_SIZE: ClassVar[int]
+
+    endpoints: _EndpointList
+    interface_address: str
+    buffer_size: int
+    ttl: int
+    zero_copy: bool
+
+    def __init__(
+        self,
+        *,
+        endpoints: _EndpointList = ...,
+        interface_address: str = ...,
+        buffer_size: int = ...,
+        ttl: int = ...,
+        zero_copy: bool = ...,
+    ) -> None: ...
+
+class _UdpUringStream:
+    def __init__(
+        self,
+        thread_pool: spead2.ThreadPool,
+        config: StreamConfig,
+        udp_uring_config: UdpUringConfig,
+    ) -> None: ...
+
+class UdpUringStream(_UdpUringStream, SyncStream): ...
+
+class UdpXdpConfig:
+    DEFAULT_BUFFER_SIZE: ClassVar[int]
+    DEFAULT_MAX_POLL: ClassVar[int]
+
+    endpoints: _EndpointList
+    interface_address: str
+    buffer_size: int
+    ttl: int
+    queue_id: int
+    mode: spead2.XdpMode
+    max_poll: int
+
+    def __init__(
+        self,
+        *,
+        endpoints: _EndpointList = ...,
+        interface_address: str = ...,
+        buffer_size: int = ...,
+        ttl: int = ...,
+        queue_id: int = ...,
+        mode: spead2.XdpMode = ...,
+        max_poll: int = ...,
+    ) -> None: ...
+
+class _UdpXdpStream:
+    def __init__(
+        self, thread_pool: spead2.ThreadPool, config: StreamConfig, udp_xdp_config: UdpXdpConfig
+    ) -> None: ...
+
+class UdpXdpStream(_UdpXdpStream, SyncStream): ...
+
 class _TcpStream:
     DEFAULT_BUFFER_SIZE: ClassVar[int]
 
@@ -225,3 +225,41 @@ try:
 
 except ImportError:
     pass
+
+try:
+    from spead2._spead2.send import UdpUringStreamAsyncio as _UdpUringStreamAsyncio
+
+    UdpUringStream = _wrap_class("UdpUringStream", _UdpUringStreamAsyncio)
+    UdpUringStream.__doc__ = """Like :class:`UdpStream`, but using io_uring.
+
+        Parameters
+        ----------
+        thread_pool : :py:class:`spead2.ThreadPool`
+            Thread pool handling the I/O
+        config : :py:class:`spead2.send.StreamConfig`
+            Stream configuration
+        udp_uring_config : :py:class:`spead2.send.UdpUringConfig`
+            Additional stream configuration
+        """
+
+except ImportError:
+    pass
+
+try:
+    from spead2._spead2.send import UdpXdpStreamAsyncio as _UdpXdpStreamAsyncio
+
+    UdpXdpStream = _wrap_class("UdpXdpStream", _UdpXdpStreamAsyncio)
+    UdpXdpStream.__doc__ = """Like :class:`UdpStream`, but using an AF_XDP socket.
+
+        Parameters
+        ----------
+        thread_pool : :py:class:`spead2.ThreadPool`
+            Thread pool handling the I/O
+        config : :py:class:`spead2.send.StreamConfig`
+            Stream configuration
+        udp_xdp_config : :py:class:`spead2.send.UdpXdpConfig`
+            Additional stream configuration
+        """
+
+except ImportError:
+    pass
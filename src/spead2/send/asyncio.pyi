@@ -36,6 +36,8 @@ class AsyncStream(spead2.send.Stream):
 
 class UdpStream(spead2.send._UdpStream, AsyncStream): ...
 class UdpIbvStream(spead2.send._UdpIbvStream, AsyncStream): ...
+class UdpUringStream(spead2.send._UdpUringStream, AsyncStream): ...
+class UdpXdpStream(spead2.send._UdpXdpStream, AsyncStream): ...
 
 class TcpStream(spead2.send._TcpStream, AsyncStream):
     def __init__(
@@ -110,6 +110,9 @@ class AgentConnection:
                     if hasattr(receiver, "ibv") and not hasattr(stream, "add_udp_ibv_reader"):
                         logging.error("--recv-ibv passed but agent does not support ibv")
                         sys.exit(1)
+                    if hasattr(receiver, "uring") and not hasattr(stream, "add_udp_uring_reader"):
+                        logging.error("--recv-uring passed but agent does not support io_uring")
+                        sys.exit(1)
 
                     endpoint = args.multicast or args.endpoint
                     receiver.add_readers(stream, [endpoint])
@@ -310,6 +313,8 @@ def main():
         "ibv": "send_ibv",
         "ibv_vector": "send_ibv_vector",
         "ibv_max_poll": "send_ibv_max_poll",
+        "uring": "send_uring",
+        "uring_zero_copy": "send_uring_zero_copy",
         "affinity": "send-affinity",
         "threads": "send-threads",
     }
@@ -319,11 +324,13 @@ def main():
         "ibv": "recv_ibv",
         "ibv_vector": "recv_ibv_vector",
         "ibv_max_poll": "recv_ibv_max_poll",
+        "uring": "recv_uring",
         "affinity": "recv-affinity",
         "threads": "recv-threads",
         "mem_pool": None,
         "mem_lower": None,
         "mem_upper": None,
+        "pcap_speed": None,  # The benchmark never reads pcap files
     }
     protocol = cmdline.ProtocolOptions(name_map={"tcp": None})
     sender = cmdline.SenderOptions(protocol, name_map=sender_map)
@@ -21,6 +21,8 @@ import spead2.recv
 import spead2.send
 
 _HAVE_IBV = hasattr(spead2.recv.Stream, "add_udp_ibv_reader")
+_HAVE_URING_RECV = hasattr(spead2.recv.Stream, "add_udp_uring_reader")
+_HAVE_URING_SEND = hasattr(spead2.send, "UdpUringConfig")
 
 
 def parse_endpoint(endpoint):
@@ -175,8 +177,11 @@ class ReceiverOptions(SharedOptions):
         self.mem_max_free = 12
         self.mem_initial = 8
         self.packet = None
+        self.pcap_speed = 0.0
         if _HAVE_IBV:
             self.ibv_max_poll = spead2.recv.UdpIbvConfig.DEFAULT_MAX_POLL
+        if _HAVE_URING_RECV:
+            self.uring = False
 
     def add_arguments(self, parser):
         self._add_argument(parser, "memcpy_nt", action="store_true", help="Use non-temporal memcpy")
@@ -212,15 +217,31 @@ class ReceiverOptions(SharedOptions):
             parser, "mem_initial", type=int, help="Initial free memory buffers [%(default)s]"
         )
         self._add_argument(parser, "packet", type=int, help="Maximum packet size to accept")
+        self._add_argument(
+            parser,
+            "pcap_speed",
+            type=float,
+            help="Replay pcap files at this multiple of the capture rate "
+            "(0 for as fast as possible) [%(default)s]",
+        )
+        if _HAVE_URING_RECV:
+            self._add_argument(parser, "uring", action="store_true", help="Use io_uring [no]")
         super().add_arguments(parser)
 
     def notify(self, parser, namespace):
         self._extract_args(namespace)
+        if not self.pcap_speed >= 0:
+            parser.error("--pcap-speed must be non-negative")
         if _HAVE_IBV:
             if self.ibv and not self.bind:
                 parser.error("--ibv requires --bind")
             if self._protocol.tcp and self.ibv:
                 parser.error("--ibv and --tcp are incompatible")
+        if _HAVE_URING_RECV:
+            if self._protocol.tcp and self.uring:
+                parser.error("--uring and --tcp are incompatible")
+            if _HAVE_IBV and self.ibv and self.uring:
+                parser.error("--uring and --ibv are incompatible")
 
         if self.buffer is None:
             if self._protocol.tcp:
@@ -262,15 +283,21 @@ class ReceiverOptions(SharedOptions):
             except ValueError:
                 if not allow_pcap:
                     raise
-                try:
+                if self.pcap_speed == 0 and hasattr(stream, "add_udp_pcap_file_reader"):
                     stream.add_udp_pcap_file_reader(source)
-                except AttributeError:
-                    raise RuntimeError("spead2 was compiled without pcap support") from None
+                else:
+                    # spead2 was compiled without libpcap, or pacing was requested
+                    stream.add_udp_pcap_replay_reader(source, self.pcap_speed)
             else:
                 if self._protocol.tcp:
                     stream.add_tcp_reader(port, self.packet, self.buffer, host)
                 elif _HAVE_IBV and self.ibv:
                     ibv_endpoints.append((host, port))
+                elif _HAVE_URING_RECV and self.uring:
+                    if self.bind:
+                        stream.add_udp_uring_reader(host, port, self.packet, self.buffer, self.bind)
+                    else:
+                        stream.add_udp_uring_reader(port, self.packet, self.buffer, host)
                 elif self.bind:
                     stream.add_udp_reader(host, port, self.packet, self.buffer, self.bind)
                 else:
@@ -303,6 +330,9 @@ class SenderOptions(SharedOptions):
         self.ttl = None
         if _HAVE_IBV:
             self.ibv_max_poll = spead2.send.UdpIbvConfig.DEFAULT_MAX_POLL
+        if _HAVE_URING_SEND:
+            self.uring = False
+            self.uring_zero_copy = False
 
     def add_arguments(self, parser):
         def parse_rate_method(value):
@@ -345,6 +375,14 @@ class SenderOptions(SharedOptions):
             parser, "rate", metavar="Gb/s", type=float, help="Transmission rate bound [no limit]"
         )
         self._add_argument(parser, "ttl", type=int, help="TTL for multicast target")
+        if _HAVE_URING_SEND:
+            self._add_argument(parser, "uring", action="store_true", help="Use io_uring [no]")
+            self._add_argument(
+                parser,
+                "uring_zero_copy",
+                action="store_true",
+                help="Use zero-copy sends with io_uring [no]",
+            )
         super().add_arguments(parser)
 
     def notify(self, parser, namespace):
@@ -354,11 +392,20 @@ class SenderOptions(SharedOptions):
                 parser.error("--ibv requires --bind")
             if self._protocol.tcp and self.ibv:
                 parser.error("--ibv and --tcp are incompatible")
+        if _HAVE_URING_SEND:
+            if self._protocol.tcp and self.uring:
+                parser.error("--uring and --tcp are incompatible")
+            if _HAVE_IBV and self.ibv and self.uring:
+                parser.error("--uring and --ibv are incompatible")
+            if self.uring_zero_copy and not self.uring:
+                parser.error("--uring-zero-copy requires --uring")
         if self.buffer is None:
             if self._protocol.tcp:
                 self.buffer = spead2.send.asyncio.TcpStream.DEFAULT_BUFFER_SIZE
             elif _HAVE_IBV and self.ibv:
                 self.buffer = spead2.send.UdpIbvConfig.DEFAULT_BUFFER_SIZE
+            elif _HAVE_URING_SEND and self.uring:
+                self.buffer = spead2.send.UdpUringConfig.DEFAULT_BUFFER_SIZE
             else:
                 self.buffer = spead2.send.asyncio.UdpStream.DEFAULT_BUFFER_SIZE
 
@@ -396,6 +443,18 @@ class SenderOptions(SharedOptions):
                     memory_regions=memory_regions,
                 ),
             )
+        elif _HAVE_URING_SEND and self.uring:
+            return spead2.send.asyncio.UdpUringStream(
+                thread_pool,
+                config,
+                spead2.send.UdpUringConfig(
+                    endpoints=endpoints,
+                    interface_address=self.bind or "",
+                    buffer_size=self.buffer,
+                    ttl=self.ttl or 1,
+                    zero_copy=self.uring_zero_copy,
+                ),
+            )
         else:
             kwargs = {}
             if self.ttl is not None:
@@ -140,6 +140,8 @@ static options parse_args(int argc, const char **argv, command_mode mode)
     receiver_map["mem-pool"] = "";
     receiver_map["mem-lower"] = "";
     receiver_map["mem-upper"] = "";
+    // The benchmark never reads pcap files
+    receiver_map["pcap-speed"] = "";
     switch (mode)
     {
     case command_mode::MEM:
@@ -147,6 +149,7 @@ static options parse_args(int argc, const char **argv, command_mode mode)
         receiver_map["ibv"] = "";
         receiver_map["ibv-vector"] = "";
         receiver_map["ibv-max-poll"] = "";
+        receiver_map["uring"] = "";
         receiver_map["bind"] = "";
         break;
     case command_mode::MASTER:
@@ -155,12 +158,15 @@ static options parse_args(int argc, const char **argv, command_mode mode)
         receiver_map["ibv"] = "recv-ibv";
         receiver_map["ibv-vector"] = "recv-ibv-vector";
         receiver_map["ibv-max-poll"] = "recv-ibv-max-poll";
+        receiver_map["uring"] = "recv-uring";
         sender_map["bind"] = "send-bind";
         sender_map["buffer"] = "send-buffer";
         sender_map["packet"] = "";  // Packet size is taken from receiver
         sender_map["ibv"] = "send-ibv";
         sender_map["ibv-vector"] = "send-ibv-vector";
         sender_map["ibv-max-poll"] = "send-max-poll";
+        sender_map["uring"] = "send-uring";
+        sender_map["uring-zero-copy"] = "send-uring-zero-copy";
         sender_map["rate"] = "";   // Controlled by test
         break;
     case command_mode::AGENT:
@@ -32,12 +32,19 @@
 #if SPEAD2_USE_PCAP
 # include <spead2/recv_udp_pcap.h>
 #endif
+#include <spead2/recv_udp_pcap_replay.h>
 #include <spead2/send_tcp.h>
 #include <spead2/send_udp.h>
 #if SPEAD2_USE_IBV
 # include <spead2/recv_udp_ibv.h>
 # include <spead2/send_udp_ibv.h>
 #endif
+#if SPEAD2_USE_URING
+# include <spead2/recv_udp_uring.h>
+#endif
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+# include <spead2/send_udp_uring.h>
+#endif
 #include "spead2_cmdline.h"
 
 namespace po = boost::program_options;
@@ -116,6 +123,16 @@ void receiver_options::notify(const protocol_options &protocol)
     if (protocol.tcp && ibv)
         throw po::error("--ibv and --tcp are incompatible");
 #endif
+#if SPEAD2_USE_URING
+    if (protocol.tcp && uring)
+        throw po::error("--uring and --tcp are incompatible");
+#if SPEAD2_USE_IBV
+    if (ibv && uring)
+        throw po::error("--uring and --ibv are incompatible");
+#endif
+#endif
+    if (!(pcap_speed >= 0.0))
+        throw po::error("--pcap-speed must be non-negative");
 
     if (!buffer_size)
     {
@@ -173,6 +190,9 @@ void receiver_options::add_readers(
 #if SPEAD2_USE_IBV
     std::vector<udp::endpoint> ibv_endpoints;
 #endif
+    auto poll_config = spead2::recv::udp_poll_config()
+        .set_max_poll(udp_max_poll)
+        .set_busy_poll(udp_busy_poll);
     for (const std::string &endpoint : endpoints)
     {
         std::string host = "";
@@ -210,10 +230,11 @@ void receiver_options::add_readers(
         if (is_pcap)
         {
 #if SPEAD2_USE_PCAP
-            stream.emplace_reader<udp_pcap_file_reader>(endpoint);
-#else
-            throw std::runtime_error("spead2 was compiled without pcap support");
+            if (pcap_speed == 0.0)
+                stream.emplace_reader<udp_pcap_file_reader>(endpoint);
+            else
 #endif
+                stream.emplace_reader<udp_pcap_replay_reader>(endpoint, pcap_speed);
         }
         else if (protocol.tcp)
         {
@@ -229,18 +250,38 @@ void receiver_options::add_readers(
                 ibv_endpoints.push_back(ep);
             }
             else
+#endif
+#if SPEAD2_USE_URING
+            if (uring)
+            {
+                if (ep.address().is_v4() && !interface_address.empty())
+                {
+                    stream.emplace_reader<spead2::recv::udp_uring_reader>(
+                        ep, *max_packet_size, *buffer_size,
+                        boost::asio::ip::address_v4::from_string(interface_address));
+                }
+                else
+                {
+                    if (!interface_address.empty())
+                        std::cerr << "--bind is not implemented for IPv6\n";
+                    stream.emplace_reader<spead2::recv::udp_uring_reader>(ep, *max_packet_size, *buffer_size);
+                }
+            }
+            else
 #endif
             if (ep.address().is_v4() && !interface_address.empty())
             {
                 stream.emplace_reader<spead2::recv::udp_reader>(
                     ep, *max_packet_size, *buffer_size,
-                    boost::asio::ip::address_v4::from_string(interface_address));
+                    boost::asio::ip::address_v4::from_string(interface_address),
+                    poll_config);
             }
             else
             {
                 if (!interface_address.empty())
                     std::cerr << "--bind is not implemented for IPv6\n";
-                stream.emplace_reader<spead2::recv::udp_reader>(ep, *max_packet_size, *buffer_size);
+                stream.emplace_reader<spead2::recv::udp_reader>(
+                    ep, *max_packet_size, *buffer_size, poll_config);
             }
         }
     }
@@ -302,6 +343,16 @@ void sender_options::notify(const protocol_options &protocol)
     if (ibv && interface_address.empty())
         throw po::error("--ibv requires --bind");
 #endif
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+    if (protocol.tcp && uring)
+        throw po::error("--tcp and --uring cannot be used together");
+#if SPEAD2_USE_IBV
+    if (ibv && uring)
+        throw po::error("--ibv and --uring cannot be used together");
+#endif
+    if (uring_zero_copy && !uring)
+        throw po::error("--uring-zero-copy requires --uring");
+#endif
 
     if (!buffer_size)
     {
@@ -379,6 +430,20 @@ std::unique_ptr<stream> sender_options::make_stream(
         }
         else
 #endif // SPEAD2_USE_IBV
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+        if (uring)
+        {
+            udp_uring_config uring_config;
+            uring_config
+                .set_endpoints(ep)
+                .set_interface_address(interface_address)
+                .set_ttl(ttl)
+                .set_zero_copy(uring_zero_copy)
+                .set_buffer_size(*buffer_size);
+            stream.reset(new udp_uring_stream(io_service, config, uring_config));
+        }
+        else
+#endif // SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
         {
             if (ep[0].address().is_multicast())
             {
@@ -189,11 +189,17 @@ struct receiver_options
     boost::optional<std::size_t> buffer_size;
     boost::optional<std::size_t> max_packet_size;
     std::string interface_address;
+    int udp_max_poll = 1;
+    int udp_busy_poll = 0;
+    double pcap_speed = 0.0;
 #if SPEAD2_USE_IBV
     bool ibv = false;
     int ibv_comp_vector = 0;
     int ibv_max_poll = spead2::recv::udp_ibv_config::default_max_poll;
 #endif
+#if SPEAD2_USE_URING
+    bool uring = false;
+#endif
 
     void notify(const protocol_options &protocol);
 
@@ -213,10 +219,16 @@ struct receiver_options
         callback("mem-initial", "Initial free memory buffers", &mem_initial);
         callback("ring", "Use ringbuffer instead of callbacks", &ring);
         callback("memcpy-nt", "Use non-temporal memcpy", &memcpy_nt);
+        callback("udp-max-poll", "Maximum number of times to poll UDP sockets in a row", &udp_max_poll);
+        callback("udp-busy-poll", "SO_BUSY_POLL value for UDP sockets, in microseconds", &udp_busy_poll);
+        callback("pcap-speed", "Replay pcap files at this multiple of the capture rate (0 for as fast as possible)", &pcap_speed);
 #if SPEAD2_USE_IBV
         callback("ibv", "Use ibverbs", &ibv);
         callback("ibv-vector", "Interrupt vector (-1 for polled)", &ibv_comp_vector);
         callback("ibv-max-poll", "Maximum number of times to poll in a row", &ibv_max_poll);
+#endif
+#if SPEAD2_USE_URING
+        callback("uring", "Use io_uring", &uring);
 #endif
     }
 
@@ -230,7 +242,9 @@ struct receiver_options
      * Add reader(s) to a stream.
      *
      * If @a allow_pcap is true, endpoints that don't parse as a port number
-     * are assumed to be filenames and added with @ref udp_pcap_file_reader.
+     * are assumed to be filenames and added with @ref udp_pcap_file_reader
+     * (or @ref udp_pcap_replay_reader if spead2 was built without libpcap
+     * or a non-zero pcap speed is given).
      */
     void add_readers(
         spead2::recv::stream &stream,
@@ -266,6 +280,10 @@ struct sender_options
     int ibv_comp_vector = 0;
     int ibv_max_poll = spead2::send::udp_ibv_config::default_max_poll;
 #endif
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+    bool uring = false;
+    bool uring_zero_copy = false;
+#endif
 
     void notify(const protocol_options &protocol);
 
@@ -286,6 +304,10 @@ struct sender_options
         callback("ibv", "Use ibverbs", &ibv);
         callback("ibv-vector", "Interrupt vector (-1 for polled)", &ibv_comp_vector);
         callback("ibv-max-poll", "Maximum number of times to poll in a row", &ibv_max_poll);
+#endif
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+        callback("uring", "Use io_uring", &uring);
+        callback("uring-zero-copy", "Use zero-copy sends with io_uring", &uring_zero_copy);
 #endif
     }
 
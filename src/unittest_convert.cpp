@@ -0,0 +1,217 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for converting copies.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+#include <spead2/common_convert.h>
+#include <spead2/common_memory_allocator.h>
+#include <spead2/recv_packet.h>
+#include <spead2/recv_stream.h>
+
+/* Declare the instruction-specific kernel tables, so that we can test all of
+ * them (that the current CPU supports) rather than just the one selected by
+ * the resolver.
+ */
+namespace spead2::detail
+{
+extern const convert_function convert_functions_scalar[];
+#if SPEAD2_USE_SSE41_CONVERT
+extern const convert_function convert_functions_sse41[];
+#endif
+#if SPEAD2_USE_AVX2_CONVERT
+extern const convert_function convert_functions_avx2[];
+#endif
+} // namespace spead2::detail
+
+namespace spead2::unittest
+{
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(convert)
+
+struct convert_functions
+{
+    const char *name;
+    const convert_function *funcs;
+    bool enabled;
+};
+
+std::ostream &operator<<(std::ostream &o, const convert_functions &funcs)
+{
+    return o << funcs.name;
+}
+
+static const convert_functions convert_function_sets[] =
+{
+    { "scalar", spead2::detail::convert_functions_scalar, true },
+#if SPEAD2_USE_SSE41_CONVERT
+    { "sse41", spead2::detail::convert_functions_sse41, bool(__builtin_cpu_supports("sse4.1")) },
+#endif
+#if SPEAD2_USE_AVX2_CONVERT
+    { "avx2", spead2::detail::convert_functions_avx2, bool(__builtin_cpu_supports("avx2")) },
+#endif
+};
+
+// Reference implementation of a single element conversion
+static void convert_reference(convert_function_id id, std::uint8_t *dest, const std::uint8_t *src)
+{
+    switch (id)
+    {
+    case CONVERT_BSWAP16:
+    case CONVERT_BSWAP32:
+    case CONVERT_BSWAP64:
+        {
+            std::size_t size = get_convert_input_size(id);
+            std::reverse_copy(src, src + size, dest);
+            break;
+        }
+    case CONVERT_INT8_INT16:
+        {
+            std::int16_t value = std::int8_t(src[0]);
+            std::memcpy(dest, &value, sizeof(value));
+            break;
+        }
+    case CONVERT_INT16_FLOAT32:
+    case CONVERT_INT16BE_FLOAT32:
+        {
+            std::int16_t raw;
+            std::memcpy(&raw, src, sizeof(raw));
+            if (id == CONVERT_INT16BE_FLOAT32)
+                raw = std::int16_t((std::uint16_t(src[0]) << 8) | src[1]);
+            float value = raw;
+            std::memcpy(dest, &value, sizeof(value));
+            break;
+        }
+    }
+}
+
+static const convert_function_id convert_ids[] =
+{
+    CONVERT_BSWAP16, CONVERT_BSWAP32, CONVERT_BSWAP64,
+    CONVERT_INT8_INT16, CONVERT_INT16_FLOAT32, CONVERT_INT16BE_FLOAT32
+};
+
+// Check all lengths up to a few vectors, with unaligned source and destination
+BOOST_DATA_TEST_CASE(
+    kernels,
+    boost::unit_test::data::make(convert_function_sets) * boost::unit_test::data::make(convert_ids),
+    sample, id)
+{
+    if (!sample.enabled)
+        return;
+
+    const std::size_t in_size = get_convert_input_size(id);
+    const std::size_t out_size = get_convert_output_size(id);
+    const std::size_t max_n = 100;
+    std::vector<std::uint8_t> src(max_n * in_size + 1);
+    for (std::size_t i = 0; i < src.size(); i++)
+        src[i] = std::uint8_t(i * 73 + 5);
+    for (std::size_t n = 0; n <= max_n; n++)
+    {
+        // One byte of padding at the start (for misalignment) and at the end
+        std::vector<std::uint8_t> dest(n * out_size + 2, 0xcc);
+        std::vector<std::uint8_t> expected(dest);
+        sample.funcs[id](dest.data() + 1, src.data() + 1, n);
+        for (std::size_t i = 0; i < n; i++)
+            convert_reference(id, expected.data() + 1 + i * out_size, src.data() + 1 + i * in_size);
+        BOOST_TEST(dest == expected, "mismatch for n = " << n);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sizes)
+{
+    BOOST_TEST(get_convert_input_size(CONVERT_INT8_INT16) == 1U);
+    BOOST_TEST(get_convert_output_size(CONVERT_INT8_INT16) == 2U);
+    BOOST_TEST(get_convert_input_size(CONVERT_INT16BE_FLOAT32) == 2U);
+    BOOST_TEST(get_convert_output_size(CONVERT_INT16BE_FLOAT32) == 4U);
+    BOOST_CHECK_THROW(get_convert_function(convert_function_id(100)), std::invalid_argument);
+}
+
+/* Split a payload of 32-bit elements into packets that are not aligned to
+ * elements, and check that packet_memcpy_convert still swaps every element.
+ */
+BOOST_AUTO_TEST_CASE(packet_memcpy_unaligned)
+{
+    const std::size_t heap_length = 256;
+    const std::size_t packet_size = 7;
+    std::vector<std::uint8_t> payload(heap_length);
+    for (std::size_t i = 0; i < heap_length; i++)
+        payload[i] = std::uint8_t(i);
+    std::vector<std::uint8_t> dest(heap_length);
+    // Wrap the destination without taking ownership
+    spead2::memory_allocator::pointer allocation(dest.data(), [](std::uint8_t *) {});
+
+    spead2::recv::packet_memcpy_convert convert(CONVERT_BSWAP32);
+    for (std::size_t offset = 0; offset < heap_length; offset += packet_size)
+    {
+        spead2::recv::packet_header packet{};
+        packet.heap_length = heap_length;
+        packet.payload_offset = offset;
+        packet.payload_length = std::min(packet_size, heap_length - offset);
+        packet.payload = payload.data() + offset;
+        convert(allocation, packet);
+    }
+    for (std::size_t i = 0; i < heap_length; i++)
+        BOOST_TEST(dest[i] == payload[(i & ~3) + 3 - (i & 3)], "mismatch at byte " << i);
+}
+
+// Widening conversions write each element at a scaled offset
+BOOST_AUTO_TEST_CASE(packet_memcpy_widen)
+{
+    const std::size_t n = 64;
+    const std::size_t packet_elements = 10;
+    std::vector<std::uint8_t> payload(n * 2);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        std::int16_t value = std::int16_t(i * 1000 - 30000);
+        payload[2 * i] = std::uint8_t(std::uint16_t(value) >> 8);
+        payload[2 * i + 1] = std::uint8_t(value);
+    }
+    std::vector<float> dest(n);
+    spead2::memory_allocator::pointer allocation(
+        reinterpret_cast<std::uint8_t *>(dest.data()), [](std::uint8_t *) {});
+
+    spead2::recv::packet_memcpy_convert convert(CONVERT_INT16BE_FLOAT32);
+    for (std::size_t start = 0; start < n; start += packet_elements)
+    {
+        spead2::recv::packet_header packet{};
+        packet.heap_length = n * 2;
+        packet.payload_offset = start * 2;
+        packet.payload_length = std::min(packet_elements, n - start) * 2;
+        packet.payload = payload.data() + start * 2;
+        convert(allocation, packet);
+    }
+    for (std::size_t i = 0; i < n; i++)
+        BOOST_TEST(dest[i] == float(std::int16_t(i * 1000 - 30000)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // convert
+BOOST_AUTO_TEST_SUITE_END()  // common
+
+} // namespace spead2::unittest
@@ -0,0 +1,227 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for common_lockfree_ringbuffer.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <spead2/common_lockfree_ringbuffer.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/common_inproc.h>
+#include <spead2/recv_inproc.h>
+#include <spead2/recv_heap.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_chunk_stream.h>
+#include <spead2/send_stream.h>
+#include <spead2/send_inproc.h>
+#include <spead2/send_heap.h>
+
+namespace spead2::unittest
+{
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(lockfree_ringbuffer)
+
+BOOST_AUTO_TEST_CASE(push_pop)
+{
+    spead2::lockfree_ringbuffer<std::unique_ptr<int>> ring(2);
+    BOOST_TEST(ring.capacity() == 2u);
+    BOOST_CHECK_THROW(ring.try_pop(), spead2::ringbuffer_empty);
+    ring.try_push(std::make_unique<int>(1));
+    ring.emplace(new int(2));
+    BOOST_TEST(ring.size() == 2u);
+    auto value = std::make_unique<int>(3);
+    BOOST_CHECK_THROW(ring.try_push(std::move(value)), spead2::ringbuffer_full);
+    // A failed push must not consume the value
+    BOOST_REQUIRE(value);
+    BOOST_TEST(*ring.pop() == 1);
+    ring.push(std::move(value));
+    BOOST_TEST(*ring.try_pop() == 2);
+    BOOST_TEST(*ring.pop() == 3);
+    BOOST_TEST(ring.size() == 0u);
+}
+
+// Items already in the ring are delivered before consumers see the stop
+BOOST_AUTO_TEST_CASE(stop)
+{
+    spead2::lockfree_ringbuffer<int> ring(4);
+    ring.push(1);
+    ring.push(2);
+    BOOST_TEST(ring.stop());
+    BOOST_TEST(!ring.stop());
+    BOOST_CHECK_THROW(ring.try_push(3), spead2::ringbuffer_stopped);
+    BOOST_CHECK_THROW(ring.push(3), spead2::ringbuffer_stopped);
+    std::vector<int> values;
+    for (int value : ring)
+        values.push_back(value);
+    BOOST_TEST(values == std::vector<int>({1, 2}));
+    BOOST_CHECK_THROW(ring.try_pop(), spead2::ringbuffer_stopped);
+    BOOST_CHECK_THROW(ring.pop(), spead2::ringbuffer_stopped);
+}
+
+// Blocked producers and consumers are woken by a stop
+BOOST_AUTO_TEST_CASE(stop_wakes)
+{
+    spead2::lockfree_ringbuffer<int> full(1, 10), empty(1, 10);
+    full.push(1);
+    std::thread producer([&] { BOOST_CHECK_THROW(full.push(2), spead2::ringbuffer_stopped); });
+    std::thread consumer([&] { BOOST_CHECK_THROW(empty.pop(), spead2::ringbuffer_stopped); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    full.stop();
+    empty.stop();
+    producer.join();
+    consumer.join();
+}
+
+BOOST_AUTO_TEST_CASE(producers)
+{
+    spead2::lockfree_ringbuffer<int> ring(4);
+    ring.add_producer();
+    ring.add_producer();
+    BOOST_TEST(!ring.remove_producer());
+    ring.push(1);
+    BOOST_TEST(ring.remove_producer());
+    BOOST_TEST(ring.pop() == 1);
+    BOOST_CHECK_THROW(ring.pop(), spead2::ringbuffer_stopped);
+}
+
+// Multiple producers and consumers through a small ring, with blocking
+BOOST_AUTO_TEST_CASE(mpmc)
+{
+    constexpr int n_producers = 3, n_consumers = 3, n_items = 20000;
+    spead2::lockfree_ringbuffer<int> ring(8, 50);
+    std::vector<std::thread> threads;
+    std::vector<long long> sums(n_consumers);
+    for (int i = 0; i < n_producers; i++)
+        ring.add_producer();
+    for (int i = 0; i < n_producers; i++)
+        threads.emplace_back([&ring, i] {
+            for (int j = 0; j < n_items; j++)
+                ring.push(i * n_items + j);
+            ring.remove_producer();
+        });
+    for (int i = 0; i < n_consumers; i++)
+        threads.emplace_back([&ring, &sums, i] {
+            for (int value : ring)
+                sums[i] += value;
+        });
+    for (auto &thread : threads)
+        thread.join();
+    long long total = 0;
+    for (long long sum : sums)
+        total += sum;
+    long long n = n_producers * n_items;
+    BOOST_TEST(total == n * (n - 1) / 2);
+}
+
+// Destroying a non-empty ring destroys the remaining items
+BOOST_AUTO_TEST_CASE(destroy)
+{
+    auto item = std::make_shared<int>(1);
+    {
+        spead2::lockfree_ringbuffer<std::shared_ptr<int>> ring(3);
+        ring.push(std::shared_ptr<int>(item));
+        ring.push(std::shared_ptr<int>(item));
+        BOOST_TEST(item.use_count() == 3);
+    }
+    BOOST_TEST(item.use_count() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(ring_stream)
+{
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    spead2::send::inproc_stream send_stream(tp, {queue});
+    for (int i = 0; i < 3; i++)
+    {
+        spead2::send::heap heap;
+        heap.add_item(0x1000, i * 100);
+        send_stream.async_send_heap(heap, boost::asio::use_future).wait();
+    }
+    queue->stop();
+
+    spead2::recv::ring_stream<spead2::lockfree_ringbuffer<spead2::recv::live_heap>> recv_stream(tp);
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue);
+    std::vector<item_pointer_t> values;
+    for (const spead2::recv::heap &heap : recv_stream)
+    {
+        for (auto &&item : heap.get_items())
+            if (item.id == 0x1000)
+                values.push_back(item.immediate_value);
+    }
+    std::vector<item_pointer_t> expected{0, 100, 200};
+    BOOST_TEST(values == expected);
+}
+
+BOOST_AUTO_TEST_CASE(chunk_ring_stream)
+{
+    using ring_t = spead2::lockfree_ringbuffer<std::unique_ptr<spead2::recv::chunk>>;
+    constexpr std::size_t heap_size = 16;
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    spead2::send::inproc_stream send_stream(tp, {queue});
+    std::vector<std::uint8_t> payload(heap_size);
+    for (int i = 0; i < 2; i++)
+    {
+        std::fill(payload.begin(), payload.end(), i + 1);
+        spead2::send::heap heap;
+        heap.add_item(0x1000, payload.data(), payload.size(), false);
+        send_stream.async_send_heap(heap, boost::asio::use_future, i).wait();
+    }
+    queue->stop();
+
+    auto data_ring = std::make_shared<ring_t>(1);
+    auto free_ring = std::make_shared<ring_t>(1);
+    auto chunk_config = spead2::recv::chunk_stream_config()
+        .set_items({spead2::HEAP_CNT_ID})
+        .set_max_chunks(1)
+        .set_place_affine(
+            spead2::recv::chunk_place_affine()
+                .set_timestamps_per_chunk(2)
+                .set_heap_size(heap_size));
+    spead2::recv::chunk_ring_stream<ring_t, ring_t> stream(
+        tp, spead2::recv::stream_config(), chunk_config, data_ring, free_ring);
+    auto c = std::make_unique<spead2::recv::chunk>();
+    c->data = memory_allocator().allocate(2 * heap_size, nullptr);
+    c->present = memory_allocator().allocate(2, nullptr);
+    c->present_size = 2;
+    stream.add_free_chunk(std::move(c));
+    stream.emplace_reader<spead2::recv::inproc_reader>(queue);
+
+    std::vector<std::unique_ptr<spead2::recv::chunk>> chunks;
+    for (auto &&c : *data_ring)
+        chunks.push_back(std::move(c));
+    stream.stop();
+    BOOST_REQUIRE(chunks.size() == 1u);
+    BOOST_TEST(chunks[0]->chunk_id == 0);
+    BOOST_TEST(chunks[0]->present[0]);
+    BOOST_TEST(chunks[0]->present[1]);
+    BOOST_TEST(chunks[0]->data[0] == 1);
+    BOOST_TEST(chunks[0]->data[heap_size] == 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // lockfree_ringbuffer
+BOOST_AUTO_TEST_SUITE_END()  // common
+
+} // namespace spead2::unittest
@@ -25,7 +25,9 @@
 #include <vector>
 #include <memory>
 #include <utility>
+#include <algorithm>
 #include <spead2/common_memory_allocator.h>
+#include <spead2/common_thread_pool.h>
 
 namespace spead2::unittest
 {
@@ -40,6 +42,14 @@ public:
     huge_mmap_allocator() : spead2::mmap_allocator(0, true) {}
 };
 
+// Wrapper to bind memory to the NUMA node of core 0 (or node 0 if unknown)
+class numa_mmap_allocator : public spead2::mmap_allocator
+{
+public:
+    numa_mmap_allocator()
+        : spead2::mmap_allocator(0, false, std::max(0, spead2::thread_pool::get_core_numa_node(0))) {}
+};
+
 class legacy_allocator : public spead2::memory_allocator
 {
 public:
@@ -68,6 +78,7 @@ typedef boost::mpl::list<
     spead2::memory_allocator,
     spead2::mmap_allocator,
     huge_mmap_allocator,
+    numa_mmap_allocator,
     legacy_allocator> test_types;
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(allocator_test, T, test_types)
@@ -107,6 +118,15 @@ BOOST_AUTO_TEST_CASE(legacy)
     BOOST_TEST(allocator->deleted[1].second == &raw);
 }
 
+BOOST_AUTO_TEST_CASE(thread_pool_numa_node)
+{
+    spead2::thread_pool unbound;
+    BOOST_TEST(unbound.get_numa_node() == -1);
+    spead2::thread_pool bound(1, {0});
+    BOOST_TEST(bound.get_numa_node() == spead2::thread_pool::get_core_numa_node(0));
+    BOOST_TEST(spead2::thread_pool::get_core_numa_node(-1) == -1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // memory_allocator
 BOOST_AUTO_TEST_SUITE_END()  // common
 
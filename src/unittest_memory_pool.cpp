@@ -28,9 +28,13 @@
 #include <memory>
 #include <thread>
 #include <chrono>
+#include <cstdint>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <spead2/common_memory_pool.h>
 #include <spead2/common_thread_pool.h>
 #include <spead2/common_logging.h>
+#include <spead2/common_prefault.h>
 
 namespace spead2::unittest
 {
@@ -203,6 +207,100 @@ BOOST_FIXTURE_TEST_CASE(memory_pool_warn_on_empty, logger_fixture)
     BOOST_CHECK_EQUAL(messages[spead2::log_level::warning].size(), 1);
 }
 
+// Check that thread caches recycle memory, respect max_free, and are
+// flushed back to the shared pool when the thread exits.
+BOOST_FIXTURE_TEST_CASE(memory_pool_thread_cache, logger_fixture)
+{
+    typedef spead2::memory_allocator::pointer pointer;
+    std::shared_ptr<mock_allocator> allocator = std::make_shared<mock_allocator>();
+    auto pool = std::make_shared<spead2::memory_pool>(1024, 2048, 4, 4, allocator);
+    pool->set_thread_cache_size(2);
+    BOOST_CHECK_EQUAL(pool->get_thread_cache_size(), 2);
+
+    std::thread thread([pool]
+    {
+        std::vector<pointer> pointers;
+        for (int i = 0; i < 2; i++)
+            pointers.push_back(pool->allocate(1024, nullptr));
+        pointers.clear();
+        // Should come from this thread's cache
+        pointers.push_back(pool->allocate(1024, nullptr));
+        // Leave the memory in the thread cache when the thread exits
+    });
+    thread.join();
+
+    // All the memory should be available again
+    std::vector<pointer> pointers;
+    for (int i = 0; i < 4; i++)
+        pointers.push_back(pool->allocate(1024, nullptr));
+    BOOST_CHECK_EQUAL(messages[spead2::log_level::warning].size(), 0);
+    BOOST_CHECK_EQUAL(allocator->records.size(), 4);
+
+    // Now exhaust the pool, then free more than max_free
+    for (int i = 0; i < 2; i++)
+        pointers.push_back(pool->allocate(1024, nullptr));
+    BOOST_CHECK_EQUAL(messages[spead2::log_level::warning].size(), 2);
+    BOOST_CHECK_EQUAL(allocator->records.size(), 6);
+    pointers.clear();
+    // Two should have been dropped
+    BOOST_CHECK_EQUAL(allocator->records.size(), 8);
+    pool.reset();
+    BOOST_CHECK_EQUAL(allocator->records.size(), 12);
+}
+
+// Check that warm_up populates the pool in the background
+BOOST_FIXTURE_TEST_CASE(memory_pool_warm_up, logger_fixture)
+{
+    spead2::thread_pool tpool(4);
+    auto pool = std::make_shared<spead2::memory_pool>(1024, 2048, 6, 0);
+    // Asks for more than max_free, to check that the excess is dropped
+    pool->warm_up(tpool, 8).get();
+    std::vector<spead2::memory_pool::pointer> pointers;
+    for (int i = 0; i < 6; i++)
+        pointers.push_back(pool->allocate(1024, nullptr));
+    BOOST_CHECK_EQUAL(messages[spead2::log_level::warning].size(), 0);
+    BOOST_CHECK_EQUAL(pool->get_hits(), 6);
+    BOOST_CHECK_EQUAL(pool->get_misses(), 0);
+
+    // No work should still complete
+    pool->warm_up(tpool, 0).get();
+}
+
+BOOST_AUTO_TEST_CASE(prefault_async)
+{
+    spead2::thread_pool tpool(4);
+    std::vector<std::uint8_t> data(100000);
+    for (std::size_t i = 0; i < data.size(); i++)
+        data[i] = i % 251;
+    spead2::prefault_async(tpool, data.data(), data.size(), 7).get();
+    // The contents must be preserved
+    for (std::size_t i = 0; i < data.size(); i++)
+        BOOST_REQUIRE_EQUAL(data[i], i % 251);
+    spead2::prefault_async(tpool, data.data(), 0, 3).get();
+    BOOST_CHECK_THROW(spead2::prefault_async(tpool, data.data(), data.size(), 0), std::invalid_argument);
+}
+
+// Every page must be touched even if the region is not page-aligned
+BOOST_AUTO_TEST_CASE(prefault_async_unaligned)
+{
+    spead2::thread_pool tpool(2);
+    const std::size_t page_size = sysconf(_SC_PAGESIZE);
+    const std::size_t pages = 8;
+    void *mem = mmap(nullptr, pages * page_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    BOOST_REQUIRE(mem != MAP_FAILED);
+    std::uint8_t *base = static_cast<std::uint8_t *>(mem);
+    // Start just before the end of the first page, and end just into the last
+    std::uint8_t *ptr = base + page_size - 96;
+    std::size_t size = (pages - 2) * page_size + 200;
+    spead2::prefault_async(tpool, ptr, size, 3).get();
+    std::vector<unsigned char> resident(pages);
+    BOOST_REQUIRE(mincore(mem, pages * page_size, resident.data()) == 0);
+    for (std::size_t i = 0; i < pages; i++)
+        BOOST_TEST((resident[i] & 1), "page " << i << " not resident");
+    munmap(mem, pages * page_size);
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // memory_pool
 BOOST_AUTO_TEST_SUITE_END()  // common
 
@@ -23,6 +23,7 @@
 #include <boost/test/unit_test.hpp>
 #include <spead2/common_raw_packet.h>
 #include <stdexcept>
+#include <net/if.h>
 
 namespace spead2::unittest
 {
@@ -106,6 +107,14 @@ BOOST_AUTO_TEST_CASE(interface_mac_lo)
     BOOST_CHECK_THROW(spead2::interface_mac(address), std::runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(interface_index_lo)
+{
+    auto address = boost::asio::ip::address::from_string("127.0.0.1");
+    BOOST_TEST(spead2::interface_index(address) == if_nametoindex("lo"));
+    address = boost::asio::ip::address::from_string("0.0.0.0");
+    BOOST_CHECK_THROW(spead2::interface_index(address), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(packet_buffer_construct)
 {
     std::uint8_t data[2];
@@ -0,0 +1,419 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for recv_chunk_stream, comparing heap assembly with direct
+ * placement.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <spead2/common_defines.h>
+#include <spead2/common_endian.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_chunk_stream.h>
+#include <spead2/recv_mem.h>
+#include <spead2/recv_packet.h>
+#include <spead2/recv_reader.h>
+#include <spead2/recv_stream.h>
+
+namespace spead2::unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(chunk_stream)
+
+static constexpr std::size_t heap_size = 1024;
+static constexpr std::size_t heaps_per_chunk = 8;
+static constexpr std::size_t packet_size = heap_size / 2;
+
+static std::uint8_t payload_byte(item_pointer_t cnt, std::size_t offset)
+{
+    return std::uint8_t(cnt * 37 + offset);
+}
+
+/* Append a packet with part of the payload of heap @a cnt to @a out. The
+ * heap has length @a length.
+ */
+static void add_packet(
+    std::vector<std::uint8_t> &out, item_pointer_t cnt,
+    std::size_t start, std::size_t end, bool stop = false,
+    std::size_t length = heap_size)
+{
+    const item_pointer_t immediate = item_pointer_t(1) << 63;
+    std::vector<item_pointer_t> pointers = {
+        immediate | (item_pointer_t(HEAP_CNT_ID) << 48) | cnt,
+        immediate | (item_pointer_t(HEAP_LENGTH_ID) << 48) | length,
+        immediate | (item_pointer_t(PAYLOAD_OFFSET_ID) << 48) | start,
+        immediate | (item_pointer_t(PAYLOAD_LENGTH_ID) << 48) | (end - start)
+    };
+    if (stop)
+        pointers.push_back(immediate | (item_pointer_t(STREAM_CTRL_ID) << 48) | CTRL_STREAM_STOP);
+    // Magic, version, item pointer width - heap address width, heap address width, reserved, items
+    const std::uint8_t header[8] = {0x53, 4, 2, 6, 0, 0, 0, std::uint8_t(pointers.size())};
+    out.insert(out.end(), header, header + 8);
+    for (item_pointer_t pointer : pointers)
+    {
+        item_pointer_t be = htobe<item_pointer_t>(pointer);
+        const std::uint8_t *p = reinterpret_cast<const std::uint8_t *>(&be);
+        out.insert(out.end(), p, p + sizeof(be));
+    }
+    for (std::size_t i = start; i < end; i++)
+        out.push_back(payload_byte(cnt, i));
+}
+
+/* Reader that decodes all the packets up front and passes them to the stream
+ * in a single batch, in the same way as the UDP readers.
+ */
+class batch_mem_reader : public spead2::recv::reader
+{
+private:
+    const std::vector<std::uint8_t> &data;
+
+public:
+    batch_mem_reader(spead2::recv::stream &owner, const std::vector<std::uint8_t> &data)
+        : reader(owner), data(data)
+    {
+    }
+
+    virtual void start() override
+    {
+        boost::asio::post(
+            get_io_service(),
+            bind_handler([this] (handler_context, spead2::recv::stream_base::add_packet_state &state) {
+                std::vector<spead2::recv::packet_header> packets;
+                const std::uint8_t *ptr = data.data();
+                std::size_t length = data.size();
+                while (length > 0)
+                {
+                    spead2::recv::packet_header packet;
+                    std::size_t size = spead2::recv::decode_packet(packet, ptr, length);
+                    if (size == 0)
+                        break;
+                    packets.push_back(packet);
+                    ptr += size;
+                    length -= size;
+                }
+                state.add_packets(packets.data(), packets.size());
+                state.stop();
+            })
+        );
+    }
+
+    virtual bool lossy() const override
+    {
+        return false;
+    }
+};
+
+struct result
+{
+    std::vector<std::unique_ptr<spead2::recv::chunk>> chunks;
+    spead2::recv::stream_stats stats;
+};
+
+// Feed @a data to a chunk stream and collect the chunks that come out
+static result receive(const std::vector<std::uint8_t> &data, bool direct,
+                      bool allow_out_of_order = false,
+                      std::size_t *batch_calls = nullptr,
+                      bool affine = false)
+{
+    thread_pool tp;
+    const std::size_t max_chunks = 2;
+    auto data_ring = std::make_shared<ringbuffer<std::unique_ptr<spead2::recv::chunk>>>(16);
+    auto free_ring = std::make_shared<ringbuffer<std::unique_ptr<spead2::recv::chunk>>>(16);
+    auto place = [](spead2::recv::chunk_place_data *data, std::size_t)
+    {
+        s_item_pointer_t cnt = data->items[0];
+        data->chunk_id = cnt / heaps_per_chunk;
+        data->heap_index = cnt % heaps_per_chunk;
+        data->heap_offset = data->heap_index * heap_size;
+    };
+    auto chunk_config = spead2::recv::chunk_stream_config()
+        .set_items({HEAP_CNT_ID})
+        .set_max_chunks(max_chunks)
+        .set_place(place)
+        .set_direct_placement(direct);
+    if (affine)
+    {
+        chunk_config.set_place_affine(
+            spead2::recv::chunk_place_affine()
+                .set_timestamps_per_chunk(heaps_per_chunk)
+                .set_heap_size(heap_size));
+    }
+    if (batch_calls)
+    {
+        *batch_calls = 0;
+        chunk_config.set_place_batch(
+            [place, batch_calls](spead2::recv::chunk_place_data *data, std::size_t n_data,
+                                 std::size_t data_size)
+            {
+                ++*batch_calls;
+                for (std::size_t i = 0; i < n_data; i++)
+                    place(data + i, data_size);
+            });
+    }
+    spead2::recv::chunk_ring_stream<> stream(
+        tp,
+        spead2::recv::stream_config().set_allow_out_of_order(allow_out_of_order),
+        chunk_config,
+        data_ring, free_ring);
+    for (int i = 0; i < 16; i++)
+    {
+        auto c = std::make_unique<spead2::recv::chunk>();
+        c->data = memory_allocator().allocate(heap_size * heaps_per_chunk, nullptr);
+        c->present = memory_allocator().allocate(heaps_per_chunk, nullptr);
+        c->present_size = heaps_per_chunk;
+        stream.add_free_chunk(std::move(c));
+    }
+    if (batch_calls)
+        stream.emplace_reader<batch_mem_reader>(data);
+    else
+        stream.emplace_reader<spead2::recv::mem_reader>(data.data(), data.size());
+
+    std::vector<std::unique_ptr<spead2::recv::chunk>> chunks;
+    for (auto &&c : *data_ring)
+        chunks.push_back(std::move(c));
+    stream.stop();
+    return {std::move(chunks), stream.get_stats()};
+}
+
+// Check that heap @a cnt was received intact
+static void check_heap(const spead2::recv::chunk &c, item_pointer_t cnt)
+{
+    std::size_t index = cnt % heaps_per_chunk;
+    BOOST_TEST(c.present[index]);
+    const std::uint8_t *data = c.data.get() + index * heap_size;
+    for (std::size_t i = 0; i < heap_size; i++)
+        if (data[i] != payload_byte(cnt, i))
+        {
+            BOOST_ERROR("mismatch in heap " << cnt << " at byte " << i);
+            break;
+        }
+}
+
+BOOST_DATA_TEST_CASE(basic, boost::unit_test::data::make({false, true}), direct)
+{
+    const int n_heaps = 20;
+    std::vector<std::uint8_t> data;
+    for (int i = 0; i < n_heaps; i++)
+    {
+        add_packet(data, i, 0, packet_size);
+        add_packet(data, i, packet_size, heap_size);
+    }
+    result r = receive(data, direct);
+    BOOST_REQUIRE_EQUAL(r.chunks.size(), 3U);
+    for (int i = 0; i < n_heaps; i++)
+        check_heap(*r.chunks[i / heaps_per_chunk], i);
+    for (std::size_t i = n_heaps % heaps_per_chunk; i < heaps_per_chunk; i++)
+        BOOST_TEST(!r.chunks.back()->present[i]);
+    BOOST_TEST(r.stats.packets == 2U * n_heaps);
+    BOOST_TEST(r.stats.heaps == std::uint64_t(n_heaps));
+    BOOST_TEST(r.stats.incomplete_heaps_evicted == 0U);
+    BOOST_TEST(r.stats.incomplete_heaps_flushed == 0U);
+}
+
+// Heaps that are missing a packet are not marked present
+BOOST_DATA_TEST_CASE(incomplete, boost::unit_test::data::make({false, true}), direct)
+{
+    std::vector<std::uint8_t> data;
+    add_packet(data, 0, 0, packet_size);
+    add_packet(data, 1, 0, packet_size);
+    add_packet(data, 1, packet_size, heap_size);
+    add_packet(data, 2, packet_size, heap_size);  // rejected: not at start of heap
+    add_packet(data, 3, 0, packet_size);
+    result r = receive(data, direct);
+    BOOST_REQUIRE_EQUAL(r.chunks.size(), 1U);
+    check_heap(*r.chunks[0], 1);
+    BOOST_TEST(!r.chunks[0]->present[0]);
+    BOOST_TEST(!r.chunks[0]->present[2]);
+    BOOST_TEST(!r.chunks[0]->present[3]);
+    BOOST_TEST(r.stats.incomplete_heaps_flushed == 2U);
+}
+
+BOOST_DATA_TEST_CASE(out_of_order, boost::unit_test::data::make({false, true}), direct)
+{
+    std::vector<std::uint8_t> data;
+    for (int i = 0; i < 4; i++)
+        add_packet(data, i, packet_size, heap_size);
+    for (int i = 0; i < 4; i++)
+        add_packet(data, i, 0, packet_size);
+    result r = receive(data, direct, true);
+    BOOST_REQUIRE_EQUAL(r.chunks.size(), 1U);
+    for (int i = 0; i < 4; i++)
+        check_heap(*r.chunks[0], i);
+}
+
+// A packet with a stop item stops the stream, and its heap is not marked present
+BOOST_DATA_TEST_CASE(stop, boost::unit_test::data::make({false, true}), direct)
+{
+    std::vector<std::uint8_t> data;
+    add_packet(data, 0, 0, heap_size);
+    add_packet(data, 1, 0, heap_size, true);
+    add_packet(data, 2, 0, heap_size);
+    result r = receive(data, direct);
+    BOOST_REQUIRE_EQUAL(r.chunks.size(), 1U);
+    check_heap(*r.chunks[0], 0);
+    BOOST_TEST(!r.chunks[0]->present[1]);
+    BOOST_TEST(!r.chunks[0]->present[2]);
+    BOOST_TEST(r.stats.packets == 2U);
+}
+
+/* The batch place function gives the same results as the per-heap one, while
+ * being called far fewer times.
+ */
+BOOST_DATA_TEST_CASE(place_batch, boost::unit_test::data::make({false, true}), direct)
+{
+    const int n_heaps = 20;
+    std::vector<std::uint8_t> data;
+    for (int i = 0; i < n_heaps; i++)
+    {
+        add_packet(data, i, 0, packet_size);
+        add_packet(data, i, packet_size, heap_size);
+    }
+    add_packet(data, n_heaps, packet_size, heap_size);  // rejected: not at start of heap
+    std::size_t batch_calls;
+    result r = receive(data, direct, false, &batch_calls);
+    BOOST_REQUIRE_EQUAL(r.chunks.size(), 3U);
+    for (int i = 0; i < n_heaps; i++)
+        check_heap(*r.chunks[i / heaps_per_chunk], i);
+    BOOST_TEST(!r.chunks.back()->present[n_heaps % heaps_per_chunk]);
+    BOOST_TEST(r.stats.heaps == std::uint64_t(n_heaps));
+    BOOST_TEST(batch_calls > 0U);
+    BOOST_TEST(batch_calls < std::size_t(n_heaps));
+}
+
+// Apply a built-in placement rule to a single heap with the given items
+static spead2::recv::chunk_place_data place_affine(
+    const spead2::recv::chunk_place_affine &rule, std::vector<s_item_pointer_t> items)
+{
+    spead2::recv::chunk_place_data data{};
+    data.items = items.data();
+    data.chunk_id = -1;
+    rule(&data, 1);
+    data.items = nullptr;
+    return data;
+}
+
+BOOST_AUTO_TEST_CASE(place_affine_rule)
+{
+    auto rule = spead2::recv::chunk_place_affine()
+        .set_timestamp_item(0)
+        .set_timestamp_step(4096)
+        .set_timestamps_per_chunk(3)
+        .set_channel_item(1)
+        .set_channel_step(16)
+        .set_channels(4)
+        .set_heap_size(100);
+    BOOST_TEST(rule.get_heaps_per_chunk() == 12U);
+
+    auto data = place_affine(rule, {7 * 4096, 32});
+    BOOST_TEST(data.chunk_id == 2);
+    BOOST_TEST(data.heap_index == 6U);    // (7 % 3) * 4 + 32 / 16
+    BOOST_TEST(data.heap_offset == 600U);
+
+    BOOST_TEST(place_affine(rule, {7 * 4096 + 1, 32}).chunk_id == -1);  // not a multiple of the step
+    BOOST_TEST(place_affine(rule, {7 * 4096, 33}).chunk_id == -1);      // not a multiple of the step
+    BOOST_TEST(place_affine(rule, {7 * 4096, 64}).chunk_id == -1);      // channel out of range
+    BOOST_TEST(place_affine(rule, {-1, 32}).chunk_id == -1);            // item missing
+
+    rule.set_channel_item(std::nullopt);
+    data = place_affine(rule, {7 * 4096, 64});
+    BOOST_TEST(data.chunk_id == 2);
+    BOOST_TEST(data.heap_index == 1U);
+
+    BOOST_CHECK_THROW(rule.set_timestamp_step(0), std::invalid_argument);
+    BOOST_CHECK_THROW(rule.set_timestamps_per_chunk(0), std::invalid_argument);
+    BOOST_CHECK_THROW(rule.set_channels(0), std::invalid_argument);
+}
+
+// A stream using a built-in placement rule matches one using a place callback
+BOOST_DATA_TEST_CASE(place_affine_stream, boost::unit_test::data::make({false, true}), direct)
+{
+    const int n_heaps = 20;
+    std::vector<std::uint8_t> data;
+    for (int i = 0; i < n_heaps; i++)
+    {
+        add_packet(data, i, 0, packet_size);
+        add_packet(data, i, packet_size, heap_size);
+    }
+    result r = receive(data, direct, false, nullptr, true);
+    BOOST_REQUIRE_EQUAL(r.chunks.size(), 3U);
+    for (int i = 0; i < n_heaps; i++)
+        check_heap(*r.chunks[i / heaps_per_chunk], i);
+    BOOST_TEST(r.stats.heaps == std::uint64_t(n_heaps));
+}
+
+// Heaps that are too big for their slot are discarded by the built-in placement rule
+BOOST_DATA_TEST_CASE(place_affine_oversize, boost::unit_test::data::make({false, true}), direct)
+{
+    std::vector<std::uint8_t> data;
+    for (int i = 0; i < 4; i++)
+    {
+        std::size_t length = (i == 1) ? 2 * heap_size : heap_size;
+        add_packet(data, i, 0, packet_size, false, length);
+        add_packet(data, i, packet_size, length, false, length);
+    }
+    result r = receive(data, direct, false, nullptr, true);
+    BOOST_REQUIRE_EQUAL(r.chunks.size(), 1U);
+    check_heap(*r.chunks[0], 0);
+    BOOST_TEST(!r.chunks[0]->present[1]);
+    check_heap(*r.chunks[0], 2);
+    check_heap(*r.chunks[0], 3);
+    BOOST_TEST(r.stats["rejected_heaps"] == 1U);
+}
+
+BOOST_AUTO_TEST_CASE(place_affine_bad_item)
+{
+    thread_pool tp;
+    BOOST_CHECK_THROW(
+        spead2::recv::chunk_stream(
+            tp, spead2::recv::stream_config(),
+            spead2::recv::chunk_stream_config()
+                .set_items({HEAP_CNT_ID})
+                .set_place_affine(
+                    spead2::recv::chunk_place_affine().set_timestamp_item(1).set_heap_size(heap_size))
+                .set_allocate([](std::int64_t, std::uint64_t *) { return nullptr; })
+                .set_ready([](std::unique_ptr<spead2::recv::chunk> &&, std::uint64_t *) {})),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(place_affine_zero_heap_size)
+{
+    thread_pool tp;
+    BOOST_CHECK_THROW(
+        spead2::recv::chunk_stream(
+            tp, spead2::recv::stream_config(),
+            spead2::recv::chunk_stream_config()
+                .set_items({HEAP_CNT_ID})
+                .set_place_affine(spead2::recv::chunk_place_affine())
+                .set_allocate([](std::int64_t, std::uint64_t *) { return nullptr; })
+                .set_ready([](std::unique_ptr<spead2::recv::chunk> &&, std::uint64_t *) {})),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // chunk_stream
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+} // namespace spead2::unittest
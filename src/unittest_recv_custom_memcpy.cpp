@@ -20,19 +20,32 @@
  * Unit tests for recv stream with custom memcpy function.
  */
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <random>
+#include <stdexcept>
 #include <vector>
+#include <boost/asio.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <spead2/common_defines.h>
+#include <spead2/common_memory_allocator.h>
 #include <spead2/recv_stream.h>
 #include <spead2/recv_ring_stream.h>
+#include <spead2/recv_chunk_stream.h>
 #include <spead2/recv_inproc.h>
 #include <spead2/recv_packet.h>
 #include <spead2/send_stream.h>
 #include <spead2/send_heap.h>
 #include <spead2/send_inproc.h>
 #include <spead2/common_inproc.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/common_convert.h>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/recv_heap.h>
 
 namespace spead2::unittest
 {
@@ -97,6 +110,248 @@ BOOST_AUTO_TEST_CASE(test_reverse)
     BOOST_CHECK(found);
 }
 
+/* Apply packet_memcpy_scatter directly to packets that are not aligned to
+ * rows, and check that every byte lands in the right place.
+ */
+BOOST_DATA_TEST_CASE(test_scatter, boost::unit_test::data::make({MEMCPY_STD, MEMCPY_NONTEMPORAL}), id)
+{
+    const std::size_t row_size = 7;
+    const std::size_t row_stride = 20;
+    const std::size_t rows = 9;
+    const std::size_t heap_length = row_size * rows;
+    const std::size_t packet_size = 10;
+    const std::uint8_t fill = 0xff;
+
+    std::vector<std::uint8_t> payload(heap_length);
+    for (std::size_t i = 0; i < heap_length; i++)
+        payload[i] = std::uint8_t(i);
+    std::vector<std::uint8_t> dest(row_stride * rows, fill);
+    // Wrap the destination without taking ownership
+    spead2::memory_allocator::pointer allocation(dest.data(), [](std::uint8_t *) {});
+
+    spead2::recv::packet_memcpy_scatter scatter(row_size, row_stride, id);
+    for (std::size_t offset = 0; offset < heap_length; offset += packet_size)
+    {
+        spead2::recv::packet_header packet{};
+        packet.heap_length = heap_length;
+        packet.payload_offset = offset;
+        packet.payload_length = std::min(packet_size, heap_length - offset);
+        packet.payload = payload.data() + offset;
+        scatter(allocation, packet);
+    }
+
+    for (std::size_t i = 0; i < dest.size(); i++)
+    {
+        std::size_t row = i / row_stride;
+        std::size_t col = i % row_stride;
+        std::uint8_t expected = col < row_size ? payload[row * row_size + col] : fill;
+        BOOST_TEST(dest[i] == expected, "mismatch at byte " << i);
+    }
+}
+
+/* Receive the heaps in @a queue into chunks of @a chunk_heaps heaps, with
+ * heap cnt i + 1 placed at offset (i % chunk_heaps) * heap_stride of chunk
+ * i / chunk_heaps, and return the first chunk.
+ */
+static std::unique_ptr<spead2::recv::chunk> receive_chunk(
+    thread_pool &tp,
+    std::shared_ptr<inproc_queue> queue,
+    const spead2::recv::packet_memcpy_function &memcpy,
+    std::size_t chunk_heaps,
+    std::size_t heap_stride,
+    std::size_t chunk_size,
+    std::optional<spead2::recv::stream_stats> *stats = nullptr)
+{
+    auto chunk_config = spead2::recv::chunk_stream_config()
+        .set_items({HEAP_CNT_ID})
+        .set_max_chunks(1)
+        .set_place([chunk_heaps, heap_stride](spead2::recv::chunk_place_data *data, std::size_t)
+        {
+            s_item_pointer_t index = data->items[0] - 1;
+            data->chunk_id = index / chunk_heaps;
+            data->heap_index = index % chunk_heaps;
+            data->heap_offset = data->heap_index * heap_stride;
+        });
+    auto data_ring = std::make_shared<ringbuffer<std::unique_ptr<spead2::recv::chunk>>>(2);
+    auto free_ring = std::make_shared<ringbuffer<std::unique_ptr<spead2::recv::chunk>>>(2);
+    spead2::recv::chunk_ring_stream<> recv_stream(
+        tp, spead2::recv::stream_config().set_memcpy(memcpy), chunk_config,
+        data_ring, free_ring);
+    auto c = std::make_unique<spead2::recv::chunk>();
+    c->data = memory_allocator().allocate(chunk_size, nullptr);
+    c->present = memory_allocator().allocate(chunk_heaps, nullptr);
+    c->present_size = chunk_heaps;
+    recv_stream.add_free_chunk(std::move(c));
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(std::move(queue));
+
+    c = data_ring->pop();
+    recv_stream.stop();
+    if (stats)
+        stats->emplace(recv_stream.get_stats());
+    return c;
+}
+
+/* Corner-turn heaps into a chunk with packet_memcpy_scatter. Each heap holds
+ * all the channels for one timestamp, and the chunk is channel-major.
+ */
+BOOST_AUTO_TEST_CASE(test_scatter_chunk_stream)
+{
+    const std::size_t timestamps = 4;    // heaps per chunk
+    const std::size_t channels = 5;
+    const std::size_t channel_size = 3;  // bytes per channel
+    const std::size_t heap_length = channels * channel_size;
+    const std::size_t chunk_size = timestamps * heap_length;
+
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    // Small packets, so that channels are split across packets
+    spead2::send::inproc_stream send_stream(
+        tp, {queue}, spead2::send::stream_config().set_max_packet_size(56));
+    std::vector<std::uint8_t> data(chunk_size);
+    for (std::size_t i = 0; i < chunk_size; i++)
+        data[i] = std::uint8_t(i);
+    for (std::size_t t = 0; t < timestamps; t++)
+    {
+        spead2::send::heap send_heap;
+        send_heap.add_item(0x1000, data.data() + t * heap_length, heap_length, false);
+        send_stream.async_send_heap(send_heap, boost::asio::use_future, t + 1).wait();
+    }
+    queue->stop();
+
+    spead2::recv::packet_memcpy_scatter scatter(channel_size, timestamps * channel_size);
+    BOOST_TEST(scatter.get_allocation_size(heap_length) == chunk_size - (timestamps - 1) * channel_size);
+    auto c = receive_chunk(tp, queue, scatter, timestamps, channel_size, chunk_size);
+    for (std::size_t t = 0; t < timestamps; t++)
+        BOOST_TEST(c->present[t]);
+    for (std::size_t t = 0; t < timestamps; t++)
+        for (std::size_t ch = 0; ch < channels; ch++)
+            for (std::size_t b = 0; b < channel_size; b++)
+            {
+                std::size_t src = t * heap_length + ch * channel_size + b;
+                std::size_t dst = (ch * timestamps + t) * channel_size + b;
+                BOOST_TEST(c->data[dst] == data[src], "mismatch at timestamp " << t << " channel " << ch);
+            }
+}
+
+/* packet_memcpy_scatter must be rejected by streams other than chunk
+ * streams, since their heaps' item pointers would not match the scattered
+ * layout.
+ */
+BOOST_AUTO_TEST_CASE(test_scatter_ring_stream)
+{
+    thread_pool tp;
+    spead2::recv::stream_config config;
+    config.set_memcpy(spead2::recv::packet_memcpy_scatter(7, 20));
+    config.set_allow_unsized_heaps(false);
+    BOOST_CHECK_THROW(spead2::recv::ring_stream<>(tp, config), std::invalid_argument);
+}
+
+// Send a single heap with cnt 1, split into packets of at most @a packet_size bytes
+static void send_single_heap(
+    thread_pool &tp, std::shared_ptr<inproc_queue> queue,
+    const std::vector<std::uint8_t> &data, std::size_t packet_size)
+{
+    spead2::send::inproc_stream send_stream(
+        tp, {queue}, spead2::send::stream_config().set_max_packet_size(packet_size));
+    spead2::send::heap send_heap;
+    send_heap.add_item(0x1000, data.data(), data.size(), false);
+    send_stream.async_send_heap(send_heap, boost::asio::use_future, 1).wait();
+    queue->stop();
+}
+
+// Convert big-endian 16-bit integers to floats while placing them in a chunk
+BOOST_AUTO_TEST_CASE(test_convert_chunk_stream)
+{
+    const std::size_t n = 64;
+    std::vector<std::uint8_t> data(n * 2);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        std::int16_t value = std::int16_t(i * 1000 - 30000);
+        data[2 * i] = std::uint8_t(std::uint16_t(value) >> 8);
+        data[2 * i + 1] = std::uint8_t(value);
+    }
+
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    send_single_heap(tp, queue, data, 100);
+
+    spead2::recv::packet_memcpy_convert convert(CONVERT_INT16BE_FLOAT32);
+    BOOST_TEST(convert.get_allocation_size(data.size()) == n * sizeof(float));
+    auto c = receive_chunk(tp, queue, convert, 1, 0, n * sizeof(float));
+    BOOST_TEST(c->present[0]);
+    const float *payload = reinterpret_cast<const float *>(c->data.get());
+    for (std::size_t i = 0; i < n; i++)
+        BOOST_TEST(payload[i] == float(std::int16_t(i * 1000 - 30000)));
+}
+
+/* A widening packet_memcpy_convert must be rejected by streams other than
+ * chunk streams, but a byte swap leaves the heap layout unchanged and can be
+ * used with any stream.
+ */
+BOOST_AUTO_TEST_CASE(test_convert_ring_stream)
+{
+    thread_pool tp;
+    spead2::recv::stream_config config;
+    config.set_memcpy(spead2::recv::packet_memcpy_convert(CONVERT_INT16BE_FLOAT32));
+    BOOST_CHECK_THROW(spead2::recv::ring_stream<>(tp, config), std::invalid_argument);
+
+    const std::size_t n = 64;
+    std::vector<std::uint8_t> data(n * 2);
+    for (std::size_t i = 0; i < data.size(); i++)
+        data[i] = std::uint8_t(i);
+    auto queue = std::make_shared<inproc_queue>();
+    send_single_heap(tp, queue, data, 100);
+
+    config.set_memcpy(spead2::recv::packet_memcpy_convert(CONVERT_BSWAP16));
+    spead2::recv::ring_stream<> recv_stream(tp, config);
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue);
+    spead2::recv::heap recv_heap = recv_stream.pop();
+    recv_stream.stop();
+    bool found = false;
+    for (const auto &item : recv_heap.get_items())
+    {
+        if (item.id == 0x1000)
+        {
+            BOOST_REQUIRE(item.length == data.size());
+            for (std::size_t i = 0; i < data.size(); i++)
+                BOOST_TEST(item.ptr[i] == data[i ^ 1], "mismatch at byte " << i);
+            found = true;
+        }
+    }
+    BOOST_TEST(found);
+}
+
+/* Packets that split elements cannot be converted by a widening
+ * packet_memcpy_convert, and must be rejected rather than leaving holes in
+ * a heap that appears complete.
+ */
+BOOST_AUTO_TEST_CASE(test_convert_misaligned)
+{
+    // An odd length leaves a partial element in the last packet
+    std::vector<std::uint8_t> data(127);
+
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    send_single_heap(tp, queue, data, 80);
+
+    std::optional<spead2::recv::stream_stats> stats;
+    auto c = receive_chunk(
+        tp, queue, spead2::recv::packet_memcpy_convert(CONVERT_INT16BE_FLOAT32),
+        1, 0, 128 * sizeof(float), &stats);
+    // The heap is incomplete, so it is not marked present
+    BOOST_TEST(!c->present[0]);
+    BOOST_REQUIRE(stats);
+    BOOST_TEST((*stats)[spead2::recv::stream_stat_indices::packets] > 1U);
+    BOOST_TEST((*stats)["misaligned_packets"] == 1U);
+    BOOST_TEST((*stats)[spead2::recv::stream_stat_indices::incomplete_heaps_flushed] == 1U);
+}
+
+BOOST_AUTO_TEST_CASE(test_scatter_bad_args)
+{
+    BOOST_CHECK_THROW(spead2::recv::packet_memcpy_scatter(0, 10), std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::recv::packet_memcpy_scatter(10, 9), std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // custom_memcpy
 BOOST_AUTO_TEST_SUITE_END()  // recv
 
@@ -27,6 +27,7 @@
 #include <vector>
 #include <algorithm>
 #include <cstdint>
+#include <thread>
 #include <spead2/recv_live_heap.h>
 #include <spead2/recv_packet.h>
 #include <spead2/common_endian.h>
@@ -105,60 +106,221 @@ BOOST_AUTO_TEST_CASE(add_pointers)
     }
 }
 
+// Enough pointers to require the duplicate-detection hash table to grow
+BOOST_AUTO_TEST_CASE(add_pointers_many)
+{
+    using spead2::recv::live_heap;
+    live_heap heap(dummy_packet(1), 0);
+
+    std::vector<item_pointer_t> expected;
+    for (int i = 0; i < 200; i++)
+        expected.push_back((item_pointer_t(0x9000 + i) << 48) | i);
+    // Add each pointer twice, in separate calls, with the copy lagging behind
+    for (int i = 0; i < 210; i++)
+    {
+        for (int j : {i, i - 10})
+        {
+            if (j >= 0 && j < 200)
+            {
+                item_pointer_t pointer = htobe(expected[j]);
+                heap.add_pointers(1, reinterpret_cast<const std::uint8_t *>(&pointer));
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL_COLLECTIONS(heap.pointers_begin(), heap.pointers_end(),
+                                  expected.begin(), expected.end());
+}
+
+// Check that a reset heap reuses the memory allocated for metadata
+BOOST_AUTO_TEST_CASE(reset_reuse)
+{
+    using spead2::recv::live_heap;
+    live_heap heap(dummy_packet(1), 0);
+
+    std::vector<item_pointer_t> pointers;
+    for (int i = 0; i < 50; i++)
+        pointers.push_back(htobe(item_pointer_t(0x9000 + i) << 48));
+    for (int pass = 0; pass < 2; pass++)
+    {
+        heap.add_pointers(pointers.size(), reinterpret_cast<const std::uint8_t *>(pointers.data()));
+        for (int i = 20; i >= 0; i -= 2)
+            BOOST_CHECK(heap.add_payload_range(i * 10, i * 10 + 10));
+        BOOST_CHECK_EQUAL(heap.pointers_end() - heap.pointers_begin(), 50);
+        if (pass == 0)
+            BOOST_CHECK_GT(heap.get_allocations(), 0);
+        else
+            BOOST_CHECK_EQUAL(heap.get_allocations(), 0);
+        heap.reset(dummy_packet(2 + pass), 0);
+        BOOST_CHECK_EQUAL(heap.get_cnt(), 2 + pass);
+        BOOST_CHECK(heap.pointers_begin() == heap.pointers_end());
+        BOOST_CHECK(heap.metadata.payload_ranges.empty());
+    }
+}
+
+/* Check that move-assigning over a heap that was returned by take gives
+ * its metadata memory back to the pool.
+ */
+BOOST_AUTO_TEST_CASE(move_assign)
+{
+    using spead2::recv::live_heap;
+    auto pool = std::make_shared<spead2::recv::detail::live_heap_storage_pool>();
+    live_heap heap(dummy_packet(1), 0);
+
+    std::vector<item_pointer_t> pointers;
+    for (int i = 0; i < 50; i++)
+        pointers.push_back(htobe(item_pointer_t(0x9000 + i) << 48));
+    heap.add_pointers(pointers.size(), reinterpret_cast<const std::uint8_t *>(pointers.data()));
+    live_heap a = heap.take(pool);
+    heap.reset(dummy_packet(2), 0);
+    heap.add_pointers(pointers.size(), reinterpret_cast<const std::uint8_t *>(pointers.data()));
+    live_heap b = heap.take(pool);
+
+    a = std::move(b);
+    BOOST_TEST(a.get_cnt() == 2);
+    BOOST_TEST(a.pointers_end() - a.pointers_begin() == 50);
+    // a's original memory is now in the pool, and b's is still held by a
+    BOOST_TEST(pool->get().pointers.capacity() >= pointers.size());
+    BOOST_TEST(pool->get().pointers.capacity() == 0U);
+}
+
+// The pool retains storage up to its capacity, and frees the rest
+BOOST_AUTO_TEST_CASE(storage_pool_capacity)
+{
+    using pool_type = spead2::recv::detail::live_heap_storage_pool;
+    pool_type pool;
+    for (std::size_t i = 0; i < pool_type::capacity + 10; i++)
+    {
+        pool_type::storage s;
+        s.pointers.resize(10);
+        pool.put(std::move(s));
+    }
+    for (std::size_t i = 0; i < pool_type::capacity; i++)
+    {
+        pool_type::storage s = pool.get();
+        BOOST_TEST(s.pointers.capacity() >= 10U);
+        BOOST_TEST(s.pointers.empty());
+    }
+    BOOST_TEST(pool.get().pointers.capacity() == 0U);
+}
+
+// Return storage from one thread while taking it on another
+BOOST_AUTO_TEST_CASE(storage_pool_threads)
+{
+    using pool_type = spead2::recv::detail::live_heap_storage_pool;
+    constexpr int n = 100000;
+    pool_type pool;
+    std::thread producer([&pool]()
+    {
+        for (int i = 0; i < n; i++)
+        {
+            pool_type::storage s;
+            s.pointers.resize(1 + i % 16);
+            pool.put(std::move(s));
+        }
+    });
+    int reused = 0;
+    for (int i = 0; i < n; i++)
+    {
+        pool_type::storage s = pool.get();
+        BOOST_TEST(s.pointers.empty());
+        if (s.pointers.capacity() > 0)
+            reused++;
+    }
+    producer.join();
+    int remaining = 0;
+    while (pool.get().pointers.capacity() > 0)
+        remaining++;
+    BOOST_TEST(remaining <= int(pool_type::capacity));
+    BOOST_TEST(reused + remaining <= n);
+}
+
 BOOST_AUTO_TEST_CASE(payload_ranges)
 {
     using spead2::recv::live_heap;
     live_heap heap(dummy_packet(1), 0);
+    const auto &ranges = heap.metadata.payload_ranges;
 
     BOOST_CHECK(heap.add_payload_range(100, 200));
-    std::pair<const s_item_pointer_t, s_item_pointer_t> expected1[] = {{100, 200}};
-    BOOST_CHECK_EQUAL_COLLECTIONS(heap.payload_ranges.begin(), heap.payload_ranges.end(),
+    std::pair<s_item_pointer_t, s_item_pointer_t> expected1[] = {{100, 200}};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ranges.begin(), ranges.end(),
                                   std::begin(expected1), std::end(expected1));
     // Range prior to all previous values
     BOOST_CHECK(heap.add_payload_range(30, 40));
-    std::pair<const s_item_pointer_t, s_item_pointer_t> expected2[] = {{30, 40}, {100, 200}};
-    BOOST_CHECK_EQUAL_COLLECTIONS(heap.payload_ranges.begin(), heap.payload_ranges.end(),
+    std::pair<s_item_pointer_t, s_item_pointer_t> expected2[] = {{30, 40}, {100, 200}};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ranges.begin(), ranges.end(),
                                   std::begin(expected2), std::end(expected2));
     // Range after all existing values
     BOOST_CHECK(heap.add_payload_range(300, 350));
-    std::pair<const s_item_pointer_t, s_item_pointer_t> expected3[] = {{30, 40}, {100, 200}, {300, 350}};
-    BOOST_CHECK_EQUAL_COLLECTIONS(heap.payload_ranges.begin(), heap.payload_ranges.end(),
+    std::pair<s_item_pointer_t, s_item_pointer_t> expected3[] = {{30, 40}, {100, 200}, {300, 350}};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ranges.begin(), ranges.end(),
                                   std::begin(expected3), std::end(expected3));
     // Insert at start, merge right
     BOOST_CHECK(heap.add_payload_range(25, 30));
-    std::pair<const s_item_pointer_t, s_item_pointer_t> expected4[] = {{25, 40}, {100, 200}, {300, 350}};
-    BOOST_CHECK_EQUAL_COLLECTIONS(heap.payload_ranges.begin(), heap.payload_ranges.end(),
+    std::pair<s_item_pointer_t, s_item_pointer_t> expected4[] = {{25, 40}, {100, 200}, {300, 350}};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ranges.begin(), ranges.end(),
                                   std::begin(expected4), std::end(expected4));
     // Insert at end, merge left
     BOOST_CHECK(heap.add_payload_range(350, 360));
-    std::pair<const s_item_pointer_t, s_item_pointer_t> expected5[] = {{25, 40}, {100, 200}, {300, 360}};
-    BOOST_CHECK_EQUAL_COLLECTIONS(heap.payload_ranges.begin(), heap.payload_ranges.end(),
+    std::pair<s_item_pointer_t, s_item_pointer_t> expected5[] = {{25, 40}, {100, 200}, {300, 360}};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ranges.begin(), ranges.end(),
                                   std::begin(expected5), std::end(expected5));
     // Insert in middle, merge left
     BOOST_CHECK(heap.add_payload_range(40, 50));
-    std::pair<const s_item_pointer_t, s_item_pointer_t> expected6[] = {{25, 50}, {100, 200}, {300, 360}};
-    BOOST_CHECK_EQUAL_COLLECTIONS(heap.payload_ranges.begin(), heap.payload_ranges.end(),
+    std::pair<s_item_pointer_t, s_item_pointer_t> expected6[] = {{25, 50}, {100, 200}, {300, 360}};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ranges.begin(), ranges.end(),
                                   std::begin(expected6), std::end(expected6));
     // Insert in middle, merge right
     BOOST_CHECK(heap.add_payload_range(80, 100));
-    std::pair<const s_item_pointer_t, s_item_pointer_t> expected7[] = {{25, 50}, {80, 200}, {300, 360}};
-    BOOST_CHECK_EQUAL_COLLECTIONS(heap.payload_ranges.begin(), heap.payload_ranges.end(),
+    std::pair<s_item_pointer_t, s_item_pointer_t> expected7[] = {{25, 50}, {80, 200}, {300, 360}};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ranges.begin(), ranges.end(),
                                   std::begin(expected7), std::end(expected7));
     // Insert in middle, no merge
     BOOST_CHECK(heap.add_payload_range(60, 70));
-    std::pair<const s_item_pointer_t, s_item_pointer_t> expected8[] = {{25, 50}, {60, 70}, {80, 200}, {300, 360}};
-    BOOST_CHECK_EQUAL_COLLECTIONS(heap.payload_ranges.begin(), heap.payload_ranges.end(),
+    std::pair<s_item_pointer_t, s_item_pointer_t> expected8[] = {{25, 50}, {60, 70}, {80, 200}, {300, 360}};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ranges.begin(), ranges.end(),
                                   std::begin(expected8), std::end(expected8));
     // Insert in middle, merge both sides
     BOOST_CHECK(heap.add_payload_range(50, 60));
-    std::pair<const s_item_pointer_t, s_item_pointer_t> expected9[] = {{25, 70}, {80, 200}, {300, 360}};
-    BOOST_CHECK_EQUAL_COLLECTIONS(heap.payload_ranges.begin(), heap.payload_ranges.end(),
+    std::pair<s_item_pointer_t, s_item_pointer_t> expected9[] = {{25, 70}, {80, 200}, {300, 360}};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ranges.begin(), ranges.end(),
                                   std::begin(expected9), std::end(expected9));
     // Duplicates of various sorts
     BOOST_CHECK(!heap.add_payload_range(40, 50));
     BOOST_CHECK(!heap.add_payload_range(25, 30));
     BOOST_CHECK(!heap.add_payload_range(90, 200));
     BOOST_CHECK(!heap.add_payload_range(300, 360));
+    // Partial overlaps
+    BOOST_CHECK(!heap.add_payload_range(60, 90));
+    BOOST_CHECK(!heap.add_payload_range(250, 310));
+}
+
+// Test payload_range_set with more ranges than fit in the inline storage
+BOOST_AUTO_TEST_CASE(payload_range_set_spill)
+{
+    spead2::recv::payload_range_set ranges;
+
+    // Insert every second range in reverse order, then fill in the gaps
+    std::vector<std::pair<s_item_pointer_t, s_item_pointer_t>> expected;
+    for (int i = 18; i >= 0; i -= 2)
+    {
+        BOOST_CHECK(ranges.add(i * 10, i * 10 + 10));
+        expected.insert(expected.begin(), {i * 10, i * 10 + 10});
+        BOOST_CHECK_EQUAL_COLLECTIONS(ranges.begin(), ranges.end(),
+                                      expected.begin(), expected.end());
+    }
+    for (int i = 1; i < 19; i += 2)
+    {
+        BOOST_CHECK(ranges.add(i * 10, i * 10 + 10));
+        BOOST_CHECK(!ranges.add(i * 10, i * 10 + 10));
+    }
+    std::pair<s_item_pointer_t, s_item_pointer_t> expected_final[] = {{0, 190}};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ranges.begin(), ranges.end(),
+                                  std::begin(expected_final), std::end(expected_final));
+
+    ranges.clear();
+    BOOST_CHECK(ranges.empty());
+    BOOST_CHECK(ranges.add(5, 10));
+    BOOST_CHECK_EQUAL(ranges.size(), 1);
 }
 
 BOOST_AUTO_TEST_SUITE_END()  // live_heap
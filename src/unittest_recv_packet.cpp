@@ -0,0 +1,199 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for packet decoding.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <vector>
+#include <spead2/common_defines.h>
+#include <spead2/common_endian.h>
+#include <spead2/common_features.h>
+#include <spead2/recv_packet.h>
+
+/* Declare the instruction-specific implementations, so that we can test all
+ * of them (that the current CPU supports) rather than just the one selected
+ * by the resolver.
+ */
+namespace spead2::recv
+{
+int decode_specials(packet_header &out, const std::uint8_t *pointers) noexcept;
+int decode_specials_scalar(packet_header &out, const std::uint8_t *pointers) noexcept;
+#if SPEAD2_USE_SSE41_DECODE
+int decode_specials_sse41(packet_header &out, const std::uint8_t *pointers) noexcept;
+#endif
+#if SPEAD2_USE_AVX2_DECODE
+int decode_specials_avx2(packet_header &out, const std::uint8_t *pointers) noexcept;
+#endif
+} // namespace spead2::recv
+
+namespace spead2::unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(packet)
+
+struct decode_specials_function
+{
+    const char *name;
+    int (*func)(spead2::recv::packet_header &, const std::uint8_t *) noexcept;
+    bool enabled;
+};
+
+std::ostream &operator<<(std::ostream &o, const decode_specials_function &func)
+{
+    return o << func.name;
+}
+
+static const decode_specials_function decode_specials_functions[] =
+{
+    { "default", spead2::recv::decode_specials, true },
+    { "scalar", spead2::recv::decode_specials_scalar, true },
+#if SPEAD2_USE_SSE41_DECODE
+    { "sse41", spead2::recv::decode_specials_sse41, bool(__builtin_cpu_supports("sse4.1")) },
+#endif
+#if SPEAD2_USE_AVX2_DECODE
+    { "avx2", spead2::recv::decode_specials_avx2, bool(__builtin_cpu_supports("avx2")) },
+#endif
+};
+
+static spead2::recv::packet_header make_header(int heap_address_bits, int n_items)
+{
+    spead2::recv::packet_header header{};
+    header.heap_address_bits = heap_address_bits;
+    header.n_items = n_items;
+    header.heap_cnt = -1;
+    header.heap_length = -1;
+    header.payload_offset = -1;
+    header.payload_length = -1;
+    return header;
+}
+
+/* Compare against the scalar implementation on random item pointers. The
+ * IDs are mostly drawn from a small range so that special items (and
+ * non-immediate items with special IDs) are common, and may be repeated.
+ */
+BOOST_DATA_TEST_CASE(decode_specials_random, boost::unit_test::data::make(decode_specials_functions), sample)
+{
+    if (!sample.enabled)
+        return;
+
+    std::mt19937_64 engine(1);
+    std::uniform_int_distribution<int> n_items_dist(0, 20);
+    std::uniform_int_distribution<int> id_dist(0, 7);
+    std::uniform_int_distribution<int> immediate_dist(0, 3);
+    const int heap_address_bits_options[] = {8, 24, 40, 48, 56};
+    for (int heap_address_bits : heap_address_bits_options)
+    {
+        const int item_id_bits = 64 - heap_address_bits;
+        for (int trial = 0; trial < 1000; trial++)
+        {
+            int n_items = n_items_dist(engine);
+            std::vector<item_pointer_t> pointers(n_items);
+            for (auto &pointer : pointers)
+            {
+                item_pointer_t id = id_dist(engine);
+                if (id == 7)
+                    id = engine() & ((item_pointer_t(1) << (item_id_bits - 1)) - 1);
+                item_pointer_t immediate = immediate_dist(engine) != 0;
+                item_pointer_t address = engine() & ((item_pointer_t(1) << heap_address_bits) - 1);
+                pointer = htobe<item_pointer_t>(
+                    (immediate << 63) | (id << heap_address_bits) | address);
+            }
+            const std::uint8_t *data = reinterpret_cast<const std::uint8_t *>(pointers.data());
+
+            auto expected = make_header(heap_address_bits, n_items);
+            int expected_first = spead2::recv::decode_specials_scalar(expected, data);
+            auto actual = make_header(heap_address_bits, n_items);
+            int actual_first = sample.func(actual, data);
+            BOOST_TEST_REQUIRE(actual_first == expected_first);
+            BOOST_TEST_REQUIRE(actual.heap_cnt == expected.heap_cnt);
+            BOOST_TEST_REQUIRE(actual.heap_length == expected.heap_length);
+            BOOST_TEST_REQUIRE(actual.payload_offset == expected.payload_offset);
+            BOOST_TEST_REQUIRE(actual.payload_length == expected.payload_length);
+        }
+    }
+}
+
+// Check the scalar implementation (which the others are compared to)
+BOOST_AUTO_TEST_CASE(decode_specials_scalar)
+{
+    const int heap_address_bits = 48;
+    const item_pointer_t immediate = item_pointer_t(1) << 63;
+    std::vector<item_pointer_t> pointers = {
+        immediate | (item_pointer_t(HEAP_CNT_ID) << 48) | 123,
+        immediate | (item_pointer_t(PAYLOAD_OFFSET_ID) << 48) | 0,
+        (item_pointer_t(HEAP_LENGTH_ID) << 48) | 1000,   // not immediate, so not special
+        immediate | (item_pointer_t(PAYLOAD_LENGTH_ID) << 48) | 64,
+        immediate | (item_pointer_t(0x1000) << 48) | 5,
+        immediate | (item_pointer_t(HEAP_LENGTH_ID) << 48) | 2000,
+    };
+    for (auto &pointer : pointers)
+        pointer = htobe(pointer);
+    auto header = make_header(heap_address_bits, pointers.size());
+    int first_regular = spead2::recv::decode_specials_scalar(
+        header, reinterpret_cast<const std::uint8_t *>(pointers.data()));
+    BOOST_TEST(first_regular == 2);
+    BOOST_TEST(header.heap_cnt == 123);
+    BOOST_TEST(header.heap_length == 2000);
+    BOOST_TEST(header.payload_offset == 0);
+    BOOST_TEST(header.payload_length == 64);
+}
+
+BOOST_AUTO_TEST_CASE(decode_packets)
+{
+    // Build a packet with the required items and 16 bytes of payload
+    const item_pointer_t immediate = item_pointer_t(1) << 63;
+    std::vector<item_pointer_t> words = {
+        htobe(std::uint64_t(0x5304020600000004)),   // header: magic, version, flavour 64-48, 4 items
+        htobe(immediate | (item_pointer_t(HEAP_CNT_ID) << 48) | 7),
+        htobe(immediate | (item_pointer_t(HEAP_LENGTH_ID) << 48) | 16),
+        htobe(immediate | (item_pointer_t(PAYLOAD_OFFSET_ID) << 48) | 0),
+        htobe(immediate | (item_pointer_t(PAYLOAD_LENGTH_ID) << 48) | 16),
+        0, 0
+    };
+    const std::uint8_t *packet = reinterpret_cast<const std::uint8_t *>(words.data());
+    const std::size_t packet_size = words.size() * sizeof(item_pointer_t);
+    const std::uint8_t garbage[16] = {};
+
+    const std::uint8_t *raw[] = {packet, garbage, packet, packet};
+    const std::size_t lengths[] = {packet_size, sizeof(garbage), packet_size - 1, packet_size};
+    spead2::recv::packet_header headers[4];
+    std::size_t n = spead2::recv::decode_packets(headers, raw, lengths, 4);
+    // The garbage and the truncated packet are rejected
+    BOOST_TEST(n == 2U);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        BOOST_TEST(headers[i].heap_cnt == 7);
+        BOOST_TEST(headers[i].heap_length == 16);
+        BOOST_TEST(headers[i].payload_offset == 0);
+        BOOST_TEST(headers[i].payload_length == 16);
+        BOOST_TEST(headers[i].n_items == 0);
+        BOOST_TEST(headers[i].packet == packet);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // packet
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+} // namespace spead2::unittest
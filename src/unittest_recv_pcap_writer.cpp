@@ -0,0 +1,266 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for recv_pcap_writer.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <csignal>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <string>
+#include <vector>
+#include <thread>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_thread_pool.h>
+#include <spead2/common_inproc.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_heap.h>
+#include <spead2/recv_pcap_writer.h>
+#include <spead2/recv_udp_pcap_replay.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_inproc.h>
+
+namespace spead2::unittest
+{
+
+// Creates a temporary filename and deletes the file on destruction
+class temp_file
+{
+private:
+    std::string filename;
+
+public:
+    temp_file()
+    {
+        char name[] = "/tmp/spead2_unittest_XXXXXX";
+        int fd = mkstemp(name);
+        if (fd < 0)
+            throw std::runtime_error("mkstemp failed");
+        close(fd);
+        filename = name;
+    }
+
+    ~temp_file()
+    {
+        std::remove(filename.c_str());
+    }
+
+    const std::string &get_filename() const { return filename; }
+};
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(pcap_writer)
+
+// Write SPEAD packets for @a n_heaps heaps to @a writer
+static void write_heaps(spead2::recv::pcap_writer &writer, int n_heaps)
+{
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    spead2::send::inproc_stream send_stream(tp, {queue});
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap heap;
+        heap.add_item(0x1000, i * 100);
+        send_stream.async_send_heap(heap, boost::asio::use_future).wait();
+    }
+    queue->stop();
+    while (true)
+    {
+        try
+        {
+            inproc_queue::packet packet = queue->buffer.try_pop();
+            writer.add_packet(packet.data.get(), packet.size);
+        }
+        catch (ringbuffer_stopped &)
+        {
+            break;
+        }
+    }
+}
+
+/* Replay a pcap file into a stream and return the values of item 0x1000.
+ * If @a tap is non-null, it is used as the packet tap for the stream.
+ */
+static std::vector<item_pointer_t> replay(
+    const std::string &filename,
+    std::shared_ptr<spead2::recv::pcap_writer> tap = nullptr)
+{
+    thread_pool tp;
+    spead2::recv::ring_stream<> stream(
+        tp, spead2::recv::stream_config().set_packet_tap(std::move(tap)));
+    stream.emplace_reader<spead2::recv::udp_pcap_replay_reader>(filename);
+    std::vector<item_pointer_t> values;
+    for (const spead2::recv::heap &heap : stream)
+    {
+        for (const auto &item : heap.get_items())
+            if (item.id == 0x1000)
+                values.push_back(item.immediate_value);
+    }
+    return values;
+}
+
+BOOST_AUTO_TEST_CASE(round_trip)
+{
+    temp_file file;
+    spead2::recv::pcap_writer writer(file.get_filename());
+    write_heaps(writer, 5);
+    writer.close();
+    BOOST_TEST(writer.get_dropped() == 0U);
+    std::vector<item_pointer_t> expected{0, 100, 200, 300, 400};
+    BOOST_TEST(replay(file.get_filename()) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(tap)
+{
+    temp_file file1, file2;
+    spead2::recv::pcap_writer writer(file1.get_filename());
+    write_heaps(writer, 3);
+    writer.close();
+
+    auto tap = std::make_shared<spead2::recv::pcap_writer>(file2.get_filename());
+    std::vector<item_pointer_t> expected{0, 100, 200};
+    BOOST_TEST(replay(file1.get_filename(), tap) == expected);
+    tap->close();
+    BOOST_TEST(tap->get_dropped() == 0U);
+    // The tap should have recorded the same packets
+    BOOST_TEST(replay(file2.get_filename()) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(buffer_full)
+{
+    temp_file file;
+    // Use minimum-size buffers, so that they fill up quickly
+    spead2::recv::pcap_writer writer(file.get_filename(), 70000, 2);
+    std::vector<std::uint8_t> packet(9000);
+    for (int i = 0; i < 1000; i++)
+        writer.add_packet(packet.data(), packet.size());
+    writer.close();
+    // Some packets may have been dropped, but the file must be consistent
+    std::uint64_t written = 1000 - writer.get_dropped();
+    BOOST_TEST(written > 0U);
+    struct stat st;
+    BOOST_REQUIRE(stat(file.get_filename().c_str(), &st) == 0);
+    BOOST_TEST(std::uint64_t(st.st_size) == 24 + written * (16 + 14 + 20 + 8 + packet.size()));
+    // Packets received after close are dropped
+    std::uint64_t dropped = writer.get_dropped();
+    writer.add_packet(packet.data(), packet.size());
+    BOOST_TEST(writer.get_dropped() == dropped + 1);
+}
+
+BOOST_AUTO_TEST_CASE(sources)
+{
+    temp_file file;
+    constexpr int n_sources = 4;
+    constexpr int n_packets = 100;
+    constexpr std::size_t packet_size = 1000;
+    spead2::recv::pcap_writer writer(file.get_filename(), 1024 * 1024, 2);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n_sources; i++)
+    {
+        threads.emplace_back([&writer] {
+            spead2::recv::pcap_writer::source source(writer);
+            std::vector<std::uint8_t> packet(packet_size);
+            for (int j = 0; j < n_packets; j++)
+                source.add_packet(packet.data(), packet.size());
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    // A source that is still alive must be flushed by close
+    spead2::recv::pcap_writer::source source(writer);
+    std::vector<std::uint8_t> packet(packet_size);
+    source.add_packet(packet.data(), packet.size());
+    writer.close();
+    BOOST_TEST(writer.get_dropped() == 0U);
+    struct stat st;
+    BOOST_REQUIRE(stat(file.get_filename().c_str(), &st) == 0);
+    std::uint64_t written = n_sources * n_packets + 1;
+    BOOST_TEST(std::uint64_t(st.st_size) == 24 + written * (16 + 14 + 20 + 8 + packet_size));
+    source.add_packet(packet.data(), packet.size());
+    BOOST_TEST(writer.get_dropped() == 1U);
+}
+
+BOOST_AUTO_TEST_CASE(write_error)
+{
+    temp_file file;
+    // Limit the file size so that the writer thread gets EFBIG
+    struct rlimit old_limit;
+    BOOST_REQUIRE(getrlimit(RLIMIT_FSIZE, &old_limit) == 0);
+    struct rlimit limit = old_limit;
+    limit.rlim_cur = 100000;
+    auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+    BOOST_REQUIRE(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+
+    spead2::recv::pcap_writer writer(file.get_filename(), 70000, 2);
+    std::vector<std::uint8_t> packet(9000);
+    for (int i = 0; i < 1000; i++)
+        writer.add_packet(packet.data(), packet.size());
+    BOOST_CHECK_THROW(writer.close(), std::system_error);
+    setrlimit(RLIMIT_FSIZE, &old_limit);
+    std::signal(SIGXFSZ, old_handler);
+    /* There are 3 buffers (including the one for add_packet), each holding
+     * 7 packets, and the packets in them were not all written.
+     */
+    BOOST_TEST(writer.get_dropped() >= 1000U - 3 * 7);
+}
+
+BOOST_AUTO_TEST_CASE(max_payload)
+{
+    temp_file file;
+    spead2::recv::pcap_writer writer(file.get_filename());
+    // Largest payload for which the IPv4 total length fits in 16 bits
+    std::vector<std::uint8_t> packet(65535 - 20 - 8);
+    writer.add_packet(packet.data(), packet.size());
+    BOOST_TEST(writer.get_dropped() == 0U);
+    std::vector<std::uint8_t> big(packet.size() + 1);
+    writer.add_packet(big.data(), big.size());
+    BOOST_TEST(writer.get_dropped() == 1U);
+    writer.close();
+
+    std::FILE *f = std::fopen(file.get_filename().c_str(), "rb");
+    BOOST_REQUIRE(f);
+    std::vector<std::uint8_t> contents(24 + 16 + 14 + 65535 + 1);
+    std::size_t size = std::fread(contents.data(), 1, contents.size(), f);
+    std::fclose(f);
+    BOOST_TEST(size == 24 + 16 + 14 + 65535);
+    // IPv4 total length field
+    BOOST_TEST((contents[24 + 16 + 14 + 2] << 8 | contents[24 + 16 + 14 + 3]) == 65535);
+}
+
+BOOST_AUTO_TEST_CASE(bad_args)
+{
+    temp_file file;
+    BOOST_CHECK_THROW(
+        spead2::recv::pcap_writer(file.get_filename(), spead2::recv::pcap_writer::default_buffer_size, 1),
+        std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::recv::pcap_writer(file.get_filename(), 1000), std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::recv::pcap_writer("/does/not/exist/file.pcap"), std::system_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // pcap_writer
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+} // namespace spead2::unittest
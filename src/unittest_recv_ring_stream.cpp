@@ -22,6 +22,13 @@
  * wrapper.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include <stdexcept>
 #include <boost/asio.hpp>
 #include <boost/test/unit_test.hpp>
 #include <spead2/common_thread_pool.h>
@@ -69,6 +76,265 @@ BOOST_AUTO_TEST_CASE(iteration)
     BOOST_TEST(values == expected);
 }
 
+// Test retrieving heaps in batches
+BOOST_AUTO_TEST_CASE(pop_live_many)
+{
+    constexpr int n_heaps = 10;
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    spead2::send::inproc_stream send_stream(tp, {queue});
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap heap;
+        heap.add_item(0x1000, i);
+        send_stream.async_send_heap(heap, boost::asio::use_future).wait();
+    }
+    queue->stop();
+
+    spead2::recv::ring_stream<> recv_stream(tp);
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue);
+    std::vector<item_pointer_t> values;
+    try
+    {
+        while (true)
+        {
+            std::vector<spead2::recv::live_heap> heaps;
+            std::size_t n = recv_stream.pop_live_many(std::back_inserter(heaps), 3);
+            BOOST_TEST(n == heaps.size());
+            BOOST_TEST(n >= 1u);
+            BOOST_TEST(n <= 3u);
+            for (auto &h : heaps)
+            {
+                spead2::recv::heap heap(std::move(h));
+                for (auto &&item : heap.get_items())
+                    if (item.id == 0x1000)
+                        values.push_back(item.immediate_value);
+            }
+        }
+    }
+    catch (spead2::ringbuffer_stopped &)
+    {
+    }
+
+    std::vector<item_pointer_t> expected;
+    for (int i = 0; i < n_heaps; i++)
+        expected.push_back(i);
+    BOOST_TEST(values == expected);
+}
+
+// Test multiple readers adding heaps to different shards
+BOOST_AUTO_TEST_CASE(shards)
+{
+    constexpr int n_heaps = 100;
+    thread_pool tp(2);
+    auto queue0 = std::make_shared<inproc_queue>();
+    auto queue1 = std::make_shared<inproc_queue>();
+    // Even heap cnts go to queue0 and odd ones to queue1
+    spead2::send::inproc_stream send_stream(tp, {queue0, queue1});
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap heap;
+        heap.add_item(0x1000, i);
+        send_stream.async_send_heap(heap, boost::asio::use_future, i + 1, i % 2).wait();
+    }
+    // The queues are not stopped, because the first reader to see the end
+    // of its queue would stop the stream.
+    spead2::recv::stream_config config;
+    config.set_substreams(2);
+    config.set_shards(2);
+    spead2::recv::ring_stream_config ring_config;
+    ring_config.set_heaps(n_heaps);
+    spead2::recv::ring_stream<> recv_stream(tp, config, ring_config);
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue0);
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue1);
+    std::vector<item_pointer_t> values;
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::recv::heap heap = recv_stream.pop();
+        for (auto &&item : heap.get_items())
+            if (item.id == 0x1000)
+                values.push_back(item.immediate_value);
+    }
+    recv_stream.stop();
+
+    std::sort(values.begin(), values.end());
+    std::vector<item_pointer_t> expected;
+    for (int i = 0; i < n_heaps; i++)
+        expected.push_back(i);
+    BOOST_TEST(values == expected);
+}
+
+/* Test that metadata storage is reused once heaps are handed off, for heaps
+ * with more item pointers than can be held inline. Each heap is popped before
+ * the next is sent, so that the number of heaps in flight (and hence the
+ * storage needed) is deterministic.
+ */
+BOOST_AUTO_TEST_CASE(metadata_reuse)
+{
+    constexpr int n_warmup = 10;
+    constexpr int n_heaps = 200;
+    constexpr int n_items = 32;
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    spead2::send::inproc_stream send_stream(tp, {queue});
+    spead2::recv::ring_stream<> recv_stream(tp);
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue);
+    std::uint64_t warm = 0;
+    for (int i = 0; i < n_heaps; i++)
+    {
+        if (i == n_warmup)
+            warm = recv_stream.get_stats()[spead2::recv::stream_stat_indices::metadata_allocations];
+        spead2::send::heap send_heap;
+        for (int j = 0; j < n_items; j++)
+            send_heap.add_item(0x1000 + j, i * 100 + j);
+        send_stream.async_send_heap(send_heap, boost::asio::use_future).wait();
+        spead2::recv::heap heap = recv_stream.pop();
+        BOOST_TEST(heap.get_items().size() == std::size_t(n_items));
+    }
+    queue->stop();
+    recv_stream.stop();
+    std::uint64_t after = recv_stream.get_stats()[spead2::recv::stream_stat_indices::metadata_allocations];
+    BOOST_TEST(warm > 0u);
+    BOOST_TEST(after == warm);
+}
+
+/* Test multiple readers adding heaps to different shards, where each reader
+ * interleaves the packets of heaps from both shards.
+ */
+BOOST_AUTO_TEST_CASE(shards_interleaved)
+{
+    constexpr int n_groups = 25;
+    constexpr int group_size = 4;
+    constexpr int n_heaps = 2 * n_groups * group_size;
+    thread_pool tp(2);
+    auto queue0 = std::make_shared<inproc_queue>();
+    auto queue1 = std::make_shared<inproc_queue>();
+    spead2::send::inproc_stream send_stream(
+        tp, {queue0, queue1}, spead2::send::stream_config().set_max_packet_size(1024));
+    std::vector<std::uint8_t> data(4096);
+    std::vector<spead2::send::heap> heaps(n_heaps);
+    for (int i = 0; i < n_heaps; i++)
+    {
+        heaps[i].add_item(0x1000, i);
+        heaps[i].add_item(0x1001, data.data(), data.size(), false);
+    }
+    // Each group of consecutive heap cnts spans both shards
+    for (int q = 0; q < 2; q++)
+        for (int g = 0; g < n_groups; g++)
+        {
+            std::vector<spead2::send::heap_reference> refs;
+            for (int j = 0; j < group_size; j++)
+            {
+                int i = (q * n_groups + g) * group_size + j;
+                refs.emplace_back(heaps[i], i + 1, q);
+            }
+            send_stream.async_send_heaps(
+                refs.begin(), refs.end(), boost::asio::use_future,
+                spead2::send::group_mode::ROUND_ROBIN).wait();
+        }
+
+    spead2::recv::stream_config config;
+    config.set_substreams(2);
+    config.set_shards(2);
+    // Enough that heaps are not evicted if one reader stalls
+    config.set_max_heaps(n_heaps);
+    spead2::recv::ring_stream_config ring_config;
+    ring_config.set_heaps(n_heaps);
+    spead2::recv::ring_stream<> recv_stream(tp, config, ring_config);
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue0);
+    recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue1);
+    std::vector<item_pointer_t> values;
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::recv::heap heap = recv_stream.pop();
+        for (auto &&item : heap.get_items())
+        {
+            if (item.id == 0x1000)
+                values.push_back(item.immediate_value);
+            else if (item.id == 0x1001)
+                BOOST_TEST(item.length == data.size());
+        }
+    }
+    recv_stream.stop();
+    BOOST_TEST(recv_stream.get_stats().incomplete_heaps_evicted == 0u);
+
+    std::sort(values.begin(), values.end());
+    std::vector<item_pointer_t> expected;
+    for (int i = 0; i < n_heaps; i++)
+        expected.push_back(i);
+    BOOST_TEST(values == expected);
+}
+
+// Test that a stream with custom statistics cannot be sharded
+BOOST_AUTO_TEST_CASE(shards_custom_stats)
+{
+    thread_pool tp;
+    spead2::recv::stream_config config;
+    config.set_substreams(2);
+    config.set_shards(2);
+    config.add_stat("counter");
+    BOOST_CHECK_THROW(spead2::recv::ring_stream<>(tp, config), std::invalid_argument);
+}
+
+/* Test that stop() is not starved by readers that keep the stream busy with
+ * a sharded stream. The ring buffer is tiny and nothing consumes from it, so
+ * readers end up blocked in heap_ready while others are still adding packets.
+ * How far the readers get before the stop is timing-dependent, so only check
+ * that stop() returns promptly and that the statistics are self-consistent.
+ */
+BOOST_AUTO_TEST_CASE(shards_stop_saturated)
+{
+    constexpr int n_readers = 4;
+    constexpr int n_heaps = 40000;
+    constexpr std::size_t ring_heaps = 2;
+    thread_pool tp(n_readers);
+    std::vector<std::shared_ptr<inproc_queue>> queues;
+    for (int i = 0; i < n_readers; i++)
+        queues.push_back(std::make_shared<inproc_queue>());
+    spead2::send::inproc_stream send_stream(tp, queues);
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap heap;
+        heap.add_item(0x1000, i);
+        send_stream.async_send_heap(heap, boost::asio::use_future, i + 1, i % n_readers).wait();
+    }
+
+    spead2::recv::stream_config config;
+    config.set_substreams(n_readers);
+    config.set_shards(n_readers);
+    spead2::recv::ring_stream_config ring_config;
+    ring_config.set_heaps(ring_heaps);
+    spead2::recv::ring_stream<> recv_stream(tp, config, ring_config);
+    for (const auto &queue : queues)
+        recv_stream.emplace_reader<spead2::recv::inproc_reader>(queue);
+    recv_stream.pop();   // Wait until the readers are running
+
+    auto start = std::chrono::steady_clock::now();
+    recv_stream.stop();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    BOOST_TEST(elapsed.count() < 10.0);
+
+    // Heaps left in the ring buffer can still be retrieved after stopping
+    std::uint64_t popped = 1;
+    try
+    {
+        while (true)
+        {
+            recv_stream.pop_live();
+            popped++;
+        }
+    }
+    catch (spead2::ringbuffer_stopped &)
+    {
+    }
+    BOOST_TEST(popped <= 1 + ring_heaps);
+    auto stats = recv_stream.get_stats();
+    std::uint64_t heaps = stats[spead2::recv::stream_stat_indices::heaps];
+    BOOST_TEST(heaps >= popped);
+    BOOST_TEST(heaps <= std::uint64_t(n_heaps));
+    BOOST_TEST(stats[spead2::recv::stream_stat_indices::packets] >= heaps);
+}
+
 BOOST_AUTO_TEST_SUITE_END()  // ring_stream
 BOOST_AUTO_TEST_SUITE_END()  // recv
 
@@ -0,0 +1,352 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for recv_udp_pcap_replay.
+ */
+
+#include <cstdint>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_thread_pool.h>
+#include <spead2/common_inproc.h>
+#include <spead2/common_raw_packet.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_heap.h>
+#include <spead2/recv_udp_pcap_replay.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_inproc.h>
+
+namespace spead2::unittest
+{
+
+// Creates a temporary pcap file and deletes it on destruction
+class pcap_file
+{
+private:
+    std::string filename;
+    std::ofstream out;
+
+    template<typename T>
+    void write(T value)
+    {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+public:
+    explicit pcap_file(std::uint32_t linktype = 1)
+    {
+        char name[] = "/tmp/spead2_unittest_XXXXXX";
+        int fd = mkstemp(name);
+        if (fd < 0)
+            throw std::runtime_error("mkstemp failed");
+        close(fd);
+        filename = name;
+        out.open(filename, std::ios::binary);
+        write<std::uint32_t>(0xa1b2c3d4);  // magic number (microsecond resolution)
+        write<std::uint16_t>(2);           // major version
+        write<std::uint16_t>(4);           // minor version
+        write<std::int32_t>(0);            // thiszone
+        write<std::uint32_t>(0);           // sigfigs
+        write<std::uint32_t>(65535);       // snaplen
+        write<std::uint32_t>(linktype);
+    }
+
+    ~pcap_file()
+    {
+        std::remove(filename.c_str());
+    }
+
+    // Wrap a UDP payload in ethernet, IPv4 and UDP headers and append it
+    void add_udp(const std::uint8_t *payload, std::size_t size, std::uint32_t time_us)
+    {
+        std::vector<std::uint8_t> frame(
+            ethernet_frame::min_size + ipv4_packet::min_size + udp_packet::min_size + size);
+        ethernet_frame eth(frame.data(), frame.size());
+        eth.ethertype(ipv4_packet::ethertype);
+        ipv4_packet ipv4 = eth.payload_ipv4();
+        ipv4.version_ihl(0x45);
+        ipv4.total_length(ipv4.size());
+        ipv4.ttl(1);
+        ipv4.protocol(udp_packet::protocol);
+        udp_packet udp = ipv4.payload_udp();
+        udp.length(udp.size());
+        std::memcpy(udp.payload().data(), payload, size);
+        add_frame(frame.data(), frame.size(), time_us);
+    }
+
+    void add_frame(const std::uint8_t *data, std::size_t size, std::uint32_t time_us)
+    {
+        write<std::uint32_t>(time_us / 1000000);
+        write<std::uint32_t>(time_us % 1000000);
+        write<std::uint32_t>(size);
+        write<std::uint32_t>(size);
+        out.write(reinterpret_cast<const char *>(data), size);
+    }
+
+    const std::string &close_and_get_filename()
+    {
+        out.close();
+        return filename;
+    }
+};
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(udp_pcap_replay)
+
+/* Generate SPEAD packets for @a n_heaps heaps, each with a single immediate
+ * item, and write them to @a file with timestamps @a interval_us apart. A
+ * non-UDP frame is inserted after the first packet.
+ */
+static void make_capture(pcap_file &file, int n_heaps, std::uint32_t interval_us)
+{
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    spead2::send::inproc_stream send_stream(tp, {queue});
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap heap;
+        heap.add_item(0x1000, i * 100);
+        send_stream.async_send_heap(heap, boost::asio::use_future).wait();
+    }
+    queue->stop();
+
+    std::uint32_t time_us = 1000;
+    bool first = true;
+    while (true)
+    {
+        try
+        {
+            inproc_queue::packet packet = queue->buffer.try_pop();
+            file.add_udp(packet.data.get(), packet.size, time_us);
+            time_us += interval_us;
+            if (first)
+            {
+                std::uint8_t arp[60] = {};
+                arp[12] = 0x08;
+                arp[13] = 0x06;
+                file.add_frame(arp, sizeof(arp), time_us);
+                first = false;
+            }
+        }
+        catch (ringbuffer_stopped &)
+        {
+            break;
+        }
+    }
+}
+
+static std::vector<item_pointer_t> replay(const std::string &filename, double speed)
+{
+    thread_pool tp;
+    spead2::recv::ring_stream<> stream(tp);
+    stream.emplace_reader<spead2::recv::udp_pcap_replay_reader>(filename, speed);
+    std::vector<item_pointer_t> values;
+    for (const spead2::recv::heap &heap : stream)
+    {
+        for (const auto &item : heap.get_items())
+            if (item.id == 0x1000)
+                values.push_back(item.immediate_value);
+    }
+    return values;
+}
+
+BOOST_AUTO_TEST_CASE(fast)
+{
+    pcap_file file;
+    make_capture(file, 3, 1000000);
+    auto start = std::chrono::steady_clock::now();
+    auto values = replay(file.close_and_get_filename(), 0.0);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::vector<item_pointer_t> expected{0, 100, 200};
+    BOOST_TEST(values == expected);
+    // The timestamps span several seconds, which should have been ignored
+    BOOST_TEST(elapsed.count() < 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(paced)
+{
+    pcap_file file;
+    // 3 single-packet heaps, spaced by 100ms
+    make_capture(file, 3, 100000);
+    auto start = std::chrono::steady_clock::now();
+    auto values = replay(file.close_and_get_filename(), 2.0);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::vector<item_pointer_t> expected{0, 100, 200};
+    BOOST_TEST(values == expected);
+    // Last packet is 200ms after the first, so replaying at 2x takes 100ms
+    BOOST_TEST(elapsed.count() >= 0.1);
+}
+
+/* Interleave the packets of two multi-packet heaps. When they are added as
+ * a batch, packets are grouped by heap, so each heap is only looked up in
+ * the hash table once.
+ */
+BOOST_AUTO_TEST_CASE(interleaved)
+{
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    spead2::send::inproc_stream send_stream(
+        tp, {queue}, spead2::send::stream_config().set_max_packet_size(1024));
+    std::vector<std::uint8_t> data[2];
+    std::vector<inproc_queue::packet> packets[2];
+    for (int i = 0; i < 2; i++)
+    {
+        data[i].resize(4000);
+        for (std::size_t j = 0; j < data[i].size(); j++)
+            data[i][j] = i + j;
+        spead2::send::heap heap;
+        heap.add_item(0x1000, data[i].data(), data[i].size(), false);
+        send_stream.async_send_heap(heap, boost::asio::use_future).wait();
+        while (true)
+        {
+            try
+            {
+                packets[i].push_back(queue->buffer.try_pop());
+            }
+            catch (ringbuffer_empty &)
+            {
+                break;
+            }
+        }
+    }
+    BOOST_REQUIRE(packets[0].size() > 1);
+    BOOST_REQUIRE(packets[0].size() == packets[1].size());
+
+    pcap_file file;
+    for (std::size_t j = 0; j < packets[0].size(); j++)
+        for (int i = 0; i < 2; i++)
+            file.add_udp(packets[i][j].data.get(), packets[i][j].size, 0);
+
+    spead2::recv::ring_stream<> stream(tp);
+    stream.emplace_reader<spead2::recv::udp_pcap_replay_reader>(file.close_and_get_filename());
+    int n_heaps = 0;
+    for (const spead2::recv::heap &heap : stream)
+    {
+        BOOST_REQUIRE(n_heaps < 2);
+        const auto &items = heap.get_items();
+        BOOST_REQUIRE(items.size() == 1U);
+        BOOST_TEST(std::vector<std::uint8_t>(items[0].ptr, items[0].ptr + items[0].length)
+                   == data[n_heaps]);
+        n_heaps++;
+    }
+    BOOST_TEST(n_heaps == 2);
+    // Ensure the reader has finished updating the statistics
+    stream.stop();
+    auto stats = stream.get_stats();
+    BOOST_TEST(stats.packets == 2 * packets[0].size());
+    BOOST_TEST(stats.search_dist == 2U);
+}
+
+/* Interleave the packets of more heaps than fit in one batch window, so
+ * that there are many heaps to group in each window and heaps straddle
+ * windows.
+ */
+BOOST_AUTO_TEST_CASE(interleaved_many)
+{
+    constexpr int n_heaps = 40;
+    thread_pool tp;
+    auto queue = std::make_shared<inproc_queue>();
+    spead2::send::inproc_stream send_stream(
+        tp, {queue}, spead2::send::stream_config().set_max_packet_size(1024));
+    std::vector<std::uint8_t> data(2500);
+    std::vector<std::vector<inproc_queue::packet>> packets(n_heaps);
+    for (int i = 0; i < n_heaps; i++)
+    {
+        for (std::size_t j = 0; j < data.size(); j++)
+            data[j] = i + j;
+        spead2::send::heap heap;
+        heap.add_item(0x1000, i);
+        heap.add_item(0x1001, data.data(), data.size(), false);
+        send_stream.async_send_heap(heap, boost::asio::use_future).wait();
+        while (true)
+        {
+            try
+            {
+                packets[i].push_back(queue->buffer.try_pop());
+            }
+            catch (ringbuffer_empty &)
+            {
+                break;
+            }
+        }
+        BOOST_REQUIRE(packets[i].size() == packets[0].size());
+    }
+    BOOST_REQUIRE(packets[0].size() > 1);
+
+    pcap_file file;
+    for (std::size_t j = 0; j < packets[0].size(); j++)
+        for (int i = 0; i < n_heaps; i++)
+            file.add_udp(packets[i][j].data.get(), packets[i][j].size, 0);
+
+    spead2::recv::stream_config config;
+    config.set_max_heaps(n_heaps);
+    spead2::recv::ring_stream<> stream(
+        tp, config, spead2::recv::ring_stream_config().set_heaps(n_heaps));
+    stream.emplace_reader<spead2::recv::udp_pcap_replay_reader>(file.close_and_get_filename());
+    std::vector<bool> seen(n_heaps);
+    for (const spead2::recv::heap &heap : stream)
+    {
+        item_pointer_t i = n_heaps;
+        std::vector<std::uint8_t> payload;
+        for (const auto &item : heap.get_items())
+        {
+            if (item.id == 0x1000)
+                i = item.immediate_value;
+            else if (item.id == 0x1001)
+                payload.assign(item.ptr, item.ptr + item.length);
+        }
+        BOOST_REQUIRE(i < item_pointer_t(n_heaps));
+        BOOST_TEST(!seen[i]);
+        seen[i] = true;
+        for (std::size_t j = 0; j < data.size(); j++)
+            data[j] = i + j;
+        BOOST_TEST(payload == data);
+    }
+    stream.stop();
+    BOOST_TEST(std::count(seen.begin(), seen.end(), true) == n_heaps);
+    BOOST_TEST(stream.get_stats().incomplete_heaps_evicted == 0U);
+}
+
+BOOST_AUTO_TEST_CASE(bad_file)
+{
+    thread_pool tp;
+    spead2::recv::ring_stream<> stream(tp);
+    pcap_file file(12345);  // unsupported link type
+    BOOST_CHECK_THROW(
+        stream.emplace_reader<spead2::recv::udp_pcap_replay_reader>(file.close_and_get_filename()),
+        std::runtime_error);
+    BOOST_CHECK_THROW(
+        stream.emplace_reader<spead2::recv::udp_pcap_replay_reader>("/does/not/exist"),
+        std::system_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // udp_pcap_replay
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+} // namespace spead2::unittest
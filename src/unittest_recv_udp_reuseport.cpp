@@ -0,0 +1,157 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for make_udp_reuseport_sockets.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_features.h>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_packet.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_heap.h>
+#include <spead2/recv_udp.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_udp.h>
+
+namespace spead2::unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(udp_reuseport)
+
+static const boost::asio::ip::udp::endpoint loopback_endpoint(
+    boost::asio::ip::address_v4::loopback(), 0);
+
+static void send_heaps(
+    thread_pool &tp, const boost::asio::ip::udp::endpoint &endpoint, int n_heaps)
+{
+    // Limit the rate so that the socket buffers do not overflow
+    spead2::send::udp_stream send_stream(
+        tp, {endpoint}, spead2::send::stream_config().set_rate(50e6));
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap heap;
+        heap.add_item(0x1000, i);
+        send_stream.async_send_heap(heap, boost::asio::use_future, i + 1).get();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bad_args)
+{
+    thread_pool tp;
+    BOOST_CHECK_THROW(
+        spead2::recv::make_udp_reuseport_sockets(tp.get_io_service(), loopback_endpoint, 0),
+        std::invalid_argument);
+    boost::asio::ip::udp::endpoint multicast(
+        boost::asio::ip::make_address("239.255.1.1"), 8888);
+    BOOST_CHECK_THROW(
+        spead2::recv::make_udp_reuseport_sockets(tp.get_io_service(), multicast, 2),
+        std::invalid_argument);
+}
+
+// All the sockets must be bound to the same (ephemeral) port
+BOOST_AUTO_TEST_CASE(same_port)
+{
+    thread_pool tp;
+    auto sockets = spead2::recv::make_udp_reuseport_sockets(
+        tp.get_io_service(), loopback_endpoint, 3);
+    BOOST_REQUIRE_EQUAL(sockets.size(), 3U);
+    auto endpoint = sockets[0].local_endpoint();
+    BOOST_TEST(endpoint.port() != 0);
+    for (const auto &socket : sockets)
+        BOOST_TEST(socket.local_endpoint() == endpoint);
+}
+
+#if SPEAD2_USE_REUSEPORT_CBPF
+// Each packet must arrive on the socket selected by its heap cnt
+BOOST_AUTO_TEST_CASE(steering)
+{
+    constexpr std::size_t n = 4;
+    constexpr int n_heaps = 40;
+    thread_pool tp;
+    auto sockets = spead2::recv::make_udp_reuseport_sockets(
+        tp.get_io_service(), loopback_endpoint, n);
+    send_heaps(tp, sockets[0].local_endpoint(), n_heaps);
+
+    std::vector<std::uint8_t> buffer(65536);
+    int received = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        while (sockets[i].available() > 0)
+        {
+            std::size_t length = sockets[i].receive(boost::asio::buffer(buffer));
+            spead2::recv::packet_header packet;
+            BOOST_REQUIRE_EQUAL(spead2::recv::decode_packet(packet, buffer.data(), length), length);
+            BOOST_TEST(std::size_t(packet.heap_cnt) % n == i);
+            received++;
+        }
+    }
+    BOOST_TEST(received == n_heaps);
+}
+#endif
+
+// Receive with one reader per shard
+BOOST_AUTO_TEST_CASE(shards)
+{
+    constexpr std::size_t n = 4;
+    constexpr int n_heaps = 200;
+    thread_pool tp(n);
+    spead2::recv::stream_config config;
+    config.set_substreams(n);
+    config.set_shards(n);
+    spead2::recv::ring_stream<> stream(
+        tp, config, spead2::recv::ring_stream_config().set_heaps(n_heaps));
+    auto sockets = spead2::recv::make_udp_reuseport_sockets(
+        stream.get_io_service(), loopback_endpoint, n);
+    auto endpoint = sockets[0].local_endpoint();
+    for (auto &socket : sockets)
+        stream.emplace_reader<spead2::recv::udp_reader>(std::move(socket));
+    send_heaps(tp, endpoint, n_heaps);
+
+    // The stream is not stopped by the sender, because the end-of-stream
+    // heap would only reach one of the readers.
+    std::vector<item_pointer_t> values;
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::recv::heap heap = stream.pop();
+        for (const auto &item : heap.get_items())
+            if (item.id == 0x1000)
+                values.push_back(item.immediate_value);
+    }
+    stream.stop();
+
+    std::sort(values.begin(), values.end());
+    std::vector<item_pointer_t> expected(n_heaps);
+    for (int i = 0; i < n_heaps; i++)
+        expected[i] = i;
+    BOOST_TEST(values == expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // udp_reuseport
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+} // namespace spead2::unittest
@@ -0,0 +1,104 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for recv_udp_uring.
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_URING
+
+#include <cstdint>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_thread_pool.h>
+#include <spead2/common_socket.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_heap.h>
+#include <spead2/recv_udp_uring.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_udp.h>
+
+namespace spead2::unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(udp_uring)
+
+/* Send @a n_heaps heaps (plus an end-of-stream heap) over loopback, and
+ * return the values of item 0x1000 that are received.
+ */
+static std::vector<item_pointer_t> transfer(int n_heaps)
+{
+    thread_pool tp;
+    spead2::recv::ring_stream<> stream(
+        tp, spead2::recv::stream_config(),
+        spead2::recv::ring_stream_config().set_heaps(n_heaps + 1));
+    boost::asio::ip::udp::socket socket(stream.get_io_service());
+    socket.open(boost::asio::ip::udp::v4());
+    socket.bind(boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    set_socket_recv_buffer_size(socket, 8 * 1024 * 1024);
+    auto endpoint = socket.local_endpoint();
+    stream.emplace_reader<spead2::recv::udp_uring_reader>(std::move(socket));
+
+    // Limit the rate so that the socket buffer does not overflow
+    spead2::send::udp_stream send_stream(
+        tp, {endpoint}, spead2::send::stream_config().set_rate(50e6));
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap heap;
+        heap.add_item(0x1000, i);
+        send_stream.async_send_heap(heap, boost::asio::use_future).get();
+    }
+    spead2::send::heap end;
+    end.add_end();
+    send_stream.async_send_heap(end, boost::asio::use_future).get();
+
+    std::vector<item_pointer_t> values;
+    for (const spead2::recv::heap &heap : stream)
+    {
+        for (const auto &item : heap.get_items())
+            if (item.id == 0x1000)
+                values.push_back(item.immediate_value);
+    }
+    return values;
+}
+
+BOOST_AUTO_TEST_CASE(simple)
+{
+    std::vector<item_pointer_t> expected{0, 1, 2, 3, 4};
+    BOOST_TEST(transfer(5) == expected);
+}
+
+// Send more packets than there are buffers, so that buffers must be recycled
+BOOST_AUTO_TEST_CASE(recycle)
+{
+    const int n = 3 * spead2::recv::udp_uring_reader::buffer_count;
+    std::vector<item_pointer_t> expected(n);
+    for (int i = 0; i < n; i++)
+        expected[i] = i;
+    BOOST_TEST(transfer(n) == expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // udp_uring
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+} // namespace spead2::unittest
+
+#endif // SPEAD2_USE_URING
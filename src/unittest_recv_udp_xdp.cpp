@@ -0,0 +1,201 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for recv_udp_xdp and send_udp_xdp.
+ *
+ * These need a network interface that can be handed over to AF_XDP, so they
+ * create a veth pair in a private network namespace. They are skipped if the
+ * process lacks the necessary capabilities.
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_XDP
+
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <spead2/common_thread_pool.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_heap.h>
+#include <spead2/recv_udp_xdp.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_udp_xdp.h>
+
+namespace spead2::unittest
+{
+
+BOOST_AUTO_TEST_SUITE(recv)
+BOOST_AUTO_TEST_SUITE(udp_xdp)
+
+// Capability numbers from linux/capability.h
+static constexpr int cap_net_admin = 12;
+static constexpr int cap_net_raw = 13;
+static constexpr int cap_sys_admin = 21;
+static constexpr int cap_bpf = 39;
+
+// Check whether the process has what it needs to create and use a veth pair
+static boost::test_tools::assertion_result can_use_veth(boost::unit_test::test_unit_id)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    std::uint64_t caps = 0;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("CapEff:", 0) == 0)
+        {
+            std::istringstream(line.substr(7)) >> std::hex >> caps;
+            break;
+        }
+    }
+    auto has = [caps](int cap) { return (caps >> cap) & 1; };
+    boost::test_tools::assertion_result result(true);
+    if (!has(cap_net_admin) || !has(cap_net_raw) || !(has(cap_bpf) || has(cap_sys_admin)))
+    {
+        result = false;
+        result.message() << "CAP_NET_ADMIN, CAP_NET_RAW and CAP_BPF (or CAP_SYS_ADMIN) are required";
+    }
+    else if (std::system("ip -V >/dev/null 2>&1") != 0)
+    {
+        result = false;
+        result.message() << "the ip command is not available";
+    }
+    return result;
+}
+
+/* Moves the calling thread into a new network namespace containing a veth
+ * pair, and moves it back on destruction. Threads created in the meantime
+ * (such as those of a thread pool) inherit the namespace. The namespace and
+ * the interfaces vanish once nothing refers to them.
+ */
+class veth_fixture
+{
+private:
+    int orig_ns = -1;
+
+    static void run(const std::string &command)
+    {
+        BOOST_REQUIRE_MESSAGE(std::system(command.c_str()) == 0, command << " failed");
+    }
+
+public:
+    static constexpr const char *tx_address = "10.88.0.1";
+    static constexpr const char *rx_address = "10.88.0.2";
+
+    veth_fixture()
+    {
+        orig_ns = open("/proc/self/ns/net", O_RDONLY | O_CLOEXEC);
+        BOOST_REQUIRE(orig_ns >= 0);
+        BOOST_REQUIRE(unshare(CLONE_NEWNET) == 0);
+        run("ip link add spead2_tx type veth peer name spead2_rx");
+        run(std::string("ip addr add ") + tx_address + "/24 dev spead2_tx");
+        run(std::string("ip addr add ") + rx_address + "/24 dev spead2_rx");
+        run("ip link set spead2_tx up");
+        run("ip link set spead2_rx up");
+    }
+
+    ~veth_fixture()
+    {
+        setns(orig_ns, CLONE_NEWNET);
+        close(orig_ns);
+    }
+};
+
+/* Send @a n_heaps heaps (plus an end-of-stream heap) from an XDP sender on
+ * one end of the veth pair to an XDP reader on the other, and return the
+ * values of item 0x1000 that are received. If packets go missing, the
+ * stream is stopped after a timeout so that the test fails rather than
+ * hanging.
+ */
+static std::vector<item_pointer_t> transfer(int n_heaps)
+{
+    const boost::asio::ip::udp::endpoint endpoint(
+        boost::asio::ip::make_address_v4("239.255.88.88"), 8888);
+    thread_pool tp;
+    spead2::recv::ring_stream<> stream(
+        tp, spead2::recv::stream_config(),
+        spead2::recv::ring_stream_config().set_heaps(n_heaps + 1));
+    stream.emplace_reader<spead2::recv::udp_xdp_reader>(
+        spead2::recv::udp_xdp_config()
+            .set_endpoints({endpoint})
+            .set_interface_address(boost::asio::ip::make_address(veth_fixture::rx_address)));
+
+    spead2::send::udp_xdp_stream send_stream(
+        tp, spead2::send::stream_config().set_rate(50e6),
+        spead2::send::udp_xdp_config()
+            .set_endpoints({endpoint})
+            .set_interface_address(boost::asio::ip::make_address(veth_fixture::tx_address)));
+    for (int i = 0; i < n_heaps; i++)
+    {
+        spead2::send::heap heap;
+        heap.add_item(0x1000, i);
+        send_stream.async_send_heap(heap, boost::asio::use_future).get();
+    }
+    spead2::send::heap end;
+    end.add_end();
+    send_stream.async_send_heap(end, boost::asio::use_future).get();
+
+    boost::asio::steady_timer timeout(tp.get_io_service(), std::chrono::seconds(5));
+    timeout.async_wait([&stream](const boost::system::error_code &error) {
+        if (!error)
+            stream.stop();
+    });
+    std::vector<item_pointer_t> values;
+    for (const spead2::recv::heap &heap : stream)
+    {
+        for (const auto &item : heap.get_items())
+            if (item.id == 0x1000)
+                values.push_back(item.immediate_value);
+    }
+    timeout.cancel();
+    stream.stop();
+    return values;
+}
+
+BOOST_FIXTURE_TEST_CASE(round_trip, veth_fixture, *boost::unit_test::precondition(can_use_veth))
+{
+    std::vector<item_pointer_t> expected{0, 1, 2, 3, 4};
+    BOOST_TEST(transfer(5) == expected);
+}
+
+// Send more packets than fit in the UMEM, so that frames must be recycled
+BOOST_FIXTURE_TEST_CASE(recycle, veth_fixture, *boost::unit_test::precondition(can_use_veth))
+{
+    const int n = 3 * (spead2::recv::udp_xdp_config::default_buffer_size
+                       / spead2::detail::xdp_socket::frame_size);
+    std::vector<item_pointer_t> expected(n);
+    for (int i = 0; i < n; i++)
+        expected[i] = i;
+    BOOST_TEST(transfer(n) == expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // udp_xdp
+BOOST_AUTO_TEST_SUITE_END()  // recv
+
+} // namespace spead2::unittest
+
+#endif // SPEAD2_USE_XDP
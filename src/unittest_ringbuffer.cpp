@@ -0,0 +1,106 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for the batched operations of common_ringbuffer and
+ * common_lockfree_ringbuffer.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include <spead2/common_ringbuffer.h>
+#include <spead2/common_lockfree_ringbuffer.h>
+
+namespace spead2::unittest
+{
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(ringbuffer)
+
+typedef boost::mpl::list<
+    spead2::ringbuffer<int>,
+    spead2::ringbuffer<int, spead2::semaphore_fd, spead2::semaphore_fd>,
+    spead2::ringbuffer<int, spead2::semaphore_pipe, spead2::semaphore_pipe>,
+    spead2::lockfree_ringbuffer<int>> ringbuffer_types;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(push_pop_many, T, ringbuffer_types)
+{
+    T ring(4);
+    std::vector<int> in{1, 2, 3, 4, 5, 6};
+    BOOST_TEST(ring.try_push_many(in.begin(), in.end()) == 4u);
+    BOOST_CHECK_THROW(ring.try_push_many(in.begin() + 4, in.end()), spead2::ringbuffer_full);
+
+    std::vector<int> out;
+    BOOST_TEST(ring.pop_many(std::back_inserter(out), 3) == 3u);
+    BOOST_TEST(out == std::vector<int>({1, 2, 3}));
+    BOOST_TEST(ring.try_pop_many(std::back_inserter(out), 0) == 0u);
+    ring.push_many(in.begin() + 4, in.end());
+    BOOST_TEST(ring.try_pop_many(std::back_inserter(out), 10) == 3u);
+    BOOST_TEST(out == in);
+    BOOST_CHECK_THROW(ring.try_pop_many(std::back_inserter(out), 10), spead2::ringbuffer_empty);
+}
+
+// Items pushed before the stop are returned, then the stop is reported
+BOOST_AUTO_TEST_CASE_TEMPLATE(pop_many_stop, T, ringbuffer_types)
+{
+    T ring(4);
+    std::vector<int> in{1, 2};
+    ring.push_many(in.begin(), in.end());
+    ring.stop();
+    BOOST_CHECK_THROW(ring.push_many(in.begin(), in.end()), spead2::ringbuffer_stopped);
+    std::vector<int> out;
+    BOOST_TEST(ring.pop_many(std::back_inserter(out), 10) == 2u);
+    BOOST_TEST(out == in);
+    BOOST_CHECK_THROW(ring.pop_many(std::back_inserter(out), 10), spead2::ringbuffer_stopped);
+    // The stop must still be visible to other consumers
+    BOOST_CHECK_THROW(ring.try_pop_many(std::back_inserter(out), 10), spead2::ringbuffer_stopped);
+    BOOST_CHECK_THROW(ring.pop(), spead2::ringbuffer_stopped);
+}
+
+// A batched producer and consumer, with more items than fit in the ring
+BOOST_AUTO_TEST_CASE_TEMPLATE(many_threaded, T, ringbuffer_types)
+{
+    constexpr int n_items = 10000;
+    T ring(7);
+    std::vector<int> in(n_items);
+    for (int i = 0; i < n_items; i++)
+        in[i] = i;
+    std::thread producer([&] {
+        ring.push_many(in.begin(), in.end());
+        ring.stop();
+    });
+    std::vector<int> out;
+    try
+    {
+        while (true)
+            ring.pop_many(std::back_inserter(out), 5);
+    }
+    catch (spead2::ringbuffer_stopped &)
+    {
+    }
+    producer.join();
+    BOOST_TEST(out == in);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // ringbuffer
+BOOST_AUTO_TEST_SUITE_END()  // common
+
+} // namespace spead2::unittest
@@ -104,6 +104,30 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(single_thread, T, semaphore_types)
     BOOST_CHECK_EQUAL(semaphore_get_value(sem), 1);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(put_many, T, semaphore_types)
+{
+    T sem(1);
+    sem.put(3);
+    BOOST_CHECK_EQUAL(semaphore_get_value(sem), 4);
+    sem.put(0);
+    BOOST_CHECK_EQUAL(semaphore_get_value(sem), 0);
+    sem.put(1000);
+    BOOST_CHECK_EQUAL(semaphore_get_value(sem), 1000);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(try_get_many, T, semaphore_types)
+{
+    T sem(5);
+    BOOST_CHECK_EQUAL(sem.try_get_many(0), 0u);
+    BOOST_CHECK_EQUAL(sem.try_get_many(3), 3u);
+    BOOST_CHECK_EQUAL(sem.try_get_many(10), 2u);
+    BOOST_CHECK_EQUAL(sem.try_get_many(1), 0u);
+    sem.put(1000);
+    BOOST_CHECK_EQUAL(sem.try_get_many(600), 600u);
+    BOOST_CHECK_EQUAL(sem.try_get_many(2000), 400u);
+    BOOST_CHECK_EQUAL(semaphore_get_value(sem), 0);
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE(multi_thread, T, semaphore_types)
 {
     const std::int64_t N = 100000;
@@ -0,0 +1,125 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for send_udp_uring.
+ */
+
+#include <spead2/common_features.h>
+#if SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
+
+#include <cstdint>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <spead2/common_thread_pool.h>
+#include <spead2/common_socket.h>
+#include <spead2/recv_ring_stream.h>
+#include <spead2/recv_heap.h>
+#include <spead2/recv_udp.h>
+#include <spead2/send_heap.h>
+#include <spead2/send_udp_uring.h>
+
+namespace spead2::unittest
+{
+
+BOOST_AUTO_TEST_SUITE(send)
+BOOST_AUTO_TEST_SUITE(udp_uring)
+
+/* Send heaps whose payloads span many packets (so that packets are merged
+ * with GSO, where available) and check that they arrive intact.
+ */
+BOOST_DATA_TEST_CASE(transfer, boost::unit_test::data::make({false, true}), zero_copy)
+{
+    const int n_heaps = 20;
+    const std::size_t payload_size = 20000;
+
+    thread_pool tp;
+    spead2::recv::ring_stream<> recv_stream(
+        tp, spead2::recv::stream_config(),
+        spead2::recv::ring_stream_config().set_heaps(n_heaps + 1));
+    boost::asio::ip::udp::socket socket(recv_stream.get_io_service());
+    socket.open(boost::asio::ip::udp::v4());
+    socket.bind(boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    set_socket_recv_buffer_size(socket, 8 * 1024 * 1024);
+    auto endpoint = socket.local_endpoint();
+    recv_stream.emplace_reader<spead2::recv::udp_reader>(std::move(socket));
+
+    std::vector<std::vector<std::uint8_t>> payloads(n_heaps);
+    {
+        // Limit the rate so that the socket buffer does not overflow
+        spead2::send::udp_uring_stream send_stream(
+            tp,
+            spead2::send::stream_config().set_rate(200e6).set_max_heaps(n_heaps + 1),
+            spead2::send::udp_uring_config()
+                .add_endpoint(endpoint)
+                .set_zero_copy(zero_copy));
+        std::vector<spead2::send::heap> heaps(n_heaps);
+        for (int i = 0; i < n_heaps; i++)
+        {
+            payloads[i].resize(payload_size);
+            for (std::size_t j = 0; j < payload_size; j++)
+                payloads[i][j] = std::uint8_t(i + j * 7);
+            heaps[i].add_item(0x1000, payloads[i].data(), payload_size, false);
+            send_stream.async_send_heap(
+                heaps[i],
+                [](const boost::system::error_code &ec, item_pointer_t)
+                {
+                    BOOST_CHECK(!ec);
+                });
+        }
+        spead2::send::heap end;
+        end.add_end();
+        send_stream.async_send_heap(end, boost::asio::use_future).get();
+    }
+
+    int n = 0;
+    for (const spead2::recv::heap &heap : recv_stream)
+    {
+        BOOST_REQUIRE_LT(n, n_heaps);
+        bool found = false;
+        for (const auto &item : heap.get_items())
+            if (item.id == 0x1000)
+            {
+                BOOST_CHECK_EQUAL_COLLECTIONS(
+                    item.ptr, item.ptr + item.length,
+                    payloads[n].begin(), payloads[n].end());
+                found = true;
+            }
+        BOOST_CHECK(found);
+        n++;
+    }
+    BOOST_TEST(n == n_heaps);
+}
+
+BOOST_AUTO_TEST_CASE(no_endpoints)
+{
+    thread_pool tp;
+    BOOST_CHECK_THROW(
+        spead2::send::udp_uring_stream(
+            tp, spead2::send::stream_config(), spead2::send::udp_uring_config()),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // udp_uring
+BOOST_AUTO_TEST_SUITE_END()  // send
+
+} // namespace spead2::unittest
+
+#endif // SPEAD2_USE_URING && SPEAD2_USE_SENDMMSG
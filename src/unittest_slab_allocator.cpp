@@ -0,0 +1,77 @@
+/* Copyright 2026 National Research Foundation (SARAO)
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ *
+ * Unit tests for common_slab_allocator.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <spead2/common_slab_allocator.h>
+
+namespace spead2::unittest
+{
+
+BOOST_AUTO_TEST_SUITE(common)
+BOOST_AUTO_TEST_SUITE(slab_allocator)
+
+BOOST_AUTO_TEST_CASE(classes)
+{
+    auto allocator = std::make_shared<spead2::slab_allocator>(100, 1000, 2, 1);
+    allocator->set_warn_on_empty(false);
+    BOOST_TEST(allocator->get_num_classes() == 4u);  // 128, 256, 512, 1024
+    BOOST_TEST(allocator->get_max_size() == 1024u);
+
+    std::vector<spead2::memory_allocator::pointer> pointers;
+    pointers.push_back(allocator->allocate(1, nullptr));    // 128: hit
+    pointers.push_back(allocator->allocate(128, nullptr));  // 128: miss
+    pointers.push_back(allocator->allocate(129, nullptr));  // 256: hit
+    pointers.push_back(allocator->allocate(1024, nullptr)); // 1024: hit
+    pointers.push_back(allocator->allocate(1025, nullptr)); // not pooled
+    pointers.clear();
+    pointers.push_back(allocator->allocate(200, nullptr));  // 256: hit
+
+    auto stats = allocator->get_stats();
+    BOOST_REQUIRE_EQUAL(stats.size(), 4u);
+    const std::size_t sizes[] = {128, 256, 512, 1024};
+    const std::uint64_t hits[] = {1, 2, 0, 1};
+    const std::uint64_t misses[] = {1, 0, 0, 0};
+    for (std::size_t i = 0; i < 4; i++)
+    {
+        BOOST_TEST_CONTEXT("class " << i)
+        {
+            BOOST_TEST(stats[i].size == sizes[i]);
+            BOOST_TEST(stats[i].hits == hits[i]);
+            BOOST_TEST(stats[i].misses == misses[i]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bad_args)
+{
+    BOOST_CHECK_THROW(spead2::slab_allocator(0, 1024, 2, 1), std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::slab_allocator(2048, 1024, 2, 1), std::invalid_argument);
+    BOOST_CHECK_THROW(spead2::slab_allocator(128, 1024, 1, 2), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()  // slab_allocator
+BOOST_AUTO_TEST_SUITE_END()  // common
+
+} // namespace spead2::unittest
@@ -52,6 +52,45 @@ class TestThreadPool:
         with pytest.raises(ValueError):
             spead2.ThreadPool(0, [0, 1])
 
+    def test_numa_node(self):
+        assert spead2.ThreadPool().numa_node == -1
+        node = spead2.ThreadPool(1, [0]).numa_node
+        assert node == spead2.ThreadPool.get_core_numa_node(0)
+        allocator = spead2.MmapAllocator(numa_node=max(node, 0))
+        assert allocator.numa_node == max(node, 0)
+
+
+class TestWarmUp:
+    def test_memory_pool(self):
+        thread_pool = spead2.ThreadPool(2)
+        pool = spead2.MemoryPool(1024, 2048, 4, 0)
+        pool.warm_up(thread_pool, 4)
+
+    def test_prefault(self):
+        thread_pool = spead2.ThreadPool(2)
+        data = np.arange(100000, dtype=np.uint8)
+        expected = data.copy()
+        spead2.prefault(thread_pool, data, 3)
+        np.testing.assert_array_equal(data, expected)
+
+
+class TestSlabAllocator:
+    """Smoke tests for :py:class:`spead2.SlabAllocator`."""
+
+    def test_classes(self):
+        allocator = spead2.SlabAllocator(100, 1000, 2, 1)
+        assert allocator.num_classes == 4
+        assert allocator.max_size == 1024
+        stats = allocator.stats
+        assert [s.size for s in stats] == [128, 256, 512, 1024]
+        assert all(s.hits == 0 and s.misses == 0 for s in stats)
+
+    def test_bad_args(self):
+        with pytest.raises(ValueError):
+            spead2.SlabAllocator(0, 1024, 2, 1)
+        with pytest.raises(ValueError):
+            spead2.SlabAllocator(2048, 1024, 2, 1)
+
 
 class TestFlavour:
     def test_bad_version(self):
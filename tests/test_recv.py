@@ -245,6 +245,7 @@ class TestDecode:
             "allow_out_of_order",
             "max_heaps",
             "substreams",
+            "shards",
         }:
             if key in kwargs:
                 setattr(config, key, kwargs.pop(key))
@@ -530,7 +531,8 @@ class TestDecode:
         assert heaps[0].received_length == 32
         assert heaps[0].payload_ranges == [(0, 32)]
 
-    def test_substreams(self):
+    @pytest.mark.parametrize("shards", [1, 2])
+    def test_substreams(self, shards):
         payload = bytearray(64)
         payload[:] = range(64)
         stream0_packets = self.flavour.make_packet_heap(
@@ -546,7 +548,7 @@ class TestDecode:
         # Interleave the packets from stream 1 into the middle of the substream
         # 0 packet.
         packets = stream0_packets[0:1] + stream1_packets + stream0_packets[1:]
-        heaps = self.data_to_heaps(b"".join(packets), substreams=2)
+        heaps = self.data_to_heaps(b"".join(packets), substreams=2, shards=shards)
         assert len(heaps) == 10
         assert heaps[-1].cnt == 2
         items = heaps[-1].get_items()
@@ -817,6 +819,7 @@ class TestStreamConfig:
         recv.StreamStatConfig("single_packet_heaps"),
         recv.StreamStatConfig("search_dist"),
         recv.StreamStatConfig("worker_blocked"),
+        recv.StreamStatConfig("metadata_allocations"),
     ]
 
     def test_default_construct(self):
@@ -853,6 +856,32 @@ class TestStreamConfig:
         assert config.stream_id == 123
         assert config.explicit_start is True
 
+    def test_memcpy_scatter(self):
+        config = recv.StreamConfig()
+        config.memcpy = recv.MemcpyScatter(8, 64, spead2.MEMCPY_NONTEMPORAL)
+        scatter = config.memcpy
+        assert isinstance(scatter, recv.MemcpyScatter)
+        assert scatter.row_size == 8
+        assert scatter.row_stride == 64
+        assert scatter.memcpy == spead2.MEMCPY_NONTEMPORAL
+        config.memcpy = spead2.MEMCPY_STD
+        assert config.memcpy == spead2.MEMCPY_STD
+
+    def test_memcpy_scatter_bad_stride(self):
+        with pytest.raises(ValueError):
+            recv.MemcpyScatter(8, 4)
+
+    def test_memcpy_convert(self):
+        config = recv.StreamConfig()
+        config.memcpy = recv.MemcpyConvert(spead2.CONVERT_BSWAP32)
+        convert = config.memcpy
+        assert isinstance(convert, recv.MemcpyConvert)
+        assert convert.convert == spead2.CONVERT_BSWAP32
+
+    def test_memcpy_convert_bad_id(self):
+        with pytest.raises(ValueError):
+            recv.MemcpyConvert(1000)
+
     def test_kwargs_construct(self):
         config = recv.StreamConfig(
             max_heaps=5,
@@ -878,6 +907,24 @@ class TestStreamConfig:
         with pytest.raises(ValueError):
             recv.StreamConfig(max_heaps=0)
 
+    def test_shards_zero(self):
+        """Constructing a config with shards=0 raises ValueError"""
+        with pytest.raises(ValueError):
+            recv.StreamConfig(shards=0)
+
+    def test_shards_not_divisor(self):
+        """Constructing a stream with shards not dividing substreams raises ValueError"""
+        config = recv.StreamConfig(substreams=3, shards=2)
+        with pytest.raises(ValueError):
+            recv.Stream(spead2.ThreadPool(), config)
+
+    def test_shards_custom_stats(self):
+        """Constructing a sharded stream with custom statistics raises ValueError"""
+        config = recv.StreamConfig(substreams=2, shards=2)
+        config.add_stat("counter")
+        with pytest.raises(ValueError):
+            recv.Stream(spead2.ThreadPool(), config)
+
     def test_bad_bug_compat(self):
         with pytest.raises(ValueError):
             recv.StreamConfig(bug_compat=0xFF)
@@ -932,6 +979,26 @@ class TestRingStreamConfig:
 
 
 @pytest.mark.skipif(not hasattr(spead2, "IbvContext"), reason="IBV support not compiled in")
+class TestUdpPollConfig:
+    def test_default_construct(self):
+        config = recv.UdpPollConfig()
+        assert config.max_poll == 1
+        assert config.busy_poll == 0
+        assert config.prefer_busy_poll is False
+
+    def test_kwargs_construct(self):
+        config = recv.UdpPollConfig(max_poll=10, busy_poll=50, prefer_busy_poll=True)
+        assert config.max_poll == 10
+        assert config.busy_poll == 50
+        assert config.prefer_busy_poll is True
+
+    def test_bad_values(self):
+        with pytest.raises(ValueError):
+            recv.UdpPollConfig(max_poll=0)
+        with pytest.raises(ValueError):
+            recv.UdpPollConfig(busy_poll=-1)
+
+
 class TestUdpIbvConfig:
     def test_default_construct(self):
         config = recv.UdpIbvConfig()
@@ -1013,6 +1080,64 @@ class TestUdpIbvConfig:
             stream.add_udp_ibv_reader(config)
 
 
+@pytest.mark.skipif(not hasattr(spead2, "XdpMode"), reason="AF_XDP support not compiled in")
+class TestUdpXdpConfig:
+    def test_default_construct(self):
+        config = recv.UdpXdpConfig()
+        assert config.endpoints == []
+        assert config.interface_address == ""
+        assert config.buffer_size == recv.UdpXdpConfig.DEFAULT_BUFFER_SIZE
+        assert config.max_size == recv.UdpXdpConfig.DEFAULT_MAX_SIZE
+        assert config.queue_id == 0
+        assert config.mode == spead2.XdpMode.AUTO
+        assert config.max_poll == recv.UdpXdpConfig.DEFAULT_MAX_POLL
+
+    def test_kwargs_construct(self):
+        config = recv.UdpXdpConfig(
+            endpoints=[("hello", 1234), ("", 2345)],
+            interface_address="1.2.3.4",
+            buffer_size=100,
+            max_size=1500,
+            queue_id=2,
+            mode=spead2.XdpMode.ZERO_COPY,
+            max_poll=1000,
+        )
+        assert config.endpoints == [("hello", 1234), ("", 2345)]
+        assert config.interface_address == "1.2.3.4"
+        assert config.buffer_size == 100
+        assert config.max_size == 1500
+        assert config.queue_id == 2
+        assert config.mode == spead2.XdpMode.ZERO_COPY
+        assert config.max_poll == 1000
+
+    def test_bad_max_size(self):
+        config = recv.UdpXdpConfig()
+        with pytest.raises(ValueError):
+            config.max_size = 0
+        with pytest.raises(ValueError):
+            config.max_size = 9000
+
+    def test_no_endpoints(self):
+        config = recv.UdpXdpConfig(interface_address="10.0.0.1")
+        stream = recv.Stream(spead2.ThreadPool(), recv.StreamConfig(), recv.RingStreamConfig())
+        with pytest.raises(ValueError, match="endpoints is empty"):
+            stream.add_udp_xdp_reader(config)
+
+    def test_ipv6_endpoints(self, unused_udp_port):
+        config = recv.UdpXdpConfig(
+            endpoints=[("::1", unused_udp_port)], interface_address="10.0.0.1"
+        )
+        stream = recv.Stream(spead2.ThreadPool(), recv.StreamConfig(), recv.RingStreamConfig())
+        with pytest.raises(ValueError, match="endpoint is not an IPv4 address"):
+            stream.add_udp_xdp_reader(config)
+
+    def test_no_interface_address(self, unused_udp_port):
+        config = recv.UdpXdpConfig(endpoints=[("239.255.88.88", unused_udp_port)])
+        stream = recv.Stream(spead2.ThreadPool(), recv.StreamConfig(), recv.RingStreamConfig())
+        with pytest.raises(ValueError, match="interface address"):
+            stream.add_udp_xdp_reader(config)
+
+
 class TestStream:
     """Tests for the stream API."""
 
@@ -1090,6 +1215,34 @@ class TestStream:
         assert stats.incomplete_heaps_flushed == 0
         assert stats.worker_blocked == 0
 
+    def test_get_many(self):
+        """Heaps can be retrieved in batches"""
+        thread_pool = spead2.ThreadPool(1)
+        sender = send.BytesStream(thread_pool)
+        ig = send.ItemGroup()
+        ig.add_item(id=0x2345, name="name", description="description", shape=(), format=[("u", 32)])
+        for i in range(10):
+            ig["name"].value = i
+            sender.send_heap(ig.get_heap())
+        sender.send_heap(ig.get_end())
+        receiver = recv.Stream(thread_pool, ring_config=recv.RingStreamConfig(heaps=16))
+        receiver.add_buffer_reader(sender.getvalue())
+        values = []
+        ig_recv = spead2.ItemGroup()
+        while True:
+            try:
+                heaps = receiver.get_many(3)
+            except spead2.Stopped:
+                break
+            assert 1 <= len(heaps) <= 3
+            for heap in heaps:
+                ig_recv.update(heap)
+                values.append(ig_recv["name"].value)
+        assert values == list(range(10))
+        assert receiver.get_many(0) == []
+        with pytest.raises(spead2.Stopped):
+            receiver.get_many_nowait(3)
+
     def test_reader_after_start(self):
         config = recv.StreamConfig(explicit_start=True)
         stream = recv.Stream(spead2.ThreadPool(1), config)
@@ -1247,6 +1400,62 @@ class TestUdpReader:
         with pytest.raises(RuntimeError):
             receiver.add_udp_reader(22)
 
+    def test_busy_poll(self):
+        """Heaps are received when the reader polls the socket"""
+        thread_pool = spead2.ThreadPool()
+        receiver = recv.Stream(thread_pool)
+        with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as recv_sock:
+            recv_sock.bind(("127.0.0.1", 0))
+            port = recv_sock.getsockname()[1]
+            receiver.add_udp_reader(socket=recv_sock, poll_config=recv.UdpPollConfig(max_poll=100))
+        sender = send.UdpStream(thread_pool, [("127.0.0.1", port)])
+        ig = send.ItemGroup()
+        ig.add_item(id=0x1000, name="x", description="x", shape=(), format=[("u", 32)], value=7)
+        sender.send_heap(ig.get_heap())
+        sender.send_heap(ig.get_end())
+        heaps = list(receiver)
+        assert len(heaps) == 1
+        ig_recv = spead2.ItemGroup()
+        ig_recv.update(heaps[0])
+        assert ig_recv["x"].value == 7
+
+    def test_reuseport_sockets(self):
+        sockets = recv.make_udp_reuseport_sockets(3, 0, "127.0.0.1")
+        assert len(sockets) == 3
+        addresses = {sock.getsockname() for sock in sockets}
+        assert len(addresses) == 1
+        assert addresses.pop()[1] != 0
+        for sock in sockets:
+            sock.close()
+
+    def test_reuseport_bad_args(self):
+        with pytest.raises(ValueError):
+            recv.make_udp_reuseport_sockets(0, 0, "127.0.0.1")
+        with pytest.raises(ValueError):
+            recv.make_udp_reuseport_sockets(2, 8888, "239.255.1.1")
+
+    def test_reuseport_shards(self):
+        """Heaps are received with one reader per shard"""
+        n = 4
+        n_heaps = 20
+        thread_pool = spead2.ThreadPool(n)
+        receiver = recv.Stream(thread_pool, recv.StreamConfig(substreams=n, shards=n))
+        sockets = recv.make_udp_reuseport_sockets(n, 0, "127.0.0.1")
+        port = sockets[0].getsockname()[1]
+        for sock in sockets:
+            receiver.add_udp_reader(sock)
+            sock.close()
+        sender = send.UdpStream(thread_pool, [("127.0.0.1", port)])
+        ig = send.ItemGroup()
+        ig.add_item(id=0x1000, name="x", description="x", shape=(), format=[("u", 32)], value=7)
+        for i in range(n_heaps):
+            sender.send_heap(ig.get_heap(descriptors="all", data="all"))
+        # The end-of-stream heap would only reach one reader, so rather
+        # stop the stream once all the heaps have arrived.
+        cnts = [receiver.get().cnt for i in range(n_heaps)]
+        receiver.stop()
+        assert sorted(cnts) == list(range(1, n_heaps + 1))
+
 
 class TestTcpReader:
     def setup_method(self):
@@ -43,6 +43,27 @@ class TestRecvAsyncio:
         assert heaps[0].is_start_of_stream()
         assert heaps[1].is_end_of_stream()
 
+    async def test_get_many(self):
+        tp = spead2.ThreadPool()
+        queue = spead2.InprocQueue()
+        sender = spead2.send.InprocStream(tp, [queue])
+        ig = spead2.send.ItemGroup()
+        sender.send_heap(ig.get_start())
+        sender.send_heap(ig.get_end())
+        queue.stop()
+        recv_config = spead2.recv.StreamConfig(stop_on_stop_item=False)
+        receiver = spead2.recv.asyncio.Stream(tp, recv_config)
+        receiver.add_inproc_reader(queue)
+        heaps = []
+        while True:
+            try:
+                heaps.extend(await receiver.get_many(5))
+            except spead2.Stopped:
+                break
+        assert len(heaps) == 2
+        assert heaps[0].is_start_of_stream()
+        assert heaps[1].is_end_of_stream()
+
 
 class MyChunk(spead2.recv.Chunk):
     """Subclasses Chunk to carry extra metadata."""
@@ -1,4 +1,4 @@
-# Copyright 2021-2022 National Research Foundation (SARAO)
+# Copyright 2021-2022, 2026 National Research Foundation (SARAO)
 #
 # This program is free software: you can redistribute it and/or modify it under
 # the terms of the GNU Lesser General Public License as published by the Free
@@ -123,6 +123,22 @@ def place_extra(data_ptr, data_size, user_data_ptr):
         extra[0] = items[2]
 
 
+@numba.cfunc(
+    types.void(types.CPointer(chunk_place_data), types.uintp, types.uintp), nopython=True
+)
+def place_batch_plain(data_ptr, n_data, data_size):
+    # Same as place_plain, but for a batch of heaps
+    data = numba.carray(data_ptr, n_data)
+    for i in range(n_data):
+        items = numba.carray(intp_to_voidptr(data[i].items), 2, dtype=np.int64)
+        heap_cnt = items[0]
+        payload_size = items[1]
+        if payload_size == HEAP_PAYLOAD_SIZE:
+            data[i].chunk_id = heap_cnt // HEAPS_PER_CHUNK
+            data[i].heap_index = heap_cnt % HEAPS_PER_CHUNK
+            data[i].heap_offset = data[i].heap_index * HEAP_PAYLOAD_SIZE
+
+
 # ctypes doesn't distinguish equivalent integer types, so we have to
 # specify the signature explicitly.
 place_plain_llc = scipy.LowLevelCallable(place_plain.ctypes, signature="void (void *, size_t)")
@@ -130,6 +146,9 @@ place_bind_llc = scipy.LowLevelCallable(
     place_bind.ctypes, signature="void (void *, size_t, void *)"
 )
 place_extra_llc = scipy.LowLevelCallable(place_extra.ctypes, signature="void (void *, size_t)")
+place_batch_plain_llc = scipy.LowLevelCallable(
+    place_batch_plain.ctypes, signature="void (void *, size_t, size_t)"
+)
 
 
 class TestChunkStreamConfig:
@@ -139,6 +158,7 @@ class TestChunkStreamConfig:
         assert config.max_chunks == config.DEFAULT_MAX_CHUNKS
         assert config.place is None
         assert config.packet_presence_payload_size == 0
+        assert not config.direct_placement
 
     def test_zero_max_chunks(self):
         config = recv.ChunkStreamConfig()
@@ -176,6 +196,27 @@ class TestChunkStreamConfig:
         config = recv.ChunkStreamConfig(place=place_bind_llc)
         assert config.place == place_bind_llc
 
+    def test_set_place_batch(self):
+        config = recv.ChunkStreamConfig(place_batch=place_batch_plain_llc)
+        assert config.place_batch == place_batch_plain_llc
+
+    def test_set_place_affine(self):
+        rule = recv.ChunkPlaceAffine(timestamp_item=1, channel_item=2, channels=4)
+        config = recv.ChunkStreamConfig(place_affine=rule)
+        assert config.place_affine.timestamp_item == 1
+        assert config.place_affine.channel_item == 2
+        assert config.place_affine.heaps_per_chunk == 4
+        config.place_affine = None
+        assert config.place_affine is None
+
+    def test_place_affine_zero_channels(self):
+        with pytest.raises(ValueError):
+            recv.ChunkPlaceAffine(channels=0)
+
+    def test_set_place_batch_bad_signature(self):
+        with pytest.raises(ValueError):
+            recv.ChunkStreamConfig(place_batch=place_plain_llc)
+
 
 def make_chunk(label="a"):
     return MyChunk(label, data=bytearray(10), present=bytearray(1))
@@ -353,8 +394,15 @@ class TestChunkRingStream:
     def queue(self):
         return spead2.InprocQueue()
 
-    @pytest.fixture(params=[place_plain_llc])
-    def recv_stream(self, request, data_ring, free_ring, queue):
+    @pytest.fixture(params=[False, True], ids=["assemble", "direct"])
+    def direct_placement(self, request):
+        return request.param
+
+    @pytest.fixture(
+        params=[{"place": place_plain_llc}, {"place_batch": place_batch_plain_llc}],
+        ids=["place", "place_batch"],
+    )
+    def recv_stream(self, request, data_ring, free_ring, queue, direct_placement):
         stream = spead2.recv.ChunkRingStream(
             spead2.ThreadPool(),
             # max_heaps is artificially high to make test_packet_too_old work
@@ -363,7 +411,8 @@ class TestChunkRingStream:
                 items=[0x1000, spead2.HEAP_LENGTH_ID, 0x1002],
                 max_chunks=4,
                 max_heap_extra=np.dtype(np.int64).itemsize,
-                place=request.param,
+                direct_placement=direct_placement,
+                **request.param,
             ),
             data_ring,
             free_ring,
@@ -442,7 +491,19 @@ class TestChunkRingStream:
 
     @pytest.mark.parametrize(
         "recv_stream, extra",
-        [(place_plain_llc, False), (place_extra_llc, True)],
+        [
+            ({"place": place_plain_llc}, False),
+            ({"place": place_extra_llc}, True),
+            ({"place_batch": place_batch_plain_llc}, False),
+            (
+                {
+                    "place_affine": recv.ChunkPlaceAffine(
+                        timestamps_per_chunk=HEAPS_PER_CHUNK, heap_size=HEAP_PAYLOAD_SIZE
+                    )
+                },
+                False,
+            ),
+        ],
         indirect=["recv_stream"],
     )
     def test_basic(self, send_stream, recv_stream, item_group, extra):
@@ -504,7 +565,7 @@ class TestChunkRingStream:
         assert recv_stream.stats["too_old_heaps"] == 1
         assert recv_stream.stats["rejected_heaps"] == 2  # Descriptors and stop heap
 
-    @pytest.mark.parametrize("recv_stream", [place_extra_llc], indirect=True)
+    @pytest.mark.parametrize("recv_stream", [{"place": place_extra_llc}], indirect=True)
     def test_extra(self, send_stream, recv_stream, item_group):
         """Test writing extra data about each heap."""
         n_heaps = 103
@@ -981,3 +981,80 @@ class TestUdpIbvConfig:
         )
         with pytest.raises(ValueError, match="interface address"):
             send.UdpIbvStream(spead2.ThreadPool(), config, udp_ibv_config)
+
+
+@pytest.mark.skipif(not hasattr(spead2, "XdpMode"), reason="AF_XDP support not compiled in")
+class TestUdpXdpConfig:
+    def test_default_construct(self):
+        config = send.UdpXdpConfig()
+        assert config.endpoints == []
+        assert config.interface_address == ""
+        assert config.buffer_size == send.UdpXdpConfig.DEFAULT_BUFFER_SIZE
+        assert config.ttl == 1
+        assert config.queue_id == 0
+        assert config.mode == spead2.XdpMode.AUTO
+        assert config.max_poll == send.UdpXdpConfig.DEFAULT_MAX_POLL
+
+    def test_kwargs_construct(self):
+        config = send.UdpXdpConfig(
+            endpoints=[("hello", 1234), ("goodbye", 2345)],
+            interface_address="1.2.3.4",
+            buffer_size=100,
+            ttl=2,
+            queue_id=3,
+            mode=spead2.XdpMode.COPY,
+            max_poll=1000,
+        )
+        assert config.endpoints == [("hello", 1234), ("goodbye", 2345)]
+        assert config.interface_address == "1.2.3.4"
+        assert config.buffer_size == 100
+        assert config.ttl == 2
+        assert config.queue_id == 3
+        assert config.mode == spead2.XdpMode.COPY
+        assert config.max_poll == 1000
+
+    def test_default_buffer_size(self):
+        config = send.UdpXdpConfig()
+        config.buffer_size = 0
+        assert config.buffer_size == send.UdpXdpConfig.DEFAULT_BUFFER_SIZE
+
+    def test_bad_max_poll(self):
+        config = send.UdpXdpConfig()
+        with pytest.raises(ValueError):
+            config.max_poll = 0
+
+    def test_no_endpoints(self):
+        config = send.StreamConfig()
+        udp_xdp_config = send.UdpXdpConfig(interface_address="10.0.0.1")
+        with pytest.raises(ValueError, match="endpoints is empty"):
+            send.UdpXdpStream(spead2.ThreadPool(), config, udp_xdp_config)
+
+    def test_unicast_endpoints(self, unused_udp_port):
+        config = send.StreamConfig()
+        udp_xdp_config = send.UdpXdpConfig(
+            endpoints=[("10.0.0.1", unused_udp_port)], interface_address="10.0.0.1"
+        )
+        with pytest.raises(ValueError, match="endpoint is not an IPv4 multicast address"):
+            send.UdpXdpStream(spead2.ThreadPool(), config, udp_xdp_config)
+
+    def test_no_interface_address(self, unused_udp_port):
+        config = send.StreamConfig()
+        udp_xdp_config = send.UdpXdpConfig(endpoints=[("239.255.88.88", unused_udp_port)])
+        with pytest.raises(ValueError, match="interface address"):
+            send.UdpXdpStream(spead2.ThreadPool(), config, udp_xdp_config)
+
+    def test_ipv6_interface_address(self, unused_udp_port):
+        config = send.StreamConfig()
+        udp_xdp_config = send.UdpXdpConfig(
+            endpoints=[("239.255.88.88", unused_udp_port)], interface_address="::1"
+        )
+        with pytest.raises(ValueError, match="interface address"):
+            send.UdpXdpStream(spead2.ThreadPool(), config, udp_xdp_config)
+
+    def test_packet_too_large(self, unused_udp_port):
+        config = send.StreamConfig(max_packet_size=8972)
+        udp_xdp_config = send.UdpXdpConfig(
+            endpoints=[("239.255.88.88", unused_udp_port)], interface_address="10.0.0.1"
+        )
+        with pytest.raises(ValueError, match="max_packet_size is too large"):
+            send.UdpXdpStream(spead2.ThreadPool(), config, udp_xdp_config)